@@ -9,6 +9,8 @@
  *        다양한 형식의 책(예: ZIP, 폴더 등)에서 공통적으로 사용하는 함수들을 제공합니다.
  */
 
+#define PROBE_HEAD_SIZE (64 * 1024) ///< 쪽 크기를 알아볼 때 읽는 앞부분 크기
+
  /**
   * @brief 페이지 엔트리(PageEntry) 메모리 해제 함수
   *        GPtrArray의 free_func로 사용됩니다.
@@ -27,6 +29,13 @@ void page_data_free(PageData* data)
 {
 	if (data->anim_timer)
 		g_source_remove(data->anim_timer);
+	if (data->refine_cancel)
+	{
+		// 끝 콜백이 해제한 자료를 만지지 않게
+		g_cancellable_cancel(data->refine_cancel);
+		g_object_unref(data->refine_cancel);
+	}
+	tiled_image_free(data->tiled);
 	if (data->buffer)
 		g_bytes_unref(data->buffer);
 	if (data->texture)
@@ -51,6 +60,9 @@ void book_base_init(Book* book, const char* filename)
 	book->full_name = g_strdup(filename);
 	book->base_name = g_path_get_basename(filename);
 	book->dir_name = g_path_get_dirname(filename);
+
+	g_atomic_ref_count_init(&book->ref);
+	g_mutex_init(&book->lock);
 }
 
 /**
@@ -68,6 +80,7 @@ void book_base_dispose(Book* book)
 		g_free(book->base_name);
 	if (book->dir_name)
 		g_free(book->dir_name);
+	g_mutex_clear(&book->lock);
 	g_free(book);
 }
 
@@ -130,34 +143,176 @@ const PageEntry* book_get_entry(Book* book, int page)
 }
 
 /**
- * @brief 지정한 페이지의 데이터를 준비합니다. (그림을 만들지는 않음)
+ * @brief 쪽 그림 크기를 적어둡니다. 처음 알게 된 쪽이면 book->probed를 늘립니다.
+ *        폭을 먼저 쓰고 높이를 나중에 쓰므로, 높이가 0이 아니면 폭도 맞습니다.
+ * @param book Book 객체 포인터
+ * @param entry 페이지 엔트리
+ * @param info 그림 정보
+ */
+static void page_entry_set_size(Book* book, PageEntry* entry, const ImageInfo* info)
+{
+	if (info->width <= 0 || info->height <= 0)
+		return;
+	g_atomic_int_set(&entry->width, info->width);
+	if (g_atomic_int_compare_and_exchange(&entry->height, 0, info->height))
+		g_atomic_int_inc(&book->probed);
+}
+
+/**
+ * @brief 쪽 파일을 읽고 그림 정보를 알아봅니다. 스레드에서 불러도 됩니다.
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @param buffer 처리할 수 있는 그림이면 읽은 데이터를 받음, 아니면 NULL
+ * @param info 그림 정보를 받음
+ * @return 읽었으면 true, 읽기에 실패하면 false
+ */
+bool book_read_image(Book* book, int page, GBytes** buffer, ImageInfo* info)
+{
+	*buffer = NULL;
+	memset(info, 0, sizeof(ImageInfo));
+	PageEntry* entry = page >= 0 && page < (int)book->entries->len ? g_ptr_array_index(book->entries, page) : NULL;
+	if (!entry)
+		return false; // 페이지 엔트리가 없음
+
+	GBytes* data = book_read_data(book, page);
+	if (!data)
+		return false; // 데이터 읽기 실패
+
+	if (doumi_detect_image_info(data, info))
+	{
+		// 처리할 수 있는 그림이면
+		*buffer = data;
+		page_entry_set_size(book, entry, info);
+
+		// 타일로 풀 그림은 통째로 풀지 않으니 올라온 타일만큼만 센다
+		if (tiled_image_wanted(info))
+			info->size = 0;
+	}
+	else
+	{
+		g_bytes_unref(data);
+		memset(info, 0, sizeof(ImageInfo));
+	}
+	return true;
+}
+
+/**
+ * @brief 파일을 읽지 않고 빈 쪽 자료를 만듭니다. 읽는 것은 book_read_image로 따로 합니다.
  * @param book Book 객체 포인터
  * @param page 페이지 번호
  * @return PageData 포인터(존재하지 않으면 NULL)
  */
-PageData* book_prepare_page(Book* book, const int page)
+PageData* book_new_page(Book* book, const int page)
 {
 	const PageEntry* entry = book_get_entry(book, page);
 	if (!entry)
 		return NULL; // 페이지 엔트리가 없음
 
-	GBytes* buffer = book_read_data(book, page);
-	if (!buffer)
-		return NULL; // 데이터 읽기 실패
-
 	PageData* data = g_new0(PageData, 1);
 	data->entry = entry;
+	data->unread = true;
+	return data;
+}
 
-	if (doumi_detect_image_info(buffer, &data->info))
+/**
+ * @brief 지정한 페이지의 데이터를 준비합니다. (그림을 만들지는 않음)
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @return PageData 포인터(존재하지 않으면 NULL)
+ */
+PageData* book_prepare_page(Book* book, const int page)
+{
+	PageData* data = book_new_page(book, page);
+	if (!data)
+		return NULL;
+
+	if (!book_read_image(book, page, &data->buffer, &data->info))
 	{
-		// 처리할 수 있는 그림이면
-		data->buffer = g_bytes_ref(buffer); // GBytes 참조 횟수 증가
+		g_free(data);
+		return NULL; // 데이터 읽기 실패
 	}
-
-	g_bytes_unref(buffer); // GBytes 해제
+	data->unread = false;
 	return data; // 준비된 페이지 데이터 반환
 }
 
+/**
+ * @brief 쪽 크기 알아보기 스레드 함수
+ *        start부터 끝까지, 그 다음 처음부터 start 앞까지 차례로 앞부분만 읽어서 헤더를 봅니다.
+ *        앞부분에 헤더가 없으면(JPEG의 큰 EXIF 등) 쪽을 통째로 읽습니다.
+ * @param user_data Book 포인터
+ * @return NULL
+ */
+static gpointer thread_probe_sizes(gpointer user_data)
+{
+	Book* book = user_data;
+	const int total = (int)book->entries->len;
+	const int start = CLAMP(book->probe_start, 0, MAX(total - 1, 0));
+
+	for (int n = 0; n < total && !g_atomic_int_get(&book->probe_stop); n++)
+	{
+		const int page = (start + n) % total;
+		PageEntry* entry = g_ptr_array_index(book->entries, page);
+		if (g_atomic_int_get(&entry->height) != 0)
+			continue; // 이미 읽어서 안다
+
+		ImageInfo info;
+		GBytes* head = book_read_head(book, page, PROBE_HEAD_SIZE);
+		bool ok = head != NULL && doumi_detect_image_info(head, &info);
+		if (head != NULL)
+			g_bytes_unref(head);
+		if (!ok && entry->size > PROBE_HEAD_SIZE && !g_atomic_int_get(&book->probe_stop))
+		{
+			GBytes* data = book_read_data(book, page);
+			ok = data != NULL && doumi_detect_image_info(data, &info);
+			if (data != NULL)
+				g_bytes_unref(data);
+		}
+		if (ok)
+			page_entry_set_size(book, entry, &info);
+	}
+
+	g_atomic_int_set(&book->probing, false);
+	return NULL;
+}
+
+// 쪽 크기 알아보기 시작
+void book_probe_sizes(Book* book, int start)
+{
+	if (book->probe_thread != NULL)
+		return;
+	if (g_atomic_int_get(&book->probed) >= book->total_page)
+		return;
+
+	book->probe_start = start;
+	g_atomic_int_set(&book->probe_stop, false);
+	g_atomic_int_set(&book->probing, true);
+	book->probe_thread = g_thread_new("book-probe", thread_probe_sizes, book);
+}
+
+// 쪽 크기 알아보기 멈춤
+void book_stop_probe(Book* book)
+{
+	if (book->probe_thread == NULL)
+		return;
+	g_atomic_int_set(&book->probe_stop, true);
+	g_thread_join(book->probe_thread);
+	book->probe_thread = NULL;
+}
+
+// 쪽 크기 얻기
+bool book_get_page_size(Book* book, int page, int* width, int* height)
+{
+	if (page < 0 || page >= (int)book->entries->len)
+		return false;
+	PageEntry* entry = g_ptr_array_index(book->entries, page);
+	const int h = g_atomic_int_get(&entry->height);
+	if (h == 0)
+		return false;
+	*width = g_atomic_int_get(&entry->width);
+	*height = h;
+	return true;
+}
+
 /**
  * @note
  * - Book 구조체는 다양한 형식의 책(ZIP, 폴더 등)에 공통적으로 사용됩니다.
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "defs.h"
+#include "comicinfo.h"
+#include "tiled.h"
 
 /**
  * @file book.h
@@ -22,6 +24,10 @@ typedef struct PageEntry
 	time_t date;		///< 파일 최종 수정 날짜
 	int64_t size;		///< 페이지 크기(바이트)
 	int64_t comp;		///< 압축된 크기(0은 압축 안함)
+	PageType type;		///< 쪽 종류 (ComicInfo.xml, 없으면 이야기)
+	bool spread;		///< 두쪽 펼침 그림 (ComicInfo.xml의 DoublePage)
+	int width;			///< 그림 폭 (0은 아직 모름, book_get_page_size로 읽을 것)
+	int height;			///< 그림 높이 (0은 아직 모름)
 } PageEntry;
 
 // 쪽 자료
@@ -29,6 +35,7 @@ typedef struct PageData
 {
 	const PageEntry* entry; // 페이지 엔트리 정보
 	ImageInfo info; // 이미지 정보
+	bool unread; // 아직 파일을 안 읽음 (book_new_page로 만든 쪽)
 	bool loaded; // 페이지가 로드되었는지 여부
 	bool async_loading; // 비동기 로딩 중인지 여부
 
@@ -37,6 +44,8 @@ typedef struct PageData
 	GdkPixbufAnimation* animation; // 애니메이션 페이지
 	GdkPixbufAnimationIter* anim_iter; // 애니메이션 반복자
 	guint anim_timer; // 애니메이션 타이머 ID (0이면 없음)
+	GCancellable* refine_cancel; // 미리보기를 보이며 고화질로 푸는 중이면 그 취소
+	TiledImage* tiled; // 아주 긴 그림이면 타일 그림 (texture 대신)
 } PageData;
 
 /**
@@ -56,6 +65,8 @@ typedef struct BookFunc
 	void (*dispose)(Book*);                        ///< 책 해제
 
 	GBytes* (*read_data)(Book*, int page);         ///< 페이지 데이터 읽기
+	GBytes* (*read_head)(Book*, int page, size_t size); ///< 페이지 앞부분만 읽기 (NULL이면 read_data로)
+	void (*suspend)(Book*);                        ///< 파일 핸들 놓기, 다음에 읽을 때 다시 엶 (NULL이면 안 놓음)
 
 	bool (*can_delete)(Book*);                     ///< 삭제 가능 여부 확인
 	bool (*delete)(Book*);                         ///< 책 파일 삭제
@@ -82,6 +93,15 @@ struct Book
 
 	int cur_page;          ///< 현재 페이지
 	int total_page;        ///< 전체 페이지 수
+
+	gatomicrefcount ref;   ///< 참조 수 (썸네일 작업이 잡고 있는 동안 살려 둠)
+	GMutex lock;           ///< 파일 접근 잠금 (썸네일 스레드와 같이 읽음)
+
+	GThread* probe_thread; ///< 쪽 크기 알아보기 스레드
+	int probe_start;       ///< 먼저 알아볼 쪽 (스레드를 만들기 전에 정함)
+	gint probe_stop;       ///< 쪽 크기 알아보기 그만 (atomic)
+	gint probing;          ///< 쪽 크기를 알아보는 중 (atomic)
+	gint probed;           ///< 크기를 아는 쪽 수 (atomic)
 };
 
 /**
@@ -138,10 +158,71 @@ extern const PageEntry* book_get_entry(Book* book, int page);
 extern PageData* book_prepare_page(Book* book, const int page);
 
 /**
- * @brief Book 객체를 해제합니다. (inline)
+ * @brief 파일을 읽지 않고 빈 쪽 자료를 만듭니다. 읽는 것은 book_read_image로 따로 합니다.
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @return PageData 포인터(존재하지 않으면 NULL)
+ */
+extern PageData* book_new_page(Book* book, const int page);
+
+/**
+ * @brief 쪽 파일을 읽고 그림 정보를 알아봅니다. 스레드에서 불러도 됩니다.
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @param buffer 처리할 수 있는 그림이면 읽은 데이터를 받음, 아니면 NULL
+ * @param info 그림 정보를 받음
+ * @return 읽었으면 true, 읽기에 실패하면 false
+ */
+extern bool book_read_image(Book* book, int page, GBytes** buffer, ImageInfo* info);
+
+/**
+ * @brief 쪽 그림 크기를 스레드에서 알아보기 시작합니다. 이미 하고 있으면 아무것도 안 합니다.
+ *        쪽 앞부분만 읽어서 헤더로 알아내며, 알아낸 만큼 book->probed가 늘어납니다.
+ * @param book Book 객체 포인터
+ * @param start 먼저 알아볼 쪽 번호 (여기부터 끝까지, 그 다음에 처음부터)
+ */
+extern void book_probe_sizes(Book* book, int start);
+
+/**
+ * @brief 쪽 그림 크기 알아보기를 멈추고 스레드가 끝나길 기다립니다.
+ * @param book Book 객체 포인터
+ */
+extern void book_stop_probe(Book* book);
+
+/**
+ * @brief 쪽 그림 크기를 얻습니다. 스레드에서 불러도 됩니다.
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @param width 폭을 받을 곳
+ * @param height 높이를 받을 곳
+ * @return 크기를 알면 true, 아직 모르면 false
+ */
+extern bool book_get_page_size(Book* book, int page, int* width, int* height);
+
+/**
+ * @brief Book 객체의 참조를 늘립니다. (inline)
+ *        놓을 때는 book_dispose를 부릅니다.
  * @param book Book 객체 포인터
+ * @return 같은 Book 객체 포인터
  */
-static inline void book_dispose(Book* book) { book->func.dispose(book); }
+static inline Book* book_ref(Book* book)
+{
+	g_atomic_ref_count_inc(&book->ref);
+	return book;
+}
+
+/**
+ * @brief Book 객체의 참조를 놓고, 마지막이면 해제합니다. (inline)
+ *        쪽 크기 알아보기 스레드가 파일을 읽고 있을 수 있으니 먼저 멈춥니다.
+ * @param book Book 객체 포인터
+ */
+static inline void book_dispose(Book* book)
+{
+	if (!g_atomic_ref_count_dec(&book->ref))
+		return;
+	book_stop_probe(book);
+	book->func.dispose(book);
+}
 
 /**
  * @brief 지정한 페이지의 데이터를 읽어옵니다. (inline)
@@ -149,7 +230,44 @@ static inline void book_dispose(Book* book) { book->func.dispose(book); }
  * @param page 페이지 번호
  * @return GBytes 포인터
  */
-static inline GBytes* book_read_data(Book* book, int page) { return book->func.read_data(book, page); }
+static inline GBytes* book_read_data(Book* book, int page)
+{
+	g_mutex_lock(&book->lock);
+	GBytes* data = book->func.read_data(book, page);
+	g_mutex_unlock(&book->lock);
+	return data;
+}
+
+/**
+ * @brief 지정한 페이지의 앞부분만 읽어옵니다. (inline)
+ *        그림 헤더만 볼 때 씁니다. 책 형식이 지원하지 않으면 통째로 읽습니다.
+ * @param book Book 객체 포인터
+ * @param page 페이지 번호
+ * @param size 읽을 크기 (바이트), 쪽이 더 작으면 쪽 크기만큼
+ * @return GBytes 포인터
+ */
+static inline GBytes* book_read_head(Book* book, int page, size_t size)
+{
+	g_mutex_lock(&book->lock);
+	GBytes* data = book->func.read_head ? book->func.read_head(book, page, size) : book->func.read_data(book, page);
+	g_mutex_unlock(&book->lock);
+	return data;
+}
+
+/**
+ * @brief 책 파일 핸들을 놓습니다. (inline)
+ *        닫은 책을 캐시에 둘 때 불러서, 윈도우에서도 파일을 지우거나 옮길 수 있게 합니다.
+ *        다음에 쪽을 읽을 때 다시 열며, 그 사이 파일이 바뀌었으면 읽지 않습니다.
+ * @param book Book 객체 포인터
+ */
+static inline void book_suspend(Book* book)
+{
+	if (book->func.suspend == NULL)
+		return;
+	g_mutex_lock(&book->lock);
+	book->func.suspend(book);
+	g_mutex_unlock(&book->lock);
+}
 
 /**
  * @brief 책 파일이 삭제 가능한지 확인합니다. (inline)
@@ -163,7 +281,13 @@ static inline bool book_can_delete(Book* book) { return book->func.can_delete(bo
  * @param book Book 객체 포인터
  * @return 성공 시 true
  */
-static inline bool book_delete(Book* book) { return book->func.delete(book); }
+static inline bool book_delete(Book* book)
+{
+	g_mutex_lock(&book->lock);
+	const bool ret = book->func.delete(book);
+	g_mutex_unlock(&book->lock);
+	return ret;
+}
 
 /**
  * @brief 책 파일을 이동합니다. (inline)
@@ -171,7 +295,13 @@ static inline bool book_delete(Book* book) { return book->func.delete(book); }
  * @param move_filename 이동할 파일명(전체 경로)
  * @return 성공 시 true
  */
-static inline bool book_move(Book* book, const char* move_filename) { return book->func.move(book, move_filename); }
+static inline bool book_move(Book* book, const char* move_filename)
+{
+	g_mutex_lock(&book->lock);
+	const bool ret = book->func.move(book, move_filename);
+	g_mutex_unlock(&book->lock);
+	return ret;
+}
 
 /**
  * @brief 책 파일의 이름을 변경합니다. (inline)
@@ -179,7 +309,13 @@ static inline bool book_move(Book* book, const char* move_filename) { return boo
  * @param new_filename 새 파일명
  * @return 새 경로 문자열(호출자가 해제 필요), 실패 시 NULL
  */
-static inline gchar* book_rename(Book* book, const char* new_filename) { return book->func.rename(book, new_filename); }
+static inline gchar* book_rename(Book* book, const char* new_filename)
+{
+	g_mutex_lock(&book->lock);
+	gchar* ret = book->func.rename(book, new_filename);
+	g_mutex_unlock(&book->lock);
+	return ret;
+}
 
 /**
  * @brief ZIP 파일로부터 Book 객체를 생성합니다.
@@ -187,3 +323,11 @@ static inline gchar* book_rename(Book* book, const char* new_filename) { return
  * @return 생성된 Book 객체 포인터, 실패 시 NULL
  */
 extern Book* book_zip_new(const char* zip_path);
+
+/**
+ * @brief ZIP 파일을 책으로 열지 않고 쪽 수를 세고 ComicInfo.xml을 읽습니다. 스레드에서 불러도 됩니다.
+ * @param zip_path ZIP 파일 경로
+ * @param info ComicInfo를 받을 곳 (NULL이면 안 읽음, 없으면 NULL이 들어감, comicinfo_free로 해제)
+ * @return 쪽 수, 열 수 없으면 -1
+ */
+extern int book_zip_count_pages(const char* zip_path, ComicInfo** info);
@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 #include "configs.h"
 #include "book.h"
+#include "bufpool.h"
 #include "doumi.h"
 
 /**
@@ -15,12 +16,16 @@
 typedef struct BookZip
 {
 	Book base;    ///< Book 구조체를 상속하여 기본 정보 및 함수 테이블 포함
-	zip_t* zip;   ///< ZIP 파일 핸들
+	zip_t* zip;   ///< ZIP 파일 핸들 (놓았으면 NULL)
+	gint64 size;  ///< 핸들을 놓을 때 파일 크기
+	gint64 mtime; ///< 핸들을 놓을 때 파일 수정 시각 (0이면 다시 열지 않음)
 } BookZip;
 
 // 내부 함수 선언
 static void bz_dispose(Book* book);
 static GBytes* bz_read_data(Book* book, int page);
+static GBytes* bz_read_head(Book* book, int page, size_t size);
+static void bz_suspend(Book* book);
 static bool bz_can_delete(Book* book);
 static bool bz_delete(Book* book);
 static bool bz_move(Book* book, const char* move_filename);
@@ -34,6 +39,8 @@ static BookFunc bz_func =
 {
 	.dispose = bz_dispose,
 	.read_data = bz_read_data,
+	.read_head = bz_read_head,
+	.suspend = bz_suspend,
 	.can_delete = bz_can_delete,
 	.delete = bz_delete,
 	.move = bz_move,
@@ -65,6 +72,7 @@ Book* book_zip_new(const char* zip_path)
 
 	book_base_init((Book*)bz, zip_path);
 
+	zip_int64_t info_index = -1;
 	const zip_int64_t count = zip_get_num_entries(zip, 0);
 	for (zip_int64_t i = 0; i < count; i++)
 	{
@@ -74,7 +82,11 @@ Book* book_zip_new(const char* zip_path)
 		if (s.encryption_method != ZIP_EM_NONE)
 			continue; // 암호화된 항목은 지원하지 않음
 		if (!doumi_is_image_file(s.name))
+		{
+			if (info_index < 0 && comicinfo_is_name(s.name))
+				info_index = i; // 쪽 종류를 읽으려고 기억
 			continue; // 이미지 파일이 아님
+		}
 
 		// 페이지 엔트리(PageEntry) 생성 및 추가
 		PageEntry* e = g_new0(PageEntry, 1);
@@ -87,12 +99,67 @@ Book* book_zip_new(const char* zip_path)
 		g_ptr_array_add(bz->base.entries, e);
 	}
 
+	// ComicInfo.xml이 있으면 쪽 종류와 펼침 쪽을 넣어둔다 (두쪽 보기에서 그림을 열지 않고 앎)
+	if (info_index >= 0)
+	{
+		ComicInfo* info = comicinfo_read_zip(zip, info_index);
+		if (info != NULL)
+		{
+			for (guint i = 0; i < info->pages->len; i++)
+			{
+				const ComicPage* cp = &g_array_index(info->pages, ComicPage, i);
+				if (cp->image < 0 || cp->image >= (int)bz->base.entries->len)
+					continue;
+				PageEntry* e = g_ptr_array_index(bz->base.entries, cp->image);
+				e->type = cp->type;
+				e->spread = cp->spread;
+			}
+			comicinfo_free(info);
+		}
+	}
+
 	bz->zip = zip;
 	bz->base.total_page = (int)count - 1;
 
 	return (Book*)bz;
 }
 
+/**
+ * @brief ZIP 파일을 책으로 열지 않고 이미지 항목 수를 세고 ComicInfo.xml을 읽습니다.
+ *        서재 색인처럼 많은 파일을 훑을 때 PageEntry를 만들지 않으려고 씁니다.
+ * @param zip_path ZIP 파일 경로
+ * @param info ComicInfo를 받을 곳 (NULL이면 안 읽음)
+ * @return 쪽 수, 열 수 없으면 -1
+ */
+int book_zip_count_pages(const char* zip_path, ComicInfo** info)
+{
+	if (info != NULL)
+		*info = NULL;
+
+	int err = 0;
+	zip_t* zip = zip_open(zip_path, ZIP_RDONLY, &err);
+	if (zip == NULL)
+		return -1; // 복사 중이거나 깨진 파일, 책을 열 때처럼 오류로 끝내지 않음
+
+	int pages = 0;
+	zip_int64_t info_index = -1;
+	const zip_int64_t count = zip_get_num_entries(zip, 0);
+	for (zip_int64_t i = 0; i < count; i++)
+	{
+		zip_stat_t s;
+		if (zip_stat_index(zip, i, 0, &s) < 0 || s.encryption_method != ZIP_EM_NONE)
+			continue;
+		if (doumi_is_image_file(s.name))
+			pages++;
+		else if (info_index < 0 && comicinfo_is_name(s.name))
+			info_index = i;
+	}
+	if (info != NULL && info_index >= 0)
+		*info = comicinfo_read_zip(zip, info_index);
+	zip_discard(zip);
+	return pages;
+}
+
 /**
  * @brief BookZip 객체를 해제합니다.
  *        ZIP 파일 핸들을 닫고, Book의 기본 해제 함수도 호출합니다.
@@ -106,6 +173,48 @@ static void bz_dispose(Book* book)
 	book_base_dispose(book);
 }
 
+/**
+ * @brief ZIP 파일 핸들을 놓습니다. 파일 크기와 수정 시각을 기억해 두고 다시 열 때 비교합니다.
+ * @param book Book 객체 포인터
+ */
+static void bz_suspend(Book* book)
+{
+	BookZip* bz = (BookZip*)book;
+	if (bz->zip == NULL)
+		return;
+
+	GStatBuf st;
+	if (g_stat(book->full_name, &st) == 0)
+	{
+		bz->size = (gint64)st.st_size;
+		bz->mtime = (gint64)st.st_mtime;
+	}
+	zip_close(bz->zip);
+	bz->zip = NULL;
+}
+
+/**
+ * @brief 놓아둔 ZIP 파일 핸들을 다시 엽니다. 놓은 뒤에 파일이 바뀌었으면 열지 않습니다.
+ * @param bz BookZip 객체 포인터
+ * @return 핸들이 있으면 true
+ */
+static bool bz_ensure_zip(BookZip* bz)
+{
+	if (bz->zip != NULL)
+		return true;
+	if (bz->mtime == 0)
+		return false; // 지우거나 옮겨서 닫았음
+
+	// 쪽 목록은 놓을 때의 파일 그대로라 파일이 바뀌었으면 못 읽는다
+	GStatBuf st;
+	if (g_stat(bz->base.full_name, &st) != 0 || (gint64)st.st_size != bz->size || (gint64)st.st_mtime != bz->mtime)
+		return false;
+
+	int err = 0;
+	bz->zip = zip_open(bz->base.full_name, ZIP_RDONLY, &err);
+	return bz->zip != NULL;
+}
+
 /**
  * @brief 지정한 페이지의 데이터를 읽어 GBytes로 반환합니다.
  * @param book Book 객체 포인터
@@ -123,27 +232,67 @@ static GBytes* bz_read_data(Book* book, int page)
 	if (entry == NULL || page != entry->page)
 		return NULL; // 페이지 항목이 없거나 페이지 번호가 일치하지 않음
 
+	if (!bz_ensure_zip(bz))
+		return NULL; // 지우거나 옮겼거나, 놓아둔 사이 파일이 바뀜
+
 	zip_file_t* zf = zip_fopen_index(bz->zip, entry->manage, 0);
 	if (zf == NULL)
 		return NULL; // ZIP파일에서 항목 열기 실패
 
-	gpointer buf = g_malloc(entry->size);
+	// 쪽마다 몇 MB씩이라 버퍼 풀에서 얻는다
+	gpointer buf;
+	GBytes* ret = bufpool_bytes_new(entry->size, &buf);
 	zip_int64_t n = zip_fread(zf, buf, entry->size);
 
-	GBytes* ret = NULL;
 	if (n != entry->size)
-		g_free(buf); // 읽기 실패시 버퍼 해제
-	else
 	{
-		ret = g_bytes_new_take(buf, entry->size); // GBytes로 변환
-		if (ret == NULL)
-			g_log("BOOK-ZIP", G_LOG_LEVEL_ERROR, _("Failed to create page %d"), page);
+		g_bytes_unref(ret); // 읽기 실패시 버퍼 해제
+		ret = NULL;
 	}
 
 	zip_fclose(zf);
 	return ret;
 }
 
+/**
+ * @brief 지정한 페이지의 앞부분만 읽어 GBytes로 반환합니다.
+ *        압축된 항목도 읽은 만큼만 풀기 때문에 그림 헤더를 볼 때 쪽을 통째로 풀지 않습니다.
+ * @param book Book 객체 포인터
+ * @param page 읽을 페이지 번호
+ * @param size 읽을 크기 (바이트)
+ * @return 페이지 앞부분(GBytes), 실패 시 NULL
+ */
+static GBytes* bz_read_head(Book* book, int page, size_t size)
+{
+	BookZip* bz = (BookZip*)book;
+
+	if (page < 0 || page >= book->total_page)
+		return NULL; // 페이지 범위 벗어남
+
+	const PageEntry* entry = g_ptr_array_index(book->entries, page);
+	if (entry == NULL || page != entry->page)
+		return NULL; // 페이지 항목이 없거나 페이지 번호가 일치하지 않음
+
+	const size_t want = MIN(size, (size_t)entry->size);
+	if (want == 0 || !bz_ensure_zip(bz))
+		return NULL;
+
+	zip_file_t* zf = zip_fopen_index(bz->zip, entry->manage, 0);
+	if (zf == NULL)
+		return NULL; // ZIP파일에서 항목 열기 실패
+
+	guint8* buf = g_malloc(want);
+	const zip_int64_t n = zip_fread(zf, buf, want);
+	zip_fclose(zf);
+
+	if (n <= 0)
+	{
+		g_free(buf);
+		return NULL;
+	}
+	return g_bytes_new_take(buf, (gsize)n);
+}
+
 /**
  * @brief 파일이 삭제 가능한지 확인합니다.
  *        (읽기 전용이 아닌 경우에만 삭제 가능)
@@ -170,6 +319,7 @@ static bool bz_delete(Book* book)
 		zip_close(bz->zip);
 		bz->zip = NULL;
 	}
+	bz->mtime = 0;
 
 	GFile* file = g_file_new_for_path(book->full_name);
 	const bool res = g_file_trash(file, NULL, NULL);
@@ -203,6 +353,7 @@ static bool bz_common_move(BookZip* bz, const char* src_path, const char* dst_pa
 		zip_close(bz->zip);
 		bz->zip = NULL;
 	}
+	bz->mtime = 0;
 
 	GFile* src = g_file_new_for_path(src_path);
 	GFile* dst = g_file_new_for_path(dst_path);
@@ -261,5 +412,6 @@ static gchar* bz_rename(Book* book, const char* new_filename)
  * - BookZip 구조체는 Book을 상속하여 다형성을 제공합니다.
  * - ZIP 파일 내 이미지 파일만 페이지로 인식합니다.
  * - 파일 이동/삭제/이름 변경 시 ZIP 핸들을 반드시 닫아야 합니다.
+ * - 닫은 책 캐시에 들어가면 ZIP 핸들을 놓고(bz_suspend), 다시 읽을 때 파일이 그대로면 엽니다.
  * - 함수 테이블(bz_func)을 통해 Book 인터페이스와 연동됩니다.
  */
@@ -0,0 +1,164 @@
+﻿#include "pch.h"
+#include "bufpool.h"
+
+/**
+ * @file bufpool.c
+ * @brief 큰 버퍼를 크기별로 다시 쓰는 버퍼 풀 구현 파일입니다.
+ *        크기는 2의 거듭제곱 사이를 4등분한 단계로 올려서 할당하므로, 크기가 조금씩 다른 쪽끼리도 버퍼를 나눠 씁니다.
+ */
+
+#define BUFPOOL_MIN_SIZE (256 * 1024)          // 이보다 작으면 풀을 거치지 않음
+#define BUFPOOL_MAX_BLOCKS 16                   // 가지고 있을 최대 버퍼 수
+#define BUFPOOL_DEFAULT_LIMIT (64 * 1024 * 1024) // 한도를 정하기 전까지의 크기
+
+/**
+ * @brief 버퍼 블럭, 데이터 바로 앞에 붙는다
+ */
+typedef struct BufBlock
+{
+	gsize capacity;            ///< 데이터 크기, 0이면 풀을 거치지 않은 작은 버퍼
+	gsize reserved;            ///< 데이터를 16바이트에 맞추려고
+} BufBlock;
+
+/**
+ * @brief 버퍼 풀
+ */
+static struct BufPool
+{
+	GMutex lock;               ///< 아래 모두 보호
+	GQueue blocks;             ///< 놓인 버퍼, 최근에 놓인 것부터 (BufBlock*)
+	gsize size;                ///< 놓인 버퍼 크기 합
+	gsize limit;               ///< 놓인 버퍼 크기 한도
+	bool limit_set;            ///< 한도를 정했나
+} bufpool;
+
+/**
+ * @brief 할당할 크기를 정합니다. 2의 거듭제곱 사이를 4등분한 단계로 올립니다.
+ * @param size 요청 크기
+ * @return 할당 크기
+ */
+static gsize round_capacity(gsize size)
+{
+	gsize octave = BUFPOOL_MIN_SIZE;
+	while (octave * 2 <= size)
+		octave *= 2;
+	const gsize step = octave / 4;
+	return (size + step - 1) / step * step;
+}
+
+/**
+ * @brief 놓인 버퍼가 한도 안에 들도록 오래된 것부터 해제합니다. 잠근 상태로 부를 것
+ */
+static void shrink_locked(void)
+{
+	const gsize limit = bufpool.limit_set ? bufpool.limit : BUFPOOL_DEFAULT_LIMIT;
+	while (!g_queue_is_empty(&bufpool.blocks) &&
+		(bufpool.size > limit || g_queue_get_length(&bufpool.blocks) > BUFPOOL_MAX_BLOCKS))
+	{
+		BufBlock* block = g_queue_pop_tail(&bufpool.blocks);
+		bufpool.size -= block->capacity;
+		g_free(block);
+	}
+}
+
+/**
+ * @brief GBytes 해제 함수. 큰 버퍼는 풀로 돌려보냅니다.
+ * @param data BufBlock 포인터
+ */
+static void release_block(gpointer data)
+{
+	BufBlock* block = data;
+	if (block->capacity == 0)
+	{
+		g_free(block);
+		return;
+	}
+
+	g_mutex_lock(&bufpool.lock);
+	g_queue_push_head(&bufpool.blocks, block);
+	bufpool.size += block->capacity;
+	shrink_locked();
+	g_mutex_unlock(&bufpool.lock);
+}
+
+/**
+ * @brief 풀에서 맞는 버퍼를 꺼냅니다. 요청 크기 이상, 두 배 미만 중에 가장 작은 것
+ * @param size 요청 크기
+ * @return BufBlock 포인터, 없으면 NULL
+ */
+static BufBlock* take_block(gsize size)
+{
+	g_mutex_lock(&bufpool.lock);
+	GList* best = NULL;
+	for (GList* l = bufpool.blocks.head; l; l = l->next)
+	{
+		const BufBlock* block = l->data;
+		if (block->capacity >= size && block->capacity / 2 < size &&
+			(best == NULL || block->capacity < ((BufBlock*)best->data)->capacity))
+			best = l;
+	}
+	BufBlock* block = NULL;
+	if (best != NULL)
+	{
+		block = best->data;
+		g_queue_delete_link(&bufpool.blocks, best);
+		bufpool.size -= block->capacity;
+	}
+	g_mutex_unlock(&bufpool.lock);
+	return block;
+}
+
+// 풀에서 버퍼 얻기
+GBytes* bufpool_bytes_new(gsize size, gpointer* data)
+{
+	BufBlock* block;
+	if (size < BUFPOOL_MIN_SIZE)
+	{
+		block = g_malloc(sizeof(BufBlock) + size);
+		block->capacity = 0;
+	}
+	else
+	{
+		block = take_block(size);
+		if (block == NULL)
+		{
+			const gsize capacity = round_capacity(size);
+			block = g_malloc(sizeof(BufBlock) + capacity);
+			block->capacity = capacity;
+		}
+	}
+
+	gpointer ptr = block + 1;
+	if (data)
+		*data = ptr;
+	return g_bytes_new_with_free_func(ptr, size, release_block, block);
+}
+
+// 한도 정하기
+void bufpool_set_limit(gsize limit)
+{
+	g_mutex_lock(&bufpool.lock);
+	bufpool.limit = limit;
+	bufpool.limit_set = true;
+	shrink_locked();
+	g_mutex_unlock(&bufpool.lock);
+}
+
+// 놓인 버퍼 크기
+gsize bufpool_get_size(void)
+{
+	g_mutex_lock(&bufpool.lock);
+	const gsize size = bufpool.size;
+	g_mutex_unlock(&bufpool.lock);
+	return size;
+}
+
+// 모두 해제
+void bufpool_clear(void)
+{
+	g_mutex_lock(&bufpool.lock);
+	while (!g_queue_is_empty(&bufpool.blocks))
+		g_free(g_queue_pop_head(&bufpool.blocks));
+	bufpool.size = 0;
+	g_mutex_unlock(&bufpool.lock);
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+/**
+ * @file bufpool.h
+ * @brief 큰 버퍼(압축된 쪽, 풀어둔 쪽)를 크기별로 다시 쓰는 버퍼 풀을 정의하는 헤더 파일입니다.
+ *        쪽을 넘길 때마다 수십 MB를 할당하고 해제하면 glibc는 mmap/munmap을 오가므로
+ *        놓인 버퍼를 가지고 있다가 비슷한 크기를 찾을 때 돌려줍니다.
+ *        모든 함수는 스레드에서 불러도 됩니다.
+ */
+
+/**
+ * @brief 풀에서 버퍼를 얻어 GBytes로 싸서 돌려줍니다. GBytes가 해제되면 버퍼는 풀로 돌아갑니다.
+ *        작은 버퍼는 풀을 거치지 않고 그냥 할당합니다.
+ * @param size 버퍼 크기
+ * @param data 버퍼 포인터를 받을 곳, 남에게 넘기기 전까지만 써 넣을 것
+ * @return GBytes 포인터
+ */
+extern GBytes* bufpool_bytes_new(gsize size, gpointer* data);
+
+/**
+ * @brief 풀이 쓰지 않고 가지고 있을 수 있는 크기를 정합니다. 넘치는 버퍼는 바로 해제합니다.
+ * @param limit 최대 크기(바이트), 0이면 가지고 있지 않음
+ */
+extern void bufpool_set_limit(gsize limit);
+
+/**
+ * @brief 풀이 쓰지 않고 가지고 있는 크기를 얻습니다.
+ * @return 크기(바이트)
+ */
+extern gsize bufpool_get_size(void);
+
+/**
+ * @brief 풀이 가지고 있는 버퍼를 모두 해제합니다.
+ */
+extern void bufpool_clear(void);
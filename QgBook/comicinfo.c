@@ -0,0 +1,265 @@
+﻿#include "pch.h"
+#include "comicinfo.h"
+
+/**
+ * @file comicinfo.c
+ * @brief ComicInfo.xml 해석 구현 파일입니다.
+ *        GMarkupParseContext에 ZIP에서 읽은 조각을 바로 넣으므로 파일 전체를 메모리에 올리지 않습니다.
+ */
+
+#define COMICINFO_MAX_SIZE (1024 * 1024)
+#define COMICINFO_CHUNK_SIZE 4096
+
+/**
+ * @brief 해석 상태
+ */
+typedef struct ComicInfoParser
+{
+	ComicInfo* info;           ///< 결과
+	GString* text;             ///< 지금 요소의 글자
+	int depth;                 ///< 요소 깊이 (ComicInfo가 1)
+	bool in_root;              ///< ComicInfo 안
+	bool in_pages;             ///< Pages 안
+	bool has_data;             ///< 하나라도 읽었음
+} ComicInfoParser;
+
+/**
+ * @brief Page의 Type 문자열을 PageType으로 바꿉니다.
+ * @param s Type 문자열
+ * @return PageType
+ */
+static PageType comicinfo_parse_page_type(const char* s)
+{
+	static const struct { const char* name; PageType type; } types[] =
+	{
+		{ "Story", PAGE_TYPE_STORY },
+		{ "FrontCover", PAGE_TYPE_FRONT_COVER },
+		{ "InnerCover", PAGE_TYPE_INNER_COVER },
+		{ "Roundup", PAGE_TYPE_ROUNDUP },
+		{ "Advertisement", PAGE_TYPE_ADVERTISEMENT },
+		{ "Editorial", PAGE_TYPE_EDITORIAL },
+		{ "Letters", PAGE_TYPE_LETTERS },
+		{ "Preview", PAGE_TYPE_PREVIEW },
+		{ "BackCover", PAGE_TYPE_BACK_COVER },
+		{ "Other", PAGE_TYPE_OTHER },
+		{ "Deleted", PAGE_TYPE_DELETED },
+	};
+	for (size_t i = 0; i < G_N_ELEMENTS(types); i++)
+	{
+		if (g_ascii_strcasecmp(s, types[i].name) == 0)
+			return types[i].type;
+	}
+	return PAGE_TYPE_STORY;
+}
+
+/**
+ * @brief 문자열 필드를 바꿉니다.
+ * @param dst 필드
+ * @param value 새 값
+ */
+static void comicinfo_set_str(char** dst, const char* value)
+{
+	g_free(*dst);
+	*dst = g_strdup(value);
+}
+
+/**
+ * @brief 태그 문자열에 덧붙입니다.
+ * @param tags 지금 태그 (해제됨)
+ * @param more 덧붙일 태그
+ * @return 새 태그 문자열
+ */
+static char* comicinfo_append_tags(char* tags, const char* more)
+{
+	if (tags == NULL)
+		return g_strdup(more);
+	char* ret = g_strconcat(tags, ", ", more, NULL);
+	g_free(tags);
+	return ret;
+}
+
+/**
+ * @brief GMarkupParser: 요소 시작
+ */
+static void parser_start_element(GMarkupParseContext* context, const gchar* element_name,
+	const gchar** attribute_names, const gchar** attribute_values, gpointer user_data, GError** error)
+{
+	ComicInfoParser* p = user_data;
+	p->depth++;
+	g_string_truncate(p->text, 0);
+
+	if (p->depth == 1)
+		p->in_root = g_ascii_strcasecmp(element_name, "ComicInfo") == 0;
+	else if (p->in_root && p->depth == 2)
+		p->in_pages = g_ascii_strcasecmp(element_name, "Pages") == 0;
+	else if (p->in_pages && p->depth == 3 && g_ascii_strcasecmp(element_name, "Page") == 0)
+	{
+		ComicPage page = { .image = -1, .type = PAGE_TYPE_STORY, .spread = false };
+		for (int i = 0; attribute_names[i] != NULL; i++)
+		{
+			const char* name = attribute_names[i];
+			const char* value = attribute_values[i];
+			if (g_ascii_strcasecmp(name, "Image") == 0)
+				page.image = (int)g_ascii_strtoll(value, NULL, 10);
+			else if (g_ascii_strcasecmp(name, "Type") == 0)
+				page.type = comicinfo_parse_page_type(value);
+			else if (g_ascii_strcasecmp(name, "DoublePage") == 0)
+				page.spread = g_ascii_strcasecmp(value, "true") == 0;
+		}
+		if (page.image >= 0)
+		{
+			g_array_append_val(p->info->pages, page);
+			p->has_data = true;
+		}
+	}
+}
+
+/**
+ * @brief GMarkupParser: 요소 끝
+ */
+static void parser_end_element(GMarkupParseContext* context, const gchar* element_name, gpointer user_data, GError** error)
+{
+	ComicInfoParser* p = user_data;
+	if (p->in_root && p->depth == 2 && !p->in_pages)
+	{
+		char* value = g_strstrip(p->text->str);
+		ComicInfo* info = p->info;
+		if (*value != '\0')
+		{
+			p->has_data = true;
+			if (g_ascii_strcasecmp(element_name, "Series") == 0)
+				comicinfo_set_str(&info->series, value);
+			else if (g_ascii_strcasecmp(element_name, "Title") == 0)
+				comicinfo_set_str(&info->title, value);
+			else if (g_ascii_strcasecmp(element_name, "Number") == 0)
+				comicinfo_set_str(&info->number, value);
+			else if (g_ascii_strcasecmp(element_name, "Volume") == 0)
+				info->volume = (int)g_ascii_strtoll(value, NULL, 10);
+			else if (g_ascii_strcasecmp(element_name, "Writer") == 0)
+				comicinfo_set_str(&info->writer, value);
+			else if (g_ascii_strcasecmp(element_name, "Genre") == 0 || g_ascii_strcasecmp(element_name, "Tags") == 0)
+				info->tags = comicinfo_append_tags(info->tags, value);
+		}
+	}
+	if (p->depth == 2)
+		p->in_pages = false;
+	p->depth--;
+	g_string_truncate(p->text, 0);
+}
+
+/**
+ * @brief GMarkupParser: 글자, 바로 아래 요소의 글자만 모읍니다.
+ */
+static void parser_text(GMarkupParseContext* context, const gchar* text, gsize text_len, gpointer user_data, GError** error)
+{
+	ComicInfoParser* p = user_data;
+	if (p->in_root && p->depth == 2 && !p->in_pages)
+		g_string_append_len(p->text, text, (gssize)text_len);
+}
+
+// ComicInfo.xml 이름 확인
+bool comicinfo_is_name(const char* name)
+{
+	if (name == NULL)
+		return false;
+	const char* base = strrchr(name, '/');
+	base = base ? base + 1 : name;
+	return g_ascii_strcasecmp(base, "ComicInfo.xml") == 0;
+}
+
+// ZIP에서 ComicInfo.xml 읽기
+ComicInfo* comicinfo_read_zip(zip_t* zip, zip_int64_t index)
+{
+	g_return_val_if_fail(zip != NULL && index >= 0, NULL);
+
+	zip_file_t* zf = zip_fopen_index(zip, (zip_uint64_t)index, 0);
+	if (zf == NULL)
+		return NULL;
+
+	static const GMarkupParser parser =
+	{
+		.start_element = parser_start_element,
+		.end_element = parser_end_element,
+		.text = parser_text,
+	};
+	ComicInfoParser p =
+	{
+		.info = g_new0(ComicInfo, 1),
+		.text = g_string_new(NULL),
+	};
+	p.info->volume = -1;
+	p.info->pages = g_array_new(false, false, sizeof(ComicPage));
+	GMarkupParseContext* context = g_markup_parse_context_new(&parser, G_MARKUP_IGNORE_QUALIFIED, &p, NULL);
+
+	char buf[COMICINFO_CHUNK_SIZE];
+	zip_int64_t total = 0;
+	bool ok = true;
+	GError* error = NULL;
+	for (;;)
+	{
+		const zip_int64_t n = zip_fread(zf, buf, sizeof(buf));
+		if (n <= 0)
+			break;
+		const char* data = buf;
+		gssize len = (gssize)n;
+		if (total == 0 && len >= 3 && memcmp(data, "\xEF\xBB\xBF", 3) == 0)
+		{
+			// GMarkup은 BOM을 모름
+			data += 3;
+			len -= 3;
+		}
+		total += n;
+		if (total > COMICINFO_MAX_SIZE || !g_markup_parse_context_parse(context, data, len, &error))
+		{
+			ok = false;
+			break;
+		}
+	}
+	if (ok)
+		ok = g_markup_parse_context_end_parse(context, &error);
+	if (!ok && error != NULL)
+	{
+		// 앞에서 읽은 것은 그대로 씀
+		g_log("COMICINFO", G_LOG_LEVEL_DEBUG, "%s", error->message);
+		g_clear_error(&error);
+	}
+
+	g_markup_parse_context_free(context);
+	g_string_free(p.text, true);
+	zip_fclose(zf);
+
+	if (!p.has_data)
+	{
+		comicinfo_free(p.info);
+		return NULL;
+	}
+	return p.info;
+}
+
+// ComicInfo 해제
+void comicinfo_free(ComicInfo* info)
+{
+	if (info == NULL)
+		return;
+	g_free(info->series);
+	g_free(info->title);
+	g_free(info->number);
+	g_free(info->writer);
+	g_free(info->tags);
+	g_array_free(info->pages, true);
+	g_free(info);
+}
+
+// 표지 쪽 번호
+int comicinfo_get_cover(const ComicInfo* info)
+{
+	if (info == NULL)
+		return 0;
+	for (guint i = 0; i < info->pages->len; i++)
+	{
+		const ComicPage* page = &g_array_index(info->pages, ComicPage, i);
+		if (page->type == PAGE_TYPE_FRONT_COVER)
+			return page->image;
+	}
+	return 0;
+}
@@ -0,0 +1,60 @@
+﻿#pragma once
+
+#include "defs.h"
+
+/**
+ * @file comicinfo.h
+ * @brief 책 안의 ComicInfo.xml(시리즈, 제목, 작가, 쪽 종류 등)을 읽는 함수를 정의하는 헤더 파일입니다.
+ */
+
+/**
+ * @brief ComicInfo.xml의 쪽 정보 (Pages/Page)
+ */
+typedef struct ComicPage
+{
+	int image;                 ///< 이미지 순서 (0부터)
+	PageType type;             ///< 쪽 종류
+	bool spread;               ///< 두쪽 펼침 (DoublePage)
+} ComicPage;
+
+/**
+ * @brief ComicInfo.xml 내용
+ */
+typedef struct ComicInfo
+{
+	char* series;              ///< 시리즈
+	char* title;               ///< 제목
+	char* number;              ///< 권 번호 (문자열, "1.5" 같은 것도 있음)
+	int volume;                ///< 볼륨 (없으면 -1)
+	char* writer;              ///< 작가
+	char* tags;                ///< 장르와 태그 (쉼표로 구분)
+	GArray* pages;             ///< 쪽 정보 (GArray<ComicPage>)
+} ComicInfo;
+
+/**
+ * @brief 항목 이름이 ComicInfo.xml인지 확인합니다. (폴더 안에 있어도 됨, 대소문자 무시)
+ * @param name 항목 이름
+ * @return ComicInfo.xml이면 true
+ */
+extern bool comicinfo_is_name(const char* name);
+
+/**
+ * @brief ZIP 항목에서 ComicInfo.xml을 조금씩 읽으며 해석합니다. 스레드에서 불러도 됩니다.
+ * @param zip ZIP 핸들
+ * @param index 항목 번호
+ * @return ComicInfo 포인터 (읽을 것이 없으면 NULL, comicinfo_free로 해제)
+ */
+extern ComicInfo* comicinfo_read_zip(zip_t* zip, zip_int64_t index);
+
+/**
+ * @brief ComicInfo를 해제합니다.
+ * @param info ComicInfo 포인터
+ */
+extern void comicinfo_free(ComicInfo* info);
+
+/**
+ * @brief 표지 쪽 번호를 얻습니다.
+ * @param info ComicInfo 포인터
+ * @return FrontCover 쪽 번호, 없으면 0
+ */
+extern int comicinfo_get_cover(const ComicInfo* info);
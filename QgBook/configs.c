@@ -2,6 +2,7 @@
 #include <time.h>
 #include "configs.h"
 #include "doumi.h"
+#include "library.h"
 
 /**
  * @file configs.c
@@ -9,13 +10,29 @@
  *        다양한 환경설정 및 관련 데이터베이스 연동을 담당하는 구현 파일입니다.
  */
 
+#define MEMORY_CHECK_INTERVAL (5 * G_USEC_PER_SEC)     // 메모리 감시가 없을 때 남은 메모리를 다시 읽는 간격
+#define MEMORY_RELAX_TIME (60 * G_USEC_PER_SEC)        // 메모리 부족 경고가 이만큼 없으면 풀어 줌
+#define MEMORY_BUDGET_MIN (64ULL * 1024 * 1024)        // 자동 캐시 크기 최소
+#define MEMORY_BUDGET_MAX (4096ULL * 1024 * 1024)      // 자동 캐시 크기 최대
+#define MEMORY_BUDGET_FALLBACK (230ULL * 1024 * 1024)  // 남은 메모리를 모를 때
+
  // 외부 변수 선언
 extern ConfigDefinition config_defs[CONFIG_MAX_VALUE];
 extern ShortcutDefinition shortcut_defs[];
 
+/**
+ * @brief 설정 바뀜 알림 항목 구조체
+ */
+typedef struct ConfigNotify
+{
+	guint id;                  ///< 알림 번호 (0은 안 씀)
+	ConfigNotifyFunc func;     ///< 콜백
+	gpointer user_data;        ///< 콜백 사용자 데이터
+} ConfigNotify;
+
 /**
  * @brief 전역 설정 자료 구조체
- *        실행 시간, 경로, 언어, 단축키, 캐시, 이동 위치, 근처 파일 등 관리
+ *        실행 시간, 경로, 언어, 단축키, 이동 위치, 알림 등 관리
  */
 static struct Configs
 {
@@ -26,8 +43,19 @@ static struct Configs
 
 	GHashTable* lang;          ///< 언어 문자열 해시
 	GHashTable* shortcut;      ///< 단축키 해시
-	GHashTable* cache;         ///< 설정 캐시 해시
+	guint shortcut_idle;       ///< 단축키 DB 읽기 아이들 번호
 	GPtrArray* moves;          ///< 책 이동 위치 배열
+	bool moves_loaded;         ///< 이동 위치를 DB에서 읽었나
+
+	GArray* notifies;          ///< 설정 바뀜 알림 배열(GArray<ConfigNotify>)
+	guint notify_id;           ///< 마지막 알림 번호
+
+	GMemoryMonitor* memory_monitor; ///< 메모리 부족 경고 감시
+	guint memory_idle;         ///< 메모리 감시 시작 아이들 번호
+	int memory_level;          ///< 마지막 메모리 부족 경고 수준 (GMemoryMonitorWarningLevel, 0은 없음)
+	gint64 memory_warned;      ///< 마지막 경고 시각 (monotonic)
+	gint64 memory_checked;     ///< 마지막으로 캐시 크기를 계산한 시각 (monotonic, 0이면 다시 계산)
+	size_t memory_budget;      ///< 계산한 캐시 크기(바이트)
 } cfgs =
 {
 	.app_path = NULL,
@@ -35,59 +63,97 @@ static struct Configs
 };
 
 /**
- * @brief 설정 캐시 아이템 구조체
- *        다양한 타입의 값을 저장할 수 있도록 union 사용
+ * @brief 설정 캐시 배열
+ *        ConfigKeys를 인덱스로 바로 읽으므로 해시 계산이 없습니다.
  */
-typedef struct ConfigCacheItem
-{
-	union
-	{
-		gint32 n;   ///< 정수형
-		gint64 l;   ///< 긴 정수형
-		bool b;     ///< 불린형
-		double d;   ///< 실수형
-		char* s;    ///< 문자열
-	};
-
-	CacheType type; ///< 값의 타입
-} ConfigCacheItem;
+ConfigCacheItem config_cache[CONFIG_MAX_VALUE];
 
 /**
- * @brief 캐시 아이템 메모리 해제 함수
- * @param ptr ConfigCacheItem 포인터
+ * @brief 캐시 아이템의 문자열을 해제합니다.
+ * @param item ConfigCacheItem 포인터
  */
-static void cache_item_free(gpointer ptr)
+static void cache_item_clear(ConfigCacheItem* item)
 {
-	ConfigCacheItem* item = ptr;
-	g_return_if_fail(item != NULL);
 	if (item->type == CACHE_TYPE_STRING && item->s)
 		g_free(item->s);
-	g_free(item);
+	memset(item, 0, sizeof(ConfigCacheItem));
 }
 
 /**
  * @brief 캐시에서 아이템을 얻어옵니다.
  * @param key 설정 키
- * @return ConfigCacheItem 포인터(없으면 NULL)
+ * @return ConfigCacheItem 포인터(읽은 적이 없으면 NULL)
  */
 static ConfigCacheItem* cache_get_item(const ConfigKeys key)
 {
-	const struct ConfigDefinition* def = &config_defs[key];
-	return g_hash_table_lookup(cfgs.cache, def->name);
+	ConfigCacheItem* item = &config_cache[key];
+	return item->type == CACHE_TYPE_UNKNOWN ? NULL : item;
 }
 
 /**
- * @brief 캐시에 아이템을 복제하여 저장합니다.
+ * @brief 설정이 바뀌었음을 알립니다. 등록한 콜백을 부릅니다.
  * @param key 설정 키
- * @param item 저장할 값
  */
-static void cache_set_item(const ConfigKeys key, const ConfigCacheItem* item)
+static void cache_notify_changed(const ConfigKeys key)
 {
-	ConfigCacheItem* new_item = g_new(ConfigCacheItem, 1);
-	memcpy(new_item, item, sizeof(ConfigCacheItem));
+	if (key == CONFIG_GENERAL_MAX_PAGE_CACHE)
+		cfgs.memory_checked = 0; // 캐시 크기를 다시 계산
+
+	if (cfgs.notifies == NULL)
+		return;
+	for (guint i = 0; i < cfgs.notifies->len; i++)
+	{
+		const ConfigNotify* n = &g_array_index(cfgs.notifies, ConfigNotify, i);
+		n->func(key, n->user_data);
+	}
+}
 
+/**
+ * @brief 캐시에 아이템을 저장합니다. 문자열은 소유권을 가져갑니다.
+ *        값이 달라졌을 때만 알림을 보냅니다.
+ * @param key 설정 키
+ * @param item 저장할 값 (타입은 정의를 따름)
+ */
+static void cache_set_item(const ConfigKeys key, const ConfigCacheItem* item)
+{
 	const struct ConfigDefinition* def = &config_defs[key];
-	g_hash_table_insert(cfgs.cache, g_strdup(def->name), new_item);
+	ConfigCacheItem* dest = &config_cache[key];
+
+	bool changed;
+	if (dest->type == CACHE_TYPE_UNKNOWN)
+		changed = true;
+	else
+	{
+		switch (def->type)
+		{
+			case CACHE_TYPE_INT:
+				changed = dest->n != item->n;
+				break;
+			case CACHE_TYPE_LONG:
+				changed = dest->l != item->l;
+				break;
+			case CACHE_TYPE_BOOL:
+				changed = dest->b != item->b;
+				break;
+			case CACHE_TYPE_DOUBLE:
+				changed = dest->d != item->d;
+				break;
+			case CACHE_TYPE_STRING:
+				changed = g_strcmp0(dest->s, item->s) != 0;
+				break;
+			case CACHE_TYPE_UNKNOWN:
+			default:
+				changed = false;
+				break;
+		}
+	}
+
+	cache_item_clear(dest);
+	memcpy(dest, item, sizeof(ConfigCacheItem));
+	dest->type = def->type;
+
+	if (changed)
+		cache_notify_changed(key);
 }
 
 /**
@@ -100,7 +166,7 @@ static void cache_set_item(const ConfigKeys key, const ConfigCacheItem* item)
 static const char* cache_auto_get_item(const ConfigKeys key, char* value, const size_t value_size)
 {
 	const struct ConfigDefinition* def = &config_defs[key];
-	const ConfigCacheItem* item = g_hash_table_lookup(cfgs.cache, def->name);
+	const ConfigCacheItem* item = cache_get_item(key);
 	g_return_val_if_fail(item != NULL, NULL);
 
 	switch (def->type)
@@ -134,32 +200,30 @@ static const char* cache_auto_get_item(const ConfigKeys key, char* value, const
 static void cache_auto_set_item(const ConfigKeys key, const char* value)
 {
 	const struct ConfigDefinition* def = &config_defs[key];
-	ConfigCacheItem* item = g_new0(ConfigCacheItem, 1);
+	ConfigCacheItem item = { .type = def->type };
 
 	switch (def->type)
 	{
 		case CACHE_TYPE_INT:
-			item->n = (gint32)g_ascii_strtoll(value, NULL, 10);
+			item.n = (gint32)g_ascii_strtoll(value, NULL, 10);
 			break;
 		case CACHE_TYPE_LONG:
-			item->l = g_ascii_strtoll(value, NULL, 10);
+			item.l = g_ascii_strtoll(value, NULL, 10);
 			break;
 		case CACHE_TYPE_BOOL:
-			item->b = doumi_atob(value);
+			item.b = doumi_atob(value);
 			break;
 		case CACHE_TYPE_DOUBLE:
-			item->d = g_ascii_strtod(value, NULL);
+			item.d = g_ascii_strtod(value, NULL);
 			break;
 		case CACHE_TYPE_STRING:
-			item->s = g_strdup(value);
+			item.s = g_strdup(value);
 			break;
 		case CACHE_TYPE_UNKNOWN:
-			g_free(item);
 			return;
 	}
 
-	item->type = def->type;
-	g_hash_table_insert(cfgs.cache, g_strdup(def->name), item);
+	cache_set_item(key, &item);
 }
 
 /**
@@ -250,6 +314,51 @@ static bool sql_select_config(sqlite3* db, const ConfigKeys key)
 	return true;
 }
 
+/**
+ * @brief DB에서 모든 설정 값을 한번에 읽어 캐시에 저장합니다.
+ *        DB에 없는 설정은 기본값으로 채웁니다.
+ * @param db sqlite3 포인터
+ * @return 성공 시 true
+ */
+static bool sql_select_all_configs(sqlite3* db)
+{
+	bool loaded[CONFIG_MAX_VALUE] = { false, };
+
+	sqlite3_stmt* stmt;
+	const char* sql = "SELECT key, value FROM configs;";
+	const bool ret = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK;
+	if (!ret)
+		sql_error(db, false);
+	else
+	{
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			const char* name = (const char*)sqlite3_column_text(stmt, 0);
+			const char* value = (const char*)sqlite3_column_text(stmt, 1);
+			if (name == NULL || value == NULL)
+				continue;
+			for (int i = CONFIG_NONE + 1; i < CONFIG_MAX_VALUE; i++)
+			{
+				if (g_strcmp0(config_defs[i].name, name) == 0)
+				{
+					cache_auto_set_item((ConfigKeys)i, value);
+					loaded[i] = true;
+					break;
+				}
+			}
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	for (int i = CONFIG_NONE + 1; i < CONFIG_MAX_VALUE; i++)
+	{
+		if (!loaded[i])
+			cache_auto_set_item((ConfigKeys)i, config_defs[i].value);
+	}
+
+	return ret;
+}
+
 /**
  * @brief DB에 설정 값을 저장합니다.
  * @param db sqlite3 포인터
@@ -291,6 +400,8 @@ static bool sql_into_config_value(sqlite3* db, const ConfigKeys key, const char*
  */
 static bool sql_into_config(sqlite3* db, const ConfigKeys key)
 {
+	if (cache_get_item(key) == NULL)
+		return false; // 읽은 적 없는 값으로 DB를 덮어쓰지 않게 (두번째 실행 등)
 	char sz[128];
 	const char* psz = cache_auto_get_item(key, sz, sizeof(sz));
 	return sql_into_config_value(db, key, psz ? psz : config_defs[key].value);
@@ -409,6 +520,184 @@ static void parse_language_hash_table_data(GHashTable* lht, const char* data)
 	}
 }
 
+/**
+ * @brief 언어 파일을 읽습니다.
+ *        창을 만들 때 바로 문자열을 찾으므로 스레드로 돌려도 곧바로 기다리게 되어 그냥 읽습니다.
+ * @param locale 로케일 문자열 (두 글자)
+ * @return 언어 문자열 해시
+ */
+static GHashTable* load_language(const char* locale)
+{
+	GHashTable* lht = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	char* text = doumi_load_resource_text(doumi_resource_path_format("lang/%s.txt", locale), NULL);
+	if (text != NULL)
+	{
+		parse_language_hash_table_data(lht, text);
+		g_free(text);
+	}
+
+	return lht;
+}
+
+/**
+ * @brief 테이블에 열이 있는지 확인합니다.
+ * @param db sqlite3 포인터
+ * @param table 테이블 이름
+ * @param column 열 이름
+ * @param has_column 열이 있는지 받을 곳
+ * @return 테이블이 있으면 true
+ */
+static bool sql_table_has_column(sqlite3* db, const char* table, const char* column, bool* has_column)
+{
+	bool exists = false;
+	*has_column = false;
+
+	char* sql = sqlite3_mprintf("PRAGMA table_info(%q);", table);
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK)
+	{
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			exists = true; // 없는 테이블이면 줄이 없다
+			if (g_strcmp0((const char*)sqlite3_column_text(stmt, 1), column) == 0)
+				*has_column = true;
+		}
+		sqlite3_finalize(stmt);
+	}
+	sqlite3_free(sql);
+	return exists;
+}
+
+/**
+ * @brief 스키마를 만듭니다. 이미 만든 DB면 user_version만 보고 건너뜁니다.
+ *        user_version을 쓰기 전의 DB는 0판으로 읽히므로 history 열을 보고 1판인지 가립니다.
+ * @param db sqlite3 포인터
+ * @return 성공 시 true
+ */
+static bool sql_prepare_schema(sqlite3* db)
+{
+	int version = 0;
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &stmt, NULL) == SQLITE_OK)
+	{
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			version = sqlite3_column_int(stmt, 0);
+		sqlite3_finalize(stmt);
+	}
+	if (version >= 3)
+		return true;
+
+	bool has_path;
+	if (version == 0 && sql_table_has_column(db, "history", "path", &has_path) && !has_path)
+	{
+		// 판 번호를 두기 전(1판)의 DB, history는 아래에서 고치고 없는 테이블만 만든다
+		if (!sql_exec_stmt(db,
+			"BEGIN;"
+			"CREATE TABLE IF NOT EXISTS configs (key TEXT PRIMARY KEY, value TEXT);"
+			"CREATE TABLE IF NOT EXISTS moves (no INTEGER PRIMARY KEY, alias TEXT, folder TEXT);"
+			"CREATE TABLE IF NOT EXISTS bookmarks (id INTEGER PRIMARY KEY AUTOINCREMENT, path TEXT, page INTEGER, created TEXT);"
+			"CREATE TABLE IF NOT EXISTS shortcuts (id INTEGER PRIMARY KEY AUTOINCREMENT, action TEXT, alias TEXT);"
+			"PRAGMA user_version = 1;"
+			"COMMIT;"))
+			return false;
+		version = 1;
+	}
+
+	if (version == 0)
+	{
+		// 한 트랜잭션으로 만들어야 디스크 동기화가 한번만 일어난다
+		return sql_exec_stmt(db,
+			"BEGIN;"
+			"CREATE TABLE IF NOT EXISTS configs (key TEXT PRIMARY KEY, value TEXT);"
+			"CREATE TABLE IF NOT EXISTS moves (no INTEGER PRIMARY KEY, alias TEXT, folder TEXT);"
+			"CREATE TABLE IF NOT EXISTS history (filename TEXT PRIMARY KEY, page INTEGER, updated TEXT, path TEXT, pages INTEGER DEFAULT 0, cover INTEGER DEFAULT 0);"
+			"CREATE INDEX IF NOT EXISTS history_updated ON history (updated);"
+			"CREATE TABLE IF NOT EXISTS bookmarks (id INTEGER PRIMARY KEY AUTOINCREMENT, path TEXT, page INTEGER, created TEXT);"
+			"CREATE TABLE IF NOT EXISTS shortcuts (id INTEGER PRIMARY KEY AUTOINCREMENT, action TEXT, alias TEXT);"
+			"CREATE TABLE IF NOT EXISTS queue (no INTEGER PRIMARY KEY, path TEXT);"
+			"PRAGMA user_version = 3;"
+			"COMMIT;");
+	}
+
+	// 1판에는 최근 목록에 보여줄 경로, 쪽 수, 표지가 없다
+	if (version < 2 && !sql_exec_stmt(db,
+		"BEGIN;"
+		"ALTER TABLE history ADD COLUMN path TEXT;"
+		"ALTER TABLE history ADD COLUMN pages INTEGER DEFAULT 0;"
+		"ALTER TABLE history ADD COLUMN cover INTEGER DEFAULT 0;"
+		"CREATE INDEX IF NOT EXISTS history_updated ON history (updated);"
+		"PRAGMA user_version = 2;"
+		"COMMIT;"))
+		return false;
+
+	// 2판에는 읽기 대기열이 없다
+	return sql_exec_stmt(db,
+		"BEGIN;"
+		"CREATE TABLE IF NOT EXISTS queue (no INTEGER PRIMARY KEY, path TEXT);"
+		"PRAGMA user_version = 3;"
+		"COMMIT;");
+}
+
+/**
+ * @brief 메모리 부족 경고를 받으면 캐시 크기를 다시 계산하게 하고 캐시 설정이 바뀐 것처럼 알립니다.
+ *        알림을 받은 쪽은 줄어든 크기에 맞춰 바로 캐시를 비웁니다.
+ */
+static void signal_low_memory_warning(GMemoryMonitor* monitor, GMemoryMonitorWarningLevel level, gpointer user_data)
+{
+	g_log("CONFIG", G_LOG_LEVEL_DEBUG, "low memory warning: %d", (int)level);
+	cfgs.memory_level = MAX(cfgs.memory_level, (int)level);
+	cfgs.memory_warned = g_get_monotonic_time();
+	cfgs.memory_checked = 0;
+	cache_notify_changed(CONFIG_GENERAL_MAX_PAGE_CACHE);
+}
+
+/**
+ * @brief 메모리 부족 경고 감시를 시작합니다.
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean idle_memory_monitor(gpointer user_data)
+{
+	cfgs.memory_idle = 0;
+	cfgs.memory_monitor = g_memory_monitor_dup_default();
+	if (cfgs.memory_monitor != NULL)
+	{
+		g_signal_connect(cfgs.memory_monitor, "low-memory-warning", G_CALLBACK(signal_low_memory_warning), NULL);
+		cfgs.memory_checked = 0; // 이제부터는 경고를 받을 때만 다시 계산
+	}
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 설정을 초기화하지 않고 불린 값 하나만 DB에서 읽습니다.
+ *        두번째 실행이 파일을 첫번째로 넘겨줄지 정할 때처럼 config_init 전에 씁니다.
+ * @param name 설정 키
+ * @return 불린 값, DB가 없거나 값이 없으면 기본값
+ */
+bool config_peek_bool(ConfigKeys name)
+{
+	const struct ConfigDefinition* def = &config_defs[name];
+	char* path = g_build_filename(g_get_user_config_dir(), "ksh", "QgBook.conf", NULL);
+	bool ret = doumi_atob(def->value);
+
+	sqlite3* db = NULL;
+	if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK)
+	{
+		sqlite3_stmt* stmt;
+		const char* sql = "SELECT value FROM configs WHERE key = ? LIMIT 1;";
+		if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) == SQLITE_OK)
+		{
+			sqlite3_bind_text(stmt, 1, def->name, -1, SQLITE_STATIC);
+			if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0) != NULL)
+				ret = doumi_atob((const char*)sqlite3_column_text(stmt, 0));
+			sqlite3_finalize(stmt);
+		}
+	}
+	sqlite3_close(db); // 열기에 실패해도 핸들은 닫아야 한다
+	g_free(path);
+	return ret;
+}
+
 /**
  * @brief 설정을 초기화합니다. (경로, 언어, 캐시, DB, 이동 위치 등)
  * @return 성공 시 true
@@ -424,8 +713,6 @@ bool config_init(void)
 	g_mkdir_with_parents(cfgs.app_path, 0755);
 
 	// 언어 초기화
-	cfgs.lang = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
-
 	const char* const* languages = g_get_language_names();
 	const char* locale = languages[0];
 	char short_locale[3] = "  ";
@@ -437,37 +724,30 @@ bool config_init(void)
 		locale = short_locale;
 	}
 
-	char* data = doumi_load_resource_text(doumi_resource_path_format("lang/%s.txt", locale), NULL);
-	if (data != NULL)
-	{
-		parse_language_hash_table_data(cfgs.lang, data);
-		g_free(data);
-	}
+	cfgs.lang = load_language(locale);
 
-	// 캐시
-	cfgs.cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, cache_item_free);
+	// 캐시 알림
+	cfgs.notifies = g_array_new(false, false, sizeof(ConfigNotify));
+
+	// 메모리 감시는 D-Bus를 탈 수 있으니 첫 화면이 나온 다음에
+	cfgs.memory_idle = g_idle_add_full(G_PRIORITY_LOW, idle_memory_monitor, NULL, NULL);
 
 	// 데이터베이스를 열고, 테이블이 없으면 만듭니다.
 	sqlite3* db = sql_open();
 	g_return_val_if_fail(db != NULL, false);
 
-	if (!sql_exec_stmt(db, "CREATE TABLE IF NOT EXISTS configs (key TEXT PRIMARY KEY, value TEXT);") ||
-		!sql_exec_stmt(db, "CREATE TABLE IF NOT EXISTS moves (no INTEGER PRIMARY KEY, alias TEXT, folder TEXT);") ||
-		!sql_exec_stmt(db, "CREATE TABLE IF NOT EXISTS history (filename TEXT PRIMARY KEY, page INTEGER, updated TEXT);") ||
-		!sql_exec_stmt(db, "CREATE TABLE IF NOT EXISTS bookmarks (id INTEGER PRIMARY KEY AUTOINCREMENT, path TEXT, page INTEGER, created TEXT);") ||
-		!sql_exec_stmt(db, "CREATE TABLE IF NOT EXISTS shortcuts (id INTEGER PRIMARY KEY AUTOINCREMENT, action TEXT, alias TEXT);"))
+	if (!sql_prepare_schema(db))
 	{
 		sqlite3_close(db);
 		return false;
 	}
 
-	// 실행 횟수 업데이트
+	// 실행 횟수 업데이트, 저장은 끝날 때 한다 (시작할 때 디스크 쓰기를 안하려고)
 	if (sql_select_config(db, CONFIG_RUN_COUNT))
 	{
-		const ConfigCacheItem* item = cache_get_item(CONFIG_RUN_COUNT);
-		char sz[64];
-		g_snprintf(sz, sizeof(sz), "%lld", item->l + 1);
-		sql_into_config_value(db, CONFIG_RUN_COUNT, sz);
+		ConfigCacheItem* run_count = cache_get_item(CONFIG_RUN_COUNT);
+		if (run_count != NULL)
+			run_count->l++;
 	}
 
 	// 다른 캐시 이전에 가져올 데이터
@@ -495,19 +775,31 @@ void config_dispose(void)
 	{
 		const time_t now = time(NULL);
 		ConfigCacheItem* run_duration = cache_get_item(CONFIG_RUN_DURATION);
-		run_duration->d += difftime(now, cfgs.launched);
+		if (run_duration != NULL)
+			run_duration->d += difftime(now, cfgs.launched);
 
+		sql_exec_stmt(db, "BEGIN;");
 		sql_into_config(db, CONFIG_WINDOW_WIDTH);
 		sql_into_config(db, CONFIG_WINDOW_HEIGHT);
+		sql_into_config(db, CONFIG_RUN_COUNT);
 		sql_into_config(db, CONFIG_RUN_DURATION);
+		sql_exec_stmt(db, "COMMIT;");
 
 		sqlite3_close(db);
 	}
 
+	if (cfgs.shortcut_idle)
+		g_source_remove(cfgs.shortcut_idle);
+	if (cfgs.memory_idle)
+		g_source_remove(cfgs.memory_idle);
+	g_clear_object(&cfgs.memory_monitor);
+
 	if (cfgs.moves)
 		g_ptr_array_free(cfgs.moves, true);
-	if (cfgs.cache)
-		g_hash_table_destroy(cfgs.cache);
+	for (int i = 0; i < CONFIG_MAX_VALUE; i++)
+		cache_item_clear(&config_cache[i]);
+	if (cfgs.notifies)
+		g_array_free(cfgs.notifies, true);
 	if (cfgs.shortcut)
 		g_hash_table_destroy(cfgs.shortcut);
 	if (cfgs.lang)
@@ -527,33 +819,40 @@ void config_load_cache(void)
 	sqlite3* db = sql_open();
 	g_return_if_fail(db != NULL);
 
-	// 캐시
-#ifdef _WIN32
-	sql_select_config(db, CONFIG_WINDOW_X);
-	sql_select_config(db, CONFIG_WINDOW_Y);
-#endif
-	sql_select_config(db, CONFIG_WINDOW_WIDTH);
-	sql_select_config(db, CONFIG_WINDOW_HEIGHT);
+	// 키 마다 SELECT 하지 않고 한번에 읽는다
+	// 실행 횟수나 시간처럼 init에서 이미 읽어서 바꾼 값은 덮어쓰지 않게 잠깐 보관
+	// 캐시에 항목이 없으면 보관하지도 되돌리지도 않는다
+	const ConfigCacheItem* item = cache_get_item(CONFIG_RUN_COUNT);
+	const bool has_count = item != NULL;
+	const gint64 run_count = has_count ? item->l : 0;
+	item = cache_get_item(CONFIG_RUN_DURATION);
+	const bool has_duration = item != NULL;
+	const double run_duration = has_duration ? item->d : 0.0;
+	sql_select_all_configs(db);
+	ConfigCacheItem* dest = cache_get_item(CONFIG_RUN_COUNT);
+	if (has_count && dest != NULL)
+		dest->l = run_count;
+	dest = cache_get_item(CONFIG_RUN_DURATION);
+	if (has_duration && dest != NULL)
+		dest->d = run_duration;
+
+	// 이동 디렉토리는 처음 쓸 때 읽는다 (movloc_ensure_loaded)
 
-	sql_select_config(db, CONFIG_GENERAL_ESC_EXIT);
-	sql_select_config(db, CONFIG_GENERAL_CONFIRM_DELETE);
-	sql_select_config(db, CONFIG_GENERAL_MAX_PAGE_CACHE);
-	sql_select_config(db, CONFIG_GENERAL_EXTERNAL_RUN);
-	sql_select_config(db, CONFIG_GENERAL_RELOAD_AFTER_EXTERNAL);
-
-	sql_select_config(db, CONFIG_MOUSE_DOUBLE_CLICK_FULLSCREEN);
-	sql_select_config(db, CONFIG_MOUSE_CLICK_PAGING);
+	sqlite3_close(db);
+}
 
-	sql_select_config(db, CONFIG_VIEW_ZOOM);
-	sql_select_config(db, CONFIG_VIEW_MODE);
-	sql_select_config(db, CONFIG_VIEW_QUALITY);
-	sql_select_config(db, CONFIG_VIEW_MARGIN);
+/**
+ * @brief 책 이동 위치를 DB에서 읽습니다. 처음 한번만 읽습니다.
+ */
+static void movloc_ensure_loaded(void)
+{
+	if (cfgs.moves_loaded)
+		return;
+	cfgs.moves_loaded = true;
 
-	sql_select_config(db, CONFIG_SECURITY_USE_PASS);
-	sql_select_config(db, CONFIG_SECURITY_PASS_CODE);
-	sql_select_config(db, CONFIG_SECURITY_PASS_USAGE);
+	sqlite3* db = sql_open();
+	g_return_if_fail(db != NULL);
 
-	// 이동 디렉토리
 	sqlite3_stmt* stmt;
 	const char* sql = "SELECT no, alias, folder FROM moves ORDER BY no;";
 	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
@@ -569,6 +868,7 @@ void config_load_cache(void)
 		p->folder = g_strdup((const char*)sqlite3_column_text(stmt, 2));
 		g_ptr_array_add(cfgs.moves, p);
 	}
+	sqlite3_finalize(stmt);
 	movloc_reindex();
 
 	sqlite3_close(db);
@@ -677,6 +977,7 @@ void config_set_string(ConfigKeys name, const char* value, bool cache_only)
 void config_set_bool(ConfigKeys name, bool value, bool cache_only)
 {
 	g_return_if_fail(name > CONFIG_NONE && name < CONFIG_MAX_VALUE);
+	g_return_if_fail(config_defs[name].type == CACHE_TYPE_BOOL);
 	const ConfigCacheItem item = { .b = value, .type = CACHE_TYPE_BOOL };
 	cache_set_item(name, &item);
 	if (!cache_only)
@@ -692,6 +993,7 @@ void config_set_bool(ConfigKeys name, bool value, bool cache_only)
 void config_set_int(ConfigKeys name, gint32 value, bool cache_only)
 {
 	g_return_if_fail(name > CONFIG_NONE && name < CONFIG_MAX_VALUE);
+	g_return_if_fail(config_defs[name].type == CACHE_TYPE_INT);
 	const ConfigCacheItem item = { .n = value, .type = CACHE_TYPE_INT };
 	cache_set_item(name, &item);
 	if (!cache_only)
@@ -707,6 +1009,7 @@ void config_set_int(ConfigKeys name, gint32 value, bool cache_only)
 void config_set_long(ConfigKeys name, gint64 value, bool cache_only)
 {
 	g_return_if_fail(name > CONFIG_NONE && name < CONFIG_MAX_VALUE);
+	g_return_if_fail(config_defs[name].type == CACHE_TYPE_LONG);
 	const ConfigCacheItem item = { .l = value, .type = CACHE_TYPE_LONG };
 	cache_set_item(name, &item);
 	if (!cache_only)
@@ -715,13 +1018,94 @@ void config_set_long(ConfigKeys name, gint64 value, bool cache_only)
 
 /**
  * @brief 실제 최대 페이지 캐시 크기를 바이트 단위로 반환합니다.
+ *        설정이 0이면 남은 메모리(cgroup 제한 포함)의 1/4로 정하고, 설정이 있어도 남은 메모리의 절반은 넘지 않습니다.
+ *        남은 메모리에는 이미 잡은 캐시가 빠져 있으므로 in_use를 되돌려 더한 뒤에 나눕니다.
+ *        메모리 부족 경고를 받으면 한동안 경고 수준에 따라 줄입니다.
+ *        계산한 값은 경고를 받거나 설정이 바뀔 때까지 쓰고, 메모리 감시가 없을 때만 몇 초마다 다시 계산합니다.
+ * @param in_use 지금 캐시가 쓰고 있는 크기(바이트)
  * @return 최대 캐시 크기(바이트)
  */
-size_t config_get_actual_max_page_cache(void)
+size_t config_get_actual_max_page_cache(size_t in_use)
 {
+	const gint64 now = g_get_monotonic_time();
+	if (cfgs.memory_level != 0 && now - cfgs.memory_warned > MEMORY_RELAX_TIME)
+	{
+		cfgs.memory_level = 0;
+		cfgs.memory_checked = 0;
+	}
+	if (cfgs.memory_checked != 0 && (cfgs.memory_monitor != NULL || now - cfgs.memory_checked < MEMORY_CHECK_INTERVAL))
+		return cfgs.memory_budget;
+	cfgs.memory_checked = now;
+
 	const ConfigCacheItem* item = cache_get_item(CONFIG_GENERAL_MAX_PAGE_CACHE);
-	const size_t mb = item ? item->n : 230; // 원래 defs에서 가져와야 하는데 귀찮다
-	return (size_t)mb * 1024ULL * 1024ULL; // MB 단위로 변환
+	const size_t mb = item ? (size_t)item->n : (size_t)g_ascii_strtoull(config_defs[CONFIG_GENERAL_MAX_PAGE_CACHE].value, NULL, 10);
+	// 캐시가 커질수록 남은 메모리가 줄어 한도가 따라 줄지 않게, 우리 캐시는 남은 것으로 친다
+	const guint64 free_now = doumi_get_available_memory();
+	const guint64 avail = free_now > 0 ? free_now + in_use : 0;
+
+	guint64 budget;
+	if (mb > 0)
+		budget = (guint64)mb * 1024ULL * 1024ULL; // MB 단위로 변환
+	else if (avail > 0)
+		budget = CLAMP(avail / 4, MEMORY_BUDGET_MIN, MEMORY_BUDGET_MAX);
+	else
+		budget = MEMORY_BUDGET_FALLBACK;
+
+	// 설정한 크기가 있어도 다른 프로그램이 쓰는 만큼은 비켜 준다
+	if (avail > 0)
+		budget = MIN(budget, MAX(avail / 2, MEMORY_BUDGET_MIN));
+
+	if (cfgs.memory_level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+		budget = 0; // 보이는 쪽만 남긴다
+	else if (cfgs.memory_level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+		budget /= 4;
+	else if (cfgs.memory_level >= G_MEMORY_MONITOR_WARNING_LEVEL_LOW)
+		budget /= 2;
+
+	cfgs.memory_budget = (size_t)MIN(budget, (guint64)G_MAXSIZE);
+	return cfgs.memory_budget;
+}
+
+/**
+ * @brief 설정 파일을 두는 디렉토리 경로를 반환합니다.
+ * @return 경로 문자열 (해제하지 말 것)
+ */
+const char* config_get_app_path(void)
+{
+	return cfgs.app_path;
+}
+
+/**
+ * @brief 설정이 바뀔 때 부를 콜백을 등록합니다.
+ *        콜백은 값이 실제로 바뀌었을 때 설정을 바꾼 스레드(보통 메인 스레드)에서 불립니다.
+ * @param func 콜백
+ * @param user_data 콜백 사용자 데이터
+ * @return 알림 번호 (config_remove_notify에 사용)
+ */
+guint config_add_notify(ConfigNotifyFunc func, gpointer user_data)
+{
+	g_return_val_if_fail(func != NULL && cfgs.notifies != NULL, 0);
+	const ConfigNotify n = { .id = ++cfgs.notify_id, .func = func, .user_data = user_data };
+	g_array_append_val(cfgs.notifies, n);
+	return n.id;
+}
+
+/**
+ * @brief 설정 바뀜 콜백을 제거합니다.
+ * @param id 알림 번호
+ */
+void config_remove_notify(guint id)
+{
+	if (cfgs.notifies == NULL || id == 0)
+		return;
+	for (guint i = 0; i < cfgs.notifies->len; i++)
+	{
+		if (g_array_index(cfgs.notifies, ConfigNotify, i).id == id)
+		{
+			g_array_remove_index(cfgs.notifies, i);
+			break;
+		}
+	}
 }
 
 /**
@@ -754,12 +1138,15 @@ int recently_get_page(const char* filename)
 
 /**
  * @brief 파일 이름에 해당하는 최근 페이지 번호를 설정합니다.
- *        page가 0 이하이면 삭제, 1 이상이면 저장
+ *        page가 0보다 작으면 삭제, 0 이상이면 저장 (0도 남겨야 최근 목록에 나옴)
  * @param filename 파일 이름
+ * @param path 책 파일 전체 경로 (최근 목록에서 다시 열 때 씀, NULL 가능)
  * @param page 페이지 번호
+ * @param pages 전체 쪽 수
+ * @param cover 표지 쪽 번호
  * @return 성공 시 true
  */
-bool recently_set_page(const char* filename, int page)
+bool recently_set_page(const char* filename, const char* path, int page, int pages, int cover)
 {
 	g_return_val_if_fail(filename != NULL, false);
 
@@ -767,7 +1154,7 @@ bool recently_set_page(const char* filename, int page)
 	g_return_val_if_fail(db != NULL, false);
 
 	sqlite3_stmt* stmt;
-	if (page <= 0)
+	if (page < 0)
 	{
 		// 삭제
 		const char* sql = "DELETE FROM history WHERE filename = ?;";
@@ -780,8 +1167,12 @@ bool recently_set_page(const char* filename, int page)
 	}
 	else
 	{
-		// 업데이트
-		const char* sql = "INSERT OR REPLACE INTO history (filename, page, updated) VALUES (?, ?, datetime('now', 'localtime'));";
+		// 업데이트, 경로를 모르면 전에 저장한 경로를 남긴다
+		const char* sql =
+			"INSERT INTO history (filename, page, updated, path, pages, cover) "
+			"VALUES (?1, ?2, datetime('now', 'localtime'), ?3, ?4, ?5) "
+			"ON CONFLICT(filename) DO UPDATE SET page = excluded.page, updated = excluded.updated, "
+			"path = COALESCE(excluded.path, path), pages = excluded.pages, cover = excluded.cover;";
 		if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
 		{
 			sql_error(db, true);
@@ -789,6 +1180,12 @@ bool recently_set_page(const char* filename, int page)
 		}
 		sqlite3_bind_text(stmt, 1, filename, -1, SQLITE_STATIC);
 		sqlite3_bind_int(stmt, 2, page);
+		if (path != NULL)
+			sqlite3_bind_text(stmt, 3, path, -1, SQLITE_STATIC);
+		else
+			sqlite3_bind_null(stmt, 3);
+		sqlite3_bind_int(stmt, 4, pages);
+		sqlite3_bind_int(stmt, 5, cover);
 	}
 
 	bool ret = true;
@@ -803,6 +1200,301 @@ bool recently_set_page(const char* filename, int page)
 	return ret;
 }
 
+/**
+ * @brief 최근 책 항목을 해제합니다.
+ * @param book RecentBook 포인터
+ */
+static void recent_book_free(RecentBook* book)
+{
+	g_free(book->filename);
+	g_free(book->path);
+	g_free(book->updated);
+	g_free(book);
+}
+
+/**
+ * @brief 최근에 본 책 목록을 얻습니다. 최근에 본 것부터 나옵니다.
+ *        경로를 모르는 옛 기록이나 지금 없는 파일은 건너뜁니다.
+ * @param limit 최대 개수
+ * @return RecentBook 배열 (g_ptr_array_unref로 해제)
+ */
+GPtrArray* recently_get_list(int limit)
+{
+	GPtrArray* list = g_ptr_array_new_with_free_func((GDestroyNotify)recent_book_free);
+
+	sqlite3* db = sql_open();
+	g_return_val_if_fail(db != NULL, list);
+
+	sqlite3_stmt* stmt;
+	const char* sql =
+		"SELECT filename, path, page, pages, cover, updated FROM history "
+		"WHERE path IS NOT NULL ORDER BY updated DESC LIMIT ?;";
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+	{
+		sql_error(db, true);
+		return list;
+	}
+
+	// 없는 파일을 건너뛰므로 조금 더 읽는다
+	sqlite3_bind_int(stmt, 1, limit * 2);
+	while ((int)list->len < limit && sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		const char* path = (const char*)sqlite3_column_text(stmt, 1);
+		if (path == NULL || !g_file_test(path, G_FILE_TEST_IS_REGULAR))
+			continue;
+
+		RecentBook* book = g_new(RecentBook, 1);
+		book->filename = g_strdup((const char*)sqlite3_column_text(stmt, 0));
+		book->path = g_strdup(path);
+		book->page = sqlite3_column_int(stmt, 2);
+		book->pages = sqlite3_column_int(stmt, 3);
+		book->cover = sqlite3_column_int(stmt, 4);
+		book->updated = g_strdup((const char*)sqlite3_column_text(stmt, 5));
+		g_ptr_array_add(list, book);
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	return list;
+}
+
+/**
+ * @brief 읽기 대기열을 읽습니다.
+ * @return 책 경로 배열 (g_ptr_array_unref로 해제)
+ */
+GPtrArray* readq_load(void)
+{
+	GPtrArray* paths = g_ptr_array_new_with_free_func(g_free);
+
+	sqlite3* db = sql_open();
+	g_return_val_if_fail(db != NULL, paths);
+
+	sqlite3_stmt* stmt;
+	const char* sql = "SELECT path FROM queue ORDER BY no;";
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+	{
+		sql_error(db, true);
+		return paths;
+	}
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		const char* path = (const char*)sqlite3_column_text(stmt, 0);
+		if (path != NULL)
+			g_ptr_array_add(paths, g_strdup(path));
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	return paths;
+}
+
+/**
+ * @brief 읽기 대기열을 저장합니다. 전에 저장한 것은 지웁니다.
+ * @param paths 책 경로 큐 (char*)
+ * @return 성공 시 true
+ */
+bool readq_save(GQueue* paths)
+{
+	g_return_val_if_fail(paths != NULL, false);
+
+	sqlite3* db = sql_open();
+	g_return_val_if_fail(db != NULL, false);
+
+	sqlite3_stmt* stmt;
+	if (!sql_exec_stmt(db, "BEGIN; DELETE FROM queue;") ||
+		sqlite3_prepare_v2(db, "INSERT INTO queue (no, path) VALUES (?, ?);", -1, &stmt, NULL) != SQLITE_OK)
+	{
+		sql_error(db, true);
+		return false;
+	}
+
+	bool ret = true;
+	int no = 0;
+	for (const GList* l = paths->head; l; l = l->next, no++)
+	{
+		sqlite3_bind_int(stmt, 1, no);
+		sqlite3_bind_text(stmt, 2, l->data, -1, SQLITE_STATIC);
+		if (sqlite3_step(stmt) != SQLITE_DONE)
+		{
+			ret = false;
+			break;
+		}
+		sqlite3_reset(stmt);
+	}
+	sqlite3_finalize(stmt);
+
+	if (!sql_exec_stmt(db, ret ? "COMMIT;" : "ROLLBACK;"))
+		ret = false;
+	if (!ret)
+		sql_error(db, true);
+	else
+		sqlite3_close(db);
+
+	return ret;
+}
+
+/**
+ * @brief 이어 보기 파일 머리
+ *        뒤에 책 이름(name_len 바이트)과 zlib으로 압축한 BGRA 픽셀(data_len 바이트)이 붙습니다.
+ */
+typedef struct ResumeHeader
+{
+	char magic[4];             ///< "QGRS"
+	guint32 version;           ///< 파일 버전
+	gint32 page;               ///< 쪽 번호
+	guint32 width;             ///< 화면 너비
+	guint32 height;            ///< 화면 높이
+	guint32 name_len;          ///< 책 이름 길이
+	guint32 data_len;          ///< 압축한 픽셀 길이
+} ResumeHeader;
+
+#define RESUME_MAGIC "QGRS"
+#define RESUME_VERSION 1
+
+/**
+ * @brief 이어 보기 파일 경로를 만듭니다. 설정 파일과 같은 디렉토리에 둡니다.
+ * @return 경로 문자열 (g_free로 해제)
+ */
+static char* resume_get_path(void)
+{
+	return g_build_filename(cfgs.app_path, "QgBook.resume", NULL);
+}
+
+/**
+ * @brief 끝날 때 보이던 화면과 책 위치를 저장합니다.
+ * @param filename 책 파일 이름
+ * @param page 쪽 번호
+ * @param texture 줄여서 그린 화면 텍스쳐
+ * @return 성공 시 true
+ */
+bool resume_save(const char* filename, int page, GdkTexture* texture)
+{
+	g_return_val_if_fail(filename != NULL && texture != NULL, false);
+
+	const int width = gdk_texture_get_width(texture);
+	const int height = gdk_texture_get_height(texture);
+	const gsize stride = (gsize)width * 4;
+	const gsize size = stride * (gsize)height;
+	guchar* pixels = g_malloc(size);
+	gdk_texture_download(texture, pixels, stride);
+
+	uLongf comp_len = compressBound((uLong)size);
+	guchar* comp = g_malloc(comp_len);
+	const int z = compress2(comp, &comp_len, pixels, (uLong)size, Z_BEST_SPEED);
+	g_free(pixels);
+	if (z != Z_OK)
+	{
+		g_log("CONFIG", G_LOG_LEVEL_WARNING, _("Failed to compress resume snapshot: %d"), z);
+		g_free(comp);
+		return false;
+	}
+
+	const size_t name_len = strlen(filename);
+	ResumeHeader header = {
+		.version = RESUME_VERSION,
+		.page = page,
+		.width = (guint32)width,
+		.height = (guint32)height,
+		.name_len = (guint32)name_len,
+		.data_len = (guint32)comp_len,
+	};
+	memcpy(header.magic, RESUME_MAGIC, sizeof(header.magic));
+
+	GByteArray* ba = g_byte_array_sized_new((guint)(sizeof(header) + name_len + comp_len));
+	g_byte_array_append(ba, (const guint8*)&header, sizeof(header));
+	g_byte_array_append(ba, (const guint8*)filename, (guint)name_len);
+	g_byte_array_append(ba, comp, (guint)comp_len);
+	g_free(comp);
+
+	char* path = resume_get_path();
+	GError* error = NULL;
+	const bool ret = g_file_set_contents(path, (const char*)ba->data, ba->len, &error);
+	if (!ret)
+	{
+		g_log("CONFIG", G_LOG_LEVEL_WARNING, _("Failed to save resume snapshot: %s"), error->message);
+		g_clear_error(&error);
+	}
+	g_free(path);
+	g_byte_array_free(ba, true);
+
+	return ret;
+}
+
+/**
+ * @brief 저장해둔 이어 보기 화면과 책 위치를 읽습니다.
+ * @return ResumeSnapshot 포인터 (없거나 잘못되었으면 NULL, resume_free로 해제)
+ */
+ResumeSnapshot* resume_load(void)
+{
+	char* path = resume_get_path();
+	char* data = NULL;
+	gsize len = 0;
+	const bool ok = g_file_get_contents(path, &data, &len, NULL);
+	g_free(path);
+	if (!ok)
+		return NULL;
+
+	ResumeHeader header;
+	if (len < sizeof(header))
+	{
+		g_free(data);
+		return NULL;
+	}
+	memcpy(&header, data, sizeof(header));
+	if (memcmp(header.magic, RESUME_MAGIC, sizeof(header.magic)) != 0 || header.version != RESUME_VERSION ||
+		header.width == 0 || header.height == 0 || header.width > 8192 || header.height > 8192 ||
+		(gsize)header.name_len + header.data_len > len - sizeof(header))
+	{
+		g_free(data);
+		return NULL;
+	}
+
+	const gsize stride = (gsize)header.width * 4;
+	uLongf size = (uLongf)(stride * header.height);
+	guchar* pixels = g_malloc(size);
+	const guchar* comp = (const guchar*)data + sizeof(header) + header.name_len;
+	if (uncompress(pixels, &size, comp, header.data_len) != Z_OK || size != stride * header.height)
+	{
+		g_free(pixels);
+		g_free(data);
+		return NULL;
+	}
+
+	GBytes* bytes = g_bytes_new_take(pixels, size);
+	ResumeSnapshot* snapshot = g_new0(ResumeSnapshot, 1);
+	snapshot->filename = g_strndup(data + sizeof(header), header.name_len);
+	snapshot->page = header.page;
+	snapshot->texture = gdk_memory_texture_new((int)header.width, (int)header.height, GDK_MEMORY_DEFAULT, bytes, stride);
+	g_bytes_unref(bytes);
+	g_free(data);
+
+	return snapshot;
+}
+
+/**
+ * @brief 이어 보기 자료를 해제합니다.
+ * @param snapshot ResumeSnapshot 포인터
+ */
+void resume_free(ResumeSnapshot* snapshot)
+{
+	if (snapshot == NULL)
+		return;
+	g_free(snapshot->filename);
+	if (snapshot->texture)
+		g_object_unref(snapshot->texture);
+	g_free(snapshot);
+}
+
+/**
+ * @brief 이어 보기 파일을 지웁니다.
+ */
+void resume_clear(void)
+{
+	char* path = resume_get_path();
+	g_remove(path);
+	g_free(path);
+}
+
 /**
  * @brief 책 이동 위치를 추가합니다.
  * @param alias 별칭
@@ -811,6 +1503,7 @@ bool recently_set_page(const char* filename, int page)
  */
 bool movloc_add(const char* alias, const char* folder)
 {
+	movloc_ensure_loaded();
 	if (alias == NULL || folder == NULL)
 		return false;
 	if (cfgs.moves->len >= 100)
@@ -843,6 +1536,7 @@ bool movloc_add(const char* alias, const char* folder)
  */
 void movloc_edit(int no, const char* alias, const char* folder)
 {
+	movloc_ensure_loaded();
 	if (alias == NULL || folder == NULL)
 		return;
 	if (no < 0 || no >= (int)cfgs.moves->len)
@@ -874,6 +1568,7 @@ void movloc_reindex(void)
  */
 bool movloc_delete(int no)
 {
+	movloc_ensure_loaded();
 	if (no < 0 || no >= (int)cfgs.moves->len)
 		return false;
 
@@ -891,6 +1586,7 @@ bool movloc_delete(int no)
  */
 bool movloc_swap(int from, int to)
 {
+	movloc_ensure_loaded();
 	if (from < 0 || from >= (int)cfgs.moves->len || to < 0 || to >= (int)cfgs.moves->len || from == to)
 		return false;
 
@@ -914,6 +1610,7 @@ bool movloc_swap(int from, int to)
  */
 GPtrArray* movloc_get_all_ptr(void)
 {
+	movloc_ensure_loaded();
 	return cfgs.moves;
 }
 
@@ -922,6 +1619,7 @@ GPtrArray* movloc_get_all_ptr(void)
  */
 void movloc_commit(void)
 {
+	movloc_ensure_loaded();
 	sqlite3* db = sql_open();
 	g_return_if_fail(db != NULL);
 
@@ -1060,6 +1758,22 @@ static GPtrArray* nears_build_array(const char* dir, NearExtentionCompare compar
 	if (dir == NULL || compare == NULL)
 		return NULL; // 디렉토리나 비교 함수가 NULL이면 실패
 
+	// 서재에서 훑은 디렉토리면 파일 시스템 대신 카탈로그에서 얻는다
+	GPtrArray* books = library_query_folder(dir);
+	if (books != NULL)
+	{
+		GPtrArray* nears = g_ptr_array_new_full(books->len, g_free);
+		for (guint i = 0; i < books->len; i++)
+		{
+			LibraryBook* book = g_ptr_array_index(books, i);
+			if (compare(book->path))
+				g_ptr_array_add(nears, g_steal_pointer(&book->path));
+		}
+		g_ptr_array_unref(books);
+		g_ptr_array_sort(nears, compare_natural_filename);
+		return nears;
+	}
+
 	GDir* gd = g_dir_open(dir, 0, NULL);
 	if (gd == NULL)
 		return NULL; // 디렉토리 열기 실패
@@ -1084,6 +1798,18 @@ static GPtrArray* nears_build_array(const char* dir, NearExtentionCompare compar
 	return nears;
 }
 
+/**
+ * @brief 디렉토리의 파일을 자연스러운 순서로 모두 얻습니다.
+ * @param dir 디렉토리 경로
+ * @param compare 확장자 비교 함수
+ * @return 파일 경로 배열 (g_ptr_array_unref로 해제), 디렉토리를 못 열면 NULL
+ */
+GPtrArray* nears_get_all(const char* dir, NearExtentionCompare compare)
+{
+	g_return_val_if_fail(dir != NULL && compare != NULL, NULL);
+	return nears_build_array(dir, compare);
+}
+
 /**
  * @brief 지정 파일의 앞쪽 근처 파일을 얻습니다. (디렉토리 및 비교 함수 지정)
  * @param fullpath 기준 파일 경로
@@ -1285,39 +2011,23 @@ static gint64* convert_shortcut(const char* alias)
 }
 
 /**
- * @brief 단축키를 등록합니다. (기본값 및 DB에서 읽기)
+ * @brief DB에 있는 사용자 단축키를 기본값 위에 덮어씁니다. (아이들에서 부름)
+ * @param user_data 사용 안함
+ * @return G_SOURCE_REMOVE
  */
-void shortcut_register(void)
+static gboolean idle_shortcut_merge_db(gpointer user_data)
 {
-	// 먼저 기본값을 넣자고
-	for (const ShortcutDefinition* sc = shortcut_defs; sc->action; sc++)
-	{
-		gint64* key = convert_shortcut(sc->alias);
-		if (key)
-			g_hash_table_insert(cfgs.shortcut, key, g_strdup(sc->action));
-#if defined(_DEBUG) && false
-		if (key == NULL)
-			g_log("SHORTCUT", G_LOG_LEVEL_ERROR, "%s -> %s", sc->action, sc->alias);
-		else
-		{
-			const guint key_val = (guint)(*key & 0xFFFFFFFF); // 하위 32비트가 키값
-			const guint key_state = (guint)(*key >> 32); // 상위 32비트가 상태
-			g_log("SHORTCUT", G_LOG_LEVEL_DEBUG, "%s -> %s (%X, %X)",
-				sc->action, sc->alias, key_state, key_val);
-		}
-#endif
-	}
+	cfgs.shortcut_idle = 0;
 
-	// SQL에서 단축키를 가져와서 넣기
 	sqlite3* db = sql_open();
-	g_return_if_fail(db != NULL);
+	g_return_val_if_fail(db != NULL, G_SOURCE_REMOVE);
 
 	sqlite3_stmt* stmt;
 	const char* sql = "SELECT action, alias FROM shortcuts;";
 	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
 	{
-		sql_error(db, false);
-		return;
+		sql_error(db, true);
+		return G_SOURCE_REMOVE;
 	}
 
 	while (sqlite3_step(stmt) == SQLITE_ROW)
@@ -1335,6 +2045,36 @@ void shortcut_register(void)
 
 	sqlite3_finalize(stmt);
 	sqlite3_close(db);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 단축키를 등록합니다. (기본값은 바로, DB는 아이들에서 읽기)
+ */
+void shortcut_register(void)
+{
+	// 먼저 기본값을 넣자고
+	for (const ShortcutDefinition* sc = shortcut_defs; sc->action; sc++)
+	{
+		gint64* key = convert_shortcut(sc->alias);
+		if (key)
+			g_hash_table_insert(cfgs.shortcut, key, g_strdup(sc->action));
+#if defined(_DEBUG) && false
+		if (key == NULL)
+			g_log("SHORTCUT", G_LOG_LEVEL_ERROR, "%s -> %s", sc->action, sc->alias);
+		else
+		{
+			const guint key_val = (guint)(*key & 0xFFFFFFFF); // 하위 32비트가 키값
+			const guint key_state = (guint)(*key >> 32); // 상위 32비트가 상태
+			g_log("SHORTCUT", G_LOG_LEVEL_DEBUG, "%s -> %s (%X, %X)",
+				sc->action, sc->alias, key_state, key_val);
+		}
+#endif
+	}
+
+	// 사용자 단축키는 첫 화면이 나온 다음에 읽는다
+	if (cfgs.shortcut_idle == 0)
+		cfgs.shortcut_idle = g_idle_add_full(G_PRIORITY_LOW, idle_shortcut_merge_db, NULL, NULL);
 }
 
 /**
@@ -1366,5 +2106,6 @@ const char* locale_lookup(const char* key)
  * - 이 파일은 프로그램의 환경설정, 캐시, 단축키, 최근 파일, 이동 위치, 언어 등
  *   다양한 설정 및 데이터베이스 연동을 담당합니다.
  * - 각 함수는 메모리 관리, DB 연동, 캐시 동기화에 주의해야 합니다.
+ * - 설정 캐시는 ConfigKeys로 바로 찾는 배열이므로 자주 읽는 곳은 CONFIG_GET_* 매크로를 쓰면 됩니다.
  * - 구조체, 함수, 주요 블록에 Doxygen 스타일 주석을 추가하였습니다.
  */
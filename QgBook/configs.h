@@ -1,44 +1,5 @@
 ﻿#pragma once
 
-// 설정 키
-typedef enum ConfigKeys
-{
-	CONFIG_NONE = 0, // 설정 없음
-	// 실행
-	CONFIG_RUN_COUNT, // 실행 횟수
-	CONFIG_RUN_DURATION, // 실행 시간 (초 단위)
-	// 윈도우
-	CONFIG_WINDOW_X, // 윈도우 X 좌표
-	CONFIG_WINDOW_Y, // 윈도우 Y 좌표
-	CONFIG_WINDOW_WIDTH, // 윈도우 너비
-	CONFIG_WINDOW_HEIGHT, // 윈도우 높이
-	// 일반
-	CONFIG_GENERAL_RUN_ONCE, // 한 번만 실행
-	CONFIG_GENERAL_ESC_EXIT, // ESC 키로 종료
-	CONFIG_GENERAL_CONFIRM_DELETE, // 책 삭제 확인
-	CONFIG_GENERAL_MAX_PAGE_CACHE, // 최대 캐시 크기
-	CONFIG_GENERAL_EXTERNAL_RUN, // 외부 프로그램 실행
-	CONFIG_GENERAL_RELOAD_AFTER_EXTERNAL, // 외부 프로그램 실행 후 재시작
-	// 마우스
-	CONFIG_MOUSE_DOUBLE_CLICK_FULLSCREEN, // 더블 클릭으로 전체 화면 전환
-	CONFIG_MOUSE_CLICK_PAGING, // 클릭으로 페이지 넘기기
-	// 보기
-	CONFIG_VIEW_ZOOM, // 보기 확대
-	CONFIG_VIEW_MODE, // 보기 모드
-	CONFIG_VIEW_QUALITY, // 보기 품질
-	CONFIG_VIEW_MARGIN, // 보기 여백
-	// 보안
-	CONFIG_SECURITY_USE_PASS, // 비밀번호 보호
-	CONFIG_SECURITY_PASS_CODE, // 비밀번호 값
-	CONFIG_SECURITY_PASS_USAGE, // 비밀번호 용도
-	// 파일
-	CONFIG_FILE_LAST_DIRECTORY, // 마지막으로 열었던 디렉토리
-	CONFIG_FILE_LAST_FILE, // 마지막으로 열었던 파일
-	CONFIG_FILE_REMEMBER, // 기억해둘 파일 이름
-	//
-	CONFIG_MAX_VALUE, // 최대 값 (마지막 값은 반드시 이 값을 사용해야 함)
-} ConfigKeys;
-
 // 설정 캐시 아이템의 변수 타입
 typedef enum CacheType
 {
@@ -50,6 +11,64 @@ typedef enum CacheType
 	CACHE_TYPE_STRING,     // 문자열
 } CacheType;
 
+// 설정 목록 (X-매크로)
+// X(키, 이름, 초기값, 타입) 순서. ConfigKeys와 config_defs와 타입 검사용 열거값을 모두 여기서 만든다
+// 새 설정은 여기에만 추가하면 된다
+#define CONFIG_KEY_LIST(X) \
+	/* 실행 */ \
+	X(CONFIG_RUN_COUNT, "RunCount", "0", LONG) /* 실행 횟수 */ \
+	X(CONFIG_RUN_DURATION, "RunDuration", "0", DOUBLE) /* 실행 시간 (초 단위) */ \
+	/* 윈도우 */ \
+	X(CONFIG_WINDOW_X, "WindowX", "-1", INT) /* 윈도우 X 좌표 */ \
+	X(CONFIG_WINDOW_Y, "WindowY", "-1", INT) /* 윈도우 Y 좌표 */ \
+	X(CONFIG_WINDOW_WIDTH, "WindowWidth", "600", INT) /* 윈도우 너비 */ \
+	X(CONFIG_WINDOW_HEIGHT, "WindowHeight", "400", INT) /* 윈도우 높이 */ \
+	/* 일반 */ \
+	X(CONFIG_GENERAL_RUN_ONCE, "GeneralRunOnce", "1", BOOL) /* 한 번만 실행 */ \
+	X(CONFIG_GENERAL_ESC_EXIT, "GeneralEscExit", "1", BOOL) /* ESC 키로 종료 */ \
+	X(CONFIG_GENERAL_CONFIRM_DELETE, "GeneralConfirmDelete", "1", BOOL) /* 책 삭제 확인 */ \
+	X(CONFIG_GENERAL_MAX_PAGE_CACHE, "GeneralMaxPageCache", "0", INT) /* 최대 캐시 크기(MB), 0이면 남은 메모리로 정함 */ \
+	X(CONFIG_GENERAL_IDLE_TRIM, "GeneralIdleTrim", "10", INT) /* 비활성 뒤 쪽 캐시 줄이기(분), 0이면 안 함 */ \
+	X(CONFIG_GENERAL_EXTERNAL_RUN, "GeneralExternalRun", "", STRING) /* 외부 프로그램 실행 */ \
+	X(CONFIG_GENERAL_RELOAD_AFTER_EXTERNAL, "GeneralReloadAfterExternal", "1", BOOL) /* 외부 프로그램 실행 후 재시작 */ \
+	X(CONFIG_GENERAL_RESUME_LAST, "GeneralResumeLast", "1", BOOL) /* 시작할 때 마지막 책 이어 보기 */ \
+	/* 마우스 */ \
+	X(CONFIG_MOUSE_DOUBLE_CLICK_FULLSCREEN, "MouseDoubleClickFullscreen", "0", BOOL) /* 더블 클릭으로 전체 화면 전환 */ \
+	X(CONFIG_MOUSE_CLICK_PAGING, "MouseClickPaging", "0", BOOL) /* 클릭으로 페이지 넘기기 */ \
+	/* 보기 */ \
+	X(CONFIG_VIEW_ZOOM, "ViewZoom", "1", BOOL) /* 보기 확대 */ \
+	X(CONFIG_VIEW_MODE, "ViewMode", "0", INT) /* 보기 모드 */ \
+	X(CONFIG_VIEW_QUALITY, "ViewQuality", "1", INT) /* 보기 품질 */ \
+	X(CONFIG_VIEW_MARGIN, "ViewMargin", "0", INT) /* 보기 여백 */ \
+	X(CONFIG_VIEW_PAGE_THUMBNAIL, "ViewPageThumbnail", "0", BOOL) /* 쪽 선택에서 썸네일 보기 */ \
+	/* 보안 */ \
+	X(CONFIG_SECURITY_USE_PASS, "SecurityUsePass", "0", BOOL) /* 비밀번호 보호 */ \
+	X(CONFIG_SECURITY_PASS_CODE, "SecurityPassCode", "", STRING) /* 비밀번호 값 */ \
+	X(CONFIG_SECURITY_PASS_USAGE, "SecurityPassUsage", "", STRING) /* 비밀번호 용도 */ \
+	/* 파일 */ \
+	X(CONFIG_FILE_LAST_DIRECTORY, "FileLastDirectory", "", STRING) /* 마지막으로 열었던 디렉토리 */ \
+	X(CONFIG_FILE_LAST_FILE, "FileLastFile", "", STRING) /* 마지막으로 열었던 파일 */ \
+	X(CONFIG_FILE_LIBRARY_ROOTS, "FileLibraryRoots", "", STRING) /* 서재 폴더들 (G_SEARCHPATH_SEPARATOR로 구분) */ \
+	X(CONFIG_FILE_REMEMBER, "FileRemember", "", STRING) /* 기억해둘 파일 이름 */
+
+// 설정 키
+typedef enum ConfigKeys
+{
+	CONFIG_NONE = 0, // 설정 없음
+#define CONFIG_KEY_ENUM(key, name, value, type) key,
+	CONFIG_KEY_LIST(CONFIG_KEY_ENUM)
+#undef CONFIG_KEY_ENUM
+	CONFIG_MAX_VALUE, // 최대 값 (마지막 값은 반드시 이 값을 사용해야 함)
+} ConfigKeys;
+
+// 설정 키마다 타입 (컴파일 시간 검사용)
+enum ConfigKeyTypes
+{
+#define CONFIG_KEY_TYPE(key, name, value, type) key##__TYPE = CACHE_TYPE_##type,
+	CONFIG_KEY_LIST(CONFIG_KEY_TYPE)
+#undef CONFIG_KEY_TYPE
+};
+
 // 설정 항목 정의
 typedef struct ConfigDefinition
 {
@@ -73,11 +92,63 @@ typedef struct MoveLocation
 	char* folder;			// 디렉토리
 } MoveLocation;
 
+// 이어 보기 스냅샷 (끝날 때 보이던 화면)
+typedef struct ResumeSnapshot
+{
+	char* filename;			// 책 파일 이름
+	int page;				// 쪽 번호
+	GdkTexture* texture;	// 줄여서 저장한 화면
+} ResumeSnapshot;
+
+// 최근에 본 책 (시작 화면용)
+typedef struct RecentBook
+{
+	char* filename;			// 책 파일 이름 (history 키)
+	char* path;				// 책 파일 전체 경로
+	int page;				// 보던 쪽 번호
+	int pages;				// 전체 쪽 수
+	int cover;				// 표지 쪽 번호
+	char* updated;			// 마지막으로 본 시각
+} RecentBook;
+
 // 근처 파일 종류 확인용 콜백
 typedef bool (*NearExtentionCompare)(const char* filename);
 
 
+// 설정 캐시 아이템
+// ConfigKeys로 바로 찾는 배열에 들어간다
+typedef struct ConfigCacheItem
+{
+	union
+	{
+		gint32 n;   // 정수형
+		gint64 l;   // 긴 정수형
+		bool b;     // 불린형
+		double d;   // 실수형
+		char* s;    // 문자열
+	};
+
+	CacheType type; // 값의 타입 (CACHE_TYPE_UNKNOWN이면 아직 안 읽음)
+} ConfigCacheItem;
+
+// 설정 바뀜 알림 콜백
+typedef void (*ConfigNotifyFunc)(ConfigKeys key, gpointer user_data);
+
+// 설정 캐시 배열. 읽기 전용으로 쓰고 값은 config_set_* 으로만 바꿀 것, 바뀜은 config_add_notify로 받는다
+extern ConfigCacheItem config_cache[CONFIG_MAX_VALUE];
+
+// 타입을 컴파일 할 때 검사하면서 캐시를 바로 읽는 매크로 (cache_only가 true인 것과 같다)
+// 예: CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM)
+#define CONFIG_TYPE_ASSERT(key, type) ((void)sizeof(char[(int)(key##__TYPE) == (int)CACHE_TYPE_##type ? 1 : -1]))
+#define CONFIG_GET_BOOL(key) (CONFIG_TYPE_ASSERT(key, BOOL), config_cache[key].b)
+#define CONFIG_GET_INT(key) (CONFIG_TYPE_ASSERT(key, INT), config_cache[key].n)
+#define CONFIG_GET_LONG(key) (CONFIG_TYPE_ASSERT(key, LONG), config_cache[key].l)
+#define CONFIG_GET_DOUBLE(key) (CONFIG_TYPE_ASSERT(key, DOUBLE), config_cache[key].d)
+#define CONFIG_GET_STRING(key) (CONFIG_TYPE_ASSERT(key, STRING), (const char*)config_cache[key].s)
+
+
 // 설정 관련 함수들
+extern bool config_peek_bool(ConfigKeys name);
 extern bool config_init(void);
 extern void config_load_cache(void);
 extern void config_dispose(void);
@@ -93,12 +164,29 @@ extern void config_set_bool(ConfigKeys name, bool value, bool cache_only);
 extern void config_set_int(ConfigKeys name, gint32 value, bool cache_only);
 extern void config_set_long(ConfigKeys name, gint64 value, bool cache_only);
 
-extern size_t config_get_actual_max_page_cache(void);
+extern size_t config_get_actual_max_page_cache(size_t in_use);
+extern const char* config_get_app_path(void);
+
+extern guint config_add_notify(ConfigNotifyFunc func, gpointer user_data);
+extern void config_remove_notify(guint id);
 
 
 // 최근 파일
 extern int recently_get_page(const char* filename);
-extern bool recently_set_page(const char* filename, int page);
+extern bool recently_set_page(const char* filename, const char* path, int page, int pages, int cover);
+extern GPtrArray* recently_get_list(int limit);
+
+
+// 읽기 대기열
+extern GPtrArray* readq_load(void);
+extern bool readq_save(GQueue* paths);
+
+
+// 이어 보기
+extern bool resume_save(const char* filename, int page, GdkTexture* texture);
+extern ResumeSnapshot* resume_load(void);
+extern void resume_free(ResumeSnapshot* snapshot);
+extern void resume_clear(void);
 
 
 // 이동 위치
@@ -112,6 +200,7 @@ extern void movloc_commit(void);
 
 
 // 근처 파일
+extern GPtrArray* nears_get_all(const char* dir, NearExtentionCompare compare);
 extern char* nears_find_prev(const char* fullpath, const char* dir, NearExtentionCompare compare);
 extern char* nears_find_next(const char* fullpath, const char* dir, NearExtentionCompare compare);
 extern char* nears_find_random(const char* fullpath, const char* dir, NearExtentionCompare compare);
@@ -16,52 +16,18 @@
   * - value: 기본값(문자열)
   * - type: 값의 타입(CacheType)
   *
+  * 실제 항목은 configs.h의 CONFIG_KEY_LIST에서 만들어지므로
+  * ConfigKeys와 순서가 어긋날 일이 없습니다.
+  *
   * 예시:
-  *   { "WindowWidth", "600", CACHE_TYPE_INT }
+  *   X(CONFIG_WINDOW_WIDTH, "WindowWidth", "600", INT)
   *   → "WindowWidth"라는 이름의 설정, 기본값 600, 타입은 정수
   */
 ConfigDefinition config_defs[CONFIG_MAX_VALUE] =
 {
 	{ "", "", CACHE_TYPE_UNKNOWN },                ///< CONFIG_NONE (사용 안 함/예약)
 
-	// 실행 관련
-	{ "RunCount", "0", CACHE_TYPE_LONG },          ///< 프로그램 실행 횟수
-	{ "RunDuration", "0", CACHE_TYPE_DOUBLE },     ///< 누적 실행 시간(초)
-
-	// 윈도우 위치/크기
-	{ "WindowX", "-1", CACHE_TYPE_INT },           ///< 윈도우 X 좌표
-	{ "WindowY", "-1", CACHE_TYPE_INT },           ///< 윈도우 Y 좌표
-	{ "WindowWidth", "600", CACHE_TYPE_INT },      ///< 윈도우 너비
-	{ "WindowHeight", "400", CACHE_TYPE_INT },     ///< 윈도우 높이
-
-	// 일반 설정
-	{ "GeneralRunOnce", "1", CACHE_TYPE_BOOL },            ///< 최초 실행 여부
-	{ "GeneralEscExit", "1", CACHE_TYPE_BOOL },            ///< ESC로 종료
-	{ "GeneralConfirmDelete", "1", CACHE_TYPE_BOOL },      ///< 삭제 확인
-	{ "GeneralMaxPageCache", "230", CACHE_TYPE_INT },      ///< 최대 페이지 캐시(MB)
-	{ "GeneralExternalRun", "", CACHE_TYPE_STRING },       ///< 외부 프로그램 실행 명령
-	{ "GeneralReloadAfterExternal", "1", CACHE_TYPE_BOOL },///< 외부 실행 후 새로고침
-
-	// 마우스 관련
-	{ "MouseDoubleClickFullscreen", "0", CACHE_TYPE_BOOL },///< 더블클릭 전체화면
-	{ "MouseClickPaging", "0", CACHE_TYPE_BOOL },          ///< 클릭으로 페이지 넘김
-
-	// 보기 관련
-	{ "ViewZoom", "1", CACHE_TYPE_BOOL },          ///< 확대/축소 사용
-	{ "ViewMode", "0", CACHE_TYPE_INT },           ///< 보기 모드(0:기본, 1:좌우 등)
-	{ "ViewQuality", "1", CACHE_TYPE_INT },        ///< 보기 품질
-	{ "ViewMargin", "0", CACHE_TYPE_INT },         ///< 보기 마진
-
-	// 보안 관련
-	{ "SecurityUsePass", "0", CACHE_TYPE_BOOL },   ///< 비밀번호 사용 여부
-	{ "SecurityPassCode", "", CACHE_TYPE_STRING }, ///< 비밀번호
-	{ "SecurityPassUsage", "", CACHE_TYPE_STRING },///< 비밀번호 사용 이력
-
-	// 파일 관련
-	{ "FileLastDirectory", "", CACHE_TYPE_STRING },///< 마지막으로 연 디렉토리
-	{ "FileLastFile", "", CACHE_TYPE_STRING },     ///< 마지막으로 연 파일
-	{ "FileRemember", "", CACHE_TYPE_STRING },     ///< 최근 파일 목록 등
-
-	// 최종값 테스트 (사용 안 함)
-	//{ NULL, NULL, 0 },
+#define CONFIG_KEY_DEF(key, name, value, type) { name, value, CACHE_TYPE_##type },
+	CONFIG_KEY_LIST(CONFIG_KEY_DEF)
+#undef CONFIG_KEY_DEF
 };
@@ -64,6 +64,7 @@ ShortcutDefinition shortcut_defs[] =
 	{"scan_book_prev", "bracketleft"}, ///< 이전 책([)
 	{"scan_book_next", "bracketright"}, ///< 다음 책(])
 	{"scan_book_random", "backslash"}, ///< 랜덤 책(\)
+	{"queue_next", "<Control>bracketright"}, ///< 대기열 다음 책(Ctrl+])
 
 	// 보기/정렬
 	{"view_zoom_toggle", "z"}, ///< 보기 확대/축소(z)
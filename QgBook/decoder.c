@@ -0,0 +1,1762 @@
+﻿#include "pch.h"
+#ifdef HAVE_LIBJPEG
+#include <setjmp.h>
+#include <jpeglib.h>
+#endif
+#ifdef HAVE_LIBPNG
+#include <png.h>
+#endif
+#ifdef HAVE_LIBWEBP
+#include <webp/decode.h>
+#endif
+#ifdef HAVE_LIBJXL
+#include <jxl/decode.h>
+#include <jxl/resizable_parallel_runner.h>
+#endif
+#ifdef HAVE_LIBAVIF
+#include <avif/avif.h>
+#endif
+#include "bufpool.h"
+#include "decoder.h"
+#include "doumi.h"
+
+/**
+ * @file decoder.c
+ * @brief 그림 형식마다 디코더를 골라 쪽 텍스쳐를 만드는 디코더 목록 구현 파일입니다.
+ *        직접 푸는 디코더는 픽셀을 버퍼 풀에서 얻은 버퍼에 바로 쓰고, 그 버퍼로 메모리 텍스쳐를 만듭니다.
+ */
+
+#define DECODE_CHUNK_SIZE (256 * 1024) // 나눠 넣으면서 취소를 확인하는 단위
+#define DECODE_CANCEL_ROWS 64 // 이만큼 줄마다 취소 확인
+#define JPEG_PARALLEL_PIXELS (4 * 1024 * 1024) // 이보다 큰 JPEG만 띠로 나눠 푼다
+
+static const Decoder* decoders[IMAGE_FILE_TYPE_MAX_VALUE];
+static GOnce decoder_once = G_ONCE_INIT;
+static gint decode_workers = -1; // 여러 스레드로 푸는 디코더가 나눠 쓰는 남은 일꾼 수
+
+/**
+ * @brief 남은 일꾼에서 want개까지 얻습니다. 부른 스레드도 일하므로 언제나 1 이상을 돌려줍니다.
+ *        다 쓰면 decoder_release_workers로 돌려줄 것
+ * @param want 원하는 일꾼 수
+ * @return 쓸 스레드 수 (부른 스레드 포함)
+ */
+static int decoder_acquire_workers(int want)
+{
+	if (g_atomic_int_get(&decode_workers) < 0)
+		g_atomic_int_compare_and_exchange(&decode_workers, -1, MAX((int)g_get_num_processors() - 1, 0));
+	for (;;)
+	{
+		const int left = g_atomic_int_get(&decode_workers);
+		const int take = CLAMP(want - 1, 0, left);
+		if (g_atomic_int_compare_and_exchange(&decode_workers, left, left - take))
+			return take + 1;
+	}
+}
+
+/**
+ * @brief 얻은 일꾼을 돌려줍니다.
+ * @param threads decoder_acquire_workers가 돌려준 수
+ */
+static void decoder_release_workers(int threads)
+{
+	g_atomic_int_add(&decode_workers, threads - 1);
+}
+
+/**
+ * @brief 줄여서 풀 크기를 구합니다. 원래 크기 안에서 max 안에 맞게 줄입니다.
+ * @param params 디코드 옵션
+ * @param width 원래 폭, 줄인 폭을 받음
+ * @param height 원래 높이, 줄인 높이를 받음
+ * @return 줄여야 하면 true
+ */
+static bool fit_scaled_size(const DecodeParams* params, int* width, int* height)
+{
+	if (params->max_width <= 0 || params->max_height <= 0 || *width <= 0 || *height <= 0)
+		return false;
+	if (*width <= params->max_width && *height <= params->max_height)
+		return false;
+	const double scale = MIN((double)params->max_width / *width, (double)params->max_height / *height);
+	*width = MAX(1, (int)(*width * scale));
+	*height = MAX(1, (int)(*height * scale));
+	return true;
+}
+
+/**
+ * @brief 텍스쳐에 붙여 두는 풀 버퍼, 줄 디코더가 복사하지 않고 가져다 쓴다
+ */
+typedef struct PoolPixels
+{
+	GBytes* bytes;
+	gsize stride;
+} PoolPixels;
+
+static void pool_pixels_free(gpointer ptr)
+{
+	PoolPixels* pp = ptr;
+	g_bytes_unref(pp->bytes);
+	g_free(pp);
+}
+
+static GQuark pool_pixels_quark(void)
+{
+	return g_quark_from_static_string("qgbook-pool-pixels");
+}
+
+/**
+ * @brief 풀 버퍼로 메모리 텍스쳐를 만들고 버퍼 참조를 텍스쳐에 넘깁니다.
+ */
+static GdkTexture* texture_from_pool(int width, int height, GdkMemoryFormat format, GBytes* bytes, gsize stride)
+{
+	GdkTexture* texture = gdk_memory_texture_new(width, height, format, bytes, stride);
+	PoolPixels* pp = g_new(PoolPixels, 1);
+	pp->bytes = bytes;
+	pp->stride = stride;
+	g_object_set_qdata_full(G_OBJECT(texture), pool_pixels_quark(), pp, pool_pixels_free);
+	return texture;
+}
+
+#pragma region libjpeg-turbo
+#ifdef HAVE_LIBJPEG
+/**
+ * @brief libjpeg 오류 처리, 오류가 나면 setjmp로 돌아간다
+ */
+typedef struct JpegError
+{
+	struct jpeg_error_mgr base;   ///< libjpeg 오류 관리자
+	jmp_buf jump;                 ///< 돌아갈 곳
+} JpegError;
+
+/**
+ * @brief libjpeg 오류 콜백, 메시지를 남기고 돌아갑니다.
+ */
+static void jpeg_error_exit(j_common_ptr cinfo)
+{
+	JpegError* err = (JpegError*)cinfo->err;
+	char msg[JMSG_LENGTH_MAX];
+	err->base.format_message(cinfo, msg);
+	g_log("DECODER", G_LOG_LEVEL_DEBUG, "libjpeg: %s", msg);
+	longjmp(err->jump, 1);
+}
+
+/**
+ * @brief libjpeg 경고 콜백, 조용히 넘어갑니다.
+ */
+static void jpeg_silent_message(j_common_ptr cinfo)
+{
+}
+
+/**
+ * @brief 재시작 마커로 나눈 JPEG 띠 하나
+ */
+typedef struct JpegStrip
+{
+	guint8* jpeg;                 ///< 이 띠만 담은 JPEG (헤더 + 엔트로피 구간들 + EOI)
+	gsize size;                   ///< jpeg 크기
+	guint top;                    ///< 원래 그림에서 띠의 윗줄
+	guint rows;                   ///< 띠의 원래 줄 수
+	guint skip;                   ///< 위에 덧붙여 풀고 버릴 원래 줄 수
+
+	J_COLOR_SPACE space;          ///< 출력 색 공간
+	unsigned int denom;           ///< 줄이는 비율 (1/denom)
+	guint8* out;                  ///< 출력 버퍼에서 띠가 시작하는 곳
+	gsize stride;                 ///< 출력 줄 간격
+	GCancellable* cancellable;    ///< 취소
+	bool ok;                      ///< 다 풀었으면 true
+} JpegStrip;
+
+static guint read_be16(const guint8* p)
+{
+	return ((guint)p[0] << 8) | p[1];
+}
+
+/**
+ * @brief 재시작 간격(DRI)이 있는 베이스라인 JPEG를 MCU 줄 단위의 띠로 나눕니다.
+ *        재시작 구간은 서로 따로 풀 수 있으므로, 구간과 MCU 줄이 같이 끝나는 곳에서 자르고
+ *        헤더의 높이만 고쳐서 띠마다 온전한 JPEG를 만듭니다.
+ *        세로로 색을 줄인 그림은 경계에서 위아래 줄이 있어야 색을 매끈하게 늘리므로, 이웃 한 칸씩을 더 붙입니다.
+ * @param src JPEG 데이터
+ * @param size 데이터 크기
+ * @param parts 나눌 최대 띠 수
+ * @return JpegStrip 배열, 나눌 수 없으면 NULL
+ */
+static GArray* split_jpeg_restart(const guint8* src, gsize size, guint parts)
+{
+	gsize pos = 2, sof = 0, header_end = 0;
+	guint width = 0, height = 0, ncomp = 0, hmax = 1, vmax = 1, interval = 0;
+	while (header_end == 0 && pos + 4 <= size)
+	{
+		if (src[pos] != 0xFF)
+			return NULL;
+		const guint8 marker = src[pos + 1];
+		if (marker == 0xFF)
+		{
+			pos++;
+			continue;
+		}
+		const gsize len = read_be16(src + pos + 2);
+		if (len < 2 || pos + 2 + len > size)
+			return NULL;
+		if (marker == 0xC0 || marker == 0xC1)
+		{
+			if (len < 8)
+				return NULL;
+			height = read_be16(src + pos + 5);
+			width = read_be16(src + pos + 7);
+			ncomp = src[pos + 9];
+			if (ncomp == 0 || len < 8 + 3 * (gsize)ncomp)
+				return NULL;
+			for (guint i = 0; i < ncomp; i++)
+			{
+				const guint8 hv = src[pos + 11 + 3 * i];
+				hmax = MAX(hmax, (guint)(hv >> 4));
+				vmax = MAX(vmax, (guint)(hv & 15));
+			}
+			sof = pos;
+		}
+		else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			return NULL; // 프로그레시브, 무손실, 산술 부호화는 나누지 않음
+		else if (marker == 0xDD && len >= 4)
+			interval = read_be16(src + pos + 4);
+		else if (marker == 0xDA)
+		{
+			if (sof == 0 || len < 3 || src[pos + 4] != ncomp)
+				return NULL; // 모든 성분이 한 스캔에 있어야
+			header_end = pos + 2 + len;
+		}
+		pos += 2 + len;
+	}
+	if (header_end == 0 || interval == 0 || width == 0 || height == 0)
+		return NULL;
+
+	const guint mcu_width = ncomp == 1 ? 8 : 8 * hmax;
+	const guint mcu_height = ncomp == 1 ? 8 : 8 * vmax;
+	const guint mcus_x = (width + mcu_width - 1) / mcu_width;
+	const guint mcus_y = (height + mcu_height - 1) / mcu_height;
+	const guint64 mcus = (guint64)mcus_x * mcus_y;
+	const guint64 intervals = (mcus + interval - 1) / interval;
+
+	// 재시작 구간과 MCU 줄이 같이 끝나는 단위
+	guint a = interval, b = mcus_x;
+	while (b != 0)
+	{
+		const guint t = a % b;
+		a = b;
+		b = t;
+	}
+	const guint64 unit_mcus = (guint64)interval / a * mcus_x;
+	const guint64 unit_rows = unit_mcus / mcus_x;
+	const guint64 unit_intervals = unit_mcus / interval;
+	const guint64 units = (mcus_y + unit_rows - 1) / unit_rows;
+	if (units < 2)
+		return NULL;
+	const guint64 per_strip = (units + MIN(parts, units) - 1) / MIN(parts, units);
+	const guint strip_count = (guint)((units + per_strip - 1) / per_strip);
+	const guint64 pad = ncomp > 1 && vmax > 1 ? 1 : 0;
+
+	// 엔트로피 데이터에서 재시작 구간의 경계를 찾는다
+	GArray* bounds = g_array_sized_new(false, false, sizeof(gsize), (guint)MIN(intervals + 1, 65536));
+	g_array_append_val(bounds, header_end);
+	const guint8* end = NULL;
+	for (gsize i = header_end; i + 1 < size;)
+	{
+		const guint8* ff = memchr(src + i, 0xFF, size - 1 - i);
+		if (ff == NULL)
+			break;
+		i = (gsize)(ff - src);
+		const guint8 m = src[i + 1];
+		if (m == 0x00 || m == 0xFF)
+		{
+			i++;
+			continue;
+		}
+		if (m >= 0xD0 && m <= 0xD7)
+		{
+			const gsize next = i + 2;
+			g_array_append_val(bounds, next);
+			i = next;
+			continue;
+		}
+		end = src + i;
+		break;
+	}
+	if (end == NULL || bounds->len != intervals)
+	{
+		g_array_free(bounds, true);
+		return NULL;
+	}
+	const gsize* starts = (const gsize*)bounds->data;
+
+	GArray* strips = g_array_sized_new(false, true, sizeof(JpegStrip), strip_count);
+	for (guint s = 0; s < strip_count; s++)
+	{
+		const guint64 first_unit = s * per_strip;
+		const guint64 last_unit = MIN(units, first_unit + per_strip);
+		const guint64 pad_first = first_unit > pad ? first_unit - pad : 0;
+		const guint64 pad_last = MIN(units, last_unit + pad);
+		const guint first = (guint)(pad_first * unit_intervals);
+		const guint last = (guint)MIN(intervals, pad_last * unit_intervals);
+		const guint top = (guint)(first_unit * unit_rows * mcu_height);
+		const guint bottom = (guint)MIN(height, last_unit * unit_rows * mcu_height);
+		const guint pad_top = (guint)(pad_first * unit_rows * mcu_height);
+		const guint pad_rows = (guint)MIN(height, pad_last * unit_rows * mcu_height) - pad_top;
+
+		// 각 구간은 다음 구간 시작 앞의 RST 두 바이트를 빼고 담는다
+		gsize total = header_end + 2;
+		for (guint j = first; j < last; j++)
+			total += (j + 1 < intervals ? starts[j + 1] - 2 : (gsize)(end - src)) - starts[j] + 2;
+
+		JpegStrip strip = { .top = top, .rows = bottom - top, .skip = top - pad_top };
+		strip.jpeg = g_malloc(total);
+		guint8* p = strip.jpeg;
+		memcpy(p, src, header_end);
+		p[sof + 5] = (guint8)(pad_rows >> 8);
+		p[sof + 6] = (guint8)pad_rows;
+		p += header_end;
+		for (guint j = first; j < last; j++)
+		{
+			if (j > first)
+			{
+				*p++ = 0xFF;
+				*p++ = (guint8)(0xD0 + ((j - first - 1) & 7));
+			}
+			const gsize seg_end = j + 1 < intervals ? starts[j + 1] - 2 : (gsize)(end - src);
+			memcpy(p, src + starts[j], seg_end - starts[j]);
+			p += seg_end - starts[j];
+		}
+		*p++ = 0xFF;
+		*p++ = 0xD9;
+		strip.size = (gsize)(p - strip.jpeg);
+		g_array_append_val(strips, strip);
+	}
+
+	g_array_free(bounds, true);
+	return strips;
+}
+
+/**
+ * @brief 띠 하나를 풀어서 출력 버퍼의 자기 자리에 씁니다. 띠끼리 쓰는 곳이 겹치지 않습니다.
+ * @param data JpegStrip 포인터
+ * @return NULL
+ */
+static gpointer thread_jpeg_strip(gpointer data)
+{
+	JpegStrip* strip = data;
+	struct jpeg_decompress_struct cinfo;
+	JpegError jerr;
+
+	cinfo.err = jpeg_std_error(&jerr.base);
+	jerr.base.error_exit = jpeg_error_exit;
+	jerr.base.output_message = jpeg_silent_message;
+	if (setjmp(jerr.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	jpeg_mem_src(&cinfo, strip->jpeg, (unsigned long)strip->size);
+	jpeg_read_header(&cinfo, TRUE);
+	cinfo.out_color_space = strip->space;
+	cinfo.scale_num = 1;
+	cinfo.scale_denom = strip->denom;
+	jpeg_start_decompress(&cinfo);
+
+	// 덧붙인 윗줄은 첫 줄 자리에 풀었다가 덮어쓴다
+	const JDIMENSION skip = strip->skip / strip->denom;
+	const JDIMENSION rows = skip + (strip->rows + strip->denom - 1) / strip->denom;
+	if ((gsize)cinfo.output_width * (gsize)cinfo.output_components == strip->stride && rows <= cinfo.output_height)
+	{
+		while (cinfo.output_scanline < rows)
+		{
+			if (cinfo.output_scanline % DECODE_CANCEL_ROWS == 0 && g_cancellable_is_cancelled(strip->cancellable))
+				break;
+			JSAMPROW row = strip->out + (gsize)(cinfo.output_scanline < skip ? 0 : cinfo.output_scanline - skip) * strip->stride;
+			jpeg_read_scanlines(&cinfo, &row, 1);
+		}
+		strip->ok = cinfo.output_scanline == rows;
+	}
+	// 덧붙인 아랫줄은 풀지 않고 끝낸다
+	jpeg_destroy_decompress(&cinfo);
+	return NULL;
+}
+
+#ifndef JCS_EXTENSIONS
+// RGB로 푼 줄을 그 자리에서 BGRA로 늘린다, JCS_EXT_BGRA가 없는 libjpeg용
+static void jpeg_expand_bgra(guint8* row, JDIMENSION width)
+{
+	// 뒤에서부터 늘려야 아직 안 옮긴 RGB를 덮지 않는다
+	for (JDIMENSION x = width; x-- > 0;)
+	{
+		const guint8 r = row[x * 3 + 0], g = row[x * 3 + 1], b = row[x * 3 + 2];
+		guint8* p = row + (gsize)x * 4;
+		p[0] = b;
+		p[1] = g;
+		p[2] = r;
+		p[3] = 255;
+	}
+}
+#endif
+
+/**
+ * @brief 재시작 마커가 있는 큰 JPEG를 띠로 나눠 여러 스레드로 풉니다.
+ *        나눌 수 없거나 일꾼이 없으면 false이고, 그때는 한 스레드로 풀면 됩니다.
+ * @param src JPEG 데이터
+ * @param size 데이터 크기
+ * @param cinfo 헤더를 읽고 출력 크기를 정한 디코드 구조체
+ * @param pixels 출력 버퍼
+ * @param stride 출력 줄 간격
+ * @param cancellable 취소
+ * @return 다 풀었으면 true
+ */
+static bool decode_jpeg_parallel(const guint8* src, gsize size, const struct jpeg_decompress_struct* cinfo,
+	guint8* pixels, gsize stride, GCancellable* cancellable)
+{
+	const int threads = decoder_acquire_workers((int)g_get_num_processors());
+	GArray* strips = threads > 1 ? split_jpeg_restart(src, size, (guint)threads) : NULL;
+	if (strips == NULL)
+	{
+		decoder_release_workers(threads);
+		return false;
+	}
+
+	// 줄인 띠의 높이가 모두 맞아 떨어져야 이어 붙일 수 있다
+	JpegStrip* list = (JpegStrip*)strips->data;
+	const unsigned int denom = cinfo->scale_denom;
+	bool ok = true;
+	guint out_rows = 0;
+	for (guint i = 0; i < strips->len; i++)
+	{
+		if (i + 1 < strips->len && list[i].rows % denom != 0)
+			ok = false;
+		list[i].space = cinfo->out_color_space;
+		list[i].denom = denom;
+		list[i].out = pixels + (gsize)(list[i].top / denom) * stride;
+		list[i].stride = stride;
+		list[i].cancellable = cancellable;
+		out_rows += (list[i].rows + denom - 1) / denom;
+	}
+	if (out_rows != cinfo->output_height)
+		ok = false;
+
+	if (ok)
+	{
+		GThread** workers = g_new0(GThread*, strips->len);
+		for (guint i = 1; i < strips->len; i++)
+			workers[i] = g_thread_try_new("jpeg strip", thread_jpeg_strip, &list[i], NULL);
+		thread_jpeg_strip(&list[0]);
+		for (guint i = 1; i < strips->len; i++)
+		{
+			if (workers[i] != NULL)
+				g_thread_join(workers[i]);
+			else
+				thread_jpeg_strip(&list[i]);
+		}
+		g_free(workers);
+
+		for (guint i = 0; i < strips->len; i++)
+			ok = ok && list[i].ok;
+	}
+
+	for (guint i = 0; i < strips->len; i++)
+		g_free(list[i].jpeg);
+	g_array_free(strips, true);
+	decoder_release_workers(threads);
+	return ok;
+}
+
+/**
+ * @brief JPEG를 libjpeg-turbo로 풉니다. DCT 단계에서 1/2, 1/4, 1/8로 줄여서 풀 수 있습니다.
+ *        재시작 마커가 있는 큰 그림은 띠로 나눠 여러 스레드로 풀고, CMYK는 gdk-pixbuf에게 넘깁니다.
+ */
+static GdkTexture* decode_jpeg(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	struct jpeg_decompress_struct cinfo;
+	JpegError jerr;
+	GBytes* volatile bytes = NULL;
+
+	cinfo.err = jpeg_std_error(&jerr.base);
+	jerr.base.error_exit = jpeg_error_exit;
+	jerr.base.output_message = jpeg_silent_message;
+	if (setjmp(jerr.jump))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		if (bytes != NULL)
+			g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	jpeg_create_decompress(&cinfo);
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+	jpeg_mem_src(&cinfo, src, (unsigned long)size);
+	jpeg_read_header(&cinfo, TRUE);
+
+	if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK)
+	{
+		jpeg_destroy_decompress(&cinfo);
+		return NULL;
+	}
+
+	GdkMemoryFormat format;
+	bool expand = false; // RGB로 풀어서 BGRA로 늘림
+	if (params->format == DECODE_FORMAT_PREMULTIPLIED)
+	{
+		// 알파는 늘 255라서 곱할 것이 없다
+#ifdef JCS_EXTENSIONS
+		cinfo.out_color_space = JCS_EXT_BGRA;
+#else
+		// libjpeg-turbo가 아니면 BGRA로 못 푼다
+		cinfo.out_color_space = JCS_RGB;
+		expand = true;
+#endif
+		format = GDK_MEMORY_B8G8R8A8_PREMULTIPLIED;
+	}
+#ifdef DOUMI_GRAY_TEXTURE
+	else if (cinfo.num_components == 1)
+	{
+		cinfo.out_color_space = JCS_GRAYSCALE;
+		format = GDK_MEMORY_G8;
+	}
+#endif
+	else
+	{
+		cinfo.out_color_space = JCS_RGB;
+		format = GDK_MEMORY_R8G8B8;
+	}
+
+	if (params->draft)
+	{
+		// 미리보기는 빠른 정수 IDCT에 단순 늘이기
+		cinfo.dct_method = JDCT_IFAST;
+		cinfo.do_fancy_upsampling = FALSE;
+		cinfo.do_block_smoothing = FALSE;
+	}
+
+	int width = (int)cinfo.image_width, height = (int)cinfo.image_height;
+	if (fit_scaled_size(params, &width, &height))
+	{
+		// 요청보다 작아지지 않는 만큼만
+		unsigned int denom = 1;
+		while (denom < 8 && cinfo.image_width / (denom * 2) >= (unsigned int)width &&
+			cinfo.image_height / (denom * 2) >= (unsigned int)height)
+			denom *= 2;
+		cinfo.scale_num = 1;
+		cinfo.scale_denom = denom;
+	}
+
+	jpeg_calc_output_dimensions(&cinfo);
+	const gsize stride = (gsize)cinfo.output_width * (gsize)(expand ? 4 : cinfo.output_components);
+	gpointer pixels;
+	bytes = bufpool_bytes_new(stride * cinfo.output_height, &pixels);
+
+	if (!params->draft && !expand && cinfo.restart_interval > 0 && (gsize)cinfo.image_width * cinfo.image_height >= JPEG_PARALLEL_PIXELS &&
+		decode_jpeg_parallel(src, size, &cinfo, pixels, stride, params->cancellable))
+	{
+		width = (int)cinfo.output_width;
+		height = (int)cinfo.output_height;
+		jpeg_destroy_decompress(&cinfo);
+		return texture_from_pool(width, height, format, bytes, stride);
+	}
+	if (g_cancellable_set_error_if_cancelled(params->cancellable, error))
+	{
+		jpeg_destroy_decompress(&cinfo);
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	jpeg_start_decompress(&cinfo);
+	while (cinfo.output_scanline < cinfo.output_height)
+	{
+		if (cinfo.output_scanline % DECODE_CANCEL_ROWS == 0 &&
+			g_cancellable_set_error_if_cancelled(params->cancellable, error))
+		{
+			jpeg_destroy_decompress(&cinfo);
+			g_bytes_unref(bytes);
+			return NULL;
+		}
+		JSAMPROW row = (JSAMPROW)pixels + (gsize)cinfo.output_scanline * stride;
+		jpeg_read_scanlines(&cinfo, &row, 1);
+#ifndef JCS_EXTENSIONS
+		if (expand)
+			jpeg_expand_bgra(row, cinfo.output_width);
+#endif
+	}
+
+	width = (int)cinfo.output_width;
+	height = (int)cinfo.output_height;
+	jpeg_finish_decompress(&cinfo);
+	jpeg_destroy_decompress(&cinfo);
+	return texture_from_pool(width, height, format, bytes, stride);
+}
+
+#ifdef LIBJPEG_TURBO_VERSION
+static const Decoder jpeg_decoder = { "libjpeg-turbo", decode_jpeg };
+#else
+static const Decoder jpeg_decoder = { "libjpeg", decode_jpeg };
+#endif
+#endif
+#pragma endregion
+
+#pragma region libpng
+#ifdef HAVE_LIBPNG
+/**
+ * @brief PNG를 libpng 간단 API로 풉니다. 팔레트와 16비트는 8비트로 바꿔서 받습니다.
+ *        줄여서 풀지는 못하므로 원래 크기로 풉니다.
+ */
+static GdkTexture* decode_png(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	png_image image;
+	memset(&image, 0, sizeof(image));
+	image.version = PNG_IMAGE_VERSION;
+
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+	if (!png_image_begin_read_from_memory(&image, src, size))
+	{
+		g_log("DECODER", G_LOG_LEVEL_DEBUG, "libpng: %s", image.message);
+		return NULL;
+	}
+
+	const bool alpha = (image.format & PNG_FORMAT_FLAG_ALPHA) != 0;
+	const bool color = (image.format & PNG_FORMAT_FLAG_COLOR) != 0;
+	GdkMemoryFormat format;
+	bool premultiply = false, premultiply_gray = false;
+#ifdef DOUMI_GRAY_TEXTURE
+	const bool bgra = params->format == DECODE_FORMAT_PREMULTIPLIED || (alpha && color);
+#else
+	// 회색 텍스쳐가 없으면 회색 알파도 BGRA로 해야 투명이 남는다
+	const bool bgra = params->format == DECODE_FORMAT_PREMULTIPLIED || alpha;
+#endif
+	if (bgra)
+	{
+		// 읽은 뒤 그 자리에서 곱한 알파 BGRA로
+		image.format = PNG_FORMAT_RGBA;
+		format = GDK_MEMORY_B8G8R8A8_PREMULTIPLIED;
+		premultiply = true;
+	}
+#ifdef DOUMI_GRAY_TEXTURE
+	else if (!color)
+	{
+		// 회색 알파도 다른 디코더처럼 곱한 알파로
+		image.format = alpha ? PNG_FORMAT_GA : PNG_FORMAT_GRAY;
+		format = alpha ? GDK_MEMORY_G8A8_PREMULTIPLIED : GDK_MEMORY_G8;
+		premultiply_gray = alpha;
+	}
+#endif
+	else
+	{
+		image.format = PNG_FORMAT_RGB;
+		format = GDK_MEMORY_R8G8B8;
+	}
+
+	if (g_cancellable_set_error_if_cancelled(params->cancellable, error))
+	{
+		png_image_free(&image);
+		return NULL;
+	}
+
+	const gsize stride = PNG_IMAGE_ROW_STRIDE(image);
+	gpointer pixels;
+	GBytes* bytes = bufpool_bytes_new(PNG_IMAGE_BUFFER_SIZE(image, stride), &pixels);
+	if (!png_image_finish_read(&image, NULL, pixels, (png_int_32)stride, NULL))
+	{
+		g_log("DECODER", G_LOG_LEVEL_DEBUG, "libpng: %s", image.message);
+		png_image_free(&image);
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	if (premultiply)
+		doumi_premultiply_rgba_to_bgra(pixels, (int)image.width, (int)image.height, stride);
+	else if (premultiply_gray)
+	{
+		for (png_uint_32 y = 0; y < image.height; y++)
+		{
+			guint8* p = (guint8*)pixels + (gsize)y * stride;
+			for (png_uint_32 x = 0; x < image.width; x++, p += 2)
+				p[0] = (guint8)((p[0] * p[1] + 127) / 255);
+		}
+	}
+	return texture_from_pool((int)image.width, (int)image.height, format, bytes, stride);
+}
+
+static const Decoder png_decoder = { "libpng", decode_png };
+#endif
+#pragma endregion
+
+#pragma region libwebp
+#ifdef HAVE_LIBWEBP
+/**
+ * @brief WebP를 libwebp로 풉니다. 필터링은 스레드를 쓰고, 줄여서 풀 수 있습니다.
+ *        나눠서 넣으면서 취소를 확인합니다. 애니메이션은 gdk-pixbuf에게 넘깁니다.
+ */
+static GdkTexture* decode_webp(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+
+	WebPDecoderConfig config;
+	if (!WebPInitDecoderConfig(&config) || WebPGetFeatures(src, size, &config.input) != VP8_STATUS_OK)
+		return NULL;
+	if (config.input.has_animation)
+		return NULL;
+
+	int width = config.input.width, height = config.input.height;
+	config.options.use_threads = 1;
+	if (fit_scaled_size(params, &width, &height))
+	{
+		config.options.use_scaling = 1;
+		config.options.scaled_width = width;
+		config.options.scaled_height = height;
+	}
+
+	const bool bgra = config.input.has_alpha || params->format == DECODE_FORMAT_PREMULTIPLIED;
+	const gsize stride = (gsize)width * (bgra ? 4 : 3);
+	gpointer pixels;
+	GBytes* bytes = bufpool_bytes_new(stride * (gsize)height, &pixels);
+	config.output.colorspace = bgra ? MODE_bgrA : MODE_RGB;
+	config.output.is_external_memory = 1;
+	config.output.u.RGBA.rgba = pixels;
+	config.output.u.RGBA.stride = (int)stride;
+	config.output.u.RGBA.size = stride * (gsize)height;
+
+	WebPIDecoder* idec = WebPIDecode(NULL, 0, &config);
+	VP8StatusCode status = idec != NULL ? VP8_STATUS_SUSPENDED : VP8_STATUS_OUT_OF_MEMORY;
+	for (gsize offset = 0; offset < size && status == VP8_STATUS_SUSPENDED; offset += DECODE_CHUNK_SIZE)
+	{
+		if (g_cancellable_set_error_if_cancelled(params->cancellable, error))
+			break;
+		status = WebPIAppend(idec, src + offset, MIN(DECODE_CHUNK_SIZE, size - offset));
+	}
+	if (idec != NULL)
+		WebPIDelete(idec);
+	WebPFreeDecBuffer(&config.output);
+
+	if (status != VP8_STATUS_OK)
+	{
+		if (status != VP8_STATUS_SUSPENDED)
+			g_log("DECODER", G_LOG_LEVEL_DEBUG, "libwebp: status %d", status);
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+	return texture_from_pool(width, height, bgra ? GDK_MEMORY_B8G8R8A8_PREMULTIPLIED : GDK_MEMORY_R8G8B8, bytes, stride);
+}
+
+static const Decoder webp_decoder = { "libwebp", decode_webp };
+#endif
+#pragma endregion
+
+#pragma region libjxl
+#ifdef HAVE_LIBJXL
+/**
+ * @brief JPEG XL을 libjxl로 풉니다. 스레드는 남은 일꾼만큼만 씁니다.
+ *        애니메이션이면 첫 장만 풉니다. 줄여서 풀지는 못하므로 원래 크기로 풉니다.
+ */
+static GdkTexture* decode_jxl(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+
+	JxlDecoder* dec = JxlDecoderCreate(NULL);
+	void* runner = JxlResizableParallelRunnerCreate(NULL);
+	if (dec == NULL || runner == NULL ||
+		JxlDecoderSubscribeEvents(dec, JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE) != JXL_DEC_SUCCESS ||
+		JxlDecoderSetParallelRunner(dec, JxlResizableParallelRunner, runner) != JXL_DEC_SUCCESS ||
+		JxlDecoderSetInput(dec, src, size) != JXL_DEC_SUCCESS)
+	{
+		if (runner != NULL)
+			JxlResizableParallelRunnerDestroy(runner);
+		if (dec != NULL)
+			JxlDecoderDestroy(dec);
+		return NULL;
+	}
+	JxlDecoderCloseInput(dec);
+
+	int threads = 0;
+	JxlBasicInfo bi;
+	JxlPixelFormat pf = { 4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 };
+	GdkMemoryFormat format = GDK_MEMORY_R8G8B8;
+	bool premultiply = false;
+	GBytes* bytes = NULL;
+	gpointer pixels = NULL;
+	bool done = false;
+
+	while (!done)
+	{
+		if (g_cancellable_set_error_if_cancelled(params->cancellable, error))
+			break;
+
+		const JxlDecoderStatus status = JxlDecoderProcessInput(dec);
+		if (status == JXL_DEC_BASIC_INFO)
+		{
+			if (JxlDecoderGetBasicInfo(dec, &bi) != JXL_DEC_SUCCESS)
+				break;
+			threads = decoder_acquire_workers((int)JxlResizableParallelRunnerSuggestThreads(bi.xsize, bi.ysize));
+			JxlResizableParallelRunnerSetThreads(runner, (size_t)threads);
+
+			const bool alpha = bi.alpha_bits > 0;
+			if (alpha || params->format == DECODE_FORMAT_PREMULTIPLIED)
+			{
+				// 곱하지 않은 RGBA로 받아서 곱한 알파 BGRA로
+				pf.num_channels = 4;
+				format = GDK_MEMORY_B8G8R8A8_PREMULTIPLIED;
+				premultiply = true;
+				if (bi.alpha_premultiplied)
+					JxlDecoderSetUnpremultiplyAlpha(dec, JXL_TRUE);
+			}
+#ifdef DOUMI_GRAY_TEXTURE
+			else if (bi.num_color_channels == 1)
+			{
+				pf.num_channels = 1;
+				format = GDK_MEMORY_G8;
+			}
+#endif
+			else
+			{
+				pf.num_channels = 3;
+				format = GDK_MEMORY_R8G8B8;
+			}
+		}
+		else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER)
+		{
+			size_t need;
+			if (bytes != NULL || JxlDecoderImageOutBufferSize(dec, &pf, &need) != JXL_DEC_SUCCESS)
+				break;
+			bytes = bufpool_bytes_new(need, &pixels);
+			if (JxlDecoderSetImageOutBuffer(dec, &pf, pixels, need) != JXL_DEC_SUCCESS)
+				break;
+		}
+		else if (status == JXL_DEC_FULL_IMAGE)
+			done = bytes != NULL; // 첫 장만
+		else
+		{
+			if (status != JXL_DEC_SUCCESS)
+				g_log("DECODER", G_LOG_LEVEL_DEBUG, "libjxl: status %d", status);
+			break;
+		}
+	}
+
+	if (threads > 0)
+		decoder_release_workers(threads);
+	JxlResizableParallelRunnerDestroy(runner);
+	JxlDecoderDestroy(dec);
+
+	if (!done)
+	{
+		if (bytes != NULL)
+			g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	const gsize stride = (gsize)bi.xsize * pf.num_channels;
+	if (premultiply)
+		doumi_premultiply_rgba_to_bgra(pixels, (int)bi.xsize, (int)bi.ysize, stride);
+	return texture_from_pool((int)bi.xsize, (int)bi.ysize, format, bytes, stride);
+}
+
+static const Decoder jxl_decoder = { "libjxl", decode_jxl };
+#endif
+#pragma endregion
+
+#pragma region libavif
+#ifdef HAVE_LIBAVIF
+/**
+ * @brief AVIF를 libavif(dav1d 등)로 풉니다. 스레드는 남은 일꾼만큼만 씁니다.
+ *        연속 그림이면 첫 장만 풉니다. 줄여서 풀지는 못하므로 원래 크기로 풉니다.
+ */
+static GdkTexture* decode_avif(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+
+	avifDecoder* dec = avifDecoderCreate();
+	if (dec == NULL)
+		return NULL;
+	const int threads = decoder_acquire_workers((int)g_get_num_processors());
+	dec->maxThreads = threads;
+
+	GdkTexture* texture = NULL;
+	avifResult result = avifDecoderSetIOMemory(dec, src, size);
+	if (result == AVIF_RESULT_OK)
+		result = avifDecoderParse(dec);
+	const bool cancelled = g_cancellable_set_error_if_cancelled(params->cancellable, error);
+	if (result == AVIF_RESULT_OK && !cancelled)
+		result = avifDecoderNextImage(dec);
+
+	if (result == AVIF_RESULT_OK && !cancelled)
+	{
+		const bool bgra = dec->alphaPresent || params->format == DECODE_FORMAT_PREMULTIPLIED;
+		avifRGBImage rgb;
+		avifRGBImageSetDefaults(&rgb, dec->image);
+		rgb.depth = 8;
+		rgb.format = bgra ? AVIF_RGB_FORMAT_BGRA : AVIF_RGB_FORMAT_RGB;
+		rgb.alphaPremultiplied = bgra ? AVIF_TRUE : AVIF_FALSE;
+		rgb.rowBytes = rgb.width * (bgra ? 4 : 3);
+
+		gpointer pixels;
+		GBytes* bytes = bufpool_bytes_new((gsize)rgb.rowBytes * rgb.height, &pixels);
+		rgb.pixels = pixels;
+		result = avifImageYUVToRGB(dec->image, &rgb);
+		if (result == AVIF_RESULT_OK)
+		{
+			texture = texture_from_pool((int)rgb.width, (int)rgb.height,
+				bgra ? GDK_MEMORY_B8G8R8A8_PREMULTIPLIED : GDK_MEMORY_R8G8B8, bytes, rgb.rowBytes);
+		}
+		else
+			g_bytes_unref(bytes);
+	}
+
+	if (result != AVIF_RESULT_OK)
+		g_log("DECODER", G_LOG_LEVEL_DEBUG, "libavif: %s", avifResultToString(result));
+	decoder_release_workers(threads);
+	avifDecoderDestroy(dec);
+	return texture;
+}
+
+static const Decoder avif_decoder = { "libavif", decode_avif };
+#endif
+#pragma endregion
+
+#pragma region gdk-pixbuf
+/**
+ * @brief 줄여서 풀 크기를 로더에 알려줍니다.
+ */
+static void cb_pixbuf_size_prepared(GdkPixbufLoader* loader, int width, int height, gpointer user_data)
+{
+	const DecodeParams* params = user_data;
+	if (fit_scaled_size(params, &width, &height))
+		gdk_pixbuf_loader_set_size(loader, width, height);
+}
+
+/**
+ * @brief 회색 텍스쳐로 다시 만듭니다. 받을 버퍼는 버퍼 풀에서
+ * @param texture 원래 텍스쳐 (참조를 가져감)
+ * @param channels 1이면 G8, 2면 G8A8
+ */
+static GdkTexture* convert_gray_texture(GdkTexture* texture, int channels)
+{
+#ifdef DOUMI_GRAY_TEXTURE
+	const GdkMemoryFormat format = channels == 1 ? GDK_MEMORY_G8 : GDK_MEMORY_G8A8_PREMULTIPLIED;
+	const int width = gdk_texture_get_width(texture);
+	const int height = gdk_texture_get_height(texture);
+	const gsize stride = (gsize)width * (gsize)channels;
+	gpointer pixels;
+	GBytes* bytes = bufpool_bytes_new(stride * (gsize)height, &pixels);
+	GdkTextureDownloader* downloader = gdk_texture_downloader_new(texture);
+	gdk_texture_downloader_set_format(downloader, format);
+	gdk_texture_downloader_download_into(downloader, pixels, stride);
+	gdk_texture_downloader_free(downloader);
+	g_object_unref(texture);
+	return texture_from_pool(width, height, format, bytes, stride);
+#else
+	return texture;
+#endif
+}
+
+/**
+ * @brief 픽스버프를 텍스쳐로 만듭니다. 알파가 있으면 그 자리에서 곱한 알파 BGRA로 바꿔서 픽스버프 메모리를 그대로 씁니다.
+ */
+static GdkTexture* texture_from_pixbuf(GdkPixbuf* pixbuf, DecodeFormat want)
+{
+	const int width = gdk_pixbuf_get_width(pixbuf);
+	const int height = gdk_pixbuf_get_height(pixbuf);
+	const gsize stride = (gsize)gdk_pixbuf_get_rowstride(pixbuf);
+	guint8* src = gdk_pixbuf_get_pixels(pixbuf);
+
+	if (gdk_pixbuf_get_bits_per_sample(pixbuf) != 8)
+		return gdk_texture_new_for_pixbuf(pixbuf);
+
+	if (gdk_pixbuf_get_has_alpha(pixbuf))
+	{
+		doumi_premultiply_rgba_to_bgra(src, width, height, stride);
+		// 마지막 줄은 rowstride보다 짧을 수 있다
+		GBytes* bytes = g_bytes_new_with_free_func(
+			src, stride * (gsize)(height - 1) + (gsize)width * 4, g_object_unref, g_object_ref(pixbuf));
+		return texture_from_pool(width, height, GDK_MEMORY_B8G8R8A8_PREMULTIPLIED, bytes, stride);
+	}
+
+	if (want == DECODE_FORMAT_PREMULTIPLIED)
+	{
+		// 불투명한 RGB를 BGRA로 옮겨 담는다
+		const gsize dst_stride = (gsize)width * 4;
+		gpointer pixels;
+		GBytes* bytes = bufpool_bytes_new(dst_stride * (gsize)height, &pixels);
+		for (int y = 0; y < height; y++)
+		{
+			const guint8* s = src + (gsize)y * stride;
+			guint8* d = (guint8*)pixels + (gsize)y * dst_stride;
+			for (int x = 0; x < width; x++, s += 3, d += 4)
+			{
+				d[0] = s[2];
+				d[1] = s[1];
+				d[2] = s[0];
+				d[3] = 255;
+			}
+		}
+		return texture_from_pool(width, height, GDK_MEMORY_B8G8R8A8_PREMULTIPLIED, bytes, dst_stride);
+	}
+
+	GBytes* bytes = gdk_pixbuf_read_pixel_bytes(pixbuf);
+	return texture_from_pool(width, height, GDK_MEMORY_R8G8B8, bytes, stride);
+}
+
+/**
+ * @brief gdk-pixbuf로 풉니다. 모든 형식의 마지막 수단
+ *        원래 크기에 AUTO 형식이고 알파가 없으면 GTK의 로더(gdk_texture_new_from_bytes)를 씁니다.
+ */
+static GdkTexture* decode_pixbuf(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	const bool scaled = params->max_width > 0 && params->max_height > 0;
+	if (!scaled && params->format == DECODE_FORMAT_AUTO && info->channels != 4)
+	{
+		GdkTexture* texture = gdk_texture_new_from_bytes(data, error);
+		if (texture != NULL && (info->channels == 1 || info->channels == 2))
+			texture = convert_gray_texture(texture, info->channels);
+		return texture;
+	}
+
+	GdkPixbufLoader* loader = gdk_pixbuf_loader_new();
+	if (scaled)
+		g_signal_connect(loader, "size-prepared", G_CALLBACK(cb_pixbuf_size_prepared), (gpointer)params);
+
+	gsize size;
+	const guint8* src = g_bytes_get_data(data, &size);
+	bool ok = true, cancelled = false;
+	for (gsize offset = 0; ok && offset < size; offset += DECODE_CHUNK_SIZE)
+	{
+		if ((cancelled = g_cancellable_set_error_if_cancelled(params->cancellable, error)))
+			break;
+		ok = gdk_pixbuf_loader_write(loader, src + offset, MIN(DECODE_CHUNK_SIZE, size - offset), error);
+	}
+	// 쓰기가 실패하면 로더가 알아서 닫는다
+	if (cancelled)
+	{
+		gdk_pixbuf_loader_close(loader, NULL);
+		ok = false;
+	}
+	else if (ok)
+		ok = gdk_pixbuf_loader_close(loader, error);
+
+	GdkPixbuf* pixbuf = ok ? gdk_pixbuf_loader_get_pixbuf(loader) : NULL;
+	GdkTexture* texture = pixbuf != NULL ? texture_from_pixbuf(pixbuf, params->format) : NULL;
+	g_object_unref(loader);
+	return texture;
+}
+#pragma endregion
+
+/**
+ * @brief 빌드할 때 찾은 디코더를 넣습니다. (GOnce로 한번만)
+ */
+static gpointer once_init_decoders(gpointer data)
+{
+#ifdef HAVE_LIBJPEG
+	decoders[IMAGE_FILE_TYPE_JPEG] = &jpeg_decoder;
+#endif
+#ifdef HAVE_LIBPNG
+	decoders[IMAGE_FILE_TYPE_PNG] = &png_decoder;
+#endif
+#ifdef HAVE_LIBWEBP
+	decoders[IMAGE_FILE_TYPE_WEBP] = &webp_decoder;
+#endif
+#ifdef HAVE_LIBJXL
+	decoders[IMAGE_FILE_TYPE_JXL] = &jxl_decoder;
+#endif
+#ifdef HAVE_LIBAVIF
+	decoders[IMAGE_FILE_TYPE_AVIF] = &avif_decoder;
+#endif
+	return NULL;
+}
+
+// 디코더 넣기
+void decoder_register(ImageFileType type, const Decoder* decoder)
+{
+	g_return_if_fail(type > IMAGE_FILE_TYPE_UNKNOWN && type < IMAGE_FILE_TYPE_MAX_VALUE);
+	g_once(&decoder_once, once_init_decoders, NULL);
+	decoders[type] = decoder;
+}
+
+// 디코더 이름
+const char* decoder_get_name(ImageFileType type)
+{
+	g_once(&decoder_once, once_init_decoders, NULL);
+	const Decoder* decoder = type > IMAGE_FILE_TYPE_UNKNOWN && type < IMAGE_FILE_TYPE_MAX_VALUE ? decoders[type] : NULL;
+	return decoder != NULL ? decoder->name : "gdk-pixbuf";
+}
+
+// 쪽 그림 풀기
+GdkTexture* decoder_decode(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error)
+{
+	static const DecodeParams default_params = { 0 };
+	g_return_val_if_fail(data != NULL && info != NULL, NULL);
+	if (params == NULL)
+		params = &default_params;
+
+	g_once(&decoder_once, once_init_decoders, NULL);
+	if (g_cancellable_set_error_if_cancelled(params->cancellable, error))
+		return NULL;
+
+	const Decoder* decoder = info->type < IMAGE_FILE_TYPE_MAX_VALUE ? decoders[info->type] : NULL;
+	if (decoder != NULL && !info->has_anim)
+	{
+		GError* err = NULL;
+		GdkTexture* texture = decoder->decode(data, info, params, &err);
+		if (texture != NULL)
+			return texture;
+		if (err != NULL && g_error_matches(err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+		{
+			g_propagate_error(error, err);
+			return NULL;
+		}
+		g_clear_error(&err);
+		g_log("DECODER", G_LOG_LEVEL_DEBUG, "%s failed, falling back to gdk-pixbuf", decoder->name);
+	}
+
+	return decode_pixbuf(data, info, params, error);
+}
+
+#pragma region 미리보기
+static guint exif_read16(const guint8* p, bool le)
+{
+	return le ? ((guint)p[1] << 8) | p[0] : ((guint)p[0] << 8) | p[1];
+}
+
+static guint32 exif_read32(const guint8* p, bool le)
+{
+	return le ? ((guint32)p[3] << 24) | ((guint32)p[2] << 16) | ((guint32)p[1] << 8) | p[0] :
+		((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief JPEG 헤더를 훑어서 프로그레시브인지와 EXIF 썸네일(IFD1의 JPEGInterchangeFormat)의 위치를 얻습니다.
+ * @param src JPEG 데이터
+ * @param size 데이터 크기
+ * @param progressive 프로그레시브면 true를 받음
+ * @param offset 썸네일 시작 위치를 받음
+ * @param length 썸네일 크기를 받음
+ * @return 썸네일이 있으면 true
+ */
+static bool jpeg_find_exif_thumbnail(const guint8* src, gsize size, bool* progressive, gsize* offset, gsize* length)
+{
+	bool found = false;
+	*progressive = false;
+	for (gsize pos = 2; pos + 4 <= size;)
+	{
+		if (src[pos] != 0xFF)
+			break;
+		const guint8 marker = src[pos + 1];
+		if (marker == 0xFF)
+		{
+			pos++;
+			continue;
+		}
+		if (marker == 0xDA || marker == 0xD9)
+			break;
+		const gsize len = ((gsize)src[pos + 2] << 8) | src[pos + 3];
+		if (len < 2 || pos + 2 + len > size)
+			break;
+		if (marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE)
+			*progressive = true;
+		else if (marker == 0xE1 && !found && len >= 2 + 6 + 8 && memcmp(src + pos + 4, "Exif\0\0", 6) == 0)
+		{
+			const guint8* tiff = src + pos + 10;
+			const gsize tiff_size = len - 8;
+			const bool le = tiff[0] == 'I';
+			guint32 ifd = exif_read32(tiff + 4, le);
+			if ((gsize)ifd + 2 <= tiff_size)
+			{
+				// IFD0을 건너뛰어 IFD1로
+				const guint count = exif_read16(tiff + ifd, le);
+				const gsize next = (gsize)ifd + 2 + (gsize)count * 12;
+				ifd = next + 4 <= tiff_size ? exif_read32(tiff + next, le) : 0;
+			}
+			if (ifd != 0 && (gsize)ifd + 2 <= tiff_size)
+			{
+				const guint count = exif_read16(tiff + ifd, le);
+				guint32 thumb_offset = 0, thumb_length = 0;
+				for (guint i = 0; i < count && (gsize)ifd + 2 + (gsize)(i + 1) * 12 <= tiff_size; i++)
+				{
+					const guint8* entry = tiff + ifd + 2 + (gsize)i * 12;
+					const guint tag = exif_read16(entry, le);
+					if (tag == 0x0201)
+						thumb_offset = exif_read32(entry + 8, le);
+					else if (tag == 0x0202)
+						thumb_length = exif_read32(entry + 8, le);
+				}
+				if (thumb_offset != 0 && thumb_length != 0 && (gsize)thumb_offset + thumb_length <= tiff_size)
+				{
+					*offset = (gsize)(tiff - src) + thumb_offset;
+					*length = thumb_length;
+					found = true;
+				}
+			}
+		}
+		pos += 2 + len;
+	}
+	return found;
+}
+
+/**
+ * @brief EXIF 썸네일을 풉니다. 그림과 비율이 다르면(검은 띠를 넣은 썸네일 등) 쓰지 않습니다.
+ */
+static GdkTexture* decode_exif_thumbnail(GBytes* data, const ImageInfo* info, gsize offset, gsize length)
+{
+	GBytes* thumb = g_bytes_new_from_bytes(data, offset, length);
+	ImageInfo thumb_info;
+	GdkTexture* texture = NULL;
+	if (doumi_detect_image_info(thumb, &thumb_info) && thumb_info.type == IMAGE_FILE_TYPE_JPEG &&
+		thumb_info.width > 0 && thumb_info.height > 0)
+	{
+		const double ratio = (double)info->width / info->height;
+		const double thumb_ratio = (double)thumb_info.width / thumb_info.height;
+		if (ABS(thumb_ratio - ratio) <= ratio * 0.02)
+			texture = decoder_decode(thumb, &thumb_info, NULL, NULL);
+	}
+	g_bytes_unref(thumb);
+	return texture;
+}
+
+// 쪽 미리보기 풀기
+GdkTexture* decoder_decode_preview(GBytes* data, const ImageInfo* info, GError** error)
+{
+	g_return_val_if_fail(data != NULL && info != NULL, NULL);
+	if (info->type != IMAGE_FILE_TYPE_JPEG || info->width <= 0 || info->height <= 0)
+		return NULL;
+
+	// 프로그레시브는 1/8로 풀어도 스캔을 다 읽어야 하니, 썸네일이 있으면 그것부터
+	gsize size, offset, length;
+	bool progressive;
+	const guint8* src = g_bytes_get_data(data, &size);
+	if (jpeg_find_exif_thumbnail(src, size, &progressive, &offset, &length) && progressive)
+	{
+		GdkTexture* texture = decode_exif_thumbnail(data, info, offset, length);
+		if (texture != NULL)
+			return texture;
+	}
+
+	// 1/8은 블록마다 DC만 쓰므로 엔트로피 복호만 하면 된다
+	const DecodeParams params =
+	{
+		.max_width = MAX(info->width / 8, 1),
+		.max_height = MAX(info->height / 8, 1),
+		.draft = true,
+	};
+	return decoder_decode(data, info, &params, error);
+}
+#pragma endregion
+
+#pragma region 줄 디코더
+/**
+ * @brief 줄 디코더가 푸는 방법
+ */
+typedef enum DecodeRowsKind
+{
+	DECODE_ROWS_BUFFERED,         ///< 한번 다 풀어 두고 잘라 줌
+	DECODE_ROWS_JPEG,             ///< libjpeg 스캔라인
+	DECODE_ROWS_PNG,              ///< libpng 줄 읽기
+} DecodeRowsKind;
+
+/**
+ * @brief 줄 디코더
+ */
+struct DecodeRows
+{
+	GBytes* data;                 ///< 그림 파일 데이터
+	ImageInfo info;               ///< 그림 정보
+	DecodeRowsKind kind;          ///< 푸는 방법
+	GdkMemoryFormat format;       ///< 픽셀 형식
+	int bpp;                      ///< 픽셀 바이트 수
+	int next_row;                 ///< 다음에 나올 줄
+	bool active;                  ///< 흘려 읽는 중 (JPEG, PNG)
+
+	int shrink;                   ///< 줄여 푸는 배수 (1, 2, 4, 8)
+	int box;                      ///< 그 가운데 평균 내어 줄이는 배수 (JPEG는 libjpeg가 줄이므로 1)
+	int width;                    ///< 내는 폭 (줄인 크기)
+	int height;                   ///< 내는 높이 (줄인 크기)
+	guint8* box_scratch;          ///< 평균 낼 원래 줄들
+
+	GBytes* pixels;               ///< 다 푼 그림 (DECODE_ROWS_BUFFERED)
+	gsize pixels_stride;          ///< 다 푼 그림의 줄 간격
+
+#ifdef HAVE_LIBJPEG
+	struct jpeg_decompress_struct jpeg; ///< JPEG 디코드
+	JpegError jpeg_error;         ///< JPEG 오류 처리
+#endif
+#ifdef HAVE_LIBPNG
+	png_structp png;              ///< PNG 디코드
+	png_infop png_info;           ///< PNG 정보
+	gsize png_offset;             ///< PNG 데이터에서 읽은 위치
+	guint8* png_scratch;          ///< 건너뛸 줄을 읽어 버릴 곳
+	bool premultiply;             ///< 읽은 줄을 곱한 알파 BGRA로 바꿈
+#endif
+};
+
+#ifdef HAVE_LIBJPEG
+/**
+ * @brief JPEG를 처음부터 풀기 시작합니다.
+ */
+static bool rows_jpeg_start(DecodeRows* rows)
+{
+	rows->jpeg.err = jpeg_std_error(&rows->jpeg_error.base);
+	rows->jpeg_error.base.error_exit = jpeg_error_exit;
+	rows->jpeg_error.base.output_message = jpeg_silent_message;
+	if (setjmp(rows->jpeg_error.jump))
+	{
+		jpeg_destroy_decompress(&rows->jpeg);
+		rows->active = false;
+		return false;
+	}
+
+	jpeg_create_decompress(&rows->jpeg);
+	rows->active = true;
+	gsize size;
+	const guint8* src = g_bytes_get_data(rows->data, &size);
+	jpeg_mem_src(&rows->jpeg, src, (unsigned long)size);
+	jpeg_read_header(&rows->jpeg, TRUE);
+	if (rows->jpeg.jpeg_color_space == JCS_CMYK || rows->jpeg.jpeg_color_space == JCS_YCCK)
+	{
+		jpeg_destroy_decompress(&rows->jpeg);
+		rows->active = false;
+		return false;
+	}
+	rows->jpeg.scale_num = 1;
+	rows->jpeg.scale_denom = (unsigned int)rows->shrink;
+
+#ifdef DOUMI_GRAY_TEXTURE
+	if (rows->jpeg.num_components == 1)
+	{
+		rows->jpeg.out_color_space = JCS_GRAYSCALE;
+		rows->format = GDK_MEMORY_G8;
+		rows->bpp = 1;
+	}
+	else
+#endif
+	{
+		rows->jpeg.out_color_space = JCS_RGB;
+		rows->format = GDK_MEMORY_R8G8B8;
+		rows->bpp = 3;
+	}
+	jpeg_start_decompress(&rows->jpeg);
+	if ((int)rows->jpeg.output_width != rows->width || (int)rows->jpeg.output_height != rows->height)
+	{
+		jpeg_destroy_decompress(&rows->jpeg);
+		rows->active = false;
+		return false;
+	}
+	rows->next_row = 0;
+	return true;
+}
+
+/**
+ * @brief JPEG 줄을 읽습니다. 앞의 줄은 IDCT 없이 건너뜁니다.
+ */
+static bool rows_jpeg_read(DecodeRows* rows, int top, int count, guint8* out, gsize stride, GCancellable* cancellable)
+{
+	if (setjmp(rows->jpeg_error.jump))
+	{
+		jpeg_destroy_decompress(&rows->jpeg);
+		rows->active = false;
+		return false;
+	}
+
+	if (top > rows->next_row)
+	{
+#ifdef LIBJPEG_TURBO_VERSION
+		jpeg_skip_scanlines(&rows->jpeg, (JDIMENSION)(top - rows->next_row));
+#else
+		// libjpeg에는 건너뛰기가 없다, 읽을 첫 줄 자리에 풀어 버린다
+		JSAMPROW row = out;
+		while (rows->jpeg.output_scanline < (JDIMENSION)top)
+		{
+			if (rows->jpeg.output_scanline % DECODE_CANCEL_ROWS == 0 && g_cancellable_is_cancelled(cancellable))
+				return false;
+			jpeg_read_scanlines(&rows->jpeg, &row, 1);
+		}
+#endif
+	}
+	rows->next_row = (int)rows->jpeg.output_scanline;
+	for (int i = 0; i < count; i++)
+	{
+		if (i % DECODE_CANCEL_ROWS == 0 && g_cancellable_is_cancelled(cancellable))
+			return false;
+		JSAMPROW row = out + (gsize)i * stride;
+		jpeg_read_scanlines(&rows->jpeg, &row, 1);
+		rows->next_row++;
+	}
+	return true;
+}
+#endif
+
+#ifdef HAVE_LIBPNG
+/**
+ * @brief libpng 읽기 콜백, 메모리에서 읽습니다.
+ */
+static void png_rows_read_data(png_structp png, png_bytep out, png_size_t length)
+{
+	DecodeRows* rows = png_get_io_ptr(png);
+	gsize size;
+	const guint8* src = g_bytes_get_data(rows->data, &size);
+	if (rows->png_offset + length > size)
+		png_error(png, "unexpected end of data");
+	memcpy(out, src + rows->png_offset, length);
+	rows->png_offset += length;
+}
+
+/**
+ * @brief libpng 오류 콜백, 메시지를 남기고 돌아갑니다.
+ */
+static void png_rows_error(png_structp png, png_const_charp msg)
+{
+	g_log("DECODER", G_LOG_LEVEL_DEBUG, "libpng: %s", msg);
+	png_longjmp(png, 1);
+}
+
+/**
+ * @brief libpng 경고 콜백, 조용히 넘어갑니다.
+ */
+static void png_rows_warning(png_structp png, png_const_charp msg)
+{
+}
+
+/**
+ * @brief PNG를 처음부터 풀기 시작합니다. 인터레이스는 줄 순서로 읽을 수 없으므로 안 됩니다.
+ */
+static bool rows_png_start(DecodeRows* rows)
+{
+	rows->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_rows_error, png_rows_warning);
+	if (rows->png == NULL)
+		return false;
+	rows->png_info = png_create_info_struct(rows->png);
+	if (rows->png_info == NULL || setjmp(png_jmpbuf(rows->png)))
+	{
+		png_destroy_read_struct(&rows->png, &rows->png_info, NULL);
+		return false;
+	}
+
+	rows->png_offset = 0;
+	png_set_read_fn(rows->png, rows, png_rows_read_data);
+	png_read_info(rows->png, rows->png_info);
+	if (png_get_interlace_type(rows->png, rows->png_info) != PNG_INTERLACE_NONE)
+	{
+		png_destroy_read_struct(&rows->png, &rows->png_info, NULL);
+		return false;
+	}
+
+	// 팔레트, 투명색, 16비트, 회색은 모두 8비트 RGB(A)로
+	png_set_expand(rows->png);
+	png_set_strip_16(rows->png);
+	png_set_gray_to_rgb(rows->png);
+	png_read_update_info(rows->png, rows->png_info);
+	const int channels = png_get_channels(rows->png, rows->png_info);
+	if (channels != 3 && channels != 4)
+	{
+		png_destroy_read_struct(&rows->png, &rows->png_info, NULL);
+		return false;
+	}
+
+	rows->premultiply = channels == 4;
+	rows->format = channels == 4 ? GDK_MEMORY_B8G8R8A8_PREMULTIPLIED : GDK_MEMORY_R8G8B8;
+	rows->bpp = channels;
+	if (rows->png_scratch == NULL)
+		rows->png_scratch = g_malloc(png_get_rowbytes(rows->png, rows->png_info));
+	rows->next_row = 0;
+	rows->active = true;
+	return true;
+}
+
+/**
+ * @brief PNG 줄을 읽습니다. 앞의 줄은 읽어서 버립니다.
+ */
+static bool rows_png_read(DecodeRows* rows, int top, int count, guint8* out, gsize stride, GCancellable* cancellable)
+{
+	if (setjmp(png_jmpbuf(rows->png)))
+	{
+		png_destroy_read_struct(&rows->png, &rows->png_info, NULL);
+		rows->active = false;
+		return false;
+	}
+
+	for (; rows->next_row < top; rows->next_row++)
+	{
+		if (rows->next_row % DECODE_CANCEL_ROWS == 0 && g_cancellable_is_cancelled(cancellable))
+			return false;
+		png_read_row(rows->png, rows->png_scratch, NULL);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		if (i % DECODE_CANCEL_ROWS == 0 && g_cancellable_is_cancelled(cancellable))
+			return false;
+		png_read_row(rows->png, out + (gsize)i * stride, NULL);
+		rows->next_row++;
+	}
+
+	if (rows->premultiply)
+		doumi_premultiply_rgba_to_bgra(out, rows->info.width, count, stride);
+	return true;
+}
+#endif
+
+/**
+ * @brief 흘려 읽기를 멈춥니다.
+ */
+static void rows_stop(DecodeRows* rows)
+{
+	if (!rows->active)
+		return;
+	rows->active = false;
+#ifdef HAVE_LIBJPEG
+	if (rows->kind == DECODE_ROWS_JPEG)
+		jpeg_destroy_decompress(&rows->jpeg);
+#endif
+#ifdef HAVE_LIBPNG
+	if (rows->kind == DECODE_ROWS_PNG)
+		png_destroy_read_struct(&rows->png, &rows->png_info, NULL);
+#endif
+}
+
+/**
+ * @brief 흘려 읽기를 처음부터 시작합니다.
+ */
+static bool rows_start(DecodeRows* rows)
+{
+	rows_stop(rows);
+	switch (rows->kind) // NOLINT(clang-diagnostic-switch-enum)
+	{
+#ifdef HAVE_LIBJPEG
+		case DECODE_ROWS_JPEG:
+			return rows_jpeg_start(rows);
+#endif
+#ifdef HAVE_LIBPNG
+		case DECODE_ROWS_PNG:
+			return rows_png_start(rows);
+#endif
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief 그림을 한번 다 풀어 둡니다. 흘려 읽을 수 없는 형식에 씁니다.
+ */
+static bool rows_buffer_all(DecodeRows* rows)
+{
+	const int channels = rows->info.channels;
+	const bool alpha = channels == 2 || channels == 4;
+	const DecodeParams params = { .format = alpha ? DECODE_FORMAT_PREMULTIPLIED : DECODE_FORMAT_AUTO };
+	GdkTexture* texture = decoder_decode(rows->data, &rows->info, &params, NULL);
+	if (texture == NULL)
+		return false;
+	if (gdk_texture_get_width(texture) != rows->info.width || gdk_texture_get_height(texture) != rows->info.height)
+	{
+		g_object_unref(texture);
+		return false;
+	}
+
+	if (alpha)
+	{
+		rows->format = GDK_MEMORY_B8G8R8A8_PREMULTIPLIED;
+		rows->bpp = 4;
+	}
+#ifdef DOUMI_GRAY_TEXTURE
+	else if (channels == 1)
+	{
+		rows->format = GDK_MEMORY_G8;
+		rows->bpp = 1;
+	}
+#endif
+	else
+	{
+		rows->format = GDK_MEMORY_R8G8B8;
+		rows->bpp = 3;
+	}
+
+	// 디코더가 푼 버퍼를 그대로 쓴다, 복사하면 잠깐이라도 그림 두 장 만큼 쓰게 된다
+	const PoolPixels* pp = g_object_get_qdata(G_OBJECT(texture), pool_pixels_quark());
+	if (pp != NULL && gdk_texture_get_format(texture) == rows->format)
+	{
+		rows->pixels = g_bytes_ref(pp->bytes);
+		rows->pixels_stride = pp->stride;
+		g_object_unref(texture);
+		return true;
+	}
+
+	// gdk-pixbuf로 풀었거나 형식이 다르면 받아 온다
+	rows->pixels_stride = (gsize)rows->info.width * (gsize)rows->bpp;
+	gpointer pixels;
+	rows->pixels = bufpool_bytes_new(rows->pixels_stride * (gsize)rows->info.height, &pixels);
+	GdkTextureDownloader* downloader = gdk_texture_downloader_new(texture);
+	gdk_texture_downloader_set_format(downloader, rows->format);
+	gdk_texture_downloader_download_into(downloader, pixels, rows->pixels_stride);
+	gdk_texture_downloader_free(downloader);
+	g_object_unref(texture);
+	return true;
+}
+
+// 줄 디코더 열기
+DecodeRows* decoder_rows_open(GBytes* data, const ImageInfo* info, int shrink)
+{
+	g_return_val_if_fail(data != NULL && info != NULL, NULL);
+	g_once(&decoder_once, once_init_decoders, NULL);
+
+	DecodeRows* rows = g_new0(DecodeRows, 1);
+	rows->data = g_bytes_ref(data);
+	rows->info = *info;
+	rows->shrink = shrink >= 8 ? 8 : shrink >= 4 ? 4 : shrink >= 2 ? 2 : 1;
+	rows->width = (info->width + rows->shrink - 1) / rows->shrink;
+	rows->height = (info->height + rows->shrink - 1) / rows->shrink;
+
+#ifdef HAVE_LIBJPEG
+	if (info->type == IMAGE_FILE_TYPE_JPEG)
+	{
+		rows->kind = DECODE_ROWS_JPEG;
+		rows->box = 1;
+		if (rows_start(rows))
+			return rows;
+	}
+#endif
+#ifdef HAVE_LIBPNG
+	if (info->type == IMAGE_FILE_TYPE_PNG)
+	{
+		rows->kind = DECODE_ROWS_PNG;
+		rows->box = rows->shrink;
+		if (rows_start(rows))
+			return rows;
+	}
+#endif
+
+	rows->kind = DECODE_ROWS_BUFFERED;
+	rows->box = rows->shrink;
+	if (rows_buffer_all(rows))
+		return rows;
+	decoder_rows_close(rows);
+	return NULL;
+}
+
+// 줄 디코더 닫기
+void decoder_rows_close(DecodeRows* rows)
+{
+	if (rows == NULL)
+		return;
+	rows_stop(rows);
+#ifdef HAVE_LIBPNG
+	g_free(rows->png_scratch);
+#endif
+	g_free(rows->box_scratch);
+	if (rows->pixels)
+		g_bytes_unref(rows->pixels);
+	g_bytes_unref(rows->data);
+	g_free(rows);
+}
+
+// 줄 디코더 픽셀 형식
+GdkMemoryFormat decoder_rows_get_format(const DecodeRows* rows, int* bpp)
+{
+	if (bpp)
+		*bpp = rows->bpp;
+	return rows->format;
+}
+
+// 줄 디코더가 내는 크기
+void decoder_rows_get_size(const DecodeRows* rows, int* width, int* height)
+{
+	if (width)
+		*width = rows->width;
+	if (height)
+		*height = rows->height;
+}
+
+// 다 풀어 둔 줄 디코더인가
+bool decoder_rows_is_buffered(const DecodeRows* rows)
+{
+	return rows->kind == DECODE_ROWS_BUFFERED;
+}
+
+/**
+ * @brief 원래 줄들을 평균 내어 줄인 줄 하나를 만듭니다. 곱한 알파도 그대로 평균 내면 됩니다.
+ * @param src 원래 줄들
+ * @param src_stride 원래 줄 간격
+ * @param src_width 원래 폭
+ * @param lines 평균 낼 줄 수 (box 이하)
+ * @param box 줄이는 배수
+ * @param bpp 픽셀 바이트 수
+ * @param out 줄인 줄
+ * @param width 줄인 폭
+ */
+static void rows_box_line(const guint8* src, gsize src_stride, int src_width, int lines, int box, int bpp, guint8* out, int width)
+{
+	for (int x = 0; x < width; x++)
+	{
+		const int left = x * box;
+		const int cols = MIN(box, src_width - left);
+		const guint total = (guint)(cols * lines);
+		for (int ch = 0; ch < bpp; ch++)
+		{
+			guint sum = 0;
+			for (int y = 0; y < lines; y++)
+			{
+				const guint8* p = src + (gsize)y * src_stride + (gsize)left * bpp + ch;
+				for (int c = 0; c < cols; c++)
+					sum += p[c * bpp];
+			}
+			out[x * bpp + ch] = (guint8)((sum + total / 2) / total);
+		}
+	}
+}
+
+/**
+ * @brief 원래 크기(JPEG는 libjpeg가 줄인 크기)로 줄을 읽습니다.
+ */
+static bool rows_read_lines(DecodeRows* rows, int top, int count, guint8* out, gsize stride, GCancellable* cancellable)
+{
+	if (rows->kind == DECODE_ROWS_BUFFERED)
+	{
+		const guint8* src = g_bytes_get_data(rows->pixels, NULL);
+		const gsize length = (gsize)rows->info.width * (gsize)rows->bpp;
+		for (int i = 0; i < count; i++)
+			memcpy(out + (gsize)i * stride, src + (gsize)(top + i) * rows->pixels_stride, length);
+		return true;
+	}
+
+	// 위로 돌아가면 처음부터
+	if ((!rows->active || top < rows->next_row) && !rows_start(rows))
+		return false;
+
+	switch (rows->kind) // NOLINT(clang-diagnostic-switch-enum)
+	{
+#ifdef HAVE_LIBJPEG
+		case DECODE_ROWS_JPEG:
+			return rows_jpeg_read(rows, top, count, out, stride, cancellable);
+#endif
+#ifdef HAVE_LIBPNG
+		case DECODE_ROWS_PNG:
+			return rows_png_read(rows, top, count, out, stride, cancellable);
+#endif
+		default:
+			return false;
+	}
+}
+
+// 줄 읽기
+bool decoder_rows_read(DecodeRows* rows, int top, int count, guint8* out, gsize stride, GCancellable* cancellable)
+{
+	g_return_val_if_fail(rows != NULL && out != NULL, false);
+	g_return_val_if_fail(top >= 0 && count > 0 && top + count <= rows->height, false);
+
+	if (rows->box == 1)
+		return rows_read_lines(rows, top, count, out, stride, cancellable);
+
+	// 원래 줄을 box 줄씩 읽어서 평균 낸다
+	const int box = rows->box;
+	const gsize src_stride = (gsize)rows->info.width * (gsize)rows->bpp;
+	if (rows->box_scratch == NULL)
+		rows->box_scratch = g_malloc(src_stride * (gsize)box);
+	for (int i = 0; i < count; i++)
+	{
+		const int src_top = (top + i) * box;
+		const int lines = MIN(box, rows->info.height - src_top);
+		if (!rows_read_lines(rows, src_top, lines, rows->box_scratch, src_stride, cancellable))
+			return false;
+		rows_box_line(rows->box_scratch, src_stride, rows->info.width, lines, box, rows->bpp, out + (gsize)i * stride, rows->width);
+	}
+	return true;
+}
+#pragma endregion
@@ -0,0 +1,144 @@
+﻿#pragma once
+
+#include "defs.h"
+
+/**
+ * @file decoder.h
+ * @brief 그림 형식(ImageFileType)마다 디코더를 골라 쪽 텍스쳐를 만드는 디코더 목록을 정의하는 헤더 파일입니다.
+ *        빌드할 때 찾은 라이브러리(libjpeg-turbo, libpng, libwebp, libjxl, libavif)로 직접 풀고,
+ *        없거나 실패하면 gdk-pixbuf로 풉니다.
+ */
+
+/**
+ * @brief 디코더가 만들 픽셀 형식
+ */
+typedef enum DecodeFormat
+{
+	DECODE_FORMAT_AUTO,            ///< 가장 작은 형식 (회색은 G8, 알파가 있으면 곱한 알파 BGRA, 아니면 RGB)
+	DECODE_FORMAT_PREMULTIPLIED,   ///< 언제나 곱한 알파 BGRA (GDK_MEMORY_B8G8R8A8_PREMULTIPLIED)
+} DecodeFormat;
+
+/**
+ * @brief 디코드 옵션
+ */
+typedef struct DecodeParams
+{
+	int max_width;                 ///< 이 크기 안에 맞게 줄여서 풂, 0이면 원래 크기
+	int max_height;                ///< 이 크기 안에 맞게 줄여서 풂, 0이면 원래 크기
+	DecodeFormat format;           ///< 픽셀 형식
+	bool draft;                    ///< 화질보다 빠르기 (미리보기용, 디코더가 지원하면)
+	GCancellable* cancellable;     ///< 취소 (NULL 가능)
+} DecodeParams;
+
+/**
+ * @brief 디코드 함수 타입. 줄여서 풀 때는 디코더가 할 수 있는 만큼만 줄이므로 요청보다 클 수 있습니다.
+ * @param data 그림 파일 데이터
+ * @param info 그림 정보 (doumi_detect_image_info로 얻은 것)
+ * @param params 디코드 옵션
+ * @param error 오류 (취소되면 G_IO_ERROR_CANCELLED)
+ * @return 텍스쳐, 실패하면 NULL
+ */
+typedef GdkTexture* (*DecodeFunc)(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error);
+
+/**
+ * @brief 디코더
+ */
+typedef struct Decoder
+{
+	const char* name;              ///< 이름 (로그용)
+	DecodeFunc decode;             ///< 디코드 함수
+} Decoder;
+
+/**
+ * @brief 위에서부터 줄 단위로 푸는 줄 디코더. 아주 긴 그림을 띠(타일)로 나눠 풀 때 씁니다.
+ *        JPEG와 PNG는 필요한 줄까지만 흘려 읽고, 다른 형식은 한번 다 풀어 둔 것에서 잘라 줍니다.
+ */
+typedef struct DecodeRows DecodeRows;
+
+/**
+ * @brief 그림 형식에 디코더를 넣습니다. 이미 있으면 바꿉니다. 디코드를 시작하기 전에만 부를 것
+ * @param type 그림 형식
+ * @param decoder 디코더 (정적 데이터, NULL이면 gdk-pixbuf만 씀)
+ */
+extern void decoder_register(ImageFileType type, const Decoder* decoder);
+
+/**
+ * @brief 그림 형식의 디코더 이름을 얻습니다.
+ * @param type 그림 형식
+ * @return 디코더 이름
+ */
+extern const char* decoder_get_name(ImageFileType type);
+
+/**
+ * @brief 쪽 그림을 풀어서 텍스쳐로 만듭니다. 형식에 맞는 디코더가 실패하면 gdk-pixbuf로 다시 풉니다.
+ *        애니메이션은 풀지 않고 첫 장만 풉니다. 스레드에서 불러도 됩니다.
+ *        DECODE_FORMAT_AUTO에 원래 크기면 텍스쳐 크기가 info->size와 맞습니다.
+ * @param data 그림 파일 데이터
+ * @param info 그림 정보
+ * @param params 디코드 옵션 (NULL이면 원래 크기, DECODE_FORMAT_AUTO)
+ * @param error 오류
+ * @return 텍스쳐, 실패하면 NULL
+ */
+extern GdkTexture* decoder_decode(GBytes* data, const ImageInfo* info, const DecodeParams* params, GError** error);
+
+/**
+ * @brief 쪽 그림의 낮은 화질 미리보기를 빨리 만듭니다. 싸게 줄여 풀 수 있는 형식(JPEG)만 만듭니다.
+ *        1/8로 DC만 풀거나, 프로그레시브 JPEG면 비율이 맞는 EXIF 썸네일을 씁니다. 스레드에서 불러도 됩니다.
+ *        텍스쳐 크기는 info와 다르므로 그릴 때는 info의 크기를 쓸 것
+ * @param data 그림 파일 데이터
+ * @param info 그림 정보
+ * @param error 오류
+ * @return 미리보기 텍스쳐, 만들 수 없으면 NULL
+ */
+extern GdkTexture* decoder_decode_preview(GBytes* data, const ImageInfo* info, GError** error);
+
+/**
+ * @brief 줄 디코더를 엽니다. 한 스레드에서만 쓸 것
+ *        줄여 풀면 JPEG는 libjpeg가 줄여서 풀고, 다른 형식은 원래 줄을 평균 내어 줄입니다.
+ * @param data 그림 파일 데이터
+ * @param info 그림 정보
+ * @param shrink 줄여 푸는 배수 (1, 2, 4, 8), 줄은 모두 줄인 크기로 셉니다
+ * @return 줄 디코더, 풀 수 없으면 NULL
+ */
+extern DecodeRows* decoder_rows_open(GBytes* data, const ImageInfo* info, int shrink);
+
+/**
+ * @brief 줄 디코더를 닫습니다.
+ * @param rows 줄 디코더 (NULL 가능)
+ */
+extern void decoder_rows_close(DecodeRows* rows);
+
+/**
+ * @brief 줄 디코더가 내는 픽셀 형식을 얻습니다.
+ * @param rows 줄 디코더
+ * @param bpp 픽셀 바이트 수를 받음
+ * @return 픽셀 형식
+ */
+extern GdkMemoryFormat decoder_rows_get_format(const DecodeRows* rows, int* bpp);
+
+/**
+ * @brief 줄 디코더가 내는 크기를 얻습니다. 줄여 풀면 원래 크기를 배수로 나눠 올린 크기입니다.
+ * @param rows 줄 디코더
+ * @param width 폭을 받음
+ * @param height 높이를 받음
+ */
+extern void decoder_rows_get_size(const DecodeRows* rows, int* width, int* height);
+
+/**
+ * @brief 다 풀어 둔 그림에서 잘라 주는지 알아봅니다. 그렇다면 다 쓴 뒤 바로 닫아서 메모리를 돌려줄 것
+ * @param rows 줄 디코더
+ * @return 다 풀어 두었으면 true
+ */
+extern bool decoder_rows_is_buffered(const DecodeRows* rows);
+
+/**
+ * @brief 줄을 읽습니다. 지난번보다 아래를 읽으면 이어서 풀고, 위를 읽으면 처음부터 다시 풉니다.
+ * @param rows 줄 디코더
+ * @param top 첫 줄
+ * @param count 줄 수
+ * @param out 출력 버퍼
+ * @param stride 출력 줄 간격
+ * @param cancellable 취소 (NULL 가능)
+ * @return 다 읽었으면 true
+ */
+extern bool decoder_rows_read(DecodeRows* rows, int top, int count, guint8* out, gsize stride, GCancellable* cancellable);
@@ -10,9 +10,28 @@ typedef enum ImageFileType
 	IMAGE_FILE_TYPE_BMP,
 	IMAGE_FILE_TYPE_TIFF,
 	IMAGE_FILE_TYPE_WEBP,
+	IMAGE_FILE_TYPE_JXL,
+	IMAGE_FILE_TYPE_AVIF,
 	IMAGE_FILE_TYPE_MAX_VALUE,
 } ImageFileType;
 
+// 쪽 종류 (ComicInfo.xml의 Page Type)
+typedef enum PageType
+{
+	PAGE_TYPE_STORY,
+	PAGE_TYPE_FRONT_COVER,
+	PAGE_TYPE_INNER_COVER,
+	PAGE_TYPE_ROUNDUP,
+	PAGE_TYPE_ADVERTISEMENT,
+	PAGE_TYPE_EDITORIAL,
+	PAGE_TYPE_LETTERS,
+	PAGE_TYPE_PREVIEW,
+	PAGE_TYPE_BACK_COVER,
+	PAGE_TYPE_OTHER,
+	PAGE_TYPE_DELETED,
+	PAGE_TYPE_MAX_VALUE,
+} PageType;
+
 // 수평 정렬 방식을 나타내는 열거형입니다.
 typedef enum HorizAlign
 {
@@ -28,6 +47,7 @@ typedef enum ViewMode
 	VIEW_MODE_FIT,
 	VIEW_MODE_LEFT_TO_RIGHT,
 	VIEW_MODE_RIGHT_TO_LEFT,
+	VIEW_MODE_SCROLL,
 	VIEW_MODE_MAX_VALUE,
 } ViewMode;
 
@@ -56,6 +76,7 @@ typedef enum BookControl
 	BOOK_CTRL_SCAN_PREV,
 	BOOK_CTRL_SCAN_NEXT,
 	BOOK_CTRL_SCAN_RANDOM,
+	BOOK_CTRL_QUEUE_NEXT,
 	BOOK_CTRL_SELECT,
 	BOOK_CTRL_MAX_VALUE,
 } BookControl;
@@ -66,6 +87,7 @@ typedef struct ImageInfo
 	ImageFileType type;  // 이미지 파일 형식
 	int width;           // 이미지 폭
 	int height;          // 이미지 높이
-	size_t size;         // 이미지 크기(바이트)
+	size_t size;         // 이미지 크기(바이트), 풀어서 텍스쳐로 만들었을 때
+	int channels;        // 채널 수 (1 회색, 2 회색+알파, 3 RGB, 4 RGBA), 헤더로 모르면 0
 	bool has_anim;       // 애니메이션 여부
 } ImageInfo;
@@ -3,7 +3,15 @@
 #include <sys/file.h>
 #include <fcntl.h>
 #endif
+#if defined(_WIN32) || defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DOUMI_SSE2 1
+#endif
 #include "configs.h"
+#include "decoder.h"
 #include "doumi.h"
 
 // 잠금 뮤텍스
@@ -58,6 +66,115 @@ void doumi_unlock_program(void)
 #endif
 }
 
+#ifndef _WIN32
+// 파일에서 숫자 하나 읽기 (cgroup 값), "max"나 없으면 0
+static guint64 read_proc_number(const char* path)
+{
+	char* contents;
+	if (!g_file_get_contents(path, &contents, NULL, NULL))
+		return 0;
+	const guint64 value = g_ascii_isdigit(contents[0]) ? g_ascii_strtoull(contents, NULL, 10) : 0;
+	g_free(contents);
+	return value;
+}
+
+// cgroup v2에서 더 쓸 수 있는 메모리, 제한이 없으면 0
+static guint64 cgroup_available_memory(void)
+{
+	char* contents;
+	if (!g_file_get_contents("/proc/self/cgroup", &contents, NULL, NULL))
+		return 0;
+
+	// v2는 "0::/경로" 한 줄
+	guint64 avail = 0;
+	const char* line = strstr(contents, "0::");
+	if (line != NULL && (line == contents || line[-1] == '\n'))
+	{
+		const char* start = line + 3;
+		const char* end = strchr(start, '\n');
+		char* group = g_strndup(start, end ? (gsize)(end - start) : strlen(start));
+		char* max_path = g_build_filename("/sys/fs/cgroup", group, "memory.max", NULL);
+		char* cur_path = g_build_filename("/sys/fs/cgroup", group, "memory.current", NULL);
+		const guint64 max = read_proc_number(max_path);
+		const guint64 cur = read_proc_number(cur_path);
+		if (max > 0)
+			avail = max > cur ? max - cur : 1; // 꽉 찼어도 제한은 있다고 알린다
+		g_free(max_path);
+		g_free(cur_path);
+		g_free(group);
+	}
+
+	g_free(contents);
+	return avail;
+}
+#endif
+
+// 지금 더 쓸 수 있는 메모리 (바이트), 모르면 0
+// 리눅스는 /proc/meminfo의 MemAvailable과 cgroup v2 제한 중 작은 것
+guint64 doumi_get_available_memory(void)
+{
+#ifdef _WIN32
+	MEMORYSTATUSEX ms = { .dwLength = sizeof(ms) };
+	return GlobalMemoryStatusEx(&ms) ? ms.ullAvailPhys : 0;
+#else
+	guint64 avail = 0;
+	char* contents;
+	if (g_file_get_contents("/proc/meminfo", &contents, NULL, NULL))
+	{
+		const char* p = strstr(contents, "MemAvailable:");
+		if (p != NULL)
+			avail = g_ascii_strtoull(p + strlen("MemAvailable:"), NULL, 10) * 1024ULL; // kB
+		g_free(contents);
+	}
+
+	const guint64 cgroup = cgroup_available_memory();
+	if (cgroup > 0 && (avail == 0 || cgroup < avail))
+		avail = cgroup;
+	return avail;
+#endif
+}
+
+// 해제한 힙 메모리를 운영체제에 돌려준다
+void doumi_trim_memory(void)
+{
+#if defined(_WIN32)
+	_heapmin();
+#elif defined(__GLIBC__)
+	malloc_trim(0);
+#endif
+}
+
+// 시작 시간 측정
+static struct
+{
+	gint64 begin;
+	gint64 last;
+} doumi_startup;
+
+// 시작 시간 측정 시작
+void doumi_startup_begin(void)
+{
+	doumi_startup.begin = doumi_startup.last = g_get_monotonic_time();
+}
+
+// 시작 단계 기록, 시작부터 걸린 시간과 앞 단계부터 걸린 시간
+void doumi_startup_mark(const char* phase)
+{
+	if (doumi_startup.begin == 0)
+		return;
+	const gint64 now = g_get_monotonic_time();
+	g_log("STARTUP", G_LOG_LEVEL_DEBUG, "%s: %.2fms (+%.2fms)", phase,
+		(double)(now - doumi_startup.begin) / 1000.0, (double)(now - doumi_startup.last) / 1000.0);
+	doumi_startup.last = now;
+}
+
+// 시작 단계 기록하고 측정 끝
+void doumi_startup_end(const char* phase)
+{
+	doumi_startup_mark(phase);
+	doumi_startup.begin = 0;
+}
+
 // 문자열을 불린으로
 bool doumi_atob(const char* str)
 {
@@ -117,7 +234,9 @@ bool doumi_is_image_file(const char* filename)
 		g_ascii_strcasecmp(ext, "jpeg") == 0 ||
 		g_ascii_strcasecmp(ext, "gif") == 0 ||
 		g_ascii_strcasecmp(ext, "bmp") == 0 || // 윈도우에서는 BMP를 지원하지 않음
-		g_ascii_strcasecmp(ext, "tiff") == 0)
+		g_ascii_strcasecmp(ext, "tiff") == 0 ||
+		g_ascii_strcasecmp(ext, "avif") == 0 ||
+		g_ascii_strcasecmp(ext, "jxl") == 0)
 		return true; // 비교 순서는 자주 쓰는 순서로
 	return false;
 
@@ -510,6 +629,149 @@ GdkTexture* doumi_load_gdk_texture(const void* buffer, size_t size)
 	return tex;
 }
 
+// 썸네일 크기 정하기 (디코더가 줄여서 읽을 수 있게 미리 알려줌)
+static void cb_thumbnail_size_prepared(GdkPixbufLoader* loader, int width, int height, gpointer user_data)
+{
+	const int max_size = GPOINTER_TO_INT(user_data);
+	if (width <= max_size && height <= max_size)
+		return;
+	const double scale = (double)max_size / (double)MAX(width, height);
+	gdk_pixbuf_loader_set_size(loader, MAX(1, (int)(width * scale)), MAX(1, (int)(height * scale)));
+}
+
+// gdk-pixbuf 로더가 없는 형식(JPEG XL, AVIF 등)은 디코더로 풀어서 픽스버프로 줄인다
+static GdkPixbuf* load_thumbnail_with_decoder(GBytes* data, int max_size)
+{
+	ImageInfo info;
+	if (!doumi_detect_image_info(data, &info) || info.has_anim)
+		return NULL;
+	const DecodeParams params = { .max_width = max_size, .max_height = max_size };
+	GdkTexture* texture = decoder_decode(data, &info, &params, NULL);
+	if (texture == NULL)
+		return NULL;
+
+	const bool alpha = info.channels == 4 || info.channels == 2;
+	const int width = gdk_texture_get_width(texture);
+	const int height = gdk_texture_get_height(texture);
+	GdkTextureDownloader* downloader = gdk_texture_downloader_new(texture);
+	gdk_texture_downloader_set_format(downloader, alpha ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R8G8B8);
+	gsize stride;
+	GBytes* bytes = gdk_texture_downloader_download_bytes(downloader, &stride);
+	gdk_texture_downloader_free(downloader);
+	g_object_unref(texture);
+
+	GdkPixbuf* full = gdk_pixbuf_new_from_bytes(bytes, GDK_COLORSPACE_RGB, alpha, 8, width, height, (int)stride);
+	g_bytes_unref(bytes);
+	if (width <= max_size && height <= max_size)
+		return full;
+
+	const double scale = (double)max_size / (double)MAX(width, height);
+	GdkPixbuf* pixbuf = gdk_pixbuf_scale_simple(full,
+		MAX(1, (int)(width * scale)), MAX(1, (int)(height * scale)), GDK_INTERP_BILINEAR);
+	g_object_unref(full);
+	return pixbuf;
+}
+
+// 썸네일 텍스쳐 만들기, 긴 쪽이 max_size가 되도록 줄여서 읽음
+// encoded가 있으면 줄인 그림을 JPEG(알파가 있으면 PNG)로 인코딩해서 넘김
+// 스레드에서 불러도 됨
+GdkTexture* doumi_load_thumbnail_texture(GBytes* data, int max_size, GBytes** encoded)
+{
+	if (encoded != NULL)
+		*encoded = NULL;
+
+	GdkPixbufLoader* loader = gdk_pixbuf_loader_new();
+	g_signal_connect(loader, "size-prepared", G_CALLBACK(cb_thumbnail_size_prepared), GINT_TO_POINTER(max_size));
+
+	GError* err = NULL;
+	GdkPixbuf* pixbuf = NULL;
+	if (gdk_pixbuf_loader_write_bytes(loader, data, &err) && gdk_pixbuf_loader_close(loader, &err))
+	{
+		pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+		if (pixbuf != NULL)
+			g_object_ref(pixbuf);
+	}
+	else
+	{
+		pixbuf = load_thumbnail_with_decoder(data, max_size);
+		if (pixbuf == NULL)
+			g_log("DOUMI", G_LOG_LEVEL_WARNING, "Thumbnail: %s", err->message);
+		g_clear_error(&err);
+	}
+	g_object_unref(loader);
+
+	GdkTexture* texture = NULL;
+	if (pixbuf != NULL)
+	{
+		GBytes* bytes = gdk_pixbuf_read_pixel_bytes(pixbuf);
+		texture = gdk_memory_texture_new(
+			gdk_pixbuf_get_width(pixbuf),
+			gdk_pixbuf_get_height(pixbuf),
+			gdk_pixbuf_get_has_alpha(pixbuf) ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R8G8B8,
+			bytes,
+			gdk_pixbuf_get_rowstride(pixbuf));
+		g_bytes_unref(bytes);
+
+		if (encoded != NULL)
+		{
+			gchar* buf = NULL;
+			gsize len = 0;
+			const bool ok = gdk_pixbuf_get_has_alpha(pixbuf) ?
+				gdk_pixbuf_save_to_buffer(pixbuf, &buf, &len, "png", NULL, NULL) :
+				gdk_pixbuf_save_to_buffer(pixbuf, &buf, &len, "jpeg", NULL, "quality", "85", NULL);
+			if (ok)
+				*encoded = g_bytes_new_take(buf, len);
+		}
+		g_object_unref(pixbuf);
+	}
+	return texture;
+}
+
+// 255로 나누기 (반올림), 0..255*255 범위에서 정확함
+#define DIV255(x) (((x) + 128 + (((x) + 128) >> 8)) >> 8)
+
+// RGBA(곱하지 않은 알파)를 그 자리에서 BGRA(곱한 알파)로 바꾼다
+// 렌더러가 바로 올릴 수 있는 형식이라 GTK가 올릴 때 한 번 더 바꾸지 않음
+void doumi_premultiply_rgba_to_bgra(guint8* pixels, int width, int height, size_t stride)
+{
+	for (int y = 0; y < height; y++)
+	{
+		guint8* p = pixels + (size_t)y * stride;
+		int x = 0;
+#ifdef DOUMI_SSE2
+		// 4픽셀씩, 16비트로 늘려서 곱하고 R/B는 워드 셔플로 바꿈
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alpha_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+		const __m128i alpha_one = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+		const __m128i round = _mm_set1_epi16(128);
+		for (; x + 4 <= width; x += 4, p += 16)
+		{
+			const __m128i src = _mm_loadu_si128((const __m128i*)p);
+			__m128i half[2] = { _mm_unpacklo_epi8(src, zero), _mm_unpackhi_epi8(src, zero) };
+			for (int i = 0; i < 2; i++)
+			{
+				__m128i v = half[i];
+				v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 0, 1, 2)), _MM_SHUFFLE(3, 0, 1, 2));
+				__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+				a = _mm_or_si128(_mm_andnot_si128(alpha_mask, a), alpha_one); // 알파 자리는 255를 곱함
+				__m128i m = _mm_add_epi16(_mm_mullo_epi16(v, a), round);
+				m = _mm_srli_epi16(_mm_add_epi16(m, _mm_srli_epi16(m, 8)), 8);
+				half[i] = m;
+			}
+			_mm_storeu_si128((__m128i*)p, _mm_packus_epi16(half[0], half[1]));
+		}
+#endif
+		for (; x < width; x++, p += 4)
+		{
+			const guint a = p[3];
+			const guint r = p[0];
+			p[0] = (guint8)DIV255(p[2] * a);
+			p[1] = (guint8)DIV255(p[1] * a);
+			p[2] = (guint8)DIV255(r * a);
+		}
+	}
+}
+
 // 서피스로 GdkTexture 만들기
 GdkTexture* doumi_texture_from_surface(cairo_surface_t* surface)
 {
@@ -559,6 +821,8 @@ GtkFileFilter* doumi_file_filter_image(void)
 	gtk_file_filter_add_pattern(filter, "*.webp");
 	gtk_file_filter_add_pattern(filter, "*.tiff");
 	gtk_file_filter_add_pattern(filter, "*.tif");
+	gtk_file_filter_add_pattern(filter, "*.avif");
+	gtk_file_filter_add_pattern(filter, "*.jxl");
 #ifndef _WIN32
 	gtk_file_filter_add_mime_type(filter, "image/jpeg");   // .jpg, .jpeg
 	gtk_file_filter_add_mime_type(filter, "image/png");    // .png
@@ -566,6 +830,8 @@ GtkFileFilter* doumi_file_filter_image(void)
 	gtk_file_filter_add_mime_type(filter, "image/bmp");    // .bmp
 	gtk_file_filter_add_mime_type(filter, "image/webp");   // .webp
 	gtk_file_filter_add_mime_type(filter, "image/tiff");   // .tiff, .tif
+	gtk_file_filter_add_mime_type(filter, "image/avif");   // .avif
+	gtk_file_filter_add_mime_type(filter, "image/jxl");    // .jxl
 #endif
 	return filter;
 }
@@ -625,6 +891,126 @@ bool doumi_get_primary_monitor_dimension(int* width, int* height)
 	return true;
 }
 
+// JPEG XL 비트 읽기 (낮은 비트부터)
+typedef struct JxlBits
+{
+	const guint8* data;
+	gsize size;
+	gsize pos; // 비트 위치
+} JxlBits;
+
+// JPEG XL 비트 n개 읽기
+static guint32 jxl_read_bits(JxlBits* b, int n)
+{
+	guint32 v = 0;
+	for (int i = 0; i < n; i++, b->pos++)
+	{
+		if ((b->pos >> 3) < b->size && (b->data[b->pos >> 3] >> (b->pos & 7)) & 1)
+			v |= 1u << i;
+	}
+	return v;
+}
+
+// JPEG XL U32 읽기, 선택자 2비트로 고른 (기본값 + 비트 n개)
+static guint32 jxl_read_u32(JxlBits* b, const guint32 base[4], const int bits[4])
+{
+	const guint32 sel = jxl_read_bits(b, 2);
+	return base[sel] + jxl_read_bits(b, bits[sel]);
+}
+
+// JPEG XL 폭 비율 (SizeHeader, PreviewHeader의 ratio)
+static guint32 jxl_ratio_width(guint32 ratio, guint32 height)
+{
+	static const guint32 num[] = { 1, 12, 4, 3, 16, 5, 2 };
+	static const guint32 den[] = { 1, 10, 3, 2, 9, 4, 1 };
+	return (guint32)((guint64)height * num[ratio - 1] / den[ratio - 1]);
+}
+
+// JPEG XL SizeHeader 읽기
+static void jxl_read_size(JxlBits* b, guint32* width, guint32* height)
+{
+	static const guint32 base[] = { 1, 1, 1, 1 };
+	static const int bits[] = { 9, 13, 18, 30 };
+	const bool small = jxl_read_bits(b, 1);
+	*height = small ? (jxl_read_bits(b, 5) + 1) * 8 : jxl_read_u32(b, base, bits);
+	const guint32 ratio = jxl_read_bits(b, 3);
+	if (ratio != 0)
+		*width = jxl_ratio_width(ratio, *height);
+	else
+		*width = small ? (jxl_read_bits(b, 5) + 1) * 8 : jxl_read_u32(b, base, bits);
+}
+
+// JPEG XL PreviewHeader 건너뛰기
+static void jxl_skip_preview(JxlBits* b)
+{
+	static const guint32 div8_base[] = { 16, 32, 1, 33 };
+	static const int div8_bits[] = { 0, 0, 5, 9 };
+	static const guint32 base[] = { 1, 65, 321, 1 };
+	static const int bits[] = { 6, 8, 10, 12 };
+	const bool div8 = jxl_read_bits(b, 1);
+	if (div8)
+		jxl_read_u32(b, div8_base, div8_bits);
+	else
+		jxl_read_u32(b, base, bits);
+	if (jxl_read_bits(b, 3) == 0)
+	{
+		if (div8)
+			jxl_read_u32(b, div8_base, div8_bits);
+		else
+			jxl_read_u32(b, base, bits);
+	}
+}
+
+// JPEG XL 코드스트림 헤더 읽기 (0xFF 0x0A 다음부터), 크기와 애니메이션 여부
+static bool jxl_read_codestream(const guint8* bytes, gsize size, ImageInfo* info)
+{
+	if (size < 4 || bytes[0] != 0xFF || bytes[1] != 0x0A)
+		return false;
+	JxlBits b = { bytes + 2, size - 2, 0 };
+	guint32 width, height;
+	jxl_read_size(&b, &width, &height);
+
+	// ImageMetadata: all_default, extra_fields, orientation, 고유 크기, 미리 보기 다음에 애니메이션
+	if (!jxl_read_bits(&b, 1) && jxl_read_bits(&b, 1))
+	{
+		jxl_read_bits(&b, 3);
+		if (jxl_read_bits(&b, 1))
+		{
+			guint32 w, h;
+			jxl_read_size(&b, &w, &h);
+		}
+		if (jxl_read_bits(&b, 1))
+			jxl_skip_preview(&b);
+		info->has_anim = jxl_read_bits(&b, 1);
+	}
+
+	if (width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT)
+		return false;
+	info->width = (int)width;
+	info->height = (int)height;
+	return true;
+}
+
+// 빅 엔디안 읽기
+static guint32 read_be32(const guint8* p)
+{
+	return ((guint32)p[0] << 24) | ((guint32)p[1] << 16) | ((guint32)p[2] << 8) | p[3];
+}
+
+// ISOBMFF 상자 찾기, 이름 바로 다음 위치를 돌려줌
+// 상자 구조를 따라가지 않고 앞쪽에서 이름을 찾는다 (meta 안의 ispe 등이 깊이 들어 있으므로)
+static const guint8* isobmff_find(const guint8* bytes, gsize size, const char* name, gsize need)
+{
+	const gsize len = strlen(name);
+	const gsize limit = MIN(size, 256 * 1024);
+	for (gsize i = 4; i + len + need <= limit; i++)
+	{
+		if (memcmp(bytes + i, name, len) == 0)
+			return bytes + i + len;
+	}
+	return NULL;
+}
+
 // 이미지 파일 확인
 bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 {
@@ -645,6 +1031,7 @@ bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 			{
 				info->height = (bytes[i + 5] << 8) | bytes[i + 6];
 				info->width = (bytes[i + 7] << 8) | bytes[i + 8];
+				info->channels = i + 9 < size ? bytes[i + 9] : 0; // 성분 수, 1이면 회색
 				if (info->width && info->height)
 				{
 					info->type = IMAGE_FILE_TYPE_JPEG;
@@ -658,6 +1045,12 @@ bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 	{
 		info->width = (bytes[16] << 24) | (bytes[17] << 16) | (bytes[18] << 8) | bytes[19];
 		info->height = (bytes[20] << 24) | (bytes[21] << 16) | (bytes[22] << 8) | bytes[23];
+		if (size >= 26)
+		{
+			// IHDR 색 형식, 팔레트(3)는 풀면 RGB(A)가 되므로 모름으로
+			static const int png_channels[] = { 1, 0, 3, 0, 2, 0, 4 };
+			info->channels = bytes[25] < G_N_ELEMENTS(png_channels) ? png_channels[bytes[25]] : 0;
+		}
 		info->type = IMAGE_FILE_TYPE_PNG;
 		goto pos_detected;
 	}
@@ -772,12 +1165,14 @@ bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 		{
 			need_test_anim = false;
 			info->has_anim = (bytes[20] & 0x02) != 0; // ANIMATION 플래그 (비트 1)
+			info->channels = (bytes[20] & 0x10) != 0 ? 4 : 3; // ALPHA 플래그 (비트 4)
 			info->width = ((bytes[24] | (bytes[25] << 8) | (bytes[26] << 16)) & 0xFFFFFF) + 1;
 			info->height = ((bytes[27] | (bytes[28] << 8) | (bytes[29] << 16)) & 0xFFFFFF) + 1;
 		}
 		else if (bytes[15] == ' ')
 		{
 			need_test_anim = true;
+			info->channels = 3;
 			info->width = (bytes[26] | (bytes[27] << 8)) & 0x3FFF;
 			info->height = (bytes[28] | (bytes[29] << 8)) & 0x3FFF;
 		}
@@ -787,6 +1182,7 @@ bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 			const guint bits = bytes[21] | (bytes[22] << 8) | (bytes[23] << 16) | (bytes[24] << 24);
 			info->width = (int)((bits & 0x3FFF) + 1);
 			info->height = (int)(((bits >> 14) & 0x3FFF) + 1);
+			info->channels = (bits & 0x10000000) != 0 ? 4 : 3; // alpha_is_used
 		}
 		else
 		{
@@ -850,11 +1246,81 @@ bool doumi_detect_image_info(GBytes* data, ImageInfo* info)
 			goto pos_detected;
 		}
 	}
+	else if (size >= 16 && bytes[0] == 0xFF && bytes[1] == 0x0A) // JPEG XL 코드스트림
+	{
+		if (jxl_read_codestream(bytes, size, info))
+		{
+			info->type = IMAGE_FILE_TYPE_JXL;
+			goto pos_detected;
+		}
+	}
+	else if (size >= 32 && !memcmp(bytes, "\0\0\0\x0CJXL \r\n\x87\n", 12)) // JPEG XL 컨테이너
+	{
+		// jxlc 상자 또는 첫 jxlp 상자(앞에 4바이트 순번)에 코드스트림이 있다
+		for (gsize pos = 12; pos + 8 <= size;)
+		{
+			guint64 box_size = read_be32(bytes + pos);
+			gsize header = 8;
+			if (box_size == 1 && pos + 16 <= size)
+			{
+				box_size = ((guint64)read_be32(bytes + pos + 8) << 32) | read_be32(bytes + pos + 12);
+				header = 16;
+			}
+			const bool jxlc = !memcmp(bytes + pos + 4, "jxlc", 4);
+			const bool jxlp = !memcmp(bytes + pos + 4, "jxlp", 4);
+			if (jxlc || jxlp)
+			{
+				const gsize start = pos + header + (jxlp ? 4 : 0);
+				if (start < size && jxl_read_codestream(bytes + start, size - start, info))
+				{
+					info->type = IMAGE_FILE_TYPE_JXL;
+					goto pos_detected;
+				}
+				break;
+			}
+			if (box_size == 0 || box_size < header || box_size > size - pos)
+				break;
+			pos += (gsize)box_size;
+		}
+	}
+	else if (size >= 24 && !memcmp(bytes + 4, "ftyp", 4)) // AVIF (ISOBMFF)
+	{
+		// 주 브랜드나 호환 브랜드에 avif(그림), avis(연속 그림)가 있어야 한다
+		const gsize ftyp_size = MIN(read_be32(bytes), size);
+		bool avif = false, avis = false;
+		for (gsize i = 8; i + 4 <= ftyp_size; i += 4)
+		{
+			if (i == 12)
+				continue; // minor_version
+			avif |= !memcmp(bytes + i, "avif", 4);
+			avis |= !memcmp(bytes + i, "avis", 4);
+		}
+		const guint8* ispe = avif || avis ? isobmff_find(bytes, size, "ispe", 12) : NULL;
+		if (ispe != NULL)
+		{
+			// ispe: 버전/플래그(4) 폭(4) 높이(4)
+			info->width = (int)read_be32(ispe + 4);
+			info->height = (int)read_be32(ispe + 8);
+			info->has_anim = avis && !memcmp(bytes + 8, "avis", 4);
+			info->channels = isobmff_find(bytes, size, "auxiliary:alpha", 0) != NULL ? 4 : 3;
+			if (info->width > 0 && info->height > 0)
+			{
+				info->type = IMAGE_FILE_TYPE_AVIF;
+				goto pos_detected;
+			}
+		}
+	}
 
 	return false;
 
 pos_detected:
-	info->size = (size_t)info->width * (size_t)info->height * 4;
+	// 텍스쳐 크기, decoder_decode와 맞춘다 (불투명하면 RGB, 알파가 있거나 모르면 BGRA)
+#ifdef DOUMI_GRAY_TEXTURE
+	const int bpp = info->channels >= 1 && info->channels <= 3 ? info->channels : 4;
+#else
+	const int bpp = info->channels == 1 || info->channels == 3 ? 3 : 4;
+#endif
+	info->size = (size_t)info->width * (size_t)info->height * bpp;
 	return true;
 }
 
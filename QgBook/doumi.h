@@ -2,6 +2,11 @@
 
 #include "defs.h"
 
+// 회색 그림을 한 채널 텍스쳐로 만들 수 있나 (GDK_MEMORY_G8은 GTK 4.12부터)
+#if GTK_CHECK_VERSION(4, 12, 0)
+#define DOUMI_GRAY_TEXTURE 1
+#endif
+
 /**
  * @brief 책 이름 바꾸기 콜백 함수 타입
  * @param sender 호출자
@@ -56,6 +61,15 @@ extern GdkTexture* res_get_view_mode_texture(ViewMode mode);
 extern bool doumi_lock_program(void);
 extern void doumi_unlock_program(void);
 
+// 메모리
+extern guint64 doumi_get_available_memory(void);
+extern void doumi_trim_memory(void);
+
+// 시작 시간 측정 (G_MESSAGES_DEBUG=STARTUP 으로 보기)
+extern void doumi_startup_begin(void);
+extern void doumi_startup_mark(const char* phase);
+extern void doumi_startup_end(const char* phase);
+
 // 검사
 extern bool doumi_is_image_file(const char* filename);
 extern bool doumi_is_archive_zip(const char* filename);
@@ -81,6 +95,8 @@ extern const char* doumi_resource_path_format(const char* fmt, ...);
 extern char* doumi_load_resource_text(const char* resource_path, gsize* out_length);
 extern GdkPixbuf* doumi_load_gdk_pixbuf(const void* buffer, size_t size);
 extern GdkTexture* doumi_load_gdk_texture(const void* buffer, size_t size);
+extern GdkTexture* doumi_load_thumbnail_texture(GBytes* data, int max_size, GBytes** encoded);
+extern void doumi_premultiply_rgba_to_bgra(guint8* pixels, int width, int height, size_t stride);
 extern GdkTexture* doumi_texture_from_surface(cairo_surface_t* surface);
 extern GtkFileFilter* doumi_file_filter_all(void);
 extern GtkFileFilter* doumi_file_filter_image(void);
@@ -0,0 +1,864 @@
+﻿#include "pch.h"
+#include "configs.h"
+#include "book.h"
+#include "doumi.h"
+#include "library.h"
+
+/**
+ * @file library.c
+ * @brief 서재 카탈로그 구현 파일입니다.
+ *        DB 쓰기와 파일 시스템 읽기는 모두 작업 스레드에서 하고, 메인 스레드는 읽기 연결로 질의만 합니다.
+ *        파일 감시(GFileMonitor)는 메인 스레드에 두고, 바뀐 경로만 작업 큐에 넣습니다.
+ *        책 안의 ComicInfo.xml은 색인할 때 읽어서 meta 테이블과 FTS5 검색 색인(meta_fts)에 넣습니다.
+ */
+
+#define LIBRARY_MAX_WATCH 4096
+
+/**
+ * @brief 작업 종류
+ */
+typedef enum LibraryJobType
+{
+	LIBRARY_JOB_SCAN,          ///< 디렉토리를 아래까지 훑기
+	LIBRARY_JOB_UPDATE,        ///< 파일 하나 (디렉토리면 훑기)
+	LIBRARY_JOB_REMOVE,        ///< 파일이나 디렉토리 지우기
+	LIBRARY_JOB_OPENED,        ///< 책을 열었음
+	LIBRARY_JOB_QUIT,          ///< 스레드 끝내기
+} LibraryJobType;
+
+/**
+ * @brief 작업 큐 항목
+ */
+typedef struct LibraryJob
+{
+	LibraryJobType type;       ///< 작업 종류
+	char* path;                ///< 경로
+	gint64 when;               ///< 작업을 만든 시각 (초)
+} LibraryJob;
+
+/**
+ * @brief 서재 전역 자료
+ */
+static struct Library
+{
+	char* db_path;             ///< 카탈로그 DB 경로
+	GMutex db_lock;            ///< db 보호 (다음 책 찾기가 스레드에서 질의함)
+	sqlite3* db;               ///< 질의용 읽기 연결 (처음 질의할 때 엶)
+
+	GThread* thread;           ///< 작업 스레드
+	GAsyncQueue* jobs;         ///< 작업 큐 (LibraryJob*)
+	gint quit;                 ///< 끝내는 중 (atomic)
+
+	GHashTable* monitors;      ///< 디렉토리 -> GFileMonitor (메인 스레드 전용)
+	gint notify_pending;       ///< 알림 아이들이 걸려 있음 (atomic)
+	LibraryNotifyFunc notify;  ///< 바뀜 알림 콜백
+	gpointer notify_data;      ///< 알림 사용자 데이터
+} lib;
+
+/**
+ * @brief 작업을 해제합니다.
+ * @param job LibraryJob 포인터
+ */
+static void library_job_free(LibraryJob* job)
+{
+	g_free(job->path);
+	g_free(job);
+}
+
+/**
+ * @brief 작업을 큐에 넣습니다.
+ * @param type 작업 종류
+ * @param path 경로
+ */
+static void library_push_job(LibraryJobType type, const char* path)
+{
+	if (lib.jobs == NULL)
+		return;
+	LibraryJob* job = g_new0(LibraryJob, 1);
+	job->type = type;
+	job->path = g_strdup(path);
+	job->when = g_get_real_time() / G_USEC_PER_SEC;
+	g_async_queue_push(lib.jobs, job);
+}
+
+/**
+ * @brief 책 항목을 해제합니다.
+ * @param ptr LibraryBook 포인터
+ */
+static void library_book_free(gpointer ptr)
+{
+	LibraryBook* book = ptr;
+	g_free(book->path);
+	g_free(book->folder);
+	g_free(book);
+}
+
+/**
+ * @brief 카탈로그 DB를 엽니다. 스레드마다 따로 엽니다.
+ * @return sqlite3 포인터(실패 시 NULL)
+ */
+static sqlite3* library_open_db(void)
+{
+	sqlite3* db;
+	if (sqlite3_open(lib.db_path, &db) != SQLITE_OK)
+	{
+		g_log("LIBRARY", G_LOG_LEVEL_WARNING, "%s", db ? sqlite3_errmsg(db) : "sqlite3_open");
+		sqlite3_close(db);
+		return NULL;
+	}
+	sqlite3_busy_timeout(db, 1000);
+	return db;
+}
+
+/**
+ * @brief SQL 문장을 실행합니다.
+ * @param db sqlite3 포인터
+ * @param sql 실행할 SQL
+ * @return 성공 시 true
+ */
+static bool library_exec(sqlite3* db, const char* sql)
+{
+	char* err_msg = NULL;
+	if (sqlite3_exec(db, sql, NULL, NULL, &err_msg) != SQLITE_OK)
+	{
+		g_log("LIBRARY", G_LOG_LEVEL_WARNING, "%s", err_msg ? err_msg : sql);
+		sqlite3_free(err_msg);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief 카탈로그 스키마를 만듭니다. 읽기와 쓰기가 서로 막지 않게 WAL을 씁니다.
+ *        FTS5가 없는 SQLite면 검색 색인만 빠지고 나머지는 그대로 씁니다.
+ * @param db sqlite3 포인터
+ * @return 성공 시 true
+ */
+static bool library_prepare_schema(sqlite3* db)
+{
+	const bool ret = library_exec(db,
+		"PRAGMA journal_mode=WAL;"
+		"PRAGMA synchronous=NORMAL;"
+		"CREATE TABLE IF NOT EXISTS folders (path TEXT PRIMARY KEY, parent TEXT, scanned INTEGER);"
+		"CREATE TABLE IF NOT EXISTS books (path TEXT PRIMARY KEY, folder TEXT, size INTEGER, mtime INTEGER, "
+		"pages INTEGER, cover INTEGER DEFAULT 0, added INTEGER, opened INTEGER DEFAULT 0);"
+		"CREATE INDEX IF NOT EXISTS books_folder ON books(folder);"
+		"CREATE INDEX IF NOT EXISTS books_opened ON books(opened);"
+		"CREATE INDEX IF NOT EXISTS folders_parent ON folders(parent);"
+		"CREATE TABLE IF NOT EXISTS meta (path TEXT PRIMARY KEY, series TEXT, volume INTEGER, number TEXT, "
+		"title TEXT, writer TEXT, tags TEXT, spreads TEXT);"
+		"CREATE TRIGGER IF NOT EXISTS books_ad AFTER DELETE ON books BEGIN DELETE FROM meta WHERE path=old.path; END;");
+	if (!ret)
+		return false;
+
+	// 검색 색인은 meta를 내용으로 쓰고, 트리거로 맞춘다
+	if (!library_exec(db,
+		"CREATE VIRTUAL TABLE IF NOT EXISTS meta_fts USING fts5(series, title, writer, tags, content='meta', content_rowid='rowid');"
+		"CREATE TRIGGER IF NOT EXISTS meta_ai AFTER INSERT ON meta BEGIN "
+		"INSERT INTO meta_fts(rowid, series, title, writer, tags) VALUES (new.rowid, new.series, new.title, new.writer, new.tags); END;"
+		"CREATE TRIGGER IF NOT EXISTS meta_ad AFTER DELETE ON meta BEGIN "
+		"INSERT INTO meta_fts(meta_fts, rowid, series, title, writer, tags) VALUES ('delete', old.rowid, old.series, old.title, old.writer, old.tags); END;"
+		"CREATE TRIGGER IF NOT EXISTS meta_au AFTER UPDATE ON meta BEGIN "
+		"INSERT INTO meta_fts(meta_fts, rowid, series, title, writer, tags) VALUES ('delete', old.rowid, old.series, old.title, old.writer, old.tags); "
+		"INSERT INTO meta_fts(rowid, series, title, writer, tags) VALUES (new.rowid, new.series, new.title, new.writer, new.tags); END;"))
+		g_log("LIBRARY", G_LOG_LEVEL_WARNING, _("Full text search is not available"));
+	return true;
+}
+
+/**
+ * @brief 메인 스레드에서 바뀜 알림을 부릅니다.
+ * @param data 안 씀
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean idle_library_notify(gpointer data)
+{
+	g_atomic_int_set(&lib.notify_pending, false);
+	if (lib.notify != NULL)
+		lib.notify(lib.notify_data);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 바뀜 알림을 메인 스레드에 겁니다. 여러 번 불러도 한번만 알립니다.
+ */
+static void library_post_notify(void)
+{
+	if (g_atomic_int_compare_and_exchange(&lib.notify_pending, false, true))
+		g_idle_add(idle_library_notify, NULL);
+}
+
+/**
+ * @brief 디렉토리 아래 범위의 시작과 끝 문자열을 만듭니다. LIKE 대신 범위 비교를 쓰려고 합니다.
+ *        ("dir/" <= x < "dir0", '0'은 '/' 다음 글자)
+ * @param dir 디렉토리
+ * @param lower 시작 (g_free로 해제)
+ * @param upper 끝 (g_free로 해제)
+ */
+static void library_subtree_range(const char* dir, char** lower, char** upper)
+{
+	*lower = g_strconcat(dir, G_DIR_SEPARATOR_S, NULL);
+	*upper = g_strdup(*lower);
+	(*upper)[strlen(*upper) - 1] = G_DIR_SEPARATOR + 1;
+}
+
+/**
+ * @brief 디렉토리와 그 아래의 책, 폴더를 모두 지웁니다.
+ * @param db sqlite3 포인터
+ * @param dir 디렉토리
+ */
+static void worker_delete_subtree(sqlite3* db, const char* dir)
+{
+	static const char* sqls[] =
+	{
+		"DELETE FROM books WHERE folder=?1 OR (folder>=?2 AND folder<?3);",
+		"DELETE FROM folders WHERE path=?1 OR (path>=?2 AND path<?3);",
+	};
+	char* lower;
+	char* upper;
+	library_subtree_range(dir, &lower, &upper);
+	for (size_t i = 0; i < G_N_ELEMENTS(sqls); i++)
+	{
+		sqlite3_stmt* stmt;
+		if (sqlite3_prepare_v2(db, sqls[i], -1, &stmt, NULL) != SQLITE_OK)
+			continue;
+		sqlite3_bind_text(stmt, 1, dir, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 2, lower, -1, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, upper, -1, SQLITE_STATIC);
+		sqlite3_step(stmt);
+		sqlite3_finalize(stmt);
+	}
+	g_free(lower);
+	g_free(upper);
+}
+
+/**
+ * @brief 책의 ComicInfo를 넣거나 지웁니다.
+ * @param db sqlite3 포인터
+ * @param path 책 경로
+ * @param info ComicInfo 포인터 (NULL이면 지움)
+ */
+static void worker_upsert_meta(sqlite3* db, const char* path, const ComicInfo* info)
+{
+	sqlite3_stmt* stmt;
+	if (info == NULL)
+	{
+		if (sqlite3_prepare_v2(db, "DELETE FROM meta WHERE path=?;", -1, &stmt, NULL) == SQLITE_OK)
+		{
+			sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+			sqlite3_step(stmt);
+			sqlite3_finalize(stmt);
+		}
+		return;
+	}
+
+	static const char* sql =
+		"INSERT INTO meta (path, series, volume, number, title, writer, tags, spreads) VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8) "
+		"ON CONFLICT(path) DO UPDATE SET series=?2, volume=?3, number=?4, title=?5, writer=?6, tags=?7, spreads=?8;";
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+		return;
+
+	// 펼침 쪽은 "3,4,17" 처럼
+	GString* spreads = g_string_new(NULL);
+	for (guint i = 0; i < info->pages->len; i++)
+	{
+		const ComicPage* page = &g_array_index(info->pages, ComicPage, i);
+		if (page->spread)
+			g_string_append_printf(spreads, spreads->len ? ",%d" : "%d", page->image);
+	}
+
+	sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, info->series, -1, SQLITE_STATIC);
+	if (info->volume >= 0)
+		sqlite3_bind_int(stmt, 3, info->volume);
+	sqlite3_bind_text(stmt, 4, info->number, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 5, info->title, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 6, info->writer, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 7, info->tags, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 8, spreads->str, -1, SQLITE_STATIC);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+	g_string_free(spreads, true);
+}
+
+/**
+ * @brief 책 하나를 넣거나 고칩니다. 연 시각은 그대로 둡니다.
+ * @param db sqlite3 포인터
+ * @param path 책 경로
+ * @param st 파일 정보
+ * @param now 지금 시각
+ */
+static void worker_upsert_book(sqlite3* db, const char* path, const GStatBuf* st, gint64 now)
+{
+	static const char* sql =
+		"INSERT INTO books (path, folder, size, mtime, pages, cover, added) VALUES (?1, ?2, ?3, ?4, ?5, ?7, ?6) "
+		"ON CONFLICT(path) DO UPDATE SET size=?3, mtime=?4, pages=?5, cover=?7;";
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK)
+		return;
+	ComicInfo* info = NULL;
+	const int pages = book_zip_count_pages(path, &info);
+	char* folder = g_path_get_dirname(path);
+	sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+	sqlite3_bind_text(stmt, 2, folder, -1, SQLITE_STATIC);
+	sqlite3_bind_int64(stmt, 3, (sqlite3_int64)st->st_size);
+	sqlite3_bind_int64(stmt, 4, (sqlite3_int64)st->st_mtime);
+	sqlite3_bind_int(stmt, 5, pages);
+	sqlite3_bind_int64(stmt, 6, now);
+	sqlite3_bind_int(stmt, 7, comicinfo_get_cover(info));
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+	g_free(folder);
+
+	worker_upsert_meta(db, path, info);
+	comicinfo_free(info);
+}
+
+/**
+ * @brief 메인 스레드에서 디렉토리 감시를 겁니다.
+ * @param data 디렉토리 경로 (소유권을 가져감)
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean idle_library_watch(gpointer data);
+
+/**
+ * @brief 디렉토리 하나를 훑습니다. 크기와 수정 시각이 같은 책은 다시 열지 않습니다.
+ * @param db sqlite3 포인터
+ * @param dir 디렉토리
+ * @param subdirs 찾은 하위 디렉토리를 넣을 큐
+ * @param now 지금 시각
+ */
+static void worker_scan_dir(sqlite3* db, const char* dir, GQueue* subdirs, gint64 now)
+{
+	GDir* gd = g_dir_open(dir, 0, NULL);
+	if (gd == NULL)
+	{
+		worker_delete_subtree(db, dir);
+		return;
+	}
+
+	// 이미 아는 책과 하위 폴더
+	GHashTable* known = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	GHashTable* known_dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, "SELECT path, size, mtime FROM books WHERE folder=?;", -1, &stmt, NULL) == SQLITE_OK)
+	{
+		sqlite3_bind_text(stmt, 1, dir, -1, SQLITE_STATIC);
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			gint64* v = g_new(gint64, 2);
+			v[0] = sqlite3_column_int64(stmt, 1);
+			v[1] = sqlite3_column_int64(stmt, 2);
+			g_hash_table_insert(known, g_strdup((const char*)sqlite3_column_text(stmt, 0)), v);
+		}
+		sqlite3_finalize(stmt);
+	}
+	if (sqlite3_prepare_v2(db, "SELECT path FROM folders WHERE parent=?;", -1, &stmt, NULL) == SQLITE_OK)
+	{
+		sqlite3_bind_text(stmt, 1, dir, -1, SQLITE_STATIC);
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+			g_hash_table_add(known_dirs, g_strdup((const char*)sqlite3_column_text(stmt, 0)));
+		sqlite3_finalize(stmt);
+	}
+
+	library_exec(db, "BEGIN;");
+
+	const char* name;
+	while ((name = g_dir_read_name(gd)) != NULL && !g_atomic_int_get(&lib.quit))
+	{
+		if (name[0] == '.' || name[0] == '\0') // 숨김 파일이나 빈 이름은 무시
+			continue;
+		char* fullpath = g_build_filename(dir, name, NULL);
+		if (g_file_test(fullpath, G_FILE_TEST_IS_DIR))
+		{
+			g_hash_table_remove(known_dirs, fullpath);
+			g_queue_push_tail(subdirs, fullpath);
+			continue;
+		}
+		if (doumi_is_archive_zip(name))
+		{
+			GStatBuf st;
+			const gint64* v = g_hash_table_lookup(known, fullpath);
+			if (g_stat(fullpath, &st) == 0 &&
+				(v == NULL || v[0] != (gint64)st.st_size || v[1] != (gint64)st.st_mtime))
+				worker_upsert_book(db, fullpath, &st, now);
+			g_hash_table_remove(known, fullpath);
+		}
+		g_free(fullpath);
+	}
+	g_dir_close(gd);
+
+	if (!g_atomic_int_get(&lib.quit))
+	{
+		// 남은 것은 없어진 것
+		GHashTableIter iter;
+		gpointer key;
+		g_hash_table_iter_init(&iter, known);
+		if (sqlite3_prepare_v2(db, "DELETE FROM books WHERE path=?;", -1, &stmt, NULL) == SQLITE_OK)
+		{
+			while (g_hash_table_iter_next(&iter, &key, NULL))
+			{
+				sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+				sqlite3_step(stmt);
+				sqlite3_reset(stmt);
+			}
+			sqlite3_finalize(stmt);
+		}
+		g_hash_table_iter_init(&iter, known_dirs);
+		while (g_hash_table_iter_next(&iter, &key, NULL))
+			worker_delete_subtree(db, key);
+
+		if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO folders (path, parent, scanned) VALUES (?, ?, ?);", -1, &stmt, NULL) == SQLITE_OK)
+		{
+			char* parent = g_path_get_dirname(dir);
+			sqlite3_bind_text(stmt, 1, dir, -1, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 2, parent, -1, SQLITE_STATIC);
+			sqlite3_bind_int64(stmt, 3, now);
+			sqlite3_step(stmt);
+			sqlite3_finalize(stmt);
+			g_free(parent);
+		}
+	}
+
+	library_exec(db, "COMMIT;");
+	g_hash_table_destroy(known);
+	g_hash_table_destroy(known_dirs);
+}
+
+/**
+ * @brief 디렉토리를 아래까지 훑습니다. 훑은 디렉토리는 감시를 겁니다.
+ * @param db sqlite3 포인터
+ * @param root 디렉토리
+ * @param now 지금 시각
+ */
+static void worker_scan(sqlite3* db, const char* root, gint64 now)
+{
+	GQueue dirs = G_QUEUE_INIT;
+	g_queue_push_tail(&dirs, g_strdup(root));
+	char* dir;
+	while ((dir = g_queue_pop_head(&dirs)) != NULL)
+	{
+		if (!g_atomic_int_get(&lib.quit))
+		{
+			worker_scan_dir(db, dir, &dirs, now);
+			g_idle_add(idle_library_watch, g_strdup(dir));
+		}
+		g_free(dir);
+	}
+}
+
+/**
+ * @brief 파일 하나를 고칩니다. 없어졌으면 지우고, 디렉토리면 훑습니다.
+ * @param db sqlite3 포인터
+ * @param path 경로
+ * @param now 지금 시각
+ */
+static void worker_update(sqlite3* db, const char* path, gint64 now)
+{
+	GStatBuf st;
+	if (g_stat(path, &st) != 0)
+	{
+		worker_delete_subtree(db, path);
+		sqlite3_stmt* stmt;
+		if (sqlite3_prepare_v2(db, "DELETE FROM books WHERE path=?;", -1, &stmt, NULL) == SQLITE_OK)
+		{
+			sqlite3_bind_text(stmt, 1, path, -1, SQLITE_STATIC);
+			sqlite3_step(stmt);
+			sqlite3_finalize(stmt);
+		}
+	}
+	else if (g_file_test(path, G_FILE_TEST_IS_DIR))
+		worker_scan(db, path, now);
+	else if (doumi_is_archive_zip(path))
+		worker_upsert_book(db, path, &st, now);
+}
+
+/**
+ * @brief 책을 연 시각을 기록합니다.
+ * @param db sqlite3 포인터
+ * @param path 책 경로
+ * @param when 연 시각
+ */
+static void worker_opened(sqlite3* db, const char* path, gint64 when)
+{
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, "UPDATE books SET opened=? WHERE path=?;", -1, &stmt, NULL) != SQLITE_OK)
+		return;
+	sqlite3_bind_int64(stmt, 1, when);
+	sqlite3_bind_text(stmt, 2, path, -1, SQLITE_STATIC);
+	sqlite3_step(stmt);
+	sqlite3_finalize(stmt);
+}
+
+/**
+ * @brief 작업 스레드. 큐에서 작업을 꺼내 카탈로그를 고칩니다.
+ * @param data 안 씀
+ * @return NULL
+ */
+static gpointer thread_library_worker(gpointer data)
+{
+	sqlite3* db = library_open_db();
+	if (db != NULL && !library_prepare_schema(db))
+	{
+		sqlite3_close(db);
+		db = NULL;
+	}
+
+	for (;;)
+	{
+		LibraryJob* job = g_async_queue_pop(lib.jobs);
+		if (job->type == LIBRARY_JOB_QUIT)
+		{
+			library_job_free(job);
+			break;
+		}
+
+		if (db != NULL && !g_atomic_int_get(&lib.quit))
+		{
+			switch (job->type)
+			{
+				case LIBRARY_JOB_SCAN:
+					worker_scan(db, job->path, job->when);
+					break;
+				case LIBRARY_JOB_UPDATE:
+				case LIBRARY_JOB_REMOVE:
+					// 지우기도 파일이 정말 없는지 보고 처리 (이름 바꾸기로 다시 생겼을 수 있음)
+					worker_update(db, job->path, job->when);
+					break;
+				case LIBRARY_JOB_OPENED:
+					worker_opened(db, job->path, job->when);
+					break;
+				default:
+					break;
+			}
+		}
+		library_job_free(job);
+
+		if (g_async_queue_length(lib.jobs) <= 0)
+			library_post_notify();
+	}
+
+	if (db != NULL)
+		sqlite3_close(db);
+	return NULL;
+}
+
+/**
+ * @brief 파일 감시 콜백. 바뀐 경로를 작업 큐에 넣습니다.
+ */
+static void cb_library_monitor(GFileMonitor* monitor, GFile* file, GFile* other, GFileMonitorEvent event, gpointer user_data)
+{
+	char* path = g_file_get_path(file);
+	if (path == NULL)
+		return;
+
+	switch (event)
+	{
+		case G_FILE_MONITOR_EVENT_CREATED:
+		case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+		case G_FILE_MONITOR_EVENT_MOVED_IN:
+			library_push_job(LIBRARY_JOB_UPDATE, path);
+			break;
+		case G_FILE_MONITOR_EVENT_DELETED:
+		case G_FILE_MONITOR_EVENT_MOVED_OUT:
+			g_hash_table_remove(lib.monitors, path);
+			library_push_job(LIBRARY_JOB_REMOVE, path);
+			break;
+		case G_FILE_MONITOR_EVENT_RENAMED:
+		{
+			g_hash_table_remove(lib.monitors, path);
+			library_push_job(LIBRARY_JOB_REMOVE, path);
+			char* other_path = other ? g_file_get_path(other) : NULL;
+			if (other_path != NULL)
+				library_push_job(LIBRARY_JOB_UPDATE, other_path);
+			g_free(other_path);
+			break;
+		}
+		default:
+			break;
+	}
+	g_free(path);
+}
+
+// 디렉토리 감시 걸기
+static gboolean idle_library_watch(gpointer data)
+{
+	char* dir = data;
+	if (lib.monitors != NULL && !g_hash_table_contains(lib.monitors, dir) &&
+		g_hash_table_size(lib.monitors) < LIBRARY_MAX_WATCH)
+	{
+		GFile* file = g_file_new_for_path(dir);
+		GFileMonitor* monitor = g_file_monitor_directory(file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+		g_object_unref(file);
+		if (monitor != NULL)
+		{
+			g_signal_connect(monitor, "changed", G_CALLBACK(cb_library_monitor), NULL);
+			g_hash_table_insert(lib.monitors, dir, monitor);
+			return G_SOURCE_REMOVE;
+		}
+	}
+	g_free(dir);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 감시를 끊고 해제합니다.
+ * @param ptr GFileMonitor 포인터
+ */
+static void library_monitor_free(gpointer ptr)
+{
+	GFileMonitor* monitor = ptr;
+	g_signal_handlers_disconnect_by_func(monitor, cb_library_monitor, NULL);
+	g_file_monitor_cancel(monitor);
+	g_object_unref(monitor);
+}
+
+/**
+ * @brief 설정의 서재 폴더 목록을 얻습니다.
+ * @return 폴더 배열 (g_strfreev로 해제)
+ */
+static char** library_get_roots(void)
+{
+	const char* roots = config_get_string_ptr(CONFIG_FILE_LIBRARY_ROOTS, true);
+	if (roots == NULL || *roots == '\0')
+		return g_new0(char*, 1);
+	return g_strsplit(roots, G_SEARCHPATH_SEPARATOR_S, -1);
+}
+
+// 서재 시작
+void library_init(void)
+{
+	if (lib.thread != NULL)
+		return;
+
+	lib.db_path = g_build_filename(config_get_app_path(), "QgBook.library", NULL);
+	lib.jobs = g_async_queue_new_full((GDestroyNotify)library_job_free);
+	lib.monitors = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, library_monitor_free);
+	g_atomic_int_set(&lib.quit, false);
+	lib.thread = g_thread_new("library", thread_library_worker, NULL);
+
+	// 꺼져 있던 동안 바뀐 것은 감시로 알 수 없으니 다시 훑는다 (안 바뀐 책은 열지 않음)
+	char** roots = library_get_roots();
+	for (char** r = roots; *r != NULL; r++)
+	{
+		if (**r != '\0')
+			library_push_job(LIBRARY_JOB_SCAN, *r);
+	}
+	g_strfreev(roots);
+}
+
+// 서재 끝내기
+void library_dispose(void)
+{
+	if (lib.thread == NULL)
+		return;
+
+	g_atomic_int_set(&lib.quit, true);
+	LibraryJob* job = g_new0(LibraryJob, 1);
+	job->type = LIBRARY_JOB_QUIT;
+	g_async_queue_push_front(lib.jobs, job);
+	g_thread_join(lib.thread);
+	lib.thread = NULL;
+
+	g_clear_pointer(&lib.monitors, g_hash_table_destroy);
+	g_clear_pointer(&lib.jobs, g_async_queue_unref);
+	g_mutex_lock(&lib.db_lock);
+	if (lib.db != NULL)
+	{
+		sqlite3_close(lib.db);
+		lib.db = NULL;
+	}
+	g_mutex_unlock(&lib.db_lock);
+	g_clear_pointer(&lib.db_path, g_free);
+	lib.notify = NULL;
+}
+
+// 서재 폴더 더하기
+bool library_add_root(const char* folder)
+{
+	g_return_val_if_fail(folder != NULL, false);
+
+	char** roots = library_get_roots();
+	bool found = false;
+	for (char** r = roots; *r != NULL && !found; r++)
+	{
+		// 이미 있거나 있는 서재 폴더 안이면 그대로
+		const size_t len = strlen(*r);
+		found = len > 0 && strncmp(folder, *r, len) == 0 && (folder[len] == '\0' || G_IS_DIR_SEPARATOR(folder[len]));
+	}
+	if (!found)
+	{
+		const guint count = g_strv_length(roots);
+		roots = g_renew(char*, roots, count + 2);
+		roots[count] = g_strdup(folder);
+		roots[count + 1] = NULL;
+		char* value = g_strjoinv(G_SEARCHPATH_SEPARATOR_S, roots);
+		config_set_string(CONFIG_FILE_LIBRARY_ROOTS, value, false);
+		g_free(value);
+		library_push_job(LIBRARY_JOB_SCAN, folder);
+	}
+	g_strfreev(roots);
+	return !found;
+}
+
+// 책을 열었음
+void library_book_opened(const char* path)
+{
+	g_return_if_fail(path != NULL);
+	library_push_job(LIBRARY_JOB_OPENED, path);
+}
+
+// 바뀜 알림 콜백
+void library_set_notify(LibraryNotifyFunc func, gpointer user_data)
+{
+	lib.notify = func;
+	lib.notify_data = user_data;
+}
+
+/**
+ * @brief 질의용 읽기 연결을 얻습니다. 처음이면 엽니다. db_lock을 잡고 부를 것
+ * @return sqlite3 포인터(실패 시 NULL)
+ */
+static sqlite3* library_get_read_db(void)
+{
+	if (lib.db == NULL && lib.db_path != NULL)
+		lib.db = library_open_db();
+	return lib.db;
+}
+
+/**
+ * @brief 질의 결과를 책 배열로 읽습니다.
+ *        열 순서: path, folder, size, mtime, pages, cover, opened
+ * @param stmt 바인딩을 마친 문장 (여기서 해제)
+ * @return GPtrArray<LibraryBook*>
+ */
+static GPtrArray* library_read_books(sqlite3_stmt* stmt)
+{
+	GPtrArray* books = g_ptr_array_new_with_free_func(library_book_free);
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		LibraryBook* book = g_new0(LibraryBook, 1);
+		book->path = g_strdup((const char*)sqlite3_column_text(stmt, 0));
+		book->folder = g_strdup((const char*)sqlite3_column_text(stmt, 1));
+		book->size = sqlite3_column_int64(stmt, 2);
+		book->mtime = sqlite3_column_int64(stmt, 3);
+		book->pages = sqlite3_column_type(stmt, 4) == SQLITE_NULL ? -1 : sqlite3_column_int(stmt, 4);
+		book->cover = sqlite3_column_int(stmt, 5);
+		book->opened = sqlite3_column_int64(stmt, 6);
+		g_ptr_array_add(books, book);
+	}
+	sqlite3_finalize(stmt);
+	return books;
+}
+
+#define LIBRARY_BOOK_COLUMNS "path, folder, size, mtime, pages, cover, opened"
+
+/**
+ * @brief 디렉토리의 책을 얻습니다. db_lock을 잡고 부를 것
+ * @param folder 디렉토리 경로
+ * @return GPtrArray<LibraryBook*>, 카탈로그에 없는 디렉토리면 NULL
+ */
+static GPtrArray* library_query_folder_locked(const char* folder)
+{
+	sqlite3* db = library_get_read_db();
+	if (db == NULL)
+		return NULL;
+
+	// 훑은 적 없는 디렉토리는 모른다고 해야 부르는 쪽이 직접 읽음
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, "SELECT 1 FROM folders WHERE path=?;", -1, &stmt, NULL) != SQLITE_OK)
+		return NULL;
+	sqlite3_bind_text(stmt, 1, folder, -1, SQLITE_STATIC);
+	const bool scanned = sqlite3_step(stmt) == SQLITE_ROW;
+	sqlite3_finalize(stmt);
+	if (!scanned)
+		return NULL;
+
+	if (sqlite3_prepare_v2(db, "SELECT " LIBRARY_BOOK_COLUMNS " FROM books WHERE folder=?;", -1, &stmt, NULL) != SQLITE_OK)
+		return NULL;
+	sqlite3_bind_text(stmt, 1, folder, -1, SQLITE_STATIC);
+	return library_read_books(stmt);
+}
+
+// 디렉토리의 책
+GPtrArray* library_query_folder(const char* folder)
+{
+	g_return_val_if_fail(folder != NULL, NULL);
+	g_mutex_lock(&lib.db_lock);
+	GPtrArray* books = library_query_folder_locked(folder);
+	g_mutex_unlock(&lib.db_lock);
+	return books;
+}
+
+// 안 읽은 책
+GPtrArray* library_query_unread(int limit)
+{
+	g_mutex_lock(&lib.db_lock);
+	sqlite3* db = library_get_read_db();
+	sqlite3_stmt* stmt;
+	GPtrArray* books;
+	if (db == NULL ||
+		sqlite3_prepare_v2(db, "SELECT " LIBRARY_BOOK_COLUMNS " FROM books WHERE opened=0 ORDER BY mtime DESC LIMIT ?;", -1, &stmt, NULL) != SQLITE_OK)
+		books = g_ptr_array_new_with_free_func(library_book_free);
+	else
+	{
+		sqlite3_bind_int(stmt, 1, limit);
+		books = library_read_books(stmt);
+	}
+	g_mutex_unlock(&lib.db_lock);
+	return books;
+}
+
+/**
+ * @brief 검색어를 FTS5 질의로 바꿉니다. 낱말마다 따옴표로 묶고 앞부분 일치로 찾습니다.
+ * @param query 검색어
+ * @return FTS5 질의 (g_free로 해제), 낱말이 없으면 NULL
+ */
+static char* library_build_match(const char* query)
+{
+	GString* match = g_string_new(NULL);
+	char** tokens = g_strsplit_set(query, " \t", -1);
+	for (char** t = tokens; *t != NULL; t++)
+	{
+		if (**t == '\0')
+			continue;
+		if (match->len > 0)
+			g_string_append_c(match, ' ');
+		g_string_append_c(match, '"');
+		for (const char* c = *t; *c; c++)
+		{
+			if (*c == '"')
+				g_string_append_c(match, '"');
+			g_string_append_c(match, *c);
+		}
+		g_string_append(match, "\"*");
+	}
+	g_strfreev(tokens);
+	return g_string_free(match, match->len == 0);
+}
+
+// 메타데이터 검색
+GPtrArray* library_search(const char* query, int limit)
+{
+	g_return_val_if_fail(query != NULL, NULL);
+
+	g_mutex_lock(&lib.db_lock);
+	sqlite3* db = library_get_read_db();
+	char* match = library_build_match(query);
+	sqlite3_stmt* stmt;
+	GPtrArray* books;
+	if (db == NULL || match == NULL ||
+		sqlite3_prepare_v2(db,
+			"SELECT b.path, b.folder, b.size, b.mtime, b.pages, b.cover, b.opened "
+			"FROM meta_fts JOIN meta m ON m.rowid=meta_fts.rowid JOIN books b ON b.path=m.path "
+			"WHERE meta_fts MATCH ? ORDER BY rank LIMIT ?;", -1, &stmt, NULL) != SQLITE_OK)
+		books = g_ptr_array_new_with_free_func(library_book_free);
+	else
+	{
+		sqlite3_bind_text(stmt, 1, match, -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(stmt, 2, limit);
+		books = library_read_books(stmt);
+	}
+	g_mutex_unlock(&lib.db_lock);
+	g_free(match);
+	return books;
+}
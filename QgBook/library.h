@@ -0,0 +1,82 @@
+﻿#pragma once
+
+/**
+ * @file library.h
+ * @brief 서재(책 목록) 카탈로그를 정의하는 헤더 파일입니다.
+ *        설정한 서재 폴더를 백그라운드 스레드에서 훑어 SQLite에 넣어두고, 파일 감시로 바뀐 것만 고칩니다.
+ *        UI는 카탈로그에 물어보기만 하므로 파일 시스템을 건드리지 않습니다.
+ *        책 안의 ComicInfo.xml도 함께 색인해서 전문 검색(FTS5)을 할 수 있습니다.
+ */
+
+/**
+ * @brief 카탈로그의 책 한 권
+ */
+typedef struct LibraryBook
+{
+	char* path;                ///< 전체 경로
+	char* folder;              ///< 들어있는 디렉토리
+	gint64 size;               ///< 파일 크기
+	gint64 mtime;              ///< 파일 수정 시각
+	int pages;                 ///< 쪽 수 (모르면 -1)
+	int cover;                 ///< 표지 쪽 번호
+	gint64 opened;             ///< 마지막으로 연 시각 (0이면 안 읽음)
+} LibraryBook;
+
+/**
+ * @brief 카탈로그가 바뀌었을 때 부르는 콜백 (메인 스레드)
+ * @param user_data 사용자 데이터
+ */
+typedef void (*LibraryNotifyFunc)(gpointer user_data);
+
+/**
+ * @brief 서재를 시작합니다. 작업 스레드를 띄우고 설정한 서재 폴더를 다시 훑습니다.
+ *        DB는 작업 스레드가 열기 때문에 바로 돌아옵니다.
+ */
+extern void library_init(void);
+
+/**
+ * @brief 서재를 끝냅니다. 훑던 작업을 멈추고 스레드가 끝나길 기다립니다.
+ */
+extern void library_dispose(void);
+
+/**
+ * @brief 서재 폴더를 더하고 훑습니다. 설정에도 저장합니다.
+ * @param folder 폴더 경로
+ * @return 새로 더했으면 true, 이미 있거나 다른 서재 폴더 안이면 false
+ */
+extern bool library_add_root(const char* folder);
+
+/**
+ * @brief 책을 열었다고 기록합니다. (최근, 안 읽은 책 질의에 씀)
+ * @param path 책 경로
+ */
+extern void library_book_opened(const char* path);
+
+/**
+ * @brief 카탈로그가 바뀌었을 때 부를 콜백을 설정합니다.
+ * @param func 콜백 (NULL이면 지움)
+ * @param user_data 콜백 사용자 데이터
+ */
+extern void library_set_notify(LibraryNotifyFunc func, gpointer user_data);
+
+/**
+ * @brief 디렉토리에 있는 책을 얻습니다. 스레드에서 불러도 됩니다.
+ * @param folder 디렉토리 경로
+ * @return GPtrArray<LibraryBook*>, 카탈로그에 없는 디렉토리면 NULL (g_ptr_array_unref로 해제)
+ */
+extern GPtrArray* library_query_folder(const char* folder);
+
+/**
+ * @brief 아직 안 읽은 책을 새 것부터 얻습니다.
+ * @param limit 최대 개수
+ * @return GPtrArray<LibraryBook*> (g_ptr_array_unref로 해제)
+ */
+extern GPtrArray* library_query_unread(int limit);
+
+/**
+ * @brief ComicInfo(시리즈, 제목, 작가, 태그)에서 책을 찾습니다. 낱말마다 앞부분이 맞으면 찾습니다.
+ * @param query 검색어
+ * @param limit 최대 개수
+ * @return GPtrArray<LibraryBook*> (g_ptr_array_unref로 해제)
+ */
+extern GPtrArray* library_search(const char* query, int limit);
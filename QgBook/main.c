@@ -1,12 +1,17 @@
 ﻿#include "pch.h"
+#include "bufpool.h"
 #include "configs.h"
 #include "doumi.h"
+#include "library.h"
+#include "thumb.h"
 
 /* main.c - 큭책 프로그램의 진입점
  *
  * main() 함수 제공
+ * 파일 열기(G_APPLICATION_HANDLES_OPEN)와 두번째 실행 넘겨주기
  * 이미지(텍스쳐) 리소스 로딩
  * CSS 스타일 적용
+ * 서재 카탈로그 시작과 끝
  * 윈도우의 경우 g_log 핸들러 등록
  */
 
@@ -16,14 +21,39 @@ extern GResource* resg_get_resource(void);
 // 읽기 윈도우
 extern void* read_window_new(GtkApplication* app);
 extern void read_window_show(const void* rw);
+extern void read_window_open_files(void* rw, GFile** files, int n_files);
+
+// 읽기 윈도우는 하나만
+static void* s_read_window;
 
 // 텍스쳐 캐시
 static GdkTexture* s_textures[RES_MAX_VALUE];
+static guint s_texture_idle;
 
-// 텍스쳐 얻기
+// 리소스 텍스쳐 파일 이름
+static const char* s_res_filenames[RES_MAX_VALUE] =
+{
+	"pix/no_image.png",
+	"pix/housebari_head_128.jpg",
+	"icon/directory.png",
+	"icon/menus.png",
+	"icon/move.png",
+	"icon/painting.png",
+	"icon/purutu.png",
+	"icon/rename.png",
+	"icon/view-mode-fit.png",
+	"icon/view-mode-l2r.png",
+	"icon/view-mode-r2l.png",
+};
+
+// 텍스쳐 얻기, 아직 안 읽었으면 여기서 읽는다
 GdkTexture* res_get_texture(const ResKeys key)
 {
-	return key < RES_MAX_VALUE ? s_textures[key] : NULL;
+	if (key >= RES_MAX_VALUE)
+		return NULL;
+	if (s_textures[key] == NULL && s_res_filenames[key] != NULL)
+		s_textures[key] = gdk_texture_new_from_resource(doumi_resource_path(s_res_filenames[key]));
+	return s_textures[key];
 }
 
 // 뷰 모드에 따른 텍스쳐 얻기
@@ -32,55 +62,94 @@ GdkTexture* res_get_view_mode_texture(ViewMode mode)
 	const ResKeys key =
 		mode == VIEW_MODE_FIT ? RES_ICON_VIEW_MODE_FIT :
 		mode == VIEW_MODE_LEFT_TO_RIGHT ? RES_ICON_VIEW_MODE_L2R :
-		mode == VIEW_MODE_RIGHT_TO_LEFT ? RES_ICON_VIEW_MODE_R2L : RES_ICON_PURUTU;
-	return s_textures[key];
+		mode == VIEW_MODE_RIGHT_TO_LEFT ? RES_ICON_VIEW_MODE_R2L :
+		mode == VIEW_MODE_SCROLL ? RES_ICON_VIEW_MODE_FIT : RES_ICON_PURUTU; // 쭉 보기는 한장 아이콘을 같이 쓴다
+	return res_get_texture(key);
 }
 
-// 활기차게 콜백
-static void app_activate(GtkApplication* app, gpointer user_data)
+// 첫 화면에 안 쓰는 텍스쳐는 아이들에서 하나씩 읽는다
+static gboolean idle_load_textures(gpointer user_data)
 {
-	// 설정 캐시
-	config_load_cache();
-
-	// 리소스 텍스쳐
-	static const char* s_res_filenames[RES_MAX_VALUE] =
-	{
-		"pix/no_image.png",
-		"pix/housebari_head_128.jpg",
-		"icon/directory.png",
-		"icon/menus.png",
-		"icon/move.png",
-		"icon/painting.png",
-		"icon/purutu.png",
-		"icon/rename.png",
-		"icon/view-mode-fit.png",
-		"icon/view-mode-l2r.png",
-		"icon/view-mode-r2l.png",
-	};
 	for (int i = 0; i < RES_MAX_VALUE; i++)
 	{
-		if (s_res_filenames[i] == NULL)
-			continue; // NULL은 건너뛰기
-		const char* psz = doumi_resource_path(s_res_filenames[i]);
-		GdkTexture* texture = gdk_texture_new_from_resource(psz);
-		s_textures[i] = texture;
+		if (s_textures[i] == NULL && s_res_filenames[i] != NULL)
+		{
+			res_get_texture((ResKeys)i);
+			return G_SOURCE_CONTINUE;
+		}
 	}
 
+	s_texture_idle = 0;
+	doumi_startup_mark("deferred textures");
+	return G_SOURCE_REMOVE;
+}
+
+// 처음 한번 윈도우 만들기, 이미 있으면 그걸 씀
+static void* app_ensure_window(GtkApplication* app)
+{
+	if (s_read_window != NULL)
+		return s_read_window;
+
+	// 설정 캐시
+	config_load_cache();
+	doumi_startup_mark("config cache");
+
 	// CSS 등록
 	GtkCssProvider* css = gtk_css_provider_new();
 	GdkDisplay* display = gdk_display_get_default();
 	gtk_css_provider_load_from_resource(css, doumi_resource_path("style.css"));
 	gtk_style_context_add_provider_for_display(display, GTK_STYLE_PROVIDER(css), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
 	g_object_unref(css);
+	doumi_startup_mark("css");
+
+	// 윈도우 만들기, 텍스쳐는 윈도우가 쓰는 것만 그때 읽는다
+	s_read_window = read_window_new(app);
+	doumi_startup_mark("window create");
+
+	// 서재, 훑기는 스레드에서 하므로 바로 돌아온다
+	library_init();
+	doumi_startup_mark("library");
+
+	// 나머지 텍스쳐
+	s_texture_idle = g_idle_add_full(G_PRIORITY_LOW, idle_load_textures, NULL, NULL);
+
+	return s_read_window;
+}
+
+// 활기차게 콜백
+// 두번째 실행에서 넘어온 경우에도 불리므로 이미 있는 윈도우를 앞으로
+static void app_activate(GtkApplication* app, gpointer user_data)
+{
+	const void* rw = app_ensure_window(app);
+	read_window_show(rw);
+	doumi_startup_mark("window show");
+}
 
-	// 윈도우 열기
-	const void* rw = read_window_new(app);
+// 파일 열기 콜백
+// 명령줄로 준 파일이나, 두번째 실행에서 넘어온 파일을 이미 떠있는 윈도우로 연다
+static void app_open(GApplication* app, GFile** files, gint n_files, const gchar* hint, gpointer user_data)
+{
+	void* rw = app_ensure_window(GTK_APPLICATION(app));
+	read_window_open_files(rw, files, n_files); // 책은 하나만 열 수 있으니 나머지는 읽기 대기열로
 	read_window_show(rw);
+	doumi_startup_mark("window show");
 }
 
 // 셧다운 콜백
 static void app_shutdown(GtkApplication* app, gpointer user_data)
 {
+	if (s_texture_idle)
+		g_source_remove(s_texture_idle);
+
+	// 서재 스레드 끝내기
+	library_dispose();
+
+	// 썸네일 저장 기다리기
+	thumb_store_sync();
+
+	// 놓인 버퍼 해제
+	bufpool_clear();
+
 	// 텍스쳐 해제
 	for (int i = 0; i < RES_MAX_VALUE; i++)
 	{
@@ -124,24 +193,55 @@ int main(int argc, char** argv)
 {
 #endif
 	// 여기가 시작
-	GtkApplication* app = gtk_application_new("ksh.qg.book", G_APPLICATION_DEFAULT_FLAGS);
+	doumi_startup_begin();
 	g_resources_register(resg_get_resource());
 
-	// 설정
-	if (!config_init())
-		return 1; // 초기 설정 실패 시 종료
-
-	// 한번만 실행 확인
-	if (config_get_bool(CONFIG_GENERAL_RUN_ONCE, true) && !doumi_lock_program())
-	{
-		config_dispose();
-		return 2;
-	}
+	// 한번만 실행이면 GApplication이 두번째 실행의 파일을 첫번째로 넘겨준다
+	// 두번째 실행은 넘겨주고 바로 끝나므로 설정은 이 값 하나만 읽고, 나머지는 첫번째 실행만 읽는다
+	const bool run_once = config_peek_bool(CONFIG_GENERAL_RUN_ONCE);
+	GApplicationFlags flags = G_APPLICATION_HANDLES_OPEN;
+	if (!run_once)
+		flags |= G_APPLICATION_NON_UNIQUE;
+	GtkApplication* app = gtk_application_new("ksh.qg.book", flags);
 
 	// 시그널
 	g_signal_connect(app, "activate", G_CALLBACK(app_activate), NULL);
+	g_signal_connect(app, "open", G_CALLBACK(app_open), NULL);
 	g_signal_connect(app, "shutdown", G_CALLBACK(app_shutdown), NULL);
 
+	if (run_once)
+	{
+		GError* error = NULL;
+		if (!g_application_register(G_APPLICATION(app), NULL, &error))
+		{
+			g_log("MAIN", G_LOG_LEVEL_WARNING, "%s", error->message);
+			g_clear_error(&error);
+		}
+
+		// 원격이면 g_application_run이 첫번째 실행으로 넘겨주고 바로 끝난다
+		if (g_application_get_is_remote(G_APPLICATION(app)))
+		{
+			const int status = g_application_run(G_APPLICATION(app), argc, argv);
+			g_object_unref(app);
+			return status;
+		}
+
+		// 원격을 못 쓰는 곳(윈도우 등)에서는 예전처럼 잠금으로 막는다
+		if (!doumi_lock_program())
+		{
+			g_object_unref(app);
+			return 2;
+		}
+	}
+
+	// 설정
+	if (!config_init())
+	{
+		g_object_unref(app);
+		return 1; // 초기 설정 실패 시 종료
+	}
+	doumi_startup_mark("config init");
+
 	// 시작
 	const int status = g_application_run(G_APPLICATION(app), argc, argv);
 	g_object_unref(app);
@@ -2,13 +2,18 @@
 #include "configs.h"
 #include "book.h"
 #include "doumi.h"
+#include "thumb.h"
 
 /**
  * @file page_dialog.c
  * @brief 책의 쪽(페이지) 선택을 위한 다이얼로그 및 관련 객체 구현 파일입니다.
  *        페이지 목록 표시, 선택, 콜백 처리 등 쪽 이동 UI를 담당합니다.
+ *        목록(GtkColumnView)과 썸네일(GtkGridView) 두 가지로 볼 수 있습니다.
+ *        검색 칸으로 이름, 쪽 번호 범위, 크기로 걸러 볼 수 있습니다.
  */
 
+#define PAGE_THUMB_SIZE 160
+
 /**
  * @brief 쪽(페이지) 정보를 나타내는 객체 타입 선언
  *        GObject 기반으로 페이지 번호, 파일명, 날짜, 크기 정보를 가집니다.
@@ -62,6 +67,331 @@ static void page_object_init(PageObject* self)
 	self->size = 0;
 }
 
+/**
+ * @brief PageObject를 만듭니다.
+ * @param entry 페이지 엔트리
+ * @return 새 PageObject (참조 1)
+ */
+static PageObject* page_object_new(const PageEntry* entry)
+{
+	PageObject* o = g_object_new(TYPE_PAGE_OBJECT, NULL);
+	o->no = entry->page;
+	o->name = g_strdup(entry->name);
+	o->date = entry->date;
+	o->size = entry->size;
+	return o;
+}
+
+/**
+ * @brief 책의 엔트리를 그대로 보여주는 목록 모델 타입 선언
+ *        PageObject는 뷰가 행을 요청할 때만 만들므로 책을 바꾸는 비용이 쪽 수와 상관없습니다.
+ */
+#define TYPE_PAGE_LIST_MODEL (page_list_model_get_type())
+G_DECLARE_FINAL_TYPE(PageListModel, page_list_model, , PAGE_LIST_MODEL, GObject)
+
+/**
+ * @brief 페이지 목록 모델 구조체
+ */
+typedef struct _PageListModel
+{
+	GObject parent_instance; ///< GObject 상속
+	Book* book;              ///< 책 (소유하지 않음)
+	guint count;             ///< 항목 수
+	GPtrArray* lower_names;  ///< 소문자로 바꾼 이름 색인 (처음 검색할 때 만듦)
+	GArray* matches;         ///< 검색에 맞은 쪽 번호 (guint, NULL이면 모든 쪽)
+} PageListModel;
+
+/**
+ * @brief GListModel: 항목 타입
+ */
+static GType page_list_model_get_item_type(GListModel* list)
+{
+	return TYPE_PAGE_OBJECT;
+}
+
+/**
+ * @brief GListModel: 항목 수
+ */
+static guint page_list_model_get_n_items(GListModel* list)
+{
+	const PageListModel* self = (PageListModel*)list;
+	return self->matches != NULL ? self->matches->len : self->count;
+}
+
+/**
+ * @brief GListModel: 항목 얻기, 요청할 때 PageObject를 만듭니다.
+ */
+static gpointer page_list_model_get_item(GListModel* list, guint position)
+{
+	const PageListModel* self = (PageListModel*)list;
+	if (self->book == NULL || position >= page_list_model_get_n_items(list))
+		return NULL;
+	const guint no = self->matches != NULL ? g_array_index(self->matches, guint, position) : position;
+	const PageEntry* entry = g_ptr_array_index(self->book->entries, no);
+	return page_object_new(entry);
+}
+
+/**
+ * @brief GListModel 인터페이스 초기화 함수
+ * @param iface GListModelInterface 포인터
+ */
+static void page_list_model_iface_init(GListModelInterface* iface)
+{
+	iface->get_item_type = page_list_model_get_item_type;
+	iface->get_n_items = page_list_model_get_n_items;
+	iface->get_item = page_list_model_get_item;
+}
+
+G_DEFINE_TYPE_WITH_CODE(PageListModel, page_list_model, G_TYPE_OBJECT,
+	G_IMPLEMENT_INTERFACE(G_TYPE_LIST_MODEL, page_list_model_iface_init))
+
+/**
+ * @brief PageListModel의 메모리 해제(파이널라이즈) 함수
+ * @param object GObject 포인터
+ */
+static void page_list_model_finalize(GObject* object)
+{
+	PageListModel* self = (PageListModel*)object;
+	g_clear_pointer(&self->lower_names, g_ptr_array_unref);
+	g_clear_pointer(&self->matches, g_array_unref);
+	G_OBJECT_CLASS(page_list_model_parent_class)->finalize(object);
+}
+
+/**
+ * @brief PageListModel 클래스 초기화 함수
+ * @param klass PageListModelClass 포인터
+ */
+static void page_list_model_class_init(PageListModelClass* klass)
+{
+	GObjectClass* object_class = G_OBJECT_CLASS(klass);
+	object_class->finalize = page_list_model_finalize;
+}
+
+/**
+ * @brief PageListModel 인스턴스 초기화 함수
+ * @param self PageListModel 포인터
+ */
+static void page_list_model_init(PageListModel* self)
+{
+	self->book = NULL;
+	self->count = 0;
+	self->lower_names = NULL;
+	self->matches = NULL;
+}
+
+/**
+ * @brief 모델의 책을 바꿉니다. 항목 바뀜 알림은 한번만 보냅니다.
+ * @param self PageListModel 포인터
+ * @param book Book 포인터 (NULL이면 비움)
+ */
+static void page_list_model_set_book(PageListModel* self, Book* book)
+{
+	const guint removed = page_list_model_get_n_items(G_LIST_MODEL(self));
+	g_clear_pointer(&self->lower_names, g_ptr_array_unref);
+	g_clear_pointer(&self->matches, g_array_unref);
+	self->book = book;
+	self->count = book != NULL ? book->entries->len : 0;
+	if (removed > 0 || self->count > 0)
+		g_list_model_items_changed(G_LIST_MODEL(self), 0, removed, self->count);
+}
+
+/**
+ * @brief 검색 결과를 바꿉니다. 항목 바뀜 알림은 한번만 보냅니다.
+ * @param self PageListModel 포인터
+ * @param matches 맞은 쪽 번호 배열 (가져감, NULL이면 모든 쪽)
+ */
+static void page_list_model_set_matches(PageListModel* self, GArray* matches)
+{
+	if (self->matches == NULL && matches == NULL)
+		return;
+	const guint removed = page_list_model_get_n_items(G_LIST_MODEL(self));
+	if (self->matches != NULL)
+		g_array_unref(self->matches);
+	self->matches = matches;
+	const guint added = page_list_model_get_n_items(G_LIST_MODEL(self));
+	if (removed > 0 || added > 0)
+		g_list_model_items_changed(G_LIST_MODEL(self), 0, removed, added);
+}
+
+/**
+ * @brief 목록 위치를 쪽 번호로 바꿉니다. 검색 중에는 둘이 다릅니다.
+ * @param self PageListModel 포인터
+ * @param position 목록 위치
+ * @return 쪽 번호 (없으면 -1)
+ */
+static int page_list_model_get_page(PageListModel* self, guint position)
+{
+	if (position >= page_list_model_get_n_items(G_LIST_MODEL(self)))
+		return -1;
+	return self->matches != NULL ? (int)g_array_index(self->matches, guint, position) : (int)position;
+}
+
+/**
+ * @brief 소문자로 바꾼 쪽 이름을 얻습니다. 색인이 없으면 한번에 만듭니다.
+ * @param self PageListModel 포인터
+ * @param no 쪽 번호
+ * @return 소문자 이름 (해제하지 말 것)
+ */
+static const char* page_list_model_get_lower_name(PageListModel* self, int no)
+{
+	if (self->lower_names == NULL)
+	{
+		self->lower_names = g_ptr_array_new_full(self->count, g_free);
+		for (guint i = 0; i < self->count; i++)
+		{
+			const PageEntry* entry = g_ptr_array_index(self->book->entries, i);
+			g_ptr_array_add(self->lower_names, entry->name ? g_utf8_strdown(entry->name, -1) : g_strdup(""));
+		}
+	}
+	return no >= 0 && (guint)no < self->lower_names->len ? g_ptr_array_index(self->lower_names, no) : "";
+}
+
+/**
+ * @brief 쪽 검색 조건 구조체
+ *        "#10-20"은 쪽 범위, ">1M" "<500K"는 크기, 나머지 낱말은 이름에 들어갈 글자입니다.
+ */
+typedef struct PageQuery
+{
+	char* text;              ///< 이름에 들어있어야 할 글자 (소문자, 없으면 NULL)
+	int first;               ///< 쪽 범위 처음 (0부터)
+	int last;                ///< 쪽 범위 끝 (포함)
+	gint64 size_min;         ///< 최소 크기
+	gint64 size_max;         ///< 최대 크기
+} PageQuery;
+
+/**
+ * @brief 검색 조건을 비웁니다. (모두 통과)
+ * @param query PageQuery 포인터
+ */
+static void page_query_clear(PageQuery* query)
+{
+	g_clear_pointer(&query->text, g_free);
+	query->first = 0;
+	query->last = G_MAXINT;
+	query->size_min = 0;
+	query->size_max = G_MAXINT64;
+}
+
+/**
+ * @brief 조건이 하나라도 있는지 확인합니다.
+ * @param query PageQuery 포인터
+ * @return 조건이 있으면 true
+ */
+static bool page_query_is_active(const PageQuery* query)
+{
+	return query->text != NULL || query->first > 0 || query->last < G_MAXINT ||
+		query->size_min > 0 || query->size_max < G_MAXINT64;
+}
+
+/**
+ * @brief "1.5M" 같은 크기 문자열을 바이트로 바꿉니다. (K, M, G는 1024 단위)
+ * @param s 문자열
+ * @param value 읽은 값
+ * @return 성공 시 true
+ */
+static bool page_query_parse_size(const char* s, gint64* value)
+{
+	char* end = NULL;
+	const double d = g_ascii_strtod(s, &end);
+	if (end == s || d < 0.0)
+		return false;
+	double mul = 1.0;
+	switch (g_ascii_toupper(*end))
+	{
+		case 'K': mul = 1024.0; end++; break;
+		case 'M': mul = 1024.0 * 1024.0; end++; break;
+		case 'G': mul = 1024.0 * 1024.0 * 1024.0; end++; break;
+		default: break;
+	}
+	if (g_ascii_toupper(*end) == 'B')
+		end++;
+	if (*end != '\0')
+		return false;
+	*value = (gint64)(d * mul);
+	return true;
+}
+
+/**
+ * @brief 검색 문자열을 조건으로 바꿉니다.
+ *        알 수 없는 조건 낱말은 이름 글자로 취급합니다.
+ * @param query 결과를 넣을 PageQuery (먼저 비움)
+ * @param str 검색 문자열
+ */
+static void page_query_parse(PageQuery* query, const char* str)
+{
+	page_query_clear(query);
+
+	GString* text = g_string_new(NULL);
+	char** tokens = g_strsplit_set(str, " \t", -1);
+	for (char** t = tokens; *t != NULL; t++)
+	{
+		const char* tok = *t;
+		if (*tok == '\0')
+			continue;
+
+		if (tok[0] == '#' && g_ascii_isdigit(tok[1]))
+		{
+			// 쪽 번호는 1부터, "#10-" 이면 끝까지
+			char* end = NULL;
+			const gint64 first = g_ascii_strtoll(tok + 1, &end, 10);
+			gint64 last = first;
+			if (*end == '-')
+				last = end[1] != '\0' ? g_ascii_strtoll(end + 1, &end, 10) : G_MAXINT;
+			else if (*end != '\0')
+				last = -1;
+			if (last >= first && (*end == '\0' || *end == '-'))
+			{
+				query->first = MAX(query->first, (int)CLAMP(first - 1, 0, G_MAXINT));
+				query->last = MIN(query->last, (int)CLAMP(last == G_MAXINT ? last : last - 1, 0, G_MAXINT));
+				continue;
+			}
+		}
+		else if (tok[0] == '>' || tok[0] == '<')
+		{
+			gint64 size;
+			if (page_query_parse_size(tok + 1, &size))
+			{
+				if (tok[0] == '>')
+					query->size_min = MAX(query->size_min, size);
+				else
+					query->size_max = MIN(query->size_max, size);
+				continue;
+			}
+		}
+
+		if (text->len > 0)
+			g_string_append_c(text, ' ');
+		g_string_append(text, tok);
+	}
+	g_strfreev(tokens);
+
+	if (text->len > 0)
+		query->text = g_utf8_strdown(text->str, -1);
+	g_string_free(text, true);
+}
+
+/**
+ * @brief 조건이 바뀐 정도를 알아냅니다. 좁아지기만 했으면 지난 결과 안에서만 찾으면 됩니다.
+ * @param prev 이전 조건
+ * @param next 새 조건
+ * @return 필터 변경 종류
+ */
+static GtkFilterChange page_query_compare(const PageQuery* prev, const PageQuery* next)
+{
+	if (prev->first != next->first || prev->last != next->last ||
+		prev->size_min != next->size_min || prev->size_max != next->size_max)
+		return GTK_FILTER_CHANGE_DIFFERENT;
+	if (prev->text == NULL)
+		return GTK_FILTER_CHANGE_MORE_STRICT;
+	if (next->text == NULL)
+		return GTK_FILTER_CHANGE_LESS_STRICT;
+	if (strstr(next->text, prev->text) != NULL)
+		return GTK_FILTER_CHANGE_MORE_STRICT;
+	if (strstr(prev->text, next->text) != NULL)
+		return GTK_FILTER_CHANGE_LESS_STRICT;
+	return GTK_FILTER_CHANGE_DIFFERENT;
+}
+
 /**
  * @brief 쪽(페이지) 선택 다이얼로그 구조체
  *        페이지 목록, 선택 모델, 콜백, 상태 플래그 등을 포함합니다.
@@ -71,8 +401,14 @@ typedef struct PageDialog
 	GtkWindow* window;           ///< 다이얼로그 윈도우 (상속)
 
 	GtkWidget* page_info;        ///< 페이지 정보 레이블
+	GtkWidget* search_entry;     ///< 검색 칸
 	GtkWidget* page_list;        ///< 페이지 목록 뷰(GtkColumnView)
-	GListStore* list_store;      ///< 페이지 데이터 저장소(GListStore<PageObject>)
+	GtkWidget* page_grid;        ///< 페이지 썸네일 뷰(GtkGridView)
+	GtkWidget* view_stack;       ///< 목록/썸네일 전환 스택
+	GtkWidget* thumb_toggle;     ///< 썸네일 보기 토글 버튼
+	ThumbLoader* thumbs;         ///< 썸네일 로더
+	PageListModel* list_model;   ///< 페이지 목록 모델(책 엔트리를 그대로 씀, 검색 결과도 여기에)
+	PageQuery query;             ///< 지금 검색 조건
 	GtkSelectionModel* selection;///< 선택 모델(GtkSingleSelection)
 
 	PageSelectCallback callback; ///< 페이지 선택 콜백
@@ -98,6 +434,17 @@ static void response_selection(PageDialog* self, int selected)
 	self->callback(self->user_data, selected);
 }
 
+/**
+ * @brief 보이는 목록의 위치를 쪽 번호로 바꿉니다. 검색 중에는 둘이 다릅니다.
+ * @param self PageDialog 포인터
+ * @param position 목록 위치
+ * @return 쪽 번호 (없으면 -1)
+ */
+static int page_dialog_position_to_page(PageDialog* self, guint position)
+{
+	return page_list_model_get_page(self->list_model, position);
+}
+
 /**
  * @brief 창 닫기 요청 시 호출되는 콜백
  * @param window 닫히는 GtkWindow
@@ -121,7 +468,18 @@ static gboolean on_window_close_request(GtkWindow* window, PageDialog* self)
  */
 static void on_row_activated(GtkColumnView* view, guint position, PageDialog* self)
 {
-	response_selection(self, (int)position);
+	response_selection(self, page_dialog_position_to_page(self, position));
+}
+
+/**
+ * @brief 썸네일에서 셀 더블클릭(활성화) 시 호출되는 콜백
+ * @param view GtkGridView
+ * @param position 선택된 셀 인덱스
+ * @param self PageDialog 포인터
+ */
+static void on_grid_activated(GtkGridView* view, guint position, PageDialog* self)
+{
+	response_selection(self, page_dialog_position_to_page(self, position));
 }
 
 /**
@@ -132,7 +490,8 @@ static void on_row_activated(GtkColumnView* view, guint position, PageDialog* se
 static void on_ok_clicked(GtkButton* button, PageDialog* self)
 {
 	const guint pos = gtk_single_selection_get_selected(GTK_SINGLE_SELECTION(self->selection));
-	response_selection(self, (int)pos);
+	if (pos != GTK_INVALID_LIST_POSITION)
+		response_selection(self, page_dialog_position_to_page(self, pos));
 }
 
 /**
@@ -239,30 +598,180 @@ static void factory_bind_size(GtkListItemFactory* factory, GtkListItem* item, gp
 }
 
 /**
- * @brief 다이얼로그에 책 정보를 설정(페이지 목록 갱신)
+ * @brief 썸네일 셀 생성: 그림과 번호 라벨을 만듭니다.
+ */
+static void factory_setup_thumb(GtkListItemFactory* factory, GtkListItem* item, gpointer user_data)
+{
+	GtkWidget* vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
+	gtk_widget_set_margin_start(vbox, 4);
+	gtk_widget_set_margin_end(vbox, 4);
+	gtk_widget_set_margin_top(vbox, 4);
+	gtk_widget_set_margin_bottom(vbox, 4);
+
+	GtkWidget* picture = gtk_picture_new();
+	gtk_picture_set_content_fit(GTK_PICTURE(picture), GTK_CONTENT_FIT_CONTAIN);
+	gtk_picture_set_can_shrink(GTK_PICTURE(picture), true);
+	gtk_widget_set_size_request(picture, PAGE_THUMB_SIZE, PAGE_THUMB_SIZE);
+	gtk_box_append(GTK_BOX(vbox), picture);
+
+	GtkWidget* label = gtk_label_new("");
+	gtk_box_append(GTK_BOX(vbox), label);
+
+	gtk_list_item_set_child(item, vbox);
+}
+
+/**
+ * @brief 썸네일 셀 바인딩: 번호를 넣고 썸네일을 요청합니다.
+ */
+static void factory_bind_thumb(GtkListItemFactory* factory, GtkListItem* item, gpointer user_data)
+{
+	PageDialog* self = user_data;
+	GtkWidget* vbox = gtk_list_item_get_child(item);
+	GtkWidget* picture = gtk_widget_get_first_child(vbox);
+	GtkWidget* label = gtk_widget_get_last_child(vbox);
+	PageObject* object = gtk_list_item_get_item(item);
+
+	char sz[64];
+	g_snprintf(sz, sizeof(sz), "%d", object->no + 1);
+	gtk_label_set_text(GTK_LABEL(label), sz);
+
+	ThumbRequest* request = thumb_loader_request(self->thumbs, object->no, GTK_PICTURE(picture));
+	g_object_set_data_full(G_OBJECT(item), "thumb-request", request, (GDestroyNotify)thumb_request_cancel);
+}
+
+/**
+ * @brief 썸네일 셀 바인딩 해제: 지나간 셀의 요청은 취소합니다.
+ */
+static void factory_unbind_thumb(GtkListItemFactory* factory, GtkListItem* item, gpointer user_data)
+{
+	g_object_set_data(G_OBJECT(item), "thumb-request", NULL);
+}
+
+/**
+ * @brief 정보 라벨을 갱신합니다. 검색 중이면 찾은 수를 보여줍니다.
  * @param self PageDialog 포인터
- * @param book Book 객체 포인터
  */
-void page_dialog_set_book(PageDialog* self, Book* book)
+static void page_dialog_update_info(PageDialog* self)
 {
-	char info[64];
-	g_snprintf(info, sizeof(info), _("Total page: %d"), book->total_page);
+	char info[128];
+	if (self->list_model->book == NULL)
+		g_strlcpy(info, _("[No Book]"), sizeof(info));
+	else if (self->list_model->matches == NULL)
+		g_snprintf(info, sizeof(info), _("Total page: %d"), self->list_model->book->total_page);
+	else
+	{
+		g_snprintf(info, sizeof(info), _("Found: %u / %u"),
+			self->list_model->matches->len, self->list_model->count);
+	}
 	gtk_label_set_text(GTK_LABEL(self->page_info), info);
+}
+
+/**
+ * @brief 조건에 맞는 쪽을 찾습니다. PageObject를 만들지 않고 책 엔트리와 소문자 이름 색인을 바로 봅니다.
+ * @param self PageDialog 포인터
+ * @param from 이 안에서만 찾음 (NULL이면 모든 쪽)
+ * @return 맞은 쪽 번호 배열
+ */
+static GArray* page_dialog_find_matches(PageDialog* self, const GArray* from)
+{
+	PageListModel* model = self->list_model;
+	const PageQuery* query = &self->query;
+	const guint count = from != NULL ? from->len : model->count;
+	GArray* matches = g_array_sized_new(false, false, sizeof(guint), count);
+	for (guint i = 0; i < count; i++)
+	{
+		const guint no = from != NULL ? g_array_index(from, guint, i) : i;
+		if ((int)no < query->first || (int)no > query->last)
+			continue;
+		const PageEntry* entry = g_ptr_array_index(model->book->entries, no);
+		if (entry->size < query->size_min || entry->size > query->size_max)
+			continue;
+		if (query->text != NULL && strstr(page_list_model_get_lower_name(model, (int)no), query->text) == NULL)
+			continue;
+		g_array_append_val(matches, no);
+	}
+	return matches;
+}
 
-	g_list_store_remove_all(self->list_store);
+/**
+ * @brief 검색 문자열을 적용합니다. 좁히기만 한 검색은 지난 결과 안에서만 찾습니다.
+ * @param self PageDialog 포인터
+ * @param str 검색 문자열
+ */
+static void page_dialog_apply_search(PageDialog* self, const char* str)
+{
+	PageQuery next = { 0 };
+	page_query_parse(&next, str);
 
-	const GPtrArray* entries = book->entries;
-	for (guint i = 0; i < entries->len; ++i)
+	const GArray* from = NULL;
+	if (self->list_model->matches != NULL)
 	{
-		PageEntry* e = g_ptr_array_index(entries, i);
-		PageObject* o = g_object_new(TYPE_PAGE_OBJECT, NULL);
-		o->no = e->page;
-		o->name = g_strdup(e->name);
-		o->date = e->date;
-		o->size = e->size;
-		g_list_store_append(self->list_store, o);
-		g_object_unref(o); // GListStore가 참조를 가지므로 여기서 해제
+		const GtkFilterChange change = page_query_compare(&self->query, &next);
+		if (change != GTK_FILTER_CHANGE_DIFFERENT && g_strcmp0(self->query.text, next.text) == 0)
+		{
+			// 같은 조건 (띄어쓰기만 바뀜)
+			page_query_clear(&next);
+			return;
+		}
+		if (change == GTK_FILTER_CHANGE_MORE_STRICT)
+			from = self->list_model->matches;
 	}
+
+	page_query_clear(&self->query);
+	self->query = next;
+	if (self->list_model->book == NULL || !page_query_is_active(&self->query))
+		page_list_model_set_matches(self->list_model, NULL);
+	else
+		page_list_model_set_matches(self->list_model, page_dialog_find_matches(self, from));
+	page_dialog_update_info(self);
+}
+
+/**
+ * @brief 검색을 지웁니다. 목록 위치와 쪽 번호가 다시 같아집니다.
+ * @param self PageDialog 포인터
+ */
+static void page_dialog_clear_search(PageDialog* self)
+{
+	gtk_editable_set_text(GTK_EDITABLE(self->search_entry), "");
+	page_dialog_apply_search(self, "");
+}
+
+/**
+ * @brief 검색 칸 바뀜 콜백
+ * @param entry GtkSearchEntry
+ * @param self PageDialog 포인터
+ */
+static void on_search_changed(GtkSearchEntry* entry, PageDialog* self)
+{
+	page_dialog_apply_search(self, gtk_editable_get_text(GTK_EDITABLE(entry)));
+}
+
+/**
+ * @brief 검색 칸에서 엔터: 선택된(없으면 첫) 결과로 이동합니다.
+ * @param entry GtkSearchEntry
+ * @param self PageDialog 포인터
+ */
+static void on_search_activate(GtkSearchEntry* entry, PageDialog* self)
+{
+	guint pos = gtk_single_selection_get_selected(GTK_SINGLE_SELECTION(self->selection));
+	if (pos == GTK_INVALID_LIST_POSITION)
+		pos = 0;
+	const int page = page_dialog_position_to_page(self, pos);
+	if (page >= 0)
+		response_selection(self, page);
+}
+
+/**
+ * @brief 다이얼로그에 책 정보를 설정(페이지 목록 갱신)
+ * @param self PageDialog 포인터
+ * @param book Book 객체 포인터
+ */
+void page_dialog_set_book(PageDialog* self, Book* book)
+{
+	page_dialog_clear_search(self);
+	thumb_loader_set_book(self->thumbs, book);
+	page_list_model_set_book(self->list_model, book);
+	page_dialog_update_info(self);
 }
 
 /**
@@ -271,27 +780,82 @@ void page_dialog_set_book(PageDialog* self, Book* book)
  */
 void page_dialog_reset_book(PageDialog* self)
 {
-	gtk_label_set_text(GTK_LABEL(self->page_info), _("[No Book]"));
-	g_list_store_remove_all(self->list_store);
+	page_dialog_clear_search(self);
+	thumb_loader_set_book(self->thumbs, NULL);
+	page_list_model_set_book(self->list_model, NULL);
+	page_dialog_update_info(self);
 }
 
+/**
+ * @brief 이미 읽어둔 쪽 텍스쳐를 찾는 콜백을 설정 (썸네일을 새로 만들지 않고 씀)
+ * @param self PageDialog 포인터
+ * @param func 콜백
+ * @param user_data 콜백 사용자 데이터
+ */
+void page_dialog_set_texture_lookup(PageDialog* self, ThumbLookupFunc func, gpointer user_data)
+{
+	thumb_loader_set_lookup(self->thumbs, func, user_data);
+}
+
+static void page_dialog_scroll_to(PageDialog* self, guint position);
+
 /**
  * @brief 선택된 페이지를 갱신하고 뷰를 해당 위치로 스크롤
  * @param self PageDialog 포인터
  */
 static void page_dialog_refresh_selection(PageDialog* self)
 {
-	const guint count = g_list_model_get_n_items(G_LIST_MODEL(self->list_store));
+	// 검색을 지웠으므로 목록 위치가 곧 쪽 번호
+	const guint count = g_list_model_get_n_items(G_LIST_MODEL(self->list_model));
 	const guint page = self->selected < 0 ? 0 : (self->selected >= (int)count ? count - 1 : self->selected);
-	gtk_single_selection_set_selected(GTK_SINGLE_SELECTION(self->selection), page);
-	gtk_column_view_scroll_to(
-		GTK_COLUMN_VIEW(self->page_list),
-		page,                   // 이동할 행 인덱스
-		NULL,                   // 전체 행 기준
-		GTK_LIST_SCROLL_FOCUS | GTK_LIST_SCROLL_SELECT, // 포커스+선택
-		NULL                    // 기본 동작
-	);
-	gtk_widget_grab_focus(self->page_list);
+	page_dialog_scroll_to(self, page);
+}
+
+/**
+ * @brief 목록 위치를 선택하고 보이는 뷰를 그 위치로 스크롤
+ * @param self PageDialog 포인터
+ * @param position 목록 위치
+ */
+static void page_dialog_scroll_to(PageDialog* self, guint position)
+{
+	if (position == GTK_INVALID_LIST_POSITION)
+		return;
+	gtk_single_selection_set_selected(GTK_SINGLE_SELECTION(self->selection), position);
+	if (gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(self->thumb_toggle)))
+	{
+		gtk_grid_view_scroll_to(
+			GTK_GRID_VIEW(self->page_grid),
+			position,
+			GTK_LIST_SCROLL_FOCUS | GTK_LIST_SCROLL_SELECT,
+			NULL);
+		gtk_widget_grab_focus(self->page_grid);
+	}
+	else
+	{
+		gtk_column_view_scroll_to(
+			GTK_COLUMN_VIEW(self->page_list),
+			position,               // 이동할 행 인덱스
+			NULL,                   // 전체 행 기준
+			GTK_LIST_SCROLL_FOCUS | GTK_LIST_SCROLL_SELECT, // 포커스+선택
+			NULL                    // 기본 동작
+		);
+		gtk_widget_grab_focus(self->page_list);
+	}
+}
+
+/**
+ * @brief 썸네일 보기 토글 콜백: 목록과 썸네일을 바꿉니다.
+ * @param button GtkToggleButton
+ * @param self PageDialog 포인터
+ */
+static void on_thumb_toggled(GtkToggleButton* button, PageDialog* self)
+{
+	const bool active = gtk_toggle_button_get_active(button);
+	gtk_stack_set_visible_child_name(GTK_STACK(self->view_stack), active ? "grid" : "list");
+	config_set_bool(CONFIG_VIEW_PAGE_THUMBNAIL, active, false);
+
+	// 선택은 모델이 같으니 그대로, 위치만 맞춤
+	page_dialog_scroll_to(self, gtk_single_selection_get_selected(GTK_SINGLE_SELECTION(self->selection)));
 }
 
 /**
@@ -318,17 +882,37 @@ PageDialog* page_dialog_new(GtkWindow* parent, PageSelectCallback callback, gpoi
 	GtkWidget* vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 8);
 	gtk_window_set_child(self->window, vbox);
 
-	// 상단 정보 라벨
+	// 상단 정보 라벨과 썸네일 토글
+	GtkWidget* top_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
+	gtk_widget_set_margin_top(top_box, 8);
+	gtk_widget_set_margin_start(top_box, 8);
+	gtk_widget_set_margin_end(top_box, 8);
+	gtk_box_append(GTK_BOX(vbox), top_box);
+
 	self->page_info = gtk_label_new("");
 	gtk_widget_set_halign(self->page_info, GTK_ALIGN_START);
-	gtk_widget_set_margin_top(self->page_info, 8);
-	gtk_widget_set_margin_start(self->page_info, 8);
-	gtk_widget_set_margin_end(self->page_info, 8);
-	gtk_box_append(GTK_BOX(vbox), self->page_info);
+	gtk_widget_set_hexpand(self->page_info, TRUE);
+	gtk_box_append(GTK_BOX(top_box), self->page_info);
+
+	self->thumb_toggle = gtk_toggle_button_new_with_label(_("Thumbnails"));
+	gtk_box_append(GTK_BOX(top_box), self->thumb_toggle);
+
+	// 검색 칸
+	self->search_entry = gtk_search_entry_new();
+	gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(self->search_entry), _("Name, #from-to, >size, <size"));
+	gtk_widget_set_margin_start(self->search_entry, 8);
+	gtk_widget_set_margin_end(self->search_entry, 8);
+	g_signal_connect(self->search_entry, "search-changed", G_CALLBACK(on_search_changed), self);
+	g_signal_connect(self->search_entry, "activate", G_CALLBACK(on_search_activate), self);
+	gtk_box_append(GTK_BOX(vbox), self->search_entry);
+
+	// 썸네일 로더
+	self->thumbs = thumb_loader_new(PAGE_THUMB_SIZE);
 
 	// 리스트와 선택 모델
-	self->list_store = g_list_store_new(TYPE_PAGE_OBJECT);
-	self->selection = GTK_SELECTION_MODEL(gtk_single_selection_new(G_LIST_MODEL(self->list_store)));
+	self->list_model = g_object_new(TYPE_PAGE_LIST_MODEL, NULL);
+	page_query_clear(&self->query);
+	self->selection = GTK_SELECTION_MODEL(gtk_single_selection_new(G_LIST_MODEL(self->list_model))); // 모델 참조를 가져감
 
 	// 컬럼뷰 및 팩토리
 	GtkListItemFactory* factory_no = gtk_signal_list_item_factory_new();
@@ -366,9 +950,31 @@ PageDialog* page_dialog_new(GtkWindow* parent, PageSelectCallback callback, gpoi
 
 	GtkWidget* scrolled = gtk_scrolled_window_new();
 	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(scrolled), self->page_list);
-	gtk_widget_set_hexpand(scrolled, TRUE);   // 가로로 확장
-	gtk_widget_set_vexpand(scrolled, TRUE);   // 세로로 확장
-	gtk_box_append(GTK_BOX(vbox), scrolled);
+
+	// 썸네일 뷰, 선택 모델은 목록과 같이 씀
+	GtkListItemFactory* factory_thumb = gtk_signal_list_item_factory_new();
+	g_signal_connect(factory_thumb, "setup", G_CALLBACK(factory_setup_thumb), self);
+	g_signal_connect(factory_thumb, "bind", G_CALLBACK(factory_bind_thumb), self);
+	g_signal_connect(factory_thumb, "unbind", G_CALLBACK(factory_unbind_thumb), self);
+
+	self->page_grid = gtk_grid_view_new(g_object_ref(self->selection), factory_thumb);
+	gtk_grid_view_set_max_columns(GTK_GRID_VIEW(self->page_grid), 12);
+	g_signal_connect(self->page_grid, "activate", G_CALLBACK(on_grid_activated), self);
+
+	GtkWidget* grid_scrolled = gtk_scrolled_window_new();
+	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(grid_scrolled), self->page_grid);
+
+	self->view_stack = gtk_stack_new();
+	gtk_stack_add_named(GTK_STACK(self->view_stack), scrolled, "list");
+	gtk_stack_add_named(GTK_STACK(self->view_stack), grid_scrolled, "grid");
+	gtk_widget_set_hexpand(self->view_stack, TRUE);   // 가로로 확장
+	gtk_widget_set_vexpand(self->view_stack, TRUE);   // 세로로 확장
+	gtk_box_append(GTK_BOX(vbox), self->view_stack);
+
+	const bool thumb_mode = config_get_bool(CONFIG_VIEW_PAGE_THUMBNAIL, true);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(self->thumb_toggle), thumb_mode);
+	gtk_stack_set_visible_child_name(GTK_STACK(self->view_stack), thumb_mode ? "grid" : "list");
+	g_signal_connect(self->thumb_toggle, "toggled", G_CALLBACK(on_thumb_toggled), self);
 
 	// 버튼 박스
 	GtkWidget* button_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 8);
@@ -410,6 +1016,12 @@ PageDialog* page_dialog_new(GtkWindow* parent, PageSelectCallback callback, gpoi
  */
 void page_dialog_dispose(PageDialog* self)
 {
+	page_query_clear(&self->query);
+	if (self->thumbs)
+	{
+		thumb_loader_dispose(self->thumbs);
+		self->thumbs = NULL;
+	}
 	if (self->window)
 	{
 		self->disposed = true; // 다이얼로그가 dispose 되었음을 표시
@@ -427,6 +1039,7 @@ void page_dialog_dispose(PageDialog* self)
 void page_dialog_show_async(PageDialog* self, int page)
 {
 	self->selected = page;
+	page_dialog_clear_search(self);
 	page_dialog_refresh_selection(self);
 
 	gtk_window_set_modal(GTK_WINDOW(self->window), true);
@@ -437,6 +1050,11 @@ void page_dialog_show_async(PageDialog* self, int page)
  * @note
  * - PageDialog는 책의 페이지 목록을 표시하고, 사용자가 원하는 쪽을 선택할 수 있도록 지원합니다.
  * - GObject 기반의 PageObject를 사용하여 각 페이지 정보를 관리합니다.
+ * - PageListModel이 책 엔트리를 그대로 감싸므로, PageObject는 보이는 행만 만들어집니다.
+ * - 검색은 PageObject를 만들지 않고 책 엔트리를 바로 걸러 맞은 쪽 번호만 모델에 넣으므로 쪽이 아주 많아도 빠릅니다.
+ *   이름은 처음 검색할 때 소문자 색인을 만들어 두고, 좁히기만 한 검색은 지난 결과 안에서만 다시 거릅니다.
+ *   검색 중에는 목록 위치와 쪽 번호가 다르므로 항상 모델에서 쪽 번호를 얻어 이동합니다.
+ * - 썸네일은 ThumbLoader가 스레드 풀에서 만들며, 보이는 셀이 먼저고 지나간 셀의 요청은 취소됩니다.
  * - ESC, 더블클릭, 버튼 등 다양한 입력 방식으로 쪽 선택이 가능합니다.
  * - 콜백을 통해 선택 결과를 비동기로 전달합니다.
  */
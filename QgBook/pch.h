@@ -22,6 +22,7 @@
 #endif
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 #include <sqlite3.h>
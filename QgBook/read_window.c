@@ -1,15 +1,36 @@
 ﻿#include "pch.h"
 #include "configs.h"
 #include "book.h"
+#include "bufpool.h"
+#include "decoder.h"
 #include "doumi.h"
 #include "bound.h"
+#include "thumb.h"
+#include "library.h"
 
 #define NOTIFY_TIMEOUT 2000
+#define RECENT_BOOK_MAX 24
+#define RECENT_COVER_SIZE 160 // 쪽 선택 썸네일과 같아야 썸네일 저장소를 같이 쓴다
+#define QUEUE_READY_MAX 2
+#define NEXT_READY_PAGES 4 // 마지막에서 이만큼 남으면 다음 책을 미리 연다
+#define NEXT_READY_BUDGET (48 * 1024 * 1024) // 다음 책 첫 쪽을 풀어둘 크기 한도
+#define WARM_BOOK_MAX 3
+#define IDLE_KEEP_NEAR 4 // 쉬는 동안 압축된 채로 남길 앞뒤 쪽 수
+#define PREVIEW_MIN_PIXELS (2 * 1024 * 1024) // 이보다 큰 쪽은 미리보기부터 보여줌
+#define SCROLL_EASE 14.0 // 쭉 보기 부드럽게 굴리기, 클수록 목표를 빨리 따라간다 (1/초)
+#define SCROLL_LOOKAHEAD 0.6 // 쭉 보기에서 굴리는 빠르기로 이만큼(초) 갈 곳까지 미리 푼다
+#define SCROLL_AHEAD_MAX 8 // 쭉 보기에서 보이는 쪽 말고 미리 풀 쪽 수 한도
+#define SCROLL_READ_PER_IDLE 2 // 쭉 보기에서 아이들 한 번에 읽기 시작할 쪽 수
+#define SCROLL_PROBE_INTERVAL 250 // 쪽 크기를 알아보는 동안 띠를 다시 짜는 간격 (ms)
+#define SCROLL_GUESS_RATIO 1.5 // 쪽 크기를 하나도 모를 때 어림하는 높이/폭
+#define SCROLL_PAGE_RATIO 0.9 // 쭉 보기나 긴 쪽에서 쪽 넘기기 키로 굴리는 만큼 (화면 높이 비율)
 
 // 앞서 선언
 typedef struct ReadWindow ReadWindow;
 typedef struct PageDialog PageDialog;
 typedef void (*ShortcutFunc)(ReadWindow*);
+typedef struct ReadyBook ReadyBook;
+typedef struct WarmBook WarmBook;
 
 // 임시 싱글턴... 이지만 아마 임시가 아닐 것이다
 static ReadWindow* s_read_window = NULL;
@@ -24,6 +45,7 @@ extern void page_dialog_dispose(PageDialog* self);
 extern void page_dialog_show_async(PageDialog* self, int page);
 extern void page_dialog_set_book(PageDialog* self, Book* book);
 extern void page_dialog_reset_book(PageDialog* self);
+extern void page_dialog_set_texture_lookup(PageDialog* self, ThumbLookupFunc func, gpointer user_data);
 
 #pragma region 스냅샷용 그리기 위젯
 // 그리기 위젯 정의
@@ -71,6 +93,13 @@ static gboolean read_draw_focus(GtkWidget* widget, GtkDirectionType direction)
 #pragma endregion
 
 
+// 쭉 보기 띠에서 쪽 하나의 자리
+typedef struct ScrollSlot
+{
+	double top; // 띠에서 위치 (화면 픽셀)
+	double width; // 그릴 폭 (화면 픽셀)
+} ScrollSlot;
+
 // 읽기 윈도우
 struct ReadWindow
 {
@@ -84,6 +113,7 @@ struct ReadWindow
 	GtkWidget* info_label;
 
 	GtkWidget* menu_file_close;
+	GtkWidget* menu_file_library;
 	GtkWidget* menu_zoom_check;
 	GtkWidget* menu_vmode_image;
 	GtkWidget* menu_vmode_radios[VIEW_MODE_MAX_VALUE];
@@ -117,12 +147,84 @@ struct ReadWindow
 	PageData** cache_pages; // 페이지 캐시
 	GQueue* cache_queue;
 	size_t cache_size;
+
+	// 닫은 책 캐시, 쪽 캐시와 예산을 같이 쓴다
+	GQueue* warm_books; // 최근에 닫은 것부터 (WarmBook*)
+	size_t warm_size; // 닫은 책들의 쪽 캐시 크기 합
+
+	guint config_notify; // 설정 바뀜 알림 번호
+
+	// 이어 보기
+	GdkTexture* resume_texture; // 책을 여는 동안 보여줄 지난번 화면
+	GCancellable* resume_cancel; // 이어 보기 책 열기 취소
+
+	// 최근 책 시작 화면
+	GtkWidget* recent_view; // 시작 화면 (책이 없을 때만 보임)
+	GtkWidget* recent_search; // 서재 검색 칸
+	GtkWidget* recent_label; // 최근 책 또는 검색 결과 제목
+	GtkWidget* recent_flow; // 최근 책 목록 (검색 중에는 검색 결과)
+	GtkWidget* unread_label; // 안 읽은 책 제목
+	GtkWidget* unread_flow; // 서재의 안 읽은 책 목록
+	GHashTable* recent_covers; // 책 경로 -> 표지 텍스쳐
+	GCancellable* recent_cancel; // 표지 읽기 취소
+	guint recent_idle; // 시작 화면 갱신 대기
+	char* preload_path; // 미리 읽는 책 경로
+	ReadyBook* preload; // 미리 읽어둔 책과 첫 쪽
+	GCancellable* preload_cancel; // 미리 읽기 취소
+
+	// 읽기 대기열
+	GQueue* read_queue; // 다음에 읽을 책 경로 (char*)
+	guint queue_idle; // 저장한 대기열 불러오기 대기
+	GPtrArray* queue_ready; // 대기열 앞쪽 책을 미리 연 것 (ReadyBook*)
+	GCancellable* queue_cancel; // 미리 여는 중인 작업 취소
+
+	// 다음 책 미리 열기
+	bool next_tried; // 지금 책에서 다음 책을 찾아 봤나
+	ReadyBook* next_ready; // 미리 연 다음 책
+	GCancellable* next_cancel; // 미리 여는 중인 작업 취소
+
+	// 쉬는 동안 캐시 줄이기
+	guint idle_timer; // 비활성 뒤 줄이기 대기
+	bool idle_trimmed; // 보이는 쪽 말고는 풀어둔 그림을 버렸나
+	GCancellable* trim_cancel; // 쉬는 동안 앞뒤 쪽을 다시 읽는 작업 취소
+	GCancellable* rehydrate_cancel; // 돌아와서 다시 푸는 작업 취소
+
+	// 타일 쪽
+	double tiled_scroll; // 아주 긴 쪽을 내려 본 만큼 (화면 픽셀)
+
+	// 쭉 보기
+	ScrollSlot* scroll_slots; // 쪽마다 띠에서의 자리, 쪽 수 + 1개 (마지막은 띠 끝), 쭉 보기가 아니면 NULL
+	int scroll_width; // 띠를 짠 화면 폭
+	int scroll_probed; // 띠를 짤 때 알던 쪽 크기 수
+	bool scroll_zoom; // 띠를 짤 때 늘려 보기였나
+	double scroll_pos; // 띠 맨 위에서 화면 맨 위까지 (화면 픽셀)
+	double scroll_target; // 부드럽게 굴러갈 곳
+	double scroll_velocity; // 굴리는 빠르기 (화면 픽셀/초)
+	int scroll_dir; // 마지막으로 굴린 방향 (1 아래, -1 위)
+	gint64 scroll_frame_time; // 지난 틱 시각 (마이크로초)
+	guint scroll_tick; // 부드럽게 굴리기 틱 콜백
+	int scroll_visible[2]; // 화면에 걸친 쪽 (처음, 끝)
+	int scroll_want[2]; // 풀어 둘 쪽 (처음, 끝)
+	int scroll_kept[2]; // 캐시에 남겨 둔 쪽 (처음, 끝), 밖은 이미 버렸다
+	bool scroll_swept; // scroll_kept가 맞음, 들어오거나 책이 바뀌면 한 번 다 훑는다
+	guint scroll_load_idle; // 쪽 읽기 대기
+	guint scroll_probe_timer; // 쪽 크기를 다 알 때까지 띠 다시 짜기
 };
 
 // 앞서 선언
 static void queue_draw_book(ReadWindow* self);
 static void prepare_pages(ReadWindow* self);
 static void page_control(ReadWindow* self, BookControl c);
+static void paint_book(ReadWindow* self, GtkSnapshot* snapshot, int width, int height);
+static void queue_recent_view(ReadWindow* self);
+static void cancel_next_ready(ReadWindow* self);
+static void cancel_idle_trim(ReadWindow* self);
+static void cancel_refine(PageData* data);
+static void read_page(ReadWindow* self, PageData* data);
+static void count_read_page(ReadWindow* self, PageData* data);
+static size_t page_cache_budget(void);
+static void cb_tiled_update(TiledImage* image, gpointer user_data);
+static void scroll_leave(ReadWindow* self);
 
 #pragma region 알림 메시지
 // 알림 메시지 타이머 콜백
@@ -184,7 +286,7 @@ static void toggle_fullscreen(ReadWindow* self)
 // 늘려보기 설정과 메뉴 처리
 static void update_view_zoom(ReadWindow* self, bool zoom)
 {
-	if (config_get_bool(CONFIG_VIEW_ZOOM, true) == zoom)
+	if (CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM) == zoom)
 		return;
 
 	gtk_check_button_set_active(GTK_CHECK_BUTTON(self->menu_zoom_check), zoom);
@@ -198,7 +300,7 @@ static void update_view_zoom(ReadWindow* self, bool zoom)
 // 읽기 방향 설정과 메뉴 처리
 static void update_view_mode(ReadWindow* self, ViewMode mode)
 {
-	if (config_get_int(CONFIG_VIEW_MODE, true) == mode)
+	if (CONFIG_GET_INT(CONFIG_VIEW_MODE) == mode)
 		return;
 
 	GdkPaintable* paintable = GDK_PAINTABLE(res_get_view_mode_texture(mode));
@@ -213,7 +315,7 @@ static void update_view_mode(ReadWindow* self, ViewMode mode)
 // 보기 품질 설정과 메뉴 처리
 static void update_view_quality(ReadWindow* self, ViewQuality quality)
 {
-	if (config_get_int(CONFIG_VIEW_QUALITY, true) == quality)
+	if (CONFIG_GET_INT(CONFIG_VIEW_QUALITY) == quality)
 		return;
 
 	gtk_check_button_set_active(GTK_CHECK_BUTTON(self->menu_vquality_radios[quality]), true);
@@ -238,7 +340,7 @@ static void update_view_align(ReadWindow* self, HorizAlign align)
 // 보기 여백 설정과 메뉴 처리
 static void update_view_margin(ReadWindow* self, int margin)
 {
-	if (config_get_int(CONFIG_VIEW_MARGIN, true) == margin)
+	if (CONFIG_GET_INT(CONFIG_VIEW_MARGIN) == margin)
 		return;
 
 	gtk_spin_button_set_value(GTK_SPIN_BUTTON(self->menu_vmargin_spin), margin);
@@ -275,6 +377,19 @@ static void queue_draw_book(ReadWindow* self)
 #pragma endregion
 
 #pragma region 책 처리
+// 화면에 보이는 쪽인가, 쭉 보기면 띠에서 화면에 걸친 쪽들
+static bool is_page_visible(const ReadWindow* self, const PageData* data)
+{
+	if (data == NULL)
+		return false;
+	if (data == self->pages[0] || data == self->pages[1])
+		return true;
+	if (self->scroll_slots == NULL || self->book == NULL || data->entry == NULL)
+		return false;
+	const int page = data->entry->page;
+	return page >= self->scroll_visible[0] && page <= self->scroll_visible[1] && self->cache_pages[page] == data;
+}
+
 // 쪽 정리
 static void clear_page(ReadWindow* self)
 {
@@ -314,8 +429,136 @@ static void clear_page(ReadWindow* self)
 	}
 }
 
+#pragma region 닫은 책 캐시
+// 닫은 책, 쪽 목록과 풀어둔 쪽을 그대로 남긴다 (파일 핸들은 놓고 다시 읽을 때 연다)
+struct WarmBook
+{
+	Book* book; // 책
+	PageData** pages; // 쪽 캐시
+	GQueue* queue; // 쪽 캐시 순서
+	size_t size; // 쪽 캐시 크기
+};
+
+// 닫은 책 해제
+static void warm_book_free(WarmBook* warm)
+{
+	for (int i = 0; i < warm->book->total_page; i++)
+	{
+		if (warm->pages[i])
+			page_data_free(warm->pages[i]);
+	}
+	g_free((gpointer)warm->pages);
+	g_queue_free(warm->queue);
+	book_dispose(warm->book);
+	g_free(warm);
+}
+
+// 닫은 책을 맨 앞에 넣는다, 넘치면 가장 오래된 책을 버린다
+static void warm_book_push(ReadWindow* self, Book* book, PageData** pages, GQueue* queue, size_t size)
+{
+	// 닫은 책은 쪽 크기를 더 알아보지 않고, 파일도 놓아서 지우거나 옮길 수 있게 한다
+	book_stop_probe(book);
+	book_suspend(book);
+
+	for (int i = 0; i < book->total_page; i++)
+	{
+		PageData* data = pages[i];
+		if (data == NULL)
+			continue;
+		if (data->anim_timer)
+		{
+			g_source_remove(data->anim_timer);
+			data->anim_timer = 0;
+		}
+		data->async_loading = false; // 다시 열면 새로 읽게
+		cancel_refine(data);
+		if (data->tiled)
+		{
+			// 타일은 버리고 다시 열면 보이는 것만 다시 푼다
+			tiled_image_trim(data->tiled);
+			size -= data->info.size;
+			data->info.size = 0;
+		}
+	}
+
+	// 같은 책이 또 있으면 예전 것은 버린다
+	for (GList* l = self->warm_books->head; l;)
+	{
+		GList* next = l->next;
+		WarmBook* old = l->data;
+		if (g_str_equal(old->book->full_name, book->full_name))
+		{
+			self->warm_size -= old->size;
+			warm_book_free(old);
+			g_queue_delete_link(self->warm_books, l);
+		}
+		l = next;
+	}
+
+	WarmBook* warm = g_new(WarmBook, 1);
+	warm->book = book;
+	warm->pages = pages;
+	warm->queue = queue;
+	warm->size = size;
+	g_queue_push_head(self->warm_books, warm);
+	self->warm_size += size;
+
+	while (g_queue_get_length(self->warm_books) > WARM_BOOK_MAX)
+	{
+		WarmBook* old = g_queue_pop_tail(self->warm_books);
+		self->warm_size -= old->size;
+		warm_book_free(old);
+	}
+}
+
+// 경로로 닫은 책을 꺼낸다, 없으면 NULL
+static WarmBook* warm_book_take(ReadWindow* self, const char* path)
+{
+	for (GList* l = self->warm_books->head; l; l = l->next)
+	{
+		WarmBook* warm = l->data;
+		if (g_str_equal(warm->book->full_name, path))
+		{
+			g_queue_delete_link(self->warm_books, l);
+			self->warm_size -= warm->size;
+			return warm;
+		}
+	}
+	return NULL;
+}
+
+// 오래 전에 닫은 책의 쪽부터 버려서 need와 닫은 책 캐시 합이 limit 이하가 되게 한다
+static void evict_warm_pages(ReadWindow* self, size_t need, size_t limit)
+{
+	for (GList* l = self->warm_books->tail; l && need + self->warm_size > limit; l = l->prev)
+	{
+		WarmBook* warm = l->data;
+		while (!g_queue_is_empty(warm->queue) && need + self->warm_size > limit)
+		{
+			const int index = GPOINTER_TO_INT(g_queue_pop_head(warm->queue));
+			PageData* item = warm->pages[index];
+			if (item == NULL)
+				continue;
+			warm->size -= item->info.size;
+			self->warm_size -= item->info.size;
+			page_data_free(item);
+			warm->pages[index] = NULL;
+		}
+	}
+}
+
+// 닫은 책 모두 해제
+static void clear_warm_books(ReadWindow* self)
+{
+	g_queue_free_full(self->warm_books, (GDestroyNotify)warm_book_free);
+	self->warm_books = NULL;
+	self->warm_size = 0;
+}
+#pragma endregion
+
 // 진짜 책 정리
 // 원래 close_book에 있던건데 종료할때 GTK 오류 메시지가 속출하여 따로 뺌
+// 파일이 남아 있으면 책과 쪽 캐시는 닫은 책 캐시로 넘긴다
 static void finalize_book(ReadWindow* self)
 {
 	clear_page(self);
@@ -331,24 +574,46 @@ static void finalize_book(ReadWindow* self)
 
 	if (self->book != NULL)
 	{
-		if (self->cache_pages)
+		// 표지는 ComicInfo.xml에 적힌 쪽, 없으면 첫쪽
+		int cover = 0;
+		for (guint i = 0; i < self->book->entries->len; i++)
 		{
-			for (int i = 0; i < self->book->total_page; i++)
+			const PageEntry* entry = g_ptr_array_index(self->book->entries, i);
+			if (entry->type == PAGE_TYPE_FRONT_COVER)
 			{
-				PageData* data = self->cache_pages[i];
-				if (data)
-					page_data_free(data);
+				cover = (int)i;
+				break;
 			}
-			g_free((gpointer)self->cache_pages);
 		}
 
-		g_queue_free(self->cache_queue);
-		self->cache_size = 0;
-
 		const int page = self->book->cur_page - 1 >= self->book->total_page ? 0 : self->book->cur_page;
-		recently_set_page(self->book->base_name, page);
+		recently_set_page(self->book->base_name, self->book->full_name, page, self->book->total_page, cover);
+
+		if (self->warm_books != NULL && self->cache_pages != NULL &&
+			g_file_test(self->book->full_name, G_FILE_TEST_IS_REGULAR))
+		{
+			// 지우거나 옮긴 책은 다시 열 일이 없으니 남기지 않는다
+			warm_book_push(self, self->book, self->cache_pages, self->cache_queue, self->cache_size);
+		}
+		else
+		{
+			if (self->cache_pages)
+			{
+				for (int i = 0; i < self->book->total_page; i++)
+				{
+					PageData* data = self->cache_pages[i];
+					if (data)
+						page_data_free(data);
+				}
+				g_free((gpointer)self->cache_pages);
+			}
+			g_queue_free(self->cache_queue);
+			book_dispose(self->book);
+		}
 
-		book_dispose(self->book);
+		self->cache_pages = NULL;
+		self->cache_queue = NULL;
+		self->cache_size = 0;
 		self->book = NULL;
 	}
 }
@@ -356,16 +621,191 @@ static void finalize_book(ReadWindow* self)
 // 책 정리
 static void close_book(ReadWindow* self)
 {
+	// 썸네일 스레드가 책을 읽고 있을 수 있으니 책을 해제하기 전에 떼어낸다
+	if (self->page_dialog)
+		page_dialog_reset_book(self->page_dialog);
+
+	cancel_next_ready(self);
+	cancel_idle_trim(self);
+	scroll_leave(self);
 	finalize_book(self);
 
 	gtk_label_set_text(GTK_LABEL(self->info_label), "----");
 	gtk_label_set_text(GTK_LABEL(self->title_label), _("[No Book]"));
 	gtk_widget_set_sensitive(self->menu_file_close, false);
+	gtk_widget_set_sensitive(self->menu_file_library, false);
+
+	queue_draw_book(self);
+	queue_recent_view(self);
+}
+
+// 이어 보기 그만 (책 열기 취소, 지난번 화면 버림)
+static void cancel_resume(ReadWindow* self)
+{
+	if (self->resume_cancel)
+	{
+		g_cancellable_cancel(self->resume_cancel);
+		g_clear_object(&self->resume_cancel);
+	}
+	if (self->resume_texture)
+	{
+		g_clear_object(&self->resume_texture);
+		gtk_widget_queue_draw(self->draw);
+		queue_recent_view(self);
+	}
+}
+
+// 열린 책과 쪽 캐시를 창에 붙이기
+static void attach_book_cache(ReadWindow* self, Book* book, int page, PageData** pages, GQueue* queue, size_t size)
+{
+	cancel_resume(self);
+	close_book(self); // 이 안에서 queue_draw가 호출되므로 아래쪽에서 안해도 된다
+
+	config_set_string(CONFIG_FILE_LAST_FILE, book->full_name, false);
+	config_set_string(CONFIG_FILE_LAST_DIRECTORY, book->dir_name, false);
+
+	self->book = book;
+	book->cur_page = page >= 0 && page < book->total_page ? page : 0;
+
+	self->cache_pages = pages;
+	self->cache_queue = queue;
+	self->cache_size = size;
+
+	update_book_info(self);
+	gtk_widget_set_sensitive(self->menu_file_close, true);
+	gtk_widget_set_sensitive(self->menu_file_library, true);
+	library_book_opened(book->full_name);
+	queue_recent_view(self);
+
+	prepare_pages(self);
 
 	if (self->page_dialog)
-		page_dialog_reset_book(self->page_dialog);
+		page_dialog_set_book(self->page_dialog, book);
+}
 
-	queue_draw_book(self);
+// 열린 책을 창에 붙이기
+// first가 있으면 미리 읽어둔 첫 쪽으로 캐시에 넣는다
+static void attach_book(ReadWindow* self, Book* book, int page, PageData* first)
+{
+	PageData** pages = g_new0(PageData*, book->total_page);
+	GQueue* queue = g_queue_new();
+	size_t size = 0;
+
+	if (first != NULL)
+	{
+		const int cur = page >= 0 && page < book->total_page ? page : 0;
+		if (first->entry->page == cur)
+		{
+			pages[cur] = first;
+			g_queue_push_tail(queue, GINT_TO_POINTER(cur));
+			size = first->info.size;
+		}
+		else
+			page_data_free(first);
+	}
+
+	attach_book_cache(self, book, page, pages, queue, size);
+}
+
+// 닫은 책을 쪽 캐시와 함께 다시 붙이기
+static void attach_warm_book(ReadWindow* self, WarmBook* warm, int page)
+{
+	attach_book_cache(self, warm->book, page, warm->pages, warm->queue, warm->size);
+	g_free(warm);
+}
+
+// 이어 보기 책 열기 스레드
+static void thread_resume_book(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	const ResumeSnapshot* rs = task_data;
+	Book* book = doumi_is_archive_zip(rs->filename) ? book_zip_new(rs->filename) : NULL;
+	if (book == NULL)
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, _("Failed to open book"));
+	else
+		g_task_return_pointer(task, book, (GDestroyNotify)book_dispose);
+}
+
+// 이어 보기 책 열기 끝
+static void cb_resume_book_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	GTask* task = G_TASK(res);
+	if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+		return; // 다른 책을 열었거나 창이 없어졌다. 책은 GTask가 해제
+
+	ReadWindow* self = user_data;
+	const ResumeSnapshot* rs = g_task_get_task_data(task);
+	Book* book = g_task_propagate_pointer(task, NULL);
+	if (book != NULL)
+		attach_book(self, book, rs->page, NULL); // 여기서 지난번 화면을 버린다
+	else
+	{
+		cancel_resume(self);
+		notify(self, 0, _("No last book found"));
+	}
+}
+
+// 지난번에 보던 책 이어 보기
+// 저장해둔 화면을 먼저 그리고 책은 스레드에서 연다
+static void start_resume(ReadWindow* self)
+{
+	if (!CONFIG_GET_BOOL(CONFIG_GENERAL_RESUME_LAST))
+		return;
+
+	ResumeSnapshot* rs = resume_load();
+	if (rs == NULL)
+		return;
+	if (!g_file_test(rs->filename, G_FILE_TEST_IS_REGULAR))
+	{
+		resume_free(rs);
+		resume_clear();
+		return;
+	}
+
+	self->resume_texture = g_object_ref(rs->texture);
+	self->resume_cancel = g_cancellable_new();
+
+	GTask* task = g_task_new(NULL, self->resume_cancel, cb_resume_book_finish, self);
+	g_task_set_task_data(task, rs, (GDestroyNotify)resume_free);
+	g_task_run_in_thread(task, thread_resume_book);
+	g_object_unref(task);
+}
+
+// 지금 보이는 화면을 줄여서 이어 보기로 저장
+static void save_resume(ReadWindow* self)
+{
+	if (!CONFIG_GET_BOOL(CONFIG_GENERAL_RESUME_LAST) || self->book == NULL)
+	{
+		resume_clear();
+		return;
+	}
+
+	const int width = gtk_widget_get_width(self->draw);
+	const int height = gtk_widget_get_height(self->draw);
+	GskRenderer* renderer = gtk_native_get_renderer(GTK_NATIVE(self->window));
+	if (width <= 0 || height <= 0 || renderer == NULL)
+		return;
+
+	// 긴 쪽이 960을 넘지 않게 줄인다
+	const float scale = MIN(1.0f, 960.0f / (float)MAX(width, height));
+	const float sw = floorf((float)width * scale);
+	const float sh = floorf((float)height * scale);
+
+	GtkSnapshot* snapshot = gtk_snapshot_new();
+	const GdkRGBA bg = { 0.1f, 0.1f, 0.1f, 1.0f };
+	gtk_snapshot_append_color(snapshot, &bg, &GRAPHENE_RECT_INIT(0, 0, sw, sh));
+	gtk_snapshot_scale(snapshot, scale, scale);
+	paint_book(self, snapshot, width, height);
+	GskRenderNode* node = gtk_snapshot_free_to_node(snapshot);
+	if (node == NULL)
+		return;
+
+	GdkTexture* texture = gsk_renderer_render_texture(renderer, node, &GRAPHENE_RECT_INIT(0, 0, sw, sh));
+	gsk_render_node_unref(node);
+	if (texture != NULL)
+	{
+		resume_save(self->book->full_name, self->book->cur_page, texture);
+		g_object_unref(texture);
+	}
 }
 
 // 책 열기
@@ -384,6 +824,15 @@ static void open_book(ReadWindow* self, GFile* file)
 	gchar* path = g_file_get_path(file);
 	Book* book = NULL;
 
+	// 얼마 전에 닫은 책이면 쪽 캐시째로 다시 붙인다
+	WarmBook* warm = path ? warm_book_take(self, path) : NULL;
+	if (warm != NULL)
+	{
+		g_free(path);
+		attach_warm_book(self, warm, recently_get_page(warm->book->base_name));
+		return;
+	}
+
 	if (doumi_is_archive_zip(path))
 	{
 		book = book_zip_new(path);
@@ -405,25 +854,7 @@ static void open_book(ReadWindow* self, GFile* file)
 	if (book == NULL)
 		return; // 오류 메시지는 오류 난데서 표시하고 여기서는 그냥 나감
 
-	close_book(self); // 이 안에서 queue_draw가 호출되므로 아래쪽에서 안해도 된다
-
-	config_set_string(CONFIG_FILE_LAST_FILE, book->full_name, false);
-	config_set_string(CONFIG_FILE_LAST_DIRECTORY, book->dir_name, false);
-
-	self->book = book;
-	book->cur_page = recently_get_page(book->base_name);
-
-	self->cache_pages = g_new0(PageData*, book->total_page);
-	self->cache_queue = g_queue_new();
-	self->cache_size = 0;
-
-	update_book_info(self);
-	gtk_widget_set_sensitive(self->menu_file_close, true);
-
-	prepare_pages(self);
-
-	if (self->page_dialog)
-		page_dialog_set_book(self->page_dialog, book);
+	attach_book(self, book, recently_get_page(book->base_name), NULL);
 }
 
 // 책 열기 대화상자 콜백
@@ -473,115 +904,979 @@ static void open_book_dialog(ReadWindow* self)
 	g_object_unref(fzip);
 }
 
-// 애니메이션 콜백
-static gboolean cb_page_anim_timeout(gpointer data)
+#pragma region 미리 여는 책
+// 미리 연 책과 첫 쪽
+struct ReadyBook
 {
-	ReadWindow* self = s_read_window;
-	PageData* page = data;
+	char* path; // 책 경로 (NULL이면 after의 다음 책을 찾는다)
+	char* after; // 이 책의 다음 책을 연다
+	int page; // 열 쪽 (-1이면 최근 기록에서 찾는다)
+	Book* book; // 연 책 (못 열었으면 NULL)
+	PageData* data; // 풀어둔 쪽
+	size_t budget; // 쪽을 풀어둘 크기 한도 (0이면 제한 없음)
+};
 
-	if (!self || !page)
+// 미리 연 책 해제
+static void ready_book_free(ReadyBook* ready)
+{
+	if (ready->data)
+		page_data_free(ready->data);
+	if (ready->book)
+		book_dispose(ready->book);
+	g_free(ready->path);
+	g_free(ready->after);
+	g_free(ready);
+}
+
+// 책 미리 열기 작업 만들기, 끝나면 ready_book_steal로 꺼낸다
+static GTask* ready_book_task_new(const char* path, int page, size_t budget, GCancellable* cancellable,
+	GAsyncReadyCallback callback, gpointer user_data)
+{
+	ReadyBook* ready = g_new0(ReadyBook, 1);
+	ready->path = g_strdup(path);
+	ready->page = page;
+	ready->budget = budget;
+
+	GTask* task = g_task_new(NULL, cancellable, callback, user_data);
+	g_task_set_task_data(task, ready, (GDestroyNotify)ready_book_free);
+	return task;
+}
+
+// 책 미리 열기 스레드, 책을 열고 쪽을 텍스쳐로 풀어둔다
+static void thread_ready_book(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	ReadyBook* ready = task_data;
+
+	// 다음 책 찾기와 쪽 기록은 디렉토리와 DB를 읽으므로 여기서
+	if (ready->path == NULL && ready->after != NULL)
 	{
-		g_log("BOOK", G_LOG_LEVEL_WARNING, "Invalid data in animation timeout callback");
-		return false;
+		char* dir = g_path_get_dirname(ready->after);
+		ready->path = nears_find_next(ready->after, dir, doumi_is_archive_zip);
+		g_free(dir);
+	}
+	if (ready->path == NULL)
+	{
+		g_task_return_boolean(task, false);
+		return;
+	}
+	if (ready->page < 0)
+	{
+		char* base_name = g_path_get_basename(ready->path);
+		ready->page = recently_get_page(base_name);
+		g_free(base_name);
 	}
 
-	if (!page->info.has_anim || !page->anim_iter)
-		return false; // 애니메이션이 없으면 그냥 나감
+	ready->book = doumi_is_archive_zip(ready->path) ? book_zip_new(ready->path) : NULL;
+	if (ready->book == NULL || g_cancellable_is_cancelled(cancellable))
+	{
+		g_task_return_boolean(task, false);
+		return;
+	}
 
-	const bool visible = page == self->pages[0] || page == self->pages[1];
-	if (!visible)
+	if (ready->page < 0 || ready->page >= ready->book->total_page)
+		ready->page = 0;
+	PageData* data = book_prepare_page(ready->book, ready->page);
+	if (data != NULL && data->buffer != NULL && !data->info.has_anim && !tiled_image_wanted(&data->info) &&
+		(ready->budget == 0 || data->info.size <= ready->budget))
 	{
-		page->anim_timer = 0;
-		return false;
+		// 애니메이션은 읽기 창에서 비동기로 읽으니 그대로 둔다
+		// 한도를 넘는 큰 그림도 풀지 않고 압축된 채로 둔다
+		data->texture = decoder_decode(data->buffer, &data->info, NULL, NULL);
+		if (data->texture != NULL)
+		{
+			g_bytes_unref(data->buffer);
+			data->buffer = NULL;
+			data->loaded = true;
+		}
 	}
+	ready->data = data;
 
-	if (page->texture)
-		g_object_unref(page->texture);
+	g_task_return_boolean(task, true);
+}
 
-	GdkPixbuf* pixbuf = gdk_pixbuf_animation_iter_get_pixbuf(page->anim_iter);
-	page->texture = gdk_texture_new_for_pixbuf(pixbuf);
+// 끝난 미리 열기 작업에서 책을 꺼낸다, 취소됐으면 NULL
+static ReadyBook* ready_book_steal(GAsyncResult* res)
+{
+	GTask* task = G_TASK(res);
+	if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+		return NULL; // 책은 GTask가 해제
+
+	g_task_propagate_boolean(task, NULL); // 못 열었어도 경로는 돌려준다
+	ReadyBook* src = g_task_get_task_data(task);
+	ReadyBook* ready = g_new(ReadyBook, 1);
+	*ready = *src;
+	src->path = NULL;
+	src->after = NULL;
+	src->book = NULL;
+	src->data = NULL;
+	return ready;
+}
 
-	gtk_widget_queue_draw(self->draw); // 다시 그리라고 요청
+// 미리 연 책이 풀어서 들고 있는 크기
+static size_t ready_book_size(const ReadyBook* ready)
+{
+	return ready != NULL && ready->data != NULL && ready->data->texture != NULL ? ready->data->info.size : 0;
+}
 
-	gdk_pixbuf_animation_iter_advance(page->anim_iter, NULL);
+// 미리 열 책 한 권이 쪽을 풀어둘 한도, 쪽 캐시에서 남은 만큼을 나눠 쓴다 (한 권에 NEXT_READY_BUDGET까지)
+static size_t ready_book_budget(ReadWindow* self, guint count)
+{
+	size_t used = self->cache_size + self->warm_size + ready_book_size(self->next_ready);
+	for (guint i = 0; i < self->queue_ready->len; i++)
+		used += ready_book_size(g_ptr_array_index(self->queue_ready, i));
+	const size_t limit = page_cache_budget();
+	const size_t left = limit > used ? (limit - used) / MAX(count, 1) : 0;
+	return CLAMP(left, 1, NEXT_READY_BUDGET); // 0은 한도 없음이라 1로
+}
 
-	return true; // 타이머 계속 유지
+// 미리 연 책을 창에 붙이고 해제
+static void attach_ready_book(ReadWindow* self, ReadyBook* ready)
+{
+	attach_book(self, ready->book, ready->page, ready->data);
+	ready->book = NULL;
+	ready->data = NULL;
+	ready_book_free(ready);
 }
+#pragma endregion
 
-// 비동기 애니메이션 로딩 완료 콜백
-static void cb_animation_load_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+#pragma region 최근 책 시작 화면
+
+// 표지 읽기 작업 자료
+typedef struct RecentCover
 {
-	ReadWindow* self = s_read_window;
-	PageData* data = user_data;
+	char* path; // 책 경로
+	int cover; // 표지 쪽 번호
+	GtkPicture* picture; // 표지를 넣을 곳
+} RecentCover;
 
-	if (!self || !data)
-	{
-		g_log("BOOK", G_LOG_LEVEL_WARNING, "Invalid data in animation load callback");
-		return;
-	}
+// 표지 읽기 작업 자료 해제
+static void recent_cover_free(RecentCover* rc)
+{
+	g_free(rc->path);
+	if (rc->picture)
+		g_object_unref(rc->picture); // 보통은 끝 콜백에서 놓는다
+	g_free(rc);
+}
 
-	bool data_valid = false;
-	if (data->entry && data->entry->page >= 0 && data->entry->page < self->book->total_page)
+// 미리 읽기 그만
+static void cancel_recent_preload(ReadWindow* self)
+{
+	if (self->preload_cancel)
 	{
-		const PageData* cached_data = self->cache_pages[data->entry->page];
-		if (cached_data == data)
-			data_valid = true;
+		g_cancellable_cancel(self->preload_cancel);
+		g_clear_object(&self->preload_cancel);
 	}
-
-	if (!data_valid)
+	if (self->preload)
 	{
-		g_log("BOOK", G_LOG_LEVEL_DEBUG, "PageData no longer valid, skipping animation load");
-		return;
+		ready_book_free(self->preload);
+		self->preload = NULL;
 	}
+	g_clear_pointer(&self->preload_path, g_free);
+}
 
-	GError* error = NULL;
-	data->animation = gdk_pixbuf_animation_new_from_stream_finish(res, &error);
-	data->async_loading = false;
+// 표지 읽기 스레드, 썸네일 저장소에 없으면 책을 열어서 만들고 저장소에 넣는다
+static void thread_recent_cover(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	const RecentCover* rc = task_data;
+	GdkTexture* texture = NULL;
 
-	if (data->anim_timer)
+	ThumbStore* store = thumb_store_open(rc->path, RECENT_COVER_SIZE);
+	GBytes* stored = store ? thumb_store_lookup(store, rc->cover) : NULL;
+	if (stored != NULL)
 	{
-		g_source_remove(data->anim_timer);
-		data->anim_timer = 0;
+		texture = gdk_texture_new_from_bytes(stored, NULL);
+		g_bytes_unref(stored);
 	}
 
-	if (error)
+	if (texture == NULL && !g_cancellable_is_cancelled(cancellable) && doumi_is_archive_zip(rc->path))
 	{
-		g_log("BOOK", G_LOG_LEVEL_WARNING, _("Failed to load animation: %s"), error->message);
-		g_clear_error(&error);
-		data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
-	}
-	else if (data->animation)
-	{
-		// 애니메이션 로딩 성공
-		data->anim_iter = gdk_pixbuf_animation_get_iter(data->animation, NULL);
+		Book* book = book_zip_new(rc->path);
+		if (book != NULL)
+		{
+			const int cover = rc->cover < book->total_page ? rc->cover : 0;
+			GBytes* bytes = book_read_data(book, cover);
+			if (bytes != NULL)
+			{
+				GBytes* encoded = NULL;
+				texture = doumi_load_thumbnail_texture(bytes, RECENT_COVER_SIZE, store ? &encoded : NULL);
+				g_bytes_unref(bytes);
+				if (encoded != NULL)
+				{
+					thumb_store_put(store, cover, encoded);
+					g_bytes_unref(encoded);
+				}
+			}
+			book_dispose(book);
+		}
+	}
+
+	thumb_store_close(store);
+
+	if (texture == NULL)
+		g_task_return_new_error(task, G_IO_ERROR, G_IO_ERROR_FAILED, _("Failed to open book"));
+	else
+		g_task_return_pointer(task, texture, g_object_unref);
+}
+
+// 표지 읽기 끝
+static void cb_recent_cover_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	GTask* task = G_TASK(res);
+	RecentCover* rc = g_task_get_task_data(task);
+	GtkPicture* picture = g_steal_pointer(&rc->picture); // 작업이 스레드에서 끝나도 위젯은 여기서 놓는다
+
+	GdkTexture* texture = g_cancellable_is_cancelled(g_task_get_cancellable(task)) ? NULL : // 목록을 다시 만들었거나 창이 없어졌다
+		g_task_propagate_pointer(task, NULL);
+	if (texture != NULL)
+	{
+		ReadWindow* self = user_data;
+		g_hash_table_insert(self->recent_covers, g_strdup(rc->path), texture);
+		gtk_picture_set_paintable(picture, GDK_PAINTABLE(texture));
+	}
+	g_object_unref(picture);
+}
+
+// 표지가 처음 보일 때 읽기 시작
+static void signal_recent_cover_map(GtkWidget* widget, ReadWindow* self)
+{
+	g_signal_handlers_disconnect_by_func(widget, signal_recent_cover_map, self);
+
+	RecentCover* rc = g_new0(RecentCover, 1);
+	rc->path = g_strdup(g_object_get_data(G_OBJECT(widget), "path"));
+	rc->cover = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(widget), "cover"));
+	rc->picture = g_object_ref(GTK_PICTURE(widget));
+
+	GTask* task = g_task_new(NULL, self->recent_cancel, cb_recent_cover_finish, self);
+	g_task_set_task_data(task, rc, (GDestroyNotify)recent_cover_free);
+	g_task_run_in_thread(task, thread_recent_cover);
+	g_object_unref(task);
+}
+
+// 첫 쪽 미리 읽기 끝
+static void cb_recent_preload_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	ReadyBook* ready = ready_book_steal(res);
+	if (ready == NULL)
+		return; // 다른 책에 포인터를 올렸거나 창이 없어졌다
+
+	ReadWindow* self = user_data;
+	if (self->preload)
+		ready_book_free(self->preload);
+	self->preload = ready;
+}
+
+// 최근 책에 포인터가 올라감, 첫 쪽을 미리 풀어둔다
+static void signal_recent_enter(GtkEventControllerMotion* controller, double x, double y, ReadWindow* self)
+{
+	GtkWidget* button = gtk_event_controller_get_widget(GTK_EVENT_CONTROLLER(controller));
+	const char* path = g_object_get_data(G_OBJECT(button), "path");
+	if (self->preload_path != NULL && g_str_equal(self->preload_path, path))
+		return; // 이미 읽었거나 읽는 중
+
+	cancel_recent_preload(self);
+	self->preload_path = g_strdup(path);
+	self->preload_cancel = g_cancellable_new();
+
+	const int page = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(button), "page"));
+	GTask* task = ready_book_task_new(path, page, 0, self->preload_cancel, cb_recent_preload_finish, self);
+	g_task_run_in_thread(task, thread_ready_book);
+	g_object_unref(task);
+}
+
+// 최근 책 누름, 미리 읽어뒀으면 그걸 바로 붙인다
+static void signal_recent_clicked(GtkButton* button, ReadWindow* self)
+{
+	const char* path = g_object_get_data(G_OBJECT(button), "path");
+	ReadyBook* preload = self->preload;
+	if (preload != NULL && preload->book != NULL && g_str_equal(preload->path, path))
+	{
+		self->preload = NULL;
+		cancel_recent_preload(self);
+		attach_ready_book(self, preload);
+	}
+	else
+	{
+		GFile* file = g_file_new_for_path(path);
+		open_book(self, file);
+		g_object_unref(file);
+	}
+	reset_focus(self);
+}
+
+// 최근 책 칸 만들기
+static GtkWidget* create_recent_item(ReadWindow* self, const RecentBook* rb)
+{
+	GtkWidget* picture = gtk_picture_new();
+	gtk_picture_set_content_fit(GTK_PICTURE(picture), GTK_CONTENT_FIT_CONTAIN);
+	gtk_picture_set_can_shrink(GTK_PICTURE(picture), true);
+	gtk_widget_set_size_request(picture, RECENT_COVER_SIZE, RECENT_COVER_SIZE);
+
+	GdkTexture* cover = g_hash_table_lookup(self->recent_covers, rb->path);
+	if (cover != NULL)
+		gtk_picture_set_paintable(GTK_PICTURE(picture), GDK_PAINTABLE(cover));
+	else
+	{
+		// 보일 때 읽는다
+		g_object_set_data_full(G_OBJECT(picture), "path", g_strdup(rb->path), g_free);
+		g_object_set_data(G_OBJECT(picture), "cover", GINT_TO_POINTER(rb->cover));
+		g_signal_connect(picture, "map", G_CALLBACK(signal_recent_cover_map), self);
+	}
+
+	GtkWidget* label = gtk_label_new(rb->filename);
+	gtk_label_set_ellipsize(GTK_LABEL(label), PANGO_ELLIPSIZE_MIDDLE);
+	gtk_label_set_max_width_chars(GTK_LABEL(label), 18);
+
+	GtkWidget* progress = gtk_progress_bar_new();
+	char text[64];
+	if (rb->pages > 0)
+	{
+		const int page = CLAMP(rb->page + 1, 1, rb->pages);
+		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress), (double)page / rb->pages);
+		g_snprintf(text, sizeof(text), "%d / %d", page, rb->pages);
+	}
+	else
+		g_snprintf(text, sizeof(text), "%d", rb->page + 1);
+	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progress), text);
+	gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(progress), true);
+
+	GtkWidget* box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 4);
+	gtk_box_append(GTK_BOX(box), picture);
+	gtk_box_append(GTK_BOX(box), label);
+	gtk_box_append(GTK_BOX(box), progress);
+
+	GtkWidget* button = gtk_button_new();
+	gtk_widget_set_can_focus(button, false);
+	gtk_widget_add_css_class(button, "flat");
+	gtk_button_set_child(GTK_BUTTON(button), box);
+	g_object_set_data_full(G_OBJECT(button), "path", g_strdup(rb->path), g_free);
+	g_object_set_data(G_OBJECT(button), "page", GINT_TO_POINTER(rb->page));
+	if (rb->updated)
+	{
+		char* tooltip = g_strdup_printf("%s\n%s", rb->path, rb->updated);
+		gtk_widget_set_tooltip_text(button, tooltip);
+		g_free(tooltip);
+	}
+	g_signal_connect(button, "clicked", G_CALLBACK(signal_recent_clicked), self);
+
+	GtkEventController* motion = gtk_event_controller_motion_new();
+	g_signal_connect(motion, "enter", G_CALLBACK(signal_recent_enter), self);
+	gtk_widget_add_controller(button, motion);
+
+	return button;
+}
+
+// 서재 책으로 만든 칸 자료 해제
+static void recent_library_free(gpointer ptr)
+{
+	RecentBook* rb = ptr;
+	g_free(rb->filename);
+	g_free(rb->path);
+	g_free(rb);
+}
+
+// 서재 책 목록을 시작 화면 칸 자료로 바꾼다 (books는 여기서 놓는다)
+static GPtrArray* recent_from_library(GPtrArray* books)
+{
+	GPtrArray* list = g_ptr_array_new_with_free_func(recent_library_free);
+	for (guint i = 0; i < books->len; i++)
+	{
+		const LibraryBook* lb = g_ptr_array_index(books, i);
+		RecentBook* rb = g_new0(RecentBook, 1);
+		rb->filename = g_path_get_basename(lb->path);
+		rb->path = g_strdup(lb->path);
+		rb->page = lb->opened > 0 ? recently_get_page(rb->filename) : 0;
+		rb->pages = lb->pages;
+		rb->cover = lb->cover;
+		g_ptr_array_add(list, rb);
+	}
+	g_ptr_array_unref(books);
+	return list;
+}
+
+// 칸 목록의 표지를 새 표지 표로 옮긴다
+static void recent_keep_covers(ReadWindow* self, GHashTable* covers, const GPtrArray* list)
+{
+	for (guint i = 0; i < list->len; i++)
+	{
+		const RecentBook* rb = g_ptr_array_index(list, i);
+		gpointer key, value;
+		if (g_hash_table_steal_extended(self->recent_covers, rb->path, &key, &value))
+			g_hash_table_insert(covers, key, value);
+	}
+}
+
+// 시작 화면 갱신 (책이 없을 때만 최근 책 목록을 다시 만든다)
+static gboolean idle_recent_view(gpointer data)
+{
+	ReadWindow* self = data;
+	self->recent_idle = 0;
+
+	// 지난번 표지 읽기는 버린다
+	if (self->recent_cancel)
+	{
+		g_cancellable_cancel(self->recent_cancel);
+		g_clear_object(&self->recent_cancel);
+	}
+
+	GtkWidget* child;
+	while ((child = gtk_widget_get_first_child(self->recent_flow)) != NULL)
+		gtk_flow_box_remove(GTK_FLOW_BOX(self->recent_flow), child);
+	while ((child = gtk_widget_get_first_child(self->unread_flow)) != NULL)
+		gtk_flow_box_remove(GTK_FLOW_BOX(self->unread_flow), child);
+
+	if (self->book != NULL || self->resume_texture != NULL)
+		return G_SOURCE_REMOVE;
+
+	// 검색어가 있으면 서재 메타데이터에서 찾고, 없으면 최근 책과 서재의 안 읽은 책
+	const char* query = gtk_editable_get_text(GTK_EDITABLE(self->recent_search));
+	const bool searching = *query != '\0';
+	GPtrArray* list = searching ?
+		recent_from_library(library_search(query, RECENT_BOOK_MAX)) : recently_get_list(RECENT_BOOK_MAX);
+	GPtrArray* unread = searching ?
+		g_ptr_array_new() : recent_from_library(library_query_unread(RECENT_BOOK_MAX));
+
+	if (list->len > 0 || unread->len > 0)
+	{
+		self->recent_cancel = g_cancellable_new();
+
+		// 목록에 남은 책의 표지만 남긴다
+		GHashTable* covers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+		recent_keep_covers(self, covers, list);
+		recent_keep_covers(self, covers, unread);
+		g_hash_table_destroy(self->recent_covers);
+		self->recent_covers = covers;
+
+		for (guint i = 0; i < list->len; i++)
+			gtk_flow_box_append(GTK_FLOW_BOX(self->recent_flow), create_recent_item(self, g_ptr_array_index(list, i)));
+		for (guint i = 0; i < unread->len; i++)
+			gtk_flow_box_append(GTK_FLOW_BOX(self->unread_flow), create_recent_item(self, g_ptr_array_index(unread, i)));
+	}
+	gtk_label_set_text(GTK_LABEL(self->recent_label), searching ? _("Search results") : _("Recent books"));
+	gtk_widget_set_visible(self->unread_label, unread->len > 0);
+	gtk_widget_set_visible(self->unread_flow, unread->len > 0);
+	gtk_widget_set_visible(self->recent_view, searching || list->len > 0 || unread->len > 0);
+	g_ptr_array_unref(list);
+	g_ptr_array_unref(unread);
+
+	return G_SOURCE_REMOVE;
+}
+
+// 시작 화면 갱신 요청, 책이 있으면 바로 숨긴다
+static void queue_recent_view(ReadWindow* self)
+{
+	if (self->recent_view == NULL)
+		return;
+	if (self->book != NULL || self->resume_texture != NULL)
+	{
+		gtk_widget_set_visible(self->recent_view, false);
+		cancel_recent_preload(self);
+	}
+	if (self->recent_idle == 0)
+		self->recent_idle = g_idle_add(idle_recent_view, self);
+}
+
+// 서재 카탈로그가 바뀜, 안 읽은 책이나 검색 결과가 달라졌을 수 있다
+static void cb_library_changed(gpointer user_data)
+{
+	ReadWindow* self = user_data;
+	if (self->book == NULL)
+		queue_recent_view(self);
+}
+
+// 서재 검색어 바뀜
+static void signal_recent_search_changed(GtkSearchEntry* entry, ReadWindow* self)
+{
+	queue_recent_view(self);
+}
+#pragma endregion
+
+#pragma region 읽기 대기열
+static void pump_read_queue(ReadWindow* self);
+
+// 대기열 책 미리 열기 끝
+static void cb_queue_ready_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	ReadyBook* ready = ready_book_steal(res);
+	if (ready == NULL)
+		return; // 창이 없어졌다
+
+	ReadWindow* self = user_data;
+	g_clear_object(&self->queue_cancel);
+	g_ptr_array_add(self->queue_ready, ready);
+	pump_read_queue(self);
+}
+
+// 대기열 앞쪽 책을 하나씩 미리 연다
+static void pump_read_queue(ReadWindow* self)
+{
+	if (self->queue_cancel != NULL)
+		return; // 한번에 하나씩
+
+	// 대기열에서 빠진 책은 버린다
+	for (guint i = self->queue_ready->len; i-- > 0;)
+	{
+		const ReadyBook* ready = g_ptr_array_index(self->queue_ready, i);
+		if (g_queue_find_custom(self->read_queue, ready->path, (GCompareFunc)g_strcmp0) == NULL)
+			g_ptr_array_remove_index(self->queue_ready, i);
+	}
+
+	guint n = 0;
+	for (const GList* l = self->read_queue->head; l && n < QUEUE_READY_MAX; l = l->next, n++)
+	{
+		const char* path = l->data;
+		bool found = false;
+		for (guint i = 0; i < self->queue_ready->len && !found; i++)
+			found = g_str_equal(((ReadyBook*)g_ptr_array_index(self->queue_ready, i))->path, path);
+		if (found)
+			continue;
+
+		// 미리 열어둘 남은 자리만큼 쪽 캐시 한도를 나눈다
+		self->queue_cancel = g_cancellable_new();
+		const guint slots = self->queue_ready->len < QUEUE_READY_MAX ? QUEUE_READY_MAX - self->queue_ready->len : 1;
+		const size_t budget = ready_book_budget(self, slots);
+		GTask* task = ready_book_task_new(path, -1, budget, self->queue_cancel, cb_queue_ready_finish, self);
+		g_task_run_in_thread(task, thread_ready_book);
+		g_object_unref(task);
+		break;
+	}
+}
+
+// 저장한 대기열 불러오기, 시작할 때 DB와 파일을 건드리지 않게 아이들에서 한다
+static gboolean idle_load_read_queue(gpointer data)
+{
+	ReadWindow* self = data;
+	self->queue_idle = 0;
+
+	// 그새 명령줄로 받은 책은 저장한 대기열 뒤로
+	const bool added = !g_queue_is_empty(self->read_queue);
+	GPtrArray* queued = readq_load();
+	for (guint i = queued->len; i-- > 0;)
+		g_queue_push_head(self->read_queue, g_steal_pointer(&g_ptr_array_index(queued, i)));
+	g_ptr_array_unref(queued);
+	if (added)
+		readq_save(self->read_queue);
+
+	pump_read_queue(self);
+	return G_SOURCE_REMOVE;
+}
+
+// 대기열 다음 책 열기, 미리 열어뒀으면 그걸 바로 붙인다
+static bool open_queued_book(ReadWindow* self)
+{
+	char* path = g_queue_pop_head(self->read_queue);
+	if (path == NULL)
+		return false;
+	readq_save(self->read_queue);
+
+	ReadyBook* ready = NULL;
+	for (guint i = 0; i < self->queue_ready->len; i++)
+	{
+		if (g_str_equal(((ReadyBook*)g_ptr_array_index(self->queue_ready, i))->path, path))
+		{
+			ready = g_ptr_array_steal_index(self->queue_ready, i);
+			break;
+		}
+	}
+
+	if (ready != NULL && ready->book != NULL)
+		attach_ready_book(self, ready);
+	else
+	{
+		// 아직 못 열었거나 열다가 실패, 실패했으면 open_book이 알려준다
+		if (ready != NULL)
+			ready_book_free(ready);
+		GFile* file = g_file_new_for_path(path);
+		open_book(self, file);
+		g_object_unref(file);
+	}
+	g_free(path);
+
+	const guint left = g_queue_get_length(self->read_queue);
+	if (left > 0)
+		notify(self, 0, _("%u books left in queue"), left);
+	pump_read_queue(self);
+	return true;
+}
+
+// 책 경로 모으기, 디렉토리면 안에 있는 책을 이름 순서로
+static void collect_book_paths(GPtrArray* paths, GFile* file)
+{
+	char* path = g_file_get_path(file);
+	if (path == NULL)
+		return;
+
+	if (g_file_test(path, G_FILE_TEST_IS_DIR))
+	{
+		GPtrArray* nears = nears_get_all(path, doumi_is_archive_zip);
+		if (nears != NULL)
+		{
+			for (guint i = 0; i < nears->len; i++)
+				g_ptr_array_add(paths, g_steal_pointer(&g_ptr_array_index(nears, i)));
+			g_ptr_array_unref(nears);
+		}
+	}
+	else if (doumi_is_archive_zip(path))
+	{
+		g_ptr_array_add(paths, path);
+		return;
+	}
+
+	g_free(path);
+}
+
+// 여러 책 열기, 첫 책은 바로 열고 나머지는 대기열에 넣는다
+static void open_or_queue_files(ReadWindow* self, GFile** files, int n_files)
+{
+	if (n_files == 1 && doumi_get_file_type_from(files[0]) != G_FILE_TYPE_DIRECTORY)
+	{
+		// 하나면 예전처럼 그냥 연다
+		open_book(self, files[0]);
+		return;
+	}
+
+	GPtrArray* paths = g_ptr_array_new_with_free_func(g_free);
+	for (int i = 0; i < n_files; i++)
+		collect_book_paths(paths, files[i]);
+	if (paths->len == 0)
+	{
+		notify(self, 0, _("No books to read"));
+		g_ptr_array_unref(paths);
+		return;
+	}
+
+	guint first = 0;
+	if (self->book == NULL)
+	{
+		GFile* file = g_file_new_for_path(g_ptr_array_index(paths, 0));
+		open_book(self, file);
+		g_object_unref(file);
+		first = 1;
+	}
+
+	const guint queued = paths->len - first;
+	for (guint i = first; i < paths->len; i++)
+		g_queue_push_tail(self->read_queue, g_steal_pointer(&g_ptr_array_index(paths, i)));
+	g_ptr_array_unref(paths);
+
+	if (queued > 0)
+	{
+		readq_save(self->read_queue);
+		notify(self, 0, _("%u books in queue"), g_queue_get_length(self->read_queue));
+		pump_read_queue(self);
+	}
+}
+#pragma endregion
+
+#pragma region 다음 책 미리 열기
+// 다음 책 미리 열기 그만
+static void cancel_next_ready(ReadWindow* self)
+{
+	if (self->next_cancel)
+	{
+		g_cancellable_cancel(self->next_cancel);
+		g_clear_object(&self->next_cancel);
+	}
+	if (self->next_ready)
+	{
+		ready_book_free(self->next_ready);
+		self->next_ready = NULL;
+	}
+	self->next_tried = false;
+}
+
+// 다음 책 미리 열기 끝
+static void cb_next_ready_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	ReadyBook* ready = ready_book_steal(res);
+	if (ready == NULL)
+		return; // 책을 바꿨거나 창이 없어졌다
+
+	ReadWindow* self = user_data;
+	g_clear_object(&self->next_cancel);
+	self->next_ready = ready;
+}
+
+// 마지막 쪽 근처면 같은 디렉토리의 다음 책을 미리 연다
+static void prefetch_next_book(ReadWindow* self)
+{
+	Book* book = self->book;
+	if (book == NULL || self->next_tried)
+		return;
+	if (book->cur_page + self->view_pages * NEXT_READY_PAGES < book->total_page)
+		return;
+	self->next_tried = true;
+
+	// 다음 책은 작업 스레드에서 찾는다
+	self->next_cancel = g_cancellable_new();
+	GTask* task = ready_book_task_new(NULL, -1, NEXT_READY_BUDGET, self->next_cancel, cb_next_ready_finish, self);
+	((ReadyBook*)g_task_get_task_data(task))->after = g_strdup(book->full_name);
+	g_task_run_in_thread(task, thread_ready_book);
+	g_object_unref(task);
+}
+
+// 미리 연 다음 책이 있으면 붙인다
+static bool attach_next_ready(ReadWindow* self)
+{
+	ReadyBook* ready = self->next_ready;
+	if (ready == NULL || ready->book == NULL || !g_file_test(ready->path, G_FILE_TEST_IS_REGULAR))
+		return false;
+	self->next_ready = NULL;
+	attach_ready_book(self, ready); // 여기서 책을 닫으면서 미리 열기도 초기화
+	return true;
+}
+#pragma endregion
+
+// 애니메이션 콜백
+static gboolean cb_page_anim_timeout(gpointer data)
+{
+	ReadWindow* self = s_read_window;
+	PageData* page = data;
+
+	if (!self || !page)
+	{
+		g_log("BOOK", G_LOG_LEVEL_WARNING, "Invalid data in animation timeout callback");
+		return false;
+	}
+
+	if (!page->info.has_anim || !page->anim_iter)
+		return false; // 애니메이션이 없으면 그냥 나감
+
+	if (!is_page_visible(self, page))
+	{
+		page->anim_timer = 0;
+		return false;
+	}
+
+	if (page->texture)
+		g_object_unref(page->texture);
+
+	GdkPixbuf* pixbuf = gdk_pixbuf_animation_iter_get_pixbuf(page->anim_iter);
+	page->texture = gdk_texture_new_for_pixbuf(pixbuf);
+
+	gtk_widget_queue_draw(self->draw); // 다시 그리라고 요청
+
+	gdk_pixbuf_animation_iter_advance(page->anim_iter, NULL);
+
+	return true; // 타이머 계속 유지
+}
+
+// 비동기 애니메이션 로딩 완료 콜백
+static void cb_animation_load_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	ReadWindow* self = s_read_window;
+	PageData* data = user_data;
+
+	if (!self || !data)
+	{
+		g_log("BOOK", G_LOG_LEVEL_WARNING, "Invalid data in animation load callback");
+		return;
+	}
+
+	bool data_valid = false;
+	if (self->book != NULL && data->entry && data->entry->page >= 0 && data->entry->page < self->book->total_page)
+	{
+		const PageData* cached_data = self->cache_pages[data->entry->page];
+		if (cached_data == data)
+			data_valid = true;
+	}
+
+	if (!data_valid)
+	{
+		g_log("BOOK", G_LOG_LEVEL_DEBUG, "PageData no longer valid, skipping animation load");
+		return;
+	}
+
+	GError* error = NULL;
+	data->animation = gdk_pixbuf_animation_new_from_stream_finish(res, &error);
+	data->async_loading = false;
+
+	if (data->anim_timer)
+	{
+		g_source_remove(data->anim_timer);
+		data->anim_timer = 0;
+	}
+
+	if (error)
+	{
+		g_log("BOOK", G_LOG_LEVEL_WARNING, _("Failed to load animation: %s"), error->message);
+		g_clear_error(&error);
+		data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
+	}
+	else if (data->animation)
+	{
+		// 애니메이션 로딩 성공
+		data->anim_iter = gdk_pixbuf_animation_get_iter(data->animation, NULL);
 		int delay = gdk_pixbuf_animation_iter_get_delay_time(data->anim_iter);
 		if (delay <= 0) delay = 100;
 
-		data->anim_timer = g_timeout_add(delay, cb_page_anim_timeout, data);
+		data->anim_timer = g_timeout_add(delay, cb_page_anim_timeout, data);
+
+		// 첫 프레임 텍스처 설정
+		GdkPixbuf* pixbuf = gdk_pixbuf_animation_iter_get_pixbuf(data->anim_iter);
+		data->texture = gdk_texture_new_for_pixbuf(pixbuf);
+	}
+	else
+	{
+		// 어쨋든 애니메이션은 실패
+		data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
+	}
+
+	data->loaded = true;
+
+	// 버퍼 정리
+	if (data->buffer)
+	{
+		g_bytes_unref(data->buffer);
+		data->buffer = NULL;
+	}
+
+	// 화면 업데이트
+	const bool visible = data == self->pages[0] || data == self->pages[1];
+	if (!visible)
+		gtk_widget_queue_draw(self->draw);
+}
+
+// 고화질로 다시 풀 자료, 작업 스레드는 쪽 자료를 만지지 않는다
+typedef struct Refine
+{
+	GBytes* buffer; // 압축된 그림 (book이 있으면 스레드에서 읽어 채움)
+	ImageInfo info; // 그림 정보
+	Book* book; // 파일부터 읽을 책 (참조, 쭉 보기), 아니면 NULL
+	int page; // 읽을 쪽 번호
+} Refine;
+
+// 다시 풀 자료 해제
+static void refine_free(Refine* refine)
+{
+	if (refine->buffer)
+		g_bytes_unref(refine->buffer);
+	if (refine->book)
+		book_dispose(refine->book);
+	g_free(refine);
+}
+
+// 작업 스레드에서 고화질로 푼다
+static void thread_refine_page(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	Refine* refine = task_data;
+	if (refine->book != NULL)
+	{
+		// 쭉 보기는 파일도 여기서 읽는다, 못 푸는 쪽, 애니메이션, 타일 쪽은 메인 스레드에서 원래대로
+		if (!book_read_image(refine->book, refine->page, &refine->buffer, &refine->info) ||
+			refine->buffer == NULL || refine->info.has_anim || tiled_image_wanted(&refine->info) ||
+			g_cancellable_is_cancelled(cancellable))
+		{
+			g_task_return_pointer(task, NULL, NULL);
+			return;
+		}
+	}
+	const DecodeParams params = { .cancellable = cancellable };
+	GError* error = NULL;
+	GdkTexture* texture = decoder_decode(refine->buffer, &refine->info, &params, &error);
+	if (error)
+		g_task_return_error(task, error);
+	else
+		g_task_return_pointer(task, texture, g_object_unref);
+}
+
+// 고화질이 다 풀리면 미리보기를 바꾼다
+static void cb_refine_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	GTask* task = G_TASK(res);
+	GError* error = NULL;
+	GdkTexture* texture = g_task_propagate_pointer(task, &error);
+	if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+	{
+		// 쪽을 넘겼거나 쪽 자료가 해제됐다, data는 만지면 안 됨
+		g_clear_error(&error);
+		if (texture)
+			g_object_unref(texture);
+		return;
+	}
+
+	ReadWindow* self = s_read_window;
+	PageData* data = user_data;
+	const Refine* refine = g_task_get_task_data(task);
+	g_clear_object(&data->refine_cancel);
+	g_clear_pointer(&data->buffer, g_bytes_unref);
 
-		// 첫 프레임 텍스처 설정
-		GdkPixbuf* pixbuf = gdk_pixbuf_animation_iter_get_pixbuf(data->anim_iter);
-		data->texture = gdk_texture_new_for_pixbuf(pixbuf);
-	}
-	else
+	if (refine->book != NULL)
 	{
-		// 어쨋든 애니메이션은 실패
-		data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
+		// 파일부터 스레드에서 읽은 쪽
+		data->unread = false;
+		data->info = refine->info;
+		if (texture == NULL && error == NULL)
+		{
+			data->buffer = refine->buffer ? g_bytes_ref(refine->buffer) : NULL;
+			if (self)
+			{
+				read_page(self, data);
+				count_read_page(self, data);
+			}
+			return;
+		}
 	}
 
-	data->loaded = true;
+	if (error)
+	{
+		g_log("BOOK", G_LOG_LEVEL_WARNING, _("Failed to create page %d: %s"),
+			data->entry->page + 1, error->message);
+		g_clear_error(&error);
+	}
 
-	// 버퍼 정리
-	if (data->buffer)
+	// 실패하면 미리보기라도 남긴다, 미리보기도 없으면 노 이미지로
+	if (texture)
 	{
-		g_bytes_unref(data->buffer);
-		data->buffer = NULL;
+		if (data->texture)
+			g_object_unref(data->texture);
+		data->texture = texture;
 	}
+	else if (data->texture == NULL)
+		data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
+	data->loaded = true;
 
-	// 화면 업데이트
-	const bool visible = data == self->pages[0] || data == self->pages[1];
-	if (!visible)
+	if (self && is_page_visible(self, data))
 		gtk_widget_queue_draw(self->draw);
+	if (self && refine->book != NULL)
+		count_read_page(self, data);
+}
+
+// 쪽 자료에 풀기 작업을 걸고 스레드에서 시작
+static void refine_start(PageData* data, Refine* refine)
+{
+	data->refine_cancel = g_cancellable_new();
+	GTask* task = g_task_new(NULL, data->refine_cancel, cb_refine_finish, data);
+	g_task_set_task_data(task, refine, (GDestroyNotify)refine_free);
+	g_task_run_in_thread(task, thread_refine_page);
+	g_object_unref(task);
+}
+
+// 쪽을 스레드에서 고화질로 풀기 시작, 미리보기가 있으면 다 풀릴 때까지 그걸 보인다
+static void refine_page(PageData* data)
+{
+	Refine* refine = g_new0(Refine, 1);
+	refine->buffer = g_bytes_ref(data->buffer);
+	refine->info = data->info;
+	refine_start(data, refine);
+}
+
+// 안 읽은 쪽을 스레드에서 읽고 풀기 시작
+static void refine_unread_page(ReadWindow* self, PageData* data)
+{
+	Refine* refine = g_new0(Refine, 1);
+	refine->book = book_ref(self->book);
+	refine->page = data->entry->page;
+	refine_start(data, refine);
+}
+
+// 안 보이게 된 쪽의 고화질 풀기를 취소, 다시 보이면 미리보기부터 다시
+static void cancel_refine(PageData* data)
+{
+	if (data == NULL || data->refine_cancel == NULL)
+		return;
+	g_cancellable_cancel(data->refine_cancel);
+	g_clear_object(&data->refine_cancel);
+	data->loaded = false;
 }
 
 // 쪽 읽기
@@ -610,6 +1905,20 @@ static void read_page(ReadWindow* self, PageData* data)
 		return;
 	}
 
+	if (data->refine_cancel)
+	{
+		// 쭉 보기에서 스레드로 풀던 쪽, 기다리지 않고 여기서 푼다
+		cancel_refine(data);
+	}
+
+	if (data->unread)
+	{
+		// 쭉 보기에서 스레드로 읽다 만 쪽은 여기서 읽는다
+		book_read_image(self->book, data->entry->page, &data->buffer, &data->info);
+		data->unread = false;
+		count_read_page(self, data);
+	}
+
 	if (data->anim_timer)
 	{
 		g_source_remove(data->anim_timer);
@@ -642,10 +1951,23 @@ static void read_page(ReadWindow* self, PageData* data)
 		// 즉시 화면 업데이트 (로딩 표시)
 		gtk_widget_queue_draw(self->draw);
 	}
+	else if (tiled_image_wanted(&data->info))
+	{
+		// 아주 긴 그림은 타일로 나눠서 보이는 곳만 푼다
+		data->tiled = tiled_image_new(data->buffer, &data->info, cb_tiled_update, data);
+		g_bytes_unref(data->buffer);
+		data->buffer = NULL;
+	}
+	else if ((gsize)data->info.width * (gsize)data->info.height >= PREVIEW_MIN_PIXELS &&
+		(data->texture = decoder_decode_preview(data->buffer, &data->info, NULL)) != NULL)
+	{
+		// 큰 쪽은 작게 먼저 보이고, 고화질은 스레드에서 풀어서 바꾼다
+		refine_page(data);
+	}
 	else
 	{
 		GError* error = NULL;
-		data->texture = gdk_texture_new_from_bytes(data->buffer, &error);
+		data->texture = decoder_decode(data->buffer, &data->info, NULL, &error);
 
 		g_bytes_unref(data->buffer);
 		data->buffer = NULL;
@@ -663,57 +1985,570 @@ static void read_page(ReadWindow* self, PageData* data)
 			data->texture = g_object_ref(res_get_texture(RES_PIX_NO_IMAGE));
 		}
 	}
-
-	data->loaded = true; // 페이지는 읽은 것으로 표시
+
+	data->loaded = true; // 페이지는 읽은 것으로 표시
+}
+
+// 캐시가 limit 이하가 될 때까지 오래된 페이지를 제거, 지금 보이는 쪽은 남김
+static size_t evict_page_cache(ReadWindow* self, size_t dest_size, const size_t limit)
+{
+	guint remain = g_queue_get_length(self->cache_queue);
+	while (dest_size > limit && remain-- > 0)
+	{
+		const int index = GPOINTER_TO_INT(g_queue_pop_head(self->cache_queue));
+		PageData* item = self->cache_pages[index];
+		if (item == NULL)
+			continue;
+
+		if (is_page_visible(self, item))
+		{
+			// 보이는 쪽은 다시 뒤로
+			g_queue_push_tail(self->cache_queue, GINT_TO_POINTER(index));
+			continue;
+		}
+
+		dest_size -= item->info.size;
+
+		if (item->anim_timer)
+		{
+			g_source_remove(item->anim_timer);
+			item->anim_timer = 0;
+		}
+
+		// 비동기 로딩이 진행 중인 경우 플래그 해제
+		item->async_loading = false;
+
+		page_data_free(item); // 페이지 데이터 해제
+		self->cache_pages[index] = NULL; // 캐시에서 제거
+	}
+
+	self->cache_size = dest_size; // 현재 캐시 크기 갱신
+	return dest_size;
+}
+
+// 쪽 캐시 한도, 버퍼 풀 몫(1/8)을 떼어 두고 남은 것
+static size_t page_cache_budget(void)
+{
+	const ReadWindow* self = s_read_window;
+	const size_t in_use = (self != NULL ? self->cache_size + self->warm_size : 0) + bufpool_get_size();
+	const size_t total = config_get_actual_max_page_cache(in_use);
+	bufpool_set_limit(total / 8);
+	return total - total / 8;
+}
+
+// 설정이 바뀌면 불림 (캐시 크기가 줄면 바로 정리)
+// 메모리 부족 경고도 여기로 오므로, 비운 게 있으면 힙을 운영체제에 돌려준다
+static void cb_config_changed(const ConfigKeys key, gpointer user_data)
+{
+	ReadWindow* self = user_data;
+	if (key != CONFIG_GENERAL_MAX_PAGE_CACHE)
+		return;
+	const size_t before = self->cache_size + self->warm_size;
+	const size_t limit = page_cache_budget();
+	evict_warm_pages(self, self->cache_size, limit);
+	if (self->book != NULL && self->cache_pages != NULL)
+		evict_page_cache(self, self->cache_size, limit > self->warm_size ? limit - self->warm_size : 0);
+	if (self->cache_size + self->warm_size < before)
+		doumi_trim_memory();
+}
+
+// 캐시에 넣은 쪽을 읽은 크기로 센다, 넘치면 닫은 책의 쪽부터 버리고 그래도 모자라면 지금 책에서 버린다
+static void count_read_page(ReadWindow* self, PageData* data)
+{
+	const int page = data->entry->page;
+	if (self->book == NULL || self->cache_pages == NULL ||
+		page < 0 || page >= self->book->total_page || self->cache_pages[page] != data)
+		return;
+
+	// 혹시나 페이지가 너무 커서 캐시가 넘쳤더라도 방금 읽은건 못지운다
+	g_queue_remove(self->cache_queue, GINT_TO_POINTER(page));
+	const size_t limit = page_cache_budget();
+	const size_t need = self->cache_size + data->info.size;
+	evict_warm_pages(self, need, limit);
+	evict_page_cache(self, need, limit > self->warm_size ? limit - self->warm_size : 0);
+	g_queue_push_tail(self->cache_queue, GINT_TO_POINTER(page)); // 캐시 큐에 넣음
+}
+
+// 쪽 준비 (여기서 캐시 처리)
+static PageData* try_page_read_or_cache_data(ReadWindow* self, const int page)
+{
+	PageData* data = self->cache_pages[page];
+
+	if (data != NULL)
+		return data; // 캐시에 있으면 그냥 반환
+
+	data = book_prepare_page(self->book, page);
+	if (data == NULL)
+		return NULL;
+
+	self->cache_pages[page] = data; // 캐시에 넣음
+	count_read_page(self, data);
+	return data;
+}
+
+#pragma region 타일 쪽
+// 타일 쪽은 올라온 타일만큼 캐시에 센다, 늘어서 넘치면 다른 쪽을 버린다
+static void sync_tiled_size(ReadWindow* self, PageData* data)
+{
+	const size_t size = tiled_image_get_resident_size(data->tiled);
+	if (size == data->info.size)
+		return;
+
+	const int page = data->entry->page;
+	const bool cached = self->book != NULL && self->cache_pages != NULL &&
+		page >= 0 && page < self->book->total_page && self->cache_pages[page] == data;
+	const bool grew = size > data->info.size;
+	if (cached)
+		self->cache_size = self->cache_size - data->info.size + size;
+	data->info.size = size;
+
+	if (cached && grew)
+	{
+		const size_t limit = page_cache_budget();
+		evict_warm_pages(self, self->cache_size, limit);
+		evict_page_cache(self, self->cache_size, limit > self->warm_size ? limit - self->warm_size : 0);
+	}
+}
+
+// 타일이 올라오면
+static void cb_tiled_update(TiledImage* image, gpointer user_data)
+{
+	ReadWindow* self = s_read_window;
+	PageData* data = user_data;
+	if (!self)
+		return;
+	sync_tiled_size(self, data);
+	if (is_page_visible(self, data))
+		gtk_widget_queue_draw(self->draw);
+}
+
+// 타일 쪽 배율, 맞춤이면 폭에 맞추고 아니면 원래 크기
+static double tiled_page_scale(const PageData* page, int width)
+{
+	return CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM) ? (double)width / page->info.width : 1.0;
+}
+
+// 타일 쪽을 더 내릴 수 있는 만큼
+static double tiled_page_max_scroll(const PageData* page, int width, int height)
+{
+	return MAX(0.0, page->info.height * tiled_page_scale(page, width) - height);
+}
+
+// 한장 보기에서 타일 쪽을 dy 픽셀 굴린다, 끝에 닿아서 못 굴리면 false
+static bool scroll_tiled_page(ReadWindow* self, double dy)
+{
+	PageData* data = self->view_pages == 1 ? self->pages[0] : NULL;
+	if (data == NULL || data->tiled == NULL)
+		return false;
+
+	const int width = gtk_widget_get_width(self->draw);
+	const int height = gtk_widget_get_height(self->draw);
+	const double max_scroll = tiled_page_max_scroll(data, width, height);
+	if ((dy > 0 && self->tiled_scroll >= max_scroll) || (dy < 0 && self->tiled_scroll <= 0.0))
+		return false;
+
+	self->tiled_scroll = CLAMP(self->tiled_scroll + dy, 0.0, max_scroll);
+	gtk_widget_queue_draw(self->draw);
+	return true;
+}
+#pragma endregion
+
+#pragma region 쭉 보기
+// 띠에서 y가 걸친 쪽
+static int scroll_page_at(const ReadWindow* self, double y)
+{
+	int lo = 0, hi = self->book->total_page - 1;
+	while (lo < hi)
+	{
+		const int mid = (lo + hi + 1) / 2;
+		if (self->scroll_slots[mid].top <= y)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+// 더 내릴 수 있는 만큼
+static double scroll_max_pos(const ReadWindow* self, int height)
+{
+	return MAX(0.0, self->scroll_slots[self->book->total_page].top - height);
+}
+
+// 쪽 크기로 띠를 짠다, 화면 폭이나 늘려 보기나 아는 쪽 크기 수가 바뀌었을 때만
+// 다시 짜도 보던 쪽의 같은 곳이 화면 맨 위에 오게 한다
+static bool scroll_relayout(ReadWindow* self, int width)
+{
+	Book* book = self->book;
+	const int total = book->total_page;
+	const int probed = g_atomic_int_get(&book->probed);
+	const bool zoom = CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM);
+	if (width <= 0 || total <= 0)
+		return false;
+	if (self->scroll_slots != NULL && self->scroll_width == width &&
+		self->scroll_probed == probed && self->scroll_zoom == zoom)
+		return false;
+
+	// 보던 곳, 처음 짜면 지금 쪽 맨 위
+	int anchor = CLAMP(book->cur_page, 0, total - 1);
+	double frac = 0.0, delta = 0.0;
+	if (self->scroll_slots != NULL)
+	{
+		anchor = scroll_page_at(self, self->scroll_pos);
+		const double h = self->scroll_slots[anchor + 1].top - self->scroll_slots[anchor].top;
+		frac = h > 0.0 ? (self->scroll_pos - self->scroll_slots[anchor].top) / h : 0.0;
+		delta = self->scroll_target - self->scroll_pos;
+	}
+	else
+		self->scroll_slots = g_new(ScrollSlot, total + 1);
+
+	// 모르는 쪽은 아는 쪽들의 평균으로 어림한다
+	double sum_width = 0.0, sum_ratio = 0.0;
+	int known = 0;
+	for (int i = 0; i < total; i++)
+	{
+		int w, h;
+		if (!book_get_page_size(book, i, &w, &h))
+			continue;
+		sum_width += w;
+		sum_ratio += (double)h / w;
+		known++;
+	}
+	const double guess_width = known > 0 ? sum_width / known : width;
+	const double guess_ratio = known > 0 ? sum_ratio / known : SCROLL_GUESS_RATIO;
+
+	double top = 0.0;
+	for (int i = 0; i < total; i++)
+	{
+		int w, h;
+		const bool ok = book_get_page_size(book, i, &w, &h);
+		const double iw = ok ? w : guess_width;
+		const double ratio = ok ? (double)h / w : guess_ratio;
+		// 늘려 보기면 화면 폭에 맞추고, 아니면 화면보다 넓은 쪽만 줄인다
+		const double dw = zoom ? width : MIN((double)width, iw);
+		self->scroll_slots[i].top = top;
+		self->scroll_slots[i].width = dw;
+		top += dw * ratio;
+	}
+	self->scroll_slots[total].top = top;
+	self->scroll_slots[total].width = 0.0;
+
+	self->scroll_width = width;
+	self->scroll_probed = probed;
+	self->scroll_zoom = zoom;
+
+	const double h = self->scroll_slots[anchor + 1].top - self->scroll_slots[anchor].top;
+	self->scroll_pos = self->scroll_slots[anchor].top + frac * h;
+	self->scroll_target = self->scroll_pos + delta;
+	return true;
+}
+
+// 쭉 보기 캐시에서 쪽 하나를 버린다
+static void drop_cached_page(ReadWindow* self, int page)
+{
+	PageData* item = self->cache_pages[page];
+	if (item == NULL)
+		return;
+	self->cache_size -= item->info.size;
+	page_data_free(item);
+	self->cache_pages[page] = NULL;
+	g_queue_remove(self->cache_queue, GINT_TO_POINTER(page));
+}
+
+// 풀어 둘 쪽 가운데 아직 안 읽었거나 안 푼 쪽이 있나
+static bool scroll_needs_load(const ReadWindow* self)
+{
+	for (int i = self->scroll_want[0]; i <= self->scroll_want[1]; i++)
+	{
+		const PageData* data = self->cache_pages[i];
+		if (data == NULL || (!data->loaded && !data->async_loading && data->refine_cancel == NULL))
+			return true;
+	}
+	return false;
+}
+
+static gboolean cb_scroll_load_idle(gpointer user_data);
+
+// 굴린 곳에 맞춰 지금 쪽, 보이는 쪽, 풀어 둘 쪽을 정한다
+// 굴리는 쪽으로는 빠르기만큼 더 미리 풀고, 범위에서 벗어난 쪽은 캐시에서 버린다
+static void scroll_update(ReadWindow* self)
+{
+	Book* book = self->book;
+	if (book == NULL || self->scroll_slots == NULL)
+		return;
+
+	const int total = book->total_page;
+	const int height = gtk_widget_get_height(self->draw);
+	self->scroll_pos = CLAMP(self->scroll_pos, 0.0, scroll_max_pos(self, height));
+
+	const int first = scroll_page_at(self, self->scroll_pos);
+	const int last = scroll_page_at(self, self->scroll_pos + MAX(height - 1, 0));
+	self->scroll_visible[0] = first;
+	self->scroll_visible[1] = last;
+
+	// 가는 쪽은 한 화면에 빠르기만큼 더, 지나온 쪽은 반 화면만
+	const double ahead = height + ABS(self->scroll_velocity) * SCROLL_LOOKAHEAD;
+	const double behind = height / 2.0;
+	const bool up = self->scroll_dir < 0;
+	const int want_first = scroll_page_at(self, self->scroll_pos - (up ? ahead : behind));
+	const int want_last = scroll_page_at(self, self->scroll_pos + height + (up ? behind : ahead));
+	self->scroll_want[0] = MAX(want_first, first - SCROLL_AHEAD_MAX);
+	self->scroll_want[1] = MIN(want_last, last + SCROLL_AHEAD_MAX);
+
+	// 지금 쪽은 화면 맨 위 쪽, 버리기 전에 바꿔둔다
+	self->pages[0] = self->cache_pages[first];
+	self->pages[1] = NULL;
+
+	// 범위 밖은 버린다, 한 쪽씩은 남겨서 왔다갔다 할 때 다시 읽지 않게
+	const int keep_first = MAX(self->scroll_want[0] - 1, 0);
+	const int keep_last = MIN(self->scroll_want[1] + 1, total - 1);
+	if (!self->scroll_swept)
+	{
+		for (int i = 0; i < total; i++)
+		{
+			if (i < keep_first || i > keep_last)
+				drop_cached_page(self, i);
+		}
+		self->scroll_swept = true;
+	}
+	else
+	{
+		// 지난번 범위에서 벗어난 쪽만
+		for (int i = self->scroll_kept[0]; i < keep_first && i <= self->scroll_kept[1]; i++)
+			drop_cached_page(self, i);
+		for (int i = MAX(keep_last + 1, self->scroll_kept[0]); i <= self->scroll_kept[1]; i++)
+			drop_cached_page(self, i);
+	}
+	self->scroll_kept[0] = keep_first;
+	self->scroll_kept[1] = keep_last;
+
+	// 다시 보이는 애니메이션은 다시 재생
+	for (int i = first; i <= last; i++)
+	{
+		PageData* data = self->cache_pages[i];
+		if (data != NULL && data->loaded && data->info.has_anim && !data->anim_timer)
+			read_page(self, data);
+	}
+
+	if (book->cur_page != first)
+	{
+		book->cur_page = first;
+		update_book_info(self);
+	}
+	prefetch_next_book(self); // 끝 근처면 다음 책을 미리 연다
+
+	if (self->scroll_load_idle == 0 && scroll_needs_load(self))
+		self->scroll_load_idle = g_idle_add(cb_scroll_load_idle, self);
+}
+
+// 쪽 하나를 스레드에서 읽거나 풀기 시작, 파일을 읽기 시작했으면 true
+static bool scroll_load_page(ReadWindow* self, int page)
+{
+	PageData* data = self->cache_pages[page];
+	if (data == NULL)
+	{
+		// 크기는 읽고 나서 센다
+		if ((data = book_new_page(self->book, page)) == NULL)
+			return false;
+		self->cache_pages[page] = data;
+		g_queue_push_tail(self->cache_queue, GINT_TO_POINTER(page));
+	}
+
+	if (data->loaded || data->async_loading || data->refine_cancel != NULL)
+		return false;
+
+	if (data->unread)
+	{
+		// 파일 읽기도 스레드에서
+		refine_unread_page(self, data);
+		return true;
+	}
+
+	if (data->buffer == NULL || data->info.has_anim || tiled_image_wanted(&data->info))
+	{
+		// 못 푸는 쪽, 애니메이션, 타일 쪽은 원래대로
+		read_page(self, data);
+	}
+	else
+	{
+		// 그림은 스레드에서 풀고 다 풀리면 다시 그린다
+		refine_page(data);
+	}
+	return false;
+}
+
+// 풀어 둘 쪽 가운데 하나를 읽고, 한 번에 읽을 만큼 읽었으면 true
+static bool scroll_load_step(ReadWindow* self, int page, int* reads)
+{
+	if (page < self->scroll_want[0] || page > self->scroll_want[1])
+		return false;
+	if (scroll_load_page(self, page))
+		(*reads)++;
+	return *reads >= SCROLL_READ_PER_IDLE;
+}
+
+// 보이는 쪽부터, 그 다음은 가는 쪽을 먼저 한 쪽씩 번갈아 읽는다
+// 읽기와 풀기는 스레드에서 하지만 한 번에 몇 쪽씩만 시작해서 보이는 쪽이 먼저 끝나게 한다
+static gboolean cb_scroll_load_idle(gpointer user_data)
+{
+	ReadWindow* self = user_data;
+	if (self->book == NULL || self->scroll_slots == NULL)
+	{
+		self->scroll_load_idle = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	scroll_update(self);
+
+	int reads = 0;
+	const int first = self->scroll_visible[0];
+	const int last = self->scroll_visible[1];
+	for (int i = first; i <= last; i++)
+	{
+		if (scroll_load_step(self, i, &reads))
+			return G_SOURCE_CONTINUE;
+	}
+	const bool up = self->scroll_dir < 0;
+	for (int d = 1; d <= SCROLL_AHEAD_MAX + 1; d++)
+	{
+		if (scroll_load_step(self, up ? first - d : last + d, &reads) ||
+			scroll_load_step(self, up ? last + d : first - d, &reads))
+			return G_SOURCE_CONTINUE;
+	}
+
+	self->pages[0] = self->cache_pages[first];
+	update_book_info(self);
+	gtk_widget_queue_draw(self->draw);
+	self->scroll_load_idle = 0;
+	return G_SOURCE_REMOVE;
+}
+
+// 화면이 바뀔 때마다 목표로 조금씩 굴린다
+static gboolean cb_scroll_tick(GtkWidget* widget, GdkFrameClock* clock, gpointer user_data)
+{
+	ReadWindow* self = user_data;
+	if (self->book == NULL || self->scroll_slots == NULL)
+	{
+		self->scroll_tick = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	const gint64 now = gdk_frame_clock_get_frame_time(clock);
+	const double dt = self->scroll_frame_time > 0 ? (double)(now - self->scroll_frame_time) / G_USEC_PER_SEC : 1.0 / 60.0;
+	self->scroll_frame_time = now;
+
+	const double prev = self->scroll_pos;
+	const double diff = self->scroll_target - self->scroll_pos;
+	const bool done = ABS(diff) < 0.5;
+	self->scroll_pos = done ? self->scroll_target : self->scroll_pos + diff * MIN(1.0, dt * SCROLL_EASE);
+	if (self->scroll_pos != prev)
+		self->scroll_dir = self->scroll_pos > prev ? 1 : -1;
+
+	// 빠르기는 반씩 따라가게 해서 미리 풀 범위가 튀지 않게
+	if (dt > 0.0)
+		self->scroll_velocity = (self->scroll_velocity + (self->scroll_pos - prev) / dt) / 2.0;
+	if (done)
+		self->scroll_velocity = 0.0;
+
+	scroll_update(self);
+	gtk_widget_queue_draw(self->draw);
+
+	if (!done)
+		return G_SOURCE_CONTINUE;
+	self->scroll_tick = 0;
+	self->scroll_frame_time = 0;
+	return G_SOURCE_REMOVE;
+}
+
+// 쭉 보기를 dy만큼 부드럽게 굴린다, 끝에 닿아서 못 굴리면 false
+static bool scroll_book_by(ReadWindow* self, double dy)
+{
+	if (self->scroll_slots == NULL)
+		return false;
+
+	const double max_pos = scroll_max_pos(self, gtk_widget_get_height(self->draw));
+	if ((dy > 0 && self->scroll_target >= max_pos) || (dy < 0 && self->scroll_target <= 0.0))
+		return false;
+
+	self->scroll_target = CLAMP(self->scroll_target + dy, 0.0, max_pos);
+	if (self->scroll_tick == 0)
+	{
+		self->scroll_frame_time = 0;
+		self->scroll_tick = gtk_widget_add_tick_callback(self->draw, cb_scroll_tick, self, NULL);
+	}
+	return true;
 }
 
-// 쪽 준비 (여기서 캐시 처리)
-static PageData* try_page_read_or_cache_data(ReadWindow* self, const int page)
+// 쪽 크기를 알아보는 동안 가끔 다시 그려서 띠를 다시 짜게 한다
+static gboolean cb_scroll_probe_timeout(gpointer user_data)
 {
-	PageData* data = self->cache_pages[page];
+	ReadWindow* self = user_data;
+	if (self->book == NULL || self->scroll_slots == NULL)
+	{
+		self->scroll_probe_timer = 0;
+		return G_SOURCE_REMOVE;
+	}
 
-	if (data != NULL)
-		return data; // 캐시에 있으면 그냥 반환
+	// 다 알아봤는지 먼저 봐야 마지막으로 알아낸 것까지 센다
+	const bool probing = g_atomic_int_get(&self->book->probing);
+	if (g_atomic_int_get(&self->book->probed) != self->scroll_probed)
+		gtk_widget_queue_draw(self->draw);
+	if (probing)
+		return G_SOURCE_CONTINUE;
+	self->scroll_probe_timer = 0;
+	return G_SOURCE_REMOVE;
+}
 
-	data = book_prepare_page(self->book, page);
+// 쭉 보기로 쪽 준비, 다른 곳에서 쪽을 옮겼으면 그 쪽 맨 위로 간다
+static void scroll_prepare(ReadWindow* self)
+{
+	Book* book = self->book;
+	book_probe_sizes(book, book->cur_page);
+	if (self->scroll_probe_timer == 0 && g_atomic_int_get(&book->probing))
+		self->scroll_probe_timer = g_timeout_add(SCROLL_PROBE_INTERVAL, cb_scroll_probe_timeout, self);
 
-	size_t dest_size = self->cache_size + data->info.size;
-	const size_t actual_size = config_get_actual_max_page_cache();
-	if (dest_size > actual_size)
+	scroll_relayout(self, gtk_widget_get_width(self->draw));
+	if (self->scroll_slots == NULL)
+		return; // 아직 창 크기를 모른다, 그릴 때 짠다
+
+	if (scroll_page_at(self, self->scroll_pos) != book->cur_page)
 	{
-		// 캐시가 너무 커지면 오래된 페이지를 제거
-		while (dest_size > actual_size && !g_queue_is_empty(self->cache_queue))
+		if (self->scroll_tick)
 		{
-			const int index = GPOINTER_TO_INT(g_queue_pop_head(self->cache_queue));
-			PageData* item = self->cache_pages[index];
-			if (item != NULL)
-			{
-				dest_size -= item->info.size;
-
-				if (item->anim_timer)
-				{
-					g_source_remove(item->anim_timer);
-					item->anim_timer = 0;
-				}
-
-				// 비동기 로딩이 진행 중인 경우 플래그 해제
-				item->async_loading = false;
-
-				page_data_free(item); // 페이지 데이터 해제
-				self->cache_pages[index] = NULL; // 캐시에서 제거
-			}
+			gtk_widget_remove_tick_callback(self->draw, self->scroll_tick);
+			self->scroll_tick = 0;
 		}
-
-		self->cache_size = dest_size; // 현재 캐시 크기 갱신
+		self->scroll_pos = self->scroll_target = self->scroll_slots[book->cur_page].top;
+		self->scroll_velocity = 0.0;
 	}
+	scroll_update(self);
+}
 
-	// 혹시나 페이지가 너무 커서 캐시가 넘쳤더라도 지금 만든건 못지운다
-	self->cache_pages[page] = data; // 캐시에 넣음
-	g_queue_push_tail(self->cache_queue, GINT_TO_POINTER(page)); // 캐시 큐에 넣음
-	self->cache_size = dest_size;
-
-	return data;
+// 쭉 보기 그만 (띠, 틱, 대기 정리), 다시 들어오면 지금 쪽부터 새로 짠다
+static void scroll_leave(ReadWindow* self)
+{
+	if (self->scroll_tick)
+	{
+		gtk_widget_remove_tick_callback(self->draw, self->scroll_tick);
+		self->scroll_tick = 0;
+	}
+	if (self->scroll_load_idle)
+	{
+		g_source_remove(self->scroll_load_idle);
+		self->scroll_load_idle = 0;
+	}
+	if (self->scroll_probe_timer)
+	{
+		g_source_remove(self->scroll_probe_timer);
+		self->scroll_probe_timer = 0;
+	}
+	g_clear_pointer(&self->scroll_slots, g_free);
+	self->scroll_velocity = 0.0;
+	self->scroll_frame_time = 0;
+	self->scroll_dir = 1;
+	self->scroll_swept = false;
 }
+#pragma endregion
 
 // 쪽 준비
 static void prepare_pages(ReadWindow* self)
@@ -721,11 +2556,15 @@ static void prepare_pages(ReadWindow* self)
 	if (self->book == NULL)
 		return; // 책이 없으면 그냥 나감
 
+	PageData* prev[2] = { self->pages[0], self->pages[1] };
 	clear_page(self);
 
 	const int cur = self->book->cur_page;
 
-	const ViewMode mode = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
+	const ViewMode mode = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
+	if (mode != VIEW_MODE_SCROLL)
+		scroll_leave(self);
+
 	switch (mode) // NOLINT(clang-diagnostic-switch-enum)
 	{
 		case VIEW_MODE_FIT:
@@ -740,22 +2579,28 @@ static void prepare_pages(ReadWindow* self)
 			PageData* l = self->pages[0] = try_page_read_or_cache_data(self, cur);
 			read_page(self, l);
 
-			if (l->info.has_anim || l->info.width > l->info.height ||
-				self->cache_size >= config_get_actual_max_page_cache())
+			if (l->entry->spread || l->info.has_anim || l->info.width > l->info.height || l->tiled ||
+				self->cache_size >= page_cache_budget())
 			{
-				// 애니메이션이 있거나 폭이 넓으면 1쪽만
+				// 펼침 쪽(ComicInfo)이거나 애니메이션이 있거나 폭이 넓으면 1쪽만
 				// 그리고 캐시가 넘쳐도 1쪽만
 				self->view_pages = 1;
 			}
 			else
 			{
 				const int next = cur + 1;
-				if (next < self->book->total_page)
+				const PageEntry* next_entry = book_get_entry(self->book, next);
+				if (next_entry != NULL && next_entry->spread)
+				{
+					// 다음 쪽이 펼침 쪽이면 그림을 읽어 보지 않고 1쪽만
+					self->view_pages = 1;
+				}
+				else if (next < self->book->total_page)
 				{
 					PageData* r = try_page_read_or_cache_data(self, next);
-					if (r->info.has_anim || r->info.width > r->info.height)
+					if (r->info.has_anim || r->info.width > r->info.height || tiled_image_wanted(&r->info))
 					{
-						// 다른쪽이 애니메이션이거나 폭이 넓으면 1쪽만
+						// 다른쪽이 애니메이션이거나 폭이 넓거나 아주 길면 1쪽만
 						self->view_pages = 1;
 					}
 					else
@@ -769,10 +2614,363 @@ static void prepare_pages(ReadWindow* self)
 			break;
 		}
 
+		case VIEW_MODE_SCROLL:
+			// 쭉 보기는 띠에서 보이는 쪽만 읽고, 그림은 스레드에서 푼다
+			self->view_pages = 1;
+			scroll_prepare(self);
+			break;
+
 		default:
 			g_assert_not_reached(); // 잘못된 모드
 	}
+
+	// 다른 쪽으로 가면 긴 쪽은 맨 위부터
+	if (self->pages[0] != prev[0])
+		self->tiled_scroll = 0.0;
+
+	// 빨리 넘기면 지나간 쪽을 푸느라 지금 쪽이 밀리지 않게
+	// 쭉 보기는 범위를 벗어난 쪽을 scroll_update에서 버리므로 prev가 이미 없을 수 있다
+	for (int i = 0; mode != VIEW_MODE_SCROLL && i < 2; i++)
+	{
+		if (prev[i] != self->pages[0] && prev[i] != self->pages[1])
+			cancel_refine(prev[i]);
+	}
+
+	prefetch_next_book(self);
+}
+
+#pragma region 쉬는 동안 캐시 줄이기
+// 다시 풀 쪽들, 작업 스레드는 buffers만 읽고 textures만 쓴다
+typedef struct Rehydrate
+{
+	GArray* pages; // 쪽 번호 (int)
+	GPtrArray* buffers; // 압축된 그림 (GBytes*)
+	GArray* infos; // 그림 정보 (ImageInfo)
+	GPtrArray* textures; // 푼 그림 (GdkTexture*, 실패하면 NULL)
+} Rehydrate;
+
+// 다시 풀 쪽들 해제
+static void rehydrate_free(Rehydrate* rh)
+{
+	g_array_unref(rh->pages);
+	g_ptr_array_unref(rh->buffers);
+	g_array_unref(rh->infos);
+	for (guint i = 0; i < rh->textures->len; i++)
+	{
+		GdkTexture* texture = g_ptr_array_index(rh->textures, i);
+		if (texture != NULL)
+			g_object_unref(texture);
+	}
+	g_ptr_array_unref(rh->textures);
+	g_free(rh);
+}
+
+// 쉬는 동안 다시 읽을 쪽들, 작업 스레드는 book에서 buffers만 채운다
+typedef struct TrimRead
+{
+	Book* book; // 책 (참조)
+	GArray* pages; // 쪽 번호 (int)
+	GPtrArray* items; // 읽기 시작할 때의 쪽 자료 (PageData*, 비교만 함)
+	GPtrArray* buffers; // 읽은 압축 자료 (GBytes*, 실패하면 NULL)
+} TrimRead;
+
+// 다시 읽을 쪽들 해제
+static void trim_read_free(TrimRead* tr)
+{
+	book_dispose(tr->book);
+	g_array_unref(tr->pages);
+	g_ptr_array_unref(tr->items);
+	for (guint i = 0; i < tr->buffers->len; i++)
+	{
+		GBytes* buffer = g_ptr_array_index(tr->buffers, i);
+		if (buffer != NULL)
+			g_bytes_unref(buffer);
+	}
+	g_ptr_array_unref(tr->buffers);
+	g_free(tr);
+}
+
+// 쉬는 동안 앞뒤 쪽 다시 읽기 그만, 아직 안 바꾼 쪽은 푼 그림을 그대로 갖고 있다
+static void cancel_trim_read(ReadWindow* self)
+{
+	if (self->trim_cancel)
+	{
+		g_cancellable_cancel(self->trim_cancel);
+		g_clear_object(&self->trim_cancel);
+	}
+}
+
+// 쉬는 동안 캐시 줄이기 그만 (타이머, 다시 읽기, 다시 풀기 취소)
+static void cancel_idle_trim(ReadWindow* self)
+{
+	if (self->idle_timer)
+	{
+		g_source_remove(self->idle_timer);
+		self->idle_timer = 0;
+	}
+	cancel_trim_read(self);
+	if (self->rehydrate_cancel)
+	{
+		g_cancellable_cancel(self->rehydrate_cancel);
+		g_clear_object(&self->rehydrate_cancel);
+	}
+	self->idle_trimmed = false;
+}
+
+// 작업 스레드에서 앞뒤 쪽의 압축된 자료를 읽는다
+static void thread_trim_read(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	TrimRead* tr = task_data;
+	for (guint i = 0; i < tr->pages->len && !g_cancellable_is_cancelled(cancellable); i++)
+		g_ptr_array_add(tr->buffers, book_read_data(tr->book, g_array_index(tr->pages, int, i)));
+	g_task_return_boolean(task, true);
+}
+
+// 앞뒤 쪽을 읽었으면 푼 그림을 버리고 압축된 자료로 바꾼다, 그 사이에 바뀐 쪽은 건너뛴다
+static void cb_trim_read_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	GTask* task = G_TASK(res);
+	if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+		return; // 돌아왔거나 창이 없어졌다
+	ReadWindow* self = user_data;
+	g_clear_object(&self->trim_cancel);
+
+	const TrimRead* tr = g_task_get_task_data(task);
+	if (tr->book != self->book || self->cache_pages == NULL)
+		return;
+
+	const size_t before = self->cache_size;
+	for (guint i = 0; i < tr->buffers->len; i++)
+	{
+		const int index = g_array_index(tr->pages, int, i);
+		PageData* item = self->cache_pages[index];
+		if (item == NULL || item != g_ptr_array_index(tr->items, i) ||
+			!item->loaded || item->buffer != NULL || is_page_visible(self, item))
+			continue;
+
+		GBytes* buffer = g_ptr_array_index(tr->buffers, i);
+		if (buffer == NULL)
+		{
+			self->cache_size -= item->info.size;
+			page_data_free(item);
+			self->cache_pages[index] = NULL;
+			g_queue_remove(self->cache_queue, GINT_TO_POINTER(index));
+			continue;
+		}
+
+		// 크기는 풀었을 때로 계속 센다, 돌아오면 다시 풀 것이므로
+		g_clear_object(&item->texture);
+		item->buffer = g_bytes_ref(buffer);
+		item->loaded = false;
+	}
+
+	bufpool_clear();
+	doumi_trim_memory();
+	g_log("BOOK", G_LOG_LEVEL_DEBUG, "idle trim near pages: %zu -> %zu bytes", before, self->cache_size);
+}
+
+// 보이는 쪽 말고는 풀어둔 그림을 버린다
+// 지금 쪽 앞뒤는 압축된 자료를 작업 스레드에서 다시 읽어 두어서 돌아왔을 때 파일을 읽지 않고 풀기만 하면 되게 한다
+static void trim_idle_pages(ReadWindow* self)
+{
+	if (self->idle_trimmed)
+		return;
+	self->idle_trimmed = true;
+	cancel_trim_read(self);
+	if (self->rehydrate_cancel)
+	{
+		g_cancellable_cancel(self->rehydrate_cancel);
+		g_clear_object(&self->rehydrate_cancel);
+	}
+	TrimRead* tr = NULL;
+
+	const size_t before = self->cache_size + self->warm_size;
+	evict_warm_pages(self, 0, 0); // 닫은 책은 책 핸들만 남긴다
+
+	if (self->book != NULL && self->cache_pages != NULL)
+	{
+		tr = g_new(TrimRead, 1);
+		tr->book = book_ref(self->book);
+		tr->pages = g_array_new(false, false, sizeof(int));
+		tr->items = g_ptr_array_new();
+		tr->buffers = g_ptr_array_new();
+
+		const int cur = self->book->cur_page;
+		GQueue* keep = g_queue_new();
+		while (!g_queue_is_empty(self->cache_queue))
+		{
+			const int index = GPOINTER_TO_INT(g_queue_pop_head(self->cache_queue));
+			PageData* item = self->cache_pages[index];
+			if (item == NULL)
+				continue;
+
+			if (item->tiled != NULL)
+			{
+				// 타일 쪽은 타일만 버린다, 보이는 쪽은 다시 그릴 때 보이는 것만 다시 푼다
+				if (!is_page_visible(self, item))
+				{
+					tiled_image_trim(item->tiled);
+					self->cache_size -= item->info.size;
+					item->info.size = 0;
+				}
+				g_queue_push_tail(keep, GINT_TO_POINTER(index));
+				continue;
+			}
+
+			if (is_page_visible(self, item) ||
+				item->info.has_anim || item->async_loading || !item->loaded)
+			{
+				// 보이는 쪽, 애니메이션, 아직 안 푼 쪽은 그대로
+				g_queue_push_tail(keep, GINT_TO_POINTER(index));
+				continue;
+			}
+
+			if (ABS(index - cur) <= IDLE_KEEP_NEAR)
+			{
+				// 앞뒤 쪽은 압축된 자료를 읽어 온 다음에 그림을 버린다
+				g_array_append_val(tr->pages, index);
+				g_ptr_array_add(tr->items, item);
+				g_queue_push_tail(keep, GINT_TO_POINTER(index));
+				continue;
+			}
+
+			self->cache_size -= item->info.size;
+			page_data_free(item);
+			self->cache_pages[index] = NULL;
+		}
+		g_queue_free(self->cache_queue);
+		self->cache_queue = keep;
+	}
+
+	if (tr != NULL && tr->pages->len > 0)
+	{
+		self->trim_cancel = g_cancellable_new();
+		GTask* task = g_task_new(NULL, self->trim_cancel, cb_trim_read_finish, self);
+		g_task_set_task_data(task, tr, (GDestroyNotify)trim_read_free);
+		g_task_set_priority(task, G_PRIORITY_LOW);
+		g_task_run_in_thread(task, thread_trim_read);
+		g_object_unref(task);
+	}
+	else if (tr != NULL)
+		trim_read_free(tr);
+
+	bufpool_clear();
+	doumi_trim_memory();
+	g_log("BOOK", G_LOG_LEVEL_DEBUG, "idle trim: %zu -> %zu bytes", before, self->cache_size + self->warm_size);
+}
+
+// 비활성 타이머
+static gboolean cb_idle_trim_timeout(gpointer data)
+{
+	ReadWindow* self = data;
+	self->idle_timer = 0;
+	trim_idle_pages(self);
+	return G_SOURCE_REMOVE;
+}
+
+// 작업 스레드에서 압축된 쪽을 푼다
+static void thread_rehydrate(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	Rehydrate* rh = task_data;
+	const DecodeParams params = { .cancellable = cancellable };
+	for (guint i = 0; i < rh->buffers->len; i++)
+	{
+		if (g_cancellable_is_cancelled(cancellable))
+			break;
+		GdkTexture* texture = decoder_decode(
+			g_ptr_array_index(rh->buffers, i), &g_array_index(rh->infos, ImageInfo, i), &params, NULL);
+		g_ptr_array_add(rh->textures, texture);
+	}
+	g_task_return_boolean(task, true);
+}
+
+// 다시 푼 쪽을 캐시에 넣는다, 그 사이에 바뀐 쪽은 건너뛴다
+static void cb_rehydrate_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	ReadWindow* self = user_data;
+	GTask* task = G_TASK(res);
+	if (g_task_had_error(task) || g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+		return;
+	g_clear_object(&self->rehydrate_cancel);
+
+	const Rehydrate* rh = g_task_get_task_data(task);
+	for (guint i = 0; i < rh->textures->len; i++)
+	{
+		GdkTexture* texture = g_ptr_array_index(rh->textures, i);
+		PageData* data = self->cache_pages[g_array_index(rh->pages, int, i)];
+		if (texture == NULL || data == NULL || data->loaded || data->buffer != g_ptr_array_index(rh->buffers, i))
+			continue;
+		g_clear_pointer(&data->buffer, g_bytes_unref);
+		g_set_object(&data->texture, texture); // 미리보기가 남아 있을 수 있다
+		data->loaded = true;
+	}
+}
+
+// 돌아왔을 때, 보이는 쪽은 그대로 있으니 앞뒤 쪽만 뒤에서 다시 푼다
+static void rehydrate_pages(ReadWindow* self)
+{
+	if (!self->idle_trimmed)
+		return;
+	self->idle_trimmed = false;
+	if (self->book == NULL || self->cache_pages == NULL || self->rehydrate_cancel != NULL)
+		return;
+
+	Rehydrate* rh = g_new(Rehydrate, 1);
+	rh->pages = g_array_new(false, false, sizeof(int));
+	rh->buffers = g_ptr_array_new_with_free_func((GDestroyNotify)g_bytes_unref);
+	rh->textures = g_ptr_array_new();
+	rh->infos = g_array_new(false, false, sizeof(ImageInfo));
+
+	// 지금 쪽에서 가까운 것부터
+	const int cur = self->book->cur_page;
+	for (int d = 0; d <= IDLE_KEEP_NEAR * 2; d++)
+	{
+		const int index = cur + (d % 2 == 0 ? d / 2 : -(d + 1) / 2);
+		if (index < 0 || index >= self->book->total_page)
+			continue;
+		const PageData* data = self->cache_pages[index];
+		if (data == NULL || data->loaded || data->async_loading || data->buffer == NULL || data->info.has_anim)
+			continue;
+		g_array_append_val(rh->pages, index);
+		g_ptr_array_add(rh->buffers, g_bytes_ref(data->buffer));
+		g_array_append_val(rh->infos, data->info);
+	}
+
+	if (rh->pages->len == 0)
+	{
+		rehydrate_free(rh);
+		return;
+	}
+
+	self->rehydrate_cancel = g_cancellable_new();
+	GTask* task = g_task_new(NULL, self->rehydrate_cancel, cb_rehydrate_finish, self);
+	g_task_set_task_data(task, rh, (GDestroyNotify)rehydrate_free);
+	g_task_set_priority(task, G_PRIORITY_LOW);
+	g_task_run_in_thread(task, thread_rehydrate);
+	g_object_unref(task);
+}
+
+// 창이 비활성이 되면 타이머를 걸고, 돌아오면 타이머를 풀고 다시 푼다
+static void update_idle_trim(ReadWindow* self, bool active)
+{
+	if (active)
+	{
+		if (self->idle_timer)
+		{
+			g_source_remove(self->idle_timer);
+			self->idle_timer = 0;
+		}
+		cancel_trim_read(self); // 아직 안 바꾼 앞뒤 쪽은 그대로 쓴다
+		rehydrate_pages(self);
+		return;
+	}
+
+	const int minutes = CONFIG_GET_INT(CONFIG_GENERAL_IDLE_TRIM);
+	if (minutes <= 0 || self->idle_timer || self->idle_trimmed)
+		return;
+	self->idle_timer = g_timeout_add_seconds((guint)minutes * 60, cb_idle_trim_timeout, self);
 }
+#pragma endregion
 
 // 쪽 조정
 static void page_control(ReadWindow* self, BookControl c)
@@ -780,18 +2978,46 @@ static void page_control(ReadWindow* self, BookControl c)
 	Book* book = self->book;
 
 	if (book == NULL)
+	{
+		// 책이 없어도 대기열은 열 수 있다
+		if (c == BOOK_CTRL_QUEUE_NEXT && !open_queued_book(self))
+			notify(self, 0, _("Reading queue is empty"));
 		return;
+	}
 
 	switch (c) // NOLINT(clang-diagnostic-switch-enum)
 	{
 		case BOOK_CTRL_PREV:
+			if (self->scroll_slots != NULL)
+			{
+				// 쭉 보기는 쪽을 넘기지 않고 화면만큼 굴린다
+				scroll_book_by(self, -gtk_widget_get_height(self->draw) * SCROLL_PAGE_RATIO);
+				return;
+			}
+			// 긴 쪽은 맨 위까지 굴린 다음에 넘긴다
+			if (scroll_tiled_page(self, -gtk_widget_get_height(self->draw) * SCROLL_PAGE_RATIO))
+				return;
 			if (!book_move_prev(book, self->view_pages))
 				return;
 			break;
 
 		case BOOK_CTRL_NEXT:
+			if (self->scroll_slots != NULL)
+			{
+				// 끝까지 굴렸으면 대기열 다음 책으로
+				if (!scroll_book_by(self, gtk_widget_get_height(self->draw) * SCROLL_PAGE_RATIO))
+					open_queued_book(self);
+				return;
+			}
+			// 긴 쪽은 맨 아래까지 굴린 다음에 넘긴다
+			if (scroll_tiled_page(self, gtk_widget_get_height(self->draw) * SCROLL_PAGE_RATIO))
+				return;
 			if (!book_move_next(book, self->view_pages))
+			{
+				// 마지막 쪽이면 대기열 다음 책으로
+				open_queued_book(self);
 				return;
+			}
 			break;
 
 		case BOOK_CTRL_FIRST:
@@ -835,6 +3061,8 @@ static void page_control(ReadWindow* self, BookControl c)
 
 		case BOOK_CTRL_SCAN_NEXT:
 		{
+			if (attach_next_ready(self))
+				break;
 			char* next = nears_find_next(book->full_name, book->dir_name, book->func.ext_compare);
 			if (next == NULL)
 				notify(self, 0, _("No next book found"));
@@ -863,6 +3091,11 @@ static void page_control(ReadWindow* self, BookControl c)
 			break;
 		}
 
+		case BOOK_CTRL_QUEUE_NEXT:
+			if (!open_queued_book(self))
+				notify(self, 0, _("Reading queue is empty"));
+			break;
+
 		case BOOK_CTRL_SELECT:
 			page_dialog_show_async(self->page_dialog, self->book->cur_page);
 			break;
@@ -895,6 +3128,42 @@ void cb_page_dialog(gpointer sender, int page)
 // 윈도우 종료되고 나서 콜백
 static void signal_destroy(GtkWidget* widget, ReadWindow* self)
 {
+	config_remove_notify(self->config_notify);
+	if (self->resume_cancel)
+	{
+		g_cancellable_cancel(self->resume_cancel);
+		g_object_unref(self->resume_cancel);
+	}
+	if (self->resume_texture)
+		g_object_unref(self->resume_texture);
+	library_set_notify(NULL, NULL);
+	if (self->recent_idle)
+		g_source_remove(self->recent_idle);
+	if (self->recent_cancel)
+	{
+		g_cancellable_cancel(self->recent_cancel);
+		g_object_unref(self->recent_cancel);
+	}
+	cancel_recent_preload(self);
+	cancel_next_ready(self);
+	cancel_idle_trim(self);
+	if (self->scroll_load_idle)
+		g_source_remove(self->scroll_load_idle);
+	if (self->scroll_probe_timer)
+		g_source_remove(self->scroll_probe_timer);
+	g_free(self->scroll_slots);
+	self->scroll_slots = NULL;
+	g_hash_table_destroy(self->recent_covers);
+	if (self->queue_cancel)
+	{
+		g_cancellable_cancel(self->queue_cancel);
+		g_object_unref(self->queue_cancel);
+	}
+	if (self->queue_idle)
+		g_source_remove(self->queue_idle);
+	g_ptr_array_unref(self->queue_ready);
+	g_queue_free_full(self->read_queue, g_free);
+	clear_warm_books(self); // 끝날 때는 닫은 책으로 남기지 않는다
 	finalize_book(self);
 
 	// 페이지 다이얼로그 해제
@@ -925,11 +3194,24 @@ static gboolean signal_close_request(GtkWidget* widget, ReadWindow* self)
 		}
 	}
 #endif
+	// 이어 보기 화면 저장
+	save_resume(self);
+
 	if (self->page_dialog)
 		page_dialog_dispose(self->page_dialog);
 	return false;
 }
 
+// 쪽 선택 썸네일용, 캐시에 읽어둔 쪽이 있으면 그 텍스쳐를 씀
+static GdkTexture* cb_page_texture_lookup(gpointer user_data, int page)
+{
+	const ReadWindow* self = user_data;
+	if (self->book == NULL || self->cache_pages == NULL || page < 0 || page >= self->book->total_page)
+		return NULL;
+	const PageData* data = self->cache_pages[page];
+	return data != NULL && data->texture != NULL ? data->texture : NULL;
+}
+
 // 맵 콜백
 static void signal_map(GtkWidget* widget, ReadWindow* self)
 {
@@ -944,7 +3226,9 @@ static void signal_map(GtkWidget* widget, ReadWindow* self)
 			SetWindowPos(self->hwnd, NULL, x, y, 0, 0, SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
 	}
 #endif
+	doumi_startup_mark("window map");
 	self->page_dialog = page_dialog_new(GTK_WINDOW(self->window), cb_page_dialog, self);
+	page_dialog_set_texture_lookup(self->page_dialog, cb_page_texture_lookup, self);
 }
 
 // 윈도우 각종 알림 콜백
@@ -962,19 +3246,51 @@ static void signal_notify(GObject* object, GParamSpec* pspec, ReadWindow* self)
 			config_set_int(CONFIG_WINDOW_HEIGHT, height, true);
 		}
 	}
+	else if (g_strcmp0(name, "is-active") == 0)
+	{
+		// 다른 창으로 가면 잠시 뒤에 캐시를 줄인다
+		update_idle_trim(self, gtk_window_is_active(GTK_WINDOW(self->window)));
+	}
+#if GTK_CHECK_VERSION(4, 12, 0)
+	else if (g_strcmp0(name, "suspended") == 0)
+	{
+		// 최소화 되거나 가려지면 바로 줄인다
+		if (gtk_window_is_suspended(GTK_WINDOW(self->window)))
+			trim_idle_pages(self);
+		else
+			update_idle_trim(self, gtk_window_is_active(GTK_WINDOW(self->window)));
+	}
+#endif
 }
 
 // 파일 끌어 놓기
 static gboolean signal_file_drop(GtkDropTarget* target, const GValue* value, double x, double y, ReadWindow* self)
 {
-	// 참고로 G_TYPE_STRING로 다중 파일을 "text/uri-list"로 처리할 수 있으나 안함
+	// 여러 파일이나 디렉토리는 읽기 대기열로
+	if (G_VALUE_HOLDS(value, GDK_TYPE_FILE_LIST))
+	{
+		GSList* list = gdk_file_list_get_files(g_value_get_boxed(value));
+		const int count = (int)g_slist_length(list);
+		if (count > 0)
+		{
+			GFile** files = g_new(GFile*, count);
+			int i = 0;
+			for (const GSList* l = list; l; l = l->next)
+				files[i++] = l->data;
+			open_or_queue_files(self, files, count);
+			g_free(files);
+		}
+		g_slist_free(list); // 파일은 목록이 가지고 있다
+		return true;
+	}
+
 	if (!G_VALUE_HOLDS(value, G_TYPE_FILE))
 		return false;
 
 	GFile* file = g_value_get_object(value);
 	if (file)
 	{
-		open_book(self, file);
+		open_or_queue_files(self, &file, 1);
 		// !!! 절대로 g_value_get_object로 얻은 값은 해제하면 안된다 !!!
 		//g_object_unref(file);
 	}
@@ -985,6 +3301,15 @@ static gboolean signal_file_drop(GtkDropTarget* target, const GValue* value, dou
 // 마우스 휠
 static gboolean signal_wheel_scroll(GtkEventControllerScroll* controller, double dx, double dy, ReadWindow* self)
 {
+	// 쭉 보기는 쪽을 넘기지 않고 굴린다
+	if (self->scroll_slots != NULL)
+	{
+		scroll_book_by(self, dy * gtk_widget_get_height(self->draw) / 6.0);
+		return true;
+	}
+	// 긴 쪽은 끝까지 굴린 다음에 넘긴다
+	if (scroll_tiled_page(self, dy * gtk_widget_get_height(self->draw) / 6.0))
+		return true;
 	if (dy > 0)
 	{
 		page_control(self, BOOK_CTRL_NEXT);
@@ -1097,6 +3422,17 @@ static void menu_file_close_clicked(GtkButton* button, ReadWindow* self)
 	close_book(self);
 }
 
+// 서재에 더하기 누르기
+static void menu_file_library_clicked(GtkButton* button, ReadWindow* self)
+{
+	if (self->book == NULL)
+		return;
+	if (library_add_root(self->book->dir_name))
+		notify(self, 0, _("Folder added to library"));
+	else
+		notify(self, 0, _("Folder is already in library"));
+}
+
 // 설정 누르기
 static void menu_settings_click(GtkButton* button, ReadWindow* self)
 {
@@ -1119,13 +3455,15 @@ static void menu_view_zoom_toggled(GtkCheckButton* button, ReadWindow* self)
 // 보기 모드 누르기
 static void menu_view_mode_clicked(GtkButton* button, ReadWindow* self)
 {
-	const ViewMode cur = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
+	const ViewMode cur = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
 	const ViewMode mode =
 		cur == VIEW_MODE_FIT
 		? VIEW_MODE_LEFT_TO_RIGHT
 		: cur == VIEW_MODE_LEFT_TO_RIGHT
 		? VIEW_MODE_RIGHT_TO_LEFT
-		: /*cur == VIEW_MODE_RIGHT_TO_LEFT ? VIEW_MODE_FIT :*/ VIEW_MODE_FIT;
+		: cur == VIEW_MODE_RIGHT_TO_LEFT
+		? VIEW_MODE_SCROLL
+		: /*cur == VIEW_MODE_SCROLL ? VIEW_MODE_FIT :*/ VIEW_MODE_FIT;
 	update_view_mode(self, mode);
 }
 
@@ -1543,17 +3881,23 @@ static void shortcut_scan_book_random(ReadWindow* self)
 	page_control(self, BOOK_CTRL_SCAN_RANDOM);
 }
 
+// 단축키 - 읽기 대기열 다음 책으로
+static void shortcut_queue_next(ReadWindow* self)
+{
+	page_control(self, BOOK_CTRL_QUEUE_NEXT);
+}
+
 // 단축키 - 크게 보기
 static void shortcut_view_zoom_toggle(ReadWindow* self)
 {
-	const bool v = !config_get_bool(CONFIG_VIEW_ZOOM, true);
+	const bool v = !CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM);
 	update_view_zoom(self, v);
 }
 
 // 단축키 - 읽기 방향 왼쪽/오른쪽 전환
 static void shortcut_view_mode_left_right(ReadWindow* self)
 {
-	const ViewMode cur = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
+	const ViewMode cur = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
 	const ViewMode mode =
 		cur == VIEW_MODE_FIT
 		? VIEW_MODE_LEFT_TO_RIGHT
@@ -1604,7 +3948,7 @@ static void shortcut_view_align_toggle(ReadWindow* self)
 // 페이지 텍스쳐 1장 그리기
 static void paint_texture_fit(ReadWindow* self, GtkSnapshot* snapshot, int sw, int sh, GdkTexture* texture, int tw, int th)
 {
-	const bool zoom = config_get_bool(CONFIG_VIEW_ZOOM, true);
+	const bool zoom = CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM);
 	const BoundSize ns = bound_size_calc_dest(zoom, sw, sh, tw, th);
 	BoundRect rt = bound_rect_calc_rect(HORIZ_ALIGN_CENTER, sw, sh, ns.width, ns.height);
 
@@ -1612,13 +3956,13 @@ static void paint_texture_fit(ReadWindow* self, GtkSnapshot* snapshot, int sw, i
 	if (self->view_align == HORIZ_ALIGN_LEFT)
 	{
 		const int w = bound_rect_width(&rt);
-		rt.left = config_get_int(CONFIG_VIEW_MARGIN, true);
+		rt.left = CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
 		rt.right = rt.left + w;
 	}
 	else if (self->view_align == HORIZ_ALIGN_RIGHT)
 	{
 		const int w = bound_rect_width(&rt);
-		rt.right = sw - config_get_int(CONFIG_VIEW_MARGIN, true);
+		rt.right = sw - CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
 		rt.left = rt.right - w;
 	}
 
@@ -1633,7 +3977,7 @@ static void paint_texture_dual(
 	GdkTexture* right, int rtw, int rth)
 {
 	const int half = sw / 2;
-	const bool zoom = config_get_bool(CONFIG_VIEW_ZOOM, true);
+	const bool zoom = CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM);
 
 	// 왼쪽 페이지
 	const BoundSize ls = bound_size_calc_dest(zoom, half, sh, ltw, lth);
@@ -1649,7 +3993,7 @@ static void paint_texture_dual(
 	{
 		const int lw = bound_rect_width(&lb);
 		const int rw = bound_rect_width(&rb);
-		const int margin = config_get_int(CONFIG_VIEW_MARGIN, true);
+		const int margin = CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
 		if (self->view_align == HORIZ_ALIGN_LEFT)
 		{
 			// 왼쪽 페이지를 margin만큼 왼쪽에 붙임
@@ -1683,7 +4027,7 @@ static void paint_async_load_info(ReadWindow* self, GtkSnapshot* snapshot, int w
 
 	if (l != NULL && r != NULL)
 	{
-		const ViewMode mode = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
+		const ViewMode mode = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
 		if (mode == VIEW_MODE_RIGHT_TO_LEFT)
 		{
 			GdkTexture* tmp = l;
@@ -1741,6 +4085,28 @@ static void paint_async_load_info(ReadWindow* self, GtkSnapshot* snapshot, int w
 	}
 }
 
+// 타일 쪽 그리기, 보이는 줄만 풀게 알려준다
+static void paint_page_tiled(ReadWindow* self, GtkSnapshot* snapshot, PageData* page, int width, int height)
+{
+	const double scale = tiled_page_scale(page, width);
+	self->tiled_scroll = CLAMP(self->tiled_scroll, 0.0, tiled_page_max_scroll(page, width, height));
+
+	const double dw = page->info.width * scale;
+	const double dh = page->info.height * scale;
+	double x = (width - dw) / 2.0;
+	if (self->view_align == HORIZ_ALIGN_LEFT)
+		x = CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
+	else if (self->view_align == HORIZ_ALIGN_RIGHT)
+		x = width - CONFIG_GET_INT(CONFIG_VIEW_MARGIN) - dw;
+	const double y = dh < height ? (height - dh) / 2.0 : -self->tiled_scroll;
+
+	const int top = (int)(-y / scale);
+	const int bottom = (int)((height - y) / scale) + 1;
+	tiled_image_set_view(page->tiled, top, bottom, scale);
+	sync_tiled_size(self, page);
+	tiled_image_snapshot(page->tiled, snapshot, (float)x, (float)y, (float)scale, top, bottom);
+}
+
 // 텍스쳐를 화면에 맞게 그리기
 static void paint_page_fit(ReadWindow* self, GtkSnapshot* snapshot, const PageData* page, int width, int height)
 {
@@ -1759,19 +4125,78 @@ static void paint_page_dual(
 		right->texture, right->info.width, right->info.height);
 }
 
+// 쭉 보기 그리기, 띠에서 화면에 걸친 쪽만 그린다
+static void paint_scroll(ReadWindow* self, GtkSnapshot* snapshot, int width, int height)
+{
+	// 창 크기나 쪽 크기가 바뀌어 띠를 다시 짰으면 풀어 둘 쪽은 아이들에서 다시 정한다
+	if (scroll_relayout(self, width) && self->scroll_load_idle == 0)
+		self->scroll_load_idle = g_idle_add(cb_scroll_load_idle, self);
+	if (self->scroll_slots == NULL)
+		return;
+
+	const int total = self->book->total_page;
+	const double pos = CLAMP(self->scroll_pos, 0.0, scroll_max_pos(self, height));
+	const double length = self->scroll_slots[total].top;
+	const double base = length < height ? (height - length) / 2.0 : -pos; // 띠가 화면보다 짧으면 가운데
+	const int first = scroll_page_at(self, pos);
+	const int last = scroll_page_at(self, pos + MAX(height - 1, 0));
+	const int margin = CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
+
+	for (int i = first; i <= last; i++)
+	{
+		// 쪽 경계는 화면 픽셀에 맞춰서 이음새가 안 보이게
+		const double y = floor(base + self->scroll_slots[i].top + 0.5);
+		const double dh = floor(base + self->scroll_slots[i + 1].top + 0.5) - y;
+		const double dw = self->scroll_slots[i].width;
+		double x = floor((width - dw) / 2.0);
+		if (self->view_align == HORIZ_ALIGN_LEFT)
+			x = margin;
+		else if (self->view_align == HORIZ_ALIGN_RIGHT)
+			x = width - margin - dw;
+		const graphene_rect_t rect = GRAPHENE_RECT_INIT((float)x, (float)y, (float)dw, (float)dh);
+
+		PageData* data = self->cache_pages[i];
+		if (data != NULL && data->tiled != NULL)
+		{
+			const double scale = dw / data->info.width;
+			const int top = MAX(0, (int)(-y / scale));
+			const int bottom = MIN(data->info.height, (int)((height - y) / scale) + 1);
+			tiled_image_set_view(data->tiled, top, bottom, scale);
+			sync_tiled_size(self, data);
+			tiled_image_snapshot(data->tiled, snapshot, (float)x, (float)y, (float)scale, top, bottom);
+		}
+		else if (data != NULL && data->texture != NULL && !data->async_loading)
+			gtk_snapshot_append_texture(snapshot, data->texture, &rect);
+		else
+		{
+			// 아직 안 풀린 쪽은 자리만
+			const GdkRGBA blank = { 0.16f, 0.16f, 0.16f, 1.0f };
+			gtk_snapshot_append_color(snapshot, &blank, &rect);
+		}
+	}
+}
+
 // 책 그리기
 static void paint_book(ReadWindow* self, GtkSnapshot* snapshot, int width, int height)
 {
 	if (self->book == NULL)
 		return;
 
+	if ((ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE) == VIEW_MODE_SCROLL)
+	{
+		paint_scroll(self, snapshot, width, height);
+		return;
+	}
+
 	if (self->view_pages == 1)
 	{
 		// 한장만 그리기
-		const PageData* data = self->pages[0] ? self->pages[0] : self->pages[1];
+		PageData* data = self->pages[0] ? self->pages[0] : self->pages[1];
 		if (data != NULL)
 		{
-			if (data->async_loading)
+			if (data->tiled)
+				paint_page_tiled(self, snapshot, data, width, height);
+			else if (data->async_loading)
 				paint_async_load_info(self, snapshot, width, height);
 			else
 				paint_page_fit(self, snapshot, data, width, height);
@@ -1779,7 +4204,7 @@ static void paint_book(ReadWindow* self, GtkSnapshot* snapshot, int width, int h
 	}
 	else if (self->view_pages == 2)
 	{
-		ViewMode mode = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
+		ViewMode mode = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
 		if (mode != VIEW_MODE_LEFT_TO_RIGHT && mode != VIEW_MODE_RIGHT_TO_LEFT)
 		{
 			// 뭐라고? 두장 그려야 하는데 모드가 왼쪽에서 오른쪽도 아니고 오른쪽에서 왼쪽도 아니라고?
@@ -1915,11 +4340,31 @@ static void read_draw_snapshot(GtkWidget* widget, GtkSnapshot* snapshot)
 		gtk_snapshot_append_texture(snapshot, logo, &GRAPHENE_RECT_INIT(x, y, lw, lh));
 	}
 
+	// 이어 보기 화면, 책이 열리면 없어진다
+	if (self->resume_texture)
+	{
+		const int tw = gdk_texture_get_width(self->resume_texture);
+		const int th = gdk_texture_get_height(self->resume_texture);
+		const BoundSize ns = bound_size_calc_dest(true, width, height, tw, th);
+		const BoundRect rt = bound_rect_calc_rect(HORIZ_ALIGN_CENTER, width, height, ns.width, ns.height);
+		gtk_snapshot_append_scaled_texture(snapshot, self->resume_texture, GSK_SCALING_FILTER_LINEAR, &BOUND_RECT_TO_GRAPHENE_RECT(&rt));
+	}
+
 	// 책 그리기
 	paint_book(self, snapshot, width, height);
 
 	// 알림 메시지 그리기
 	paint_notify(self, snapshot, width, height);
+
+	// 시작 시간 측정
+	static bool s_first_frame = false;
+	if (!s_first_frame)
+	{
+		s_first_frame = true;
+		doumi_startup_mark("first frame");
+	}
+	if (self->book != NULL && self->pages[0] != NULL && !self->pages[0]->async_loading)
+		doumi_startup_end("first page");
 }
 #pragma endregion
 
@@ -1929,12 +4374,13 @@ ReadWindow* read_window_new(GtkApplication* app)
 {
 	ReadWindow* self = g_new0(ReadWindow, 1);
 	s_read_window = self; // 전역 변수에 저장
+	self->warm_books = g_queue_new();
 
 	// 첨에 UI 설정할 때 중복 호출 방지
-	bool view_zoom = config_get_bool(CONFIG_VIEW_ZOOM, true);
-	ViewMode view_mode = (ViewMode)config_get_int(CONFIG_VIEW_MODE, true);
-	ViewQuality view_quality = (ViewQuality)config_get_int(CONFIG_VIEW_QUALITY, true);
-	int view_margin = config_get_int(CONFIG_VIEW_MARGIN, true);
+	bool view_zoom = CONFIG_GET_BOOL(CONFIG_VIEW_ZOOM);
+	ViewMode view_mode = (ViewMode)CONFIG_GET_INT(CONFIG_VIEW_MODE);
+	ViewQuality view_quality = (ViewQuality)CONFIG_GET_INT(CONFIG_VIEW_QUALITY);
+	int view_margin = CONFIG_GET_INT(CONFIG_VIEW_MARGIN);
 
 	const int width = config_get_int(CONFIG_WINDOW_WIDTH, true);
 	const int height = config_get_int(CONFIG_WINDOW_HEIGHT, true);
@@ -1972,6 +4418,12 @@ ReadWindow* read_window_new(GtkApplication* app)
 	g_signal_connect(self->menu_file_close, "clicked", G_CALLBACK(menu_file_close_clicked), self);
 	gtk_box_append(GTK_BOX(menu_box), self->menu_file_close);
 
+	// 메뉴 - 서재에 더하기
+	self->menu_file_library = gtk_button_new_with_label(_("Add folder to library"));
+	gtk_widget_set_sensitive(self->menu_file_library, false);
+	g_signal_connect(self->menu_file_library, "clicked", G_CALLBACK(menu_file_library_clicked), self);
+	gtk_box_append(GTK_BOX(menu_box), self->menu_file_library);
+
 	gtk_box_append(GTK_BOX(menu_box), gtk_separator_new(GTK_ORIENTATION_HORIZONTAL));
 
 	// 메뉴 - 설정
@@ -2011,6 +4463,7 @@ ReadWindow* read_window_new(GtkApplication* app)
 		_("Fit Window"),
 		_("Left to Right"),
 		_("Right to Left"),
+		_("Vertical Scroll"),
 	};
 	for (int i = 0; i < VIEW_MODE_MAX_VALUE; i++)
 	{
@@ -2151,18 +4604,75 @@ ReadWindow* read_window_new(GtkApplication* app)
 	gtk_widget_set_hexpand(self->draw, true);
 	gtk_widget_set_vexpand(self->draw, true);
 
+	// 최근 책 시작 화면, 그리기 위젯 위에 얹는다
+	self->recent_covers = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+	self->recent_flow = gtk_flow_box_new();
+	gtk_flow_box_set_selection_mode(GTK_FLOW_BOX(self->recent_flow), GTK_SELECTION_NONE);
+	gtk_flow_box_set_homogeneous(GTK_FLOW_BOX(self->recent_flow), true);
+	gtk_flow_box_set_max_children_per_line(GTK_FLOW_BOX(self->recent_flow), 8);
+	gtk_widget_set_can_focus(self->recent_flow, false);
+
+	GtkWidget* recent_scroll = gtk_scrolled_window_new();
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(recent_scroll), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_propagate_natural_height(GTK_SCROLLED_WINDOW(recent_scroll), true);
+	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(recent_scroll), self->recent_flow);
+	gtk_widget_set_vexpand(recent_scroll, true);
+
+	self->recent_label = gtk_label_new(_("Recent books"));
+	gtk_widget_set_halign(self->recent_label, GTK_ALIGN_START);
+
+	self->recent_search = gtk_search_entry_new();
+	gtk_search_entry_set_placeholder_text(GTK_SEARCH_ENTRY(self->recent_search), _("Search library"));
+	g_signal_connect(self->recent_search, "search-changed", G_CALLBACK(signal_recent_search_changed), self);
+
+	// 서재의 안 읽은 책
+	self->unread_flow = gtk_flow_box_new();
+	gtk_flow_box_set_selection_mode(GTK_FLOW_BOX(self->unread_flow), GTK_SELECTION_NONE);
+	gtk_flow_box_set_homogeneous(GTK_FLOW_BOX(self->unread_flow), true);
+	gtk_flow_box_set_max_children_per_line(GTK_FLOW_BOX(self->unread_flow), 8);
+	gtk_widget_set_can_focus(self->unread_flow, false);
+
+	GtkWidget* unread_scroll = gtk_scrolled_window_new();
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(unread_scroll), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_propagate_natural_height(GTK_SCROLLED_WINDOW(unread_scroll), true);
+	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(unread_scroll), self->unread_flow);
+	gtk_widget_set_vexpand(unread_scroll, true);
+
+	self->unread_label = gtk_label_new(_("Unread books"));
+	gtk_widget_set_halign(self->unread_label, GTK_ALIGN_START);
+
+	self->recent_view = gtk_box_new(GTK_ORIENTATION_VERTICAL, 8);
+	gtk_widget_set_halign(self->recent_view, GTK_ALIGN_CENTER);
+	gtk_widget_set_valign(self->recent_view, GTK_ALIGN_CENTER);
+	gtk_widget_set_margin_top(self->recent_view, 24);
+	gtk_widget_set_margin_bottom(self->recent_view, 24);
+	gtk_widget_set_margin_start(self->recent_view, 24);
+	gtk_widget_set_margin_end(self->recent_view, 24);
+	gtk_box_append(GTK_BOX(self->recent_view), self->recent_search);
+	gtk_box_append(GTK_BOX(self->recent_view), self->recent_label);
+	gtk_box_append(GTK_BOX(self->recent_view), recent_scroll);
+	gtk_box_append(GTK_BOX(self->recent_view), self->unread_label);
+	gtk_box_append(GTK_BOX(self->recent_view), unread_scroll);
+	gtk_widget_set_visible(self->recent_view, false);
+	library_set_notify(cb_library_changed, self);
+
+	GtkWidget* overlay = gtk_overlay_new();
+	gtk_overlay_set_child(GTK_OVERLAY(overlay), self->draw);
+	gtk_overlay_add_overlay(GTK_OVERLAY(overlay), self->recent_view);
+
 	// 메인 레이아웃
 	GtkWidget* main_box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
 	gtk_widget_set_can_focus(main_box, false);
-	gtk_box_append(GTK_BOX(main_box), self->draw);
+	gtk_box_append(GTK_BOX(main_box), overlay);
 	gtk_window_set_child(GTK_WINDOW(self->window), main_box);
 #pragma endregion
 
 #pragma region 컨트롤러
 	// 파일 끌어다 놓기
-	GtkDropTarget* drop = gtk_drop_target_new(G_TYPE_FILE, GDK_ACTION_COPY);
+	GtkDropTarget* drop = gtk_drop_target_new(G_TYPE_INVALID, GDK_ACTION_COPY);
+	gtk_drop_target_set_gtypes(drop, (GType[]) { GDK_TYPE_FILE_LIST, G_TYPE_FILE }, 2);
 	g_signal_connect(drop, "drop", G_CALLBACK(signal_file_drop), self);
-	gtk_widget_add_controller(self->draw, GTK_EVENT_CONTROLLER(drop));
+	gtk_widget_add_controller(overlay, GTK_EVENT_CONTROLLER(drop)); // 시작 화면 위에 놓아도 되게
 
 	// 마우스 휠
 	GtkEventController* wheel = gtk_event_controller_scroll_new(GTK_EVENT_CONTROLLER_SCROLL_VERTICAL);
@@ -2214,6 +4724,7 @@ ReadWindow* read_window_new(GtkApplication* app)
 		{"scan_book_prev", shortcut_scan_book_prev},
 		{"scan_book_next", shortcut_scan_book_next},
 		{"scan_book_random", shortcut_scan_book_random},
+		{"queue_next", shortcut_queue_next},
 		{"view_zoom_toggle", shortcut_view_zoom_toggle},
 		{"view_mode_left_right", shortcut_view_mode_left_right},
 		{"view_align_center", shortcut_view_align_center},
@@ -2231,6 +4742,17 @@ ReadWindow* read_window_new(GtkApplication* app)
 	shortcut_register();
 #pragma endregion
 
+	self->config_notify = config_add_notify(cb_config_changed, self);
+
+	// 지난번 책 이어 보기, 아니면 최근 책 시작 화면
+	start_resume(self);
+	queue_recent_view(self);
+
+	// 읽기 대기열, 저장한 것은 창을 띄운 뒤에 불러서 앞쪽 책을 미리 열어둔다
+	self->read_queue = g_queue_new();
+	self->queue_ready = g_ptr_array_new_with_free_func((GDestroyNotify)ready_book_free);
+	self->queue_idle = g_idle_add_full(G_PRIORITY_LOW, idle_load_read_queue, self, NULL);
+
 	// 초기화를 끝내면서
 	reset_focus(self);
 
@@ -2240,6 +4762,14 @@ ReadWindow* read_window_new(GtkApplication* app)
 // 창 보이기
 void read_window_show(const ReadWindow* self)
 {
-	gtk_widget_set_visible(self->window, true);
+	gtk_window_present(GTK_WINDOW(self->window));
+}
+
+// 밖에서 준 파일 열기 (명령줄, 두번째 실행), 여럿이면 나머지는 읽기 대기열로
+void read_window_open_files(ReadWindow* self, GFile** files, int n_files)
+{
+	g_return_if_fail(self != NULL && files != NULL);
+	if (n_files > 0)
+		open_or_queue_files(self, files, n_files);
 }
 #pragma endregion
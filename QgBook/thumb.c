@@ -0,0 +1,334 @@
+﻿#include "pch.h"
+#include "book.h"
+#include "doumi.h"
+#include "thumb.h"
+
+/**
+ * @file thumb.c
+ * @brief 쪽 썸네일을 스레드 풀에서 만드는 로더 구현 파일입니다.
+ *        책 읽기는 Book의 잠금으로 읽기 창과 나눠 쓰고, 결과는 메인 스레드에서 GtkPicture에 넣습니다.
+ *        책을 바꿀 때 하던 작업을 기다리지 않습니다. 작업이 책을 참조로 잡고 있다가 세대가 바뀐 걸 보면 그만둡니다.
+ *        만든 썸네일은 ThumbStore에 넣어 두고, 다음에 같은 책을 열면 거기서 꺼냅니다.
+ */
+
+#define THUMB_CACHE_MAX 256
+
+/**
+ * @brief 썸네일을 만들 책과 저장소
+ *        책을 바꿔도 이걸 잡은 작업이 끝날 때까지 살아 있습니다.
+ */
+typedef struct ThumbSource
+{
+	gatomicrefcount ref;       ///< 참조 수 (로더 + 작업)
+	Book* book;                ///< 책 (참조)
+	ThumbStore* store;         ///< 책의 디스크 썸네일 저장소
+} ThumbSource;
+
+/**
+ * @brief 썸네일 로더 구조체
+ */
+struct ThumbLoader
+{
+	gatomicrefcount ref;       ///< 참조 수 (요청이 하나씩 가짐)
+	int size;                  ///< 썸네일 긴 쪽 크기
+
+	GThreadPool* pool;         ///< 작업 스레드 풀
+
+	GMutex lock;               ///< source 보호
+	ThumbSource* source;       ///< 지금 책 (참조)
+	guint generation;          ///< 책을 바꿀 때마다 늘어남 (atomic)
+
+	GHashTable* cache;         ///< 쪽 번호 -> GdkTexture (메인 스레드 전용)
+	GQueue* cache_order;       ///< 캐시에 넣은 순서
+
+	ThumbLookupFunc lookup;    ///< 읽어둔 텍스쳐 찾기
+	gpointer lookup_data;      ///< 찾기 사용자 데이터
+
+	guint64 sequence;          ///< 요청 순서
+};
+
+/**
+ * @brief 썸네일 요청 구조체
+ */
+struct ThumbRequest
+{
+	gatomicrefcount ref;       ///< 참조 수 (요청한 쪽 + 작업)
+	ThumbLoader* loader;       ///< 로더 (참조)
+	int page;                  ///< 쪽 번호
+	guint generation;          ///< 요청할 때의 책 세대
+	guint64 sequence;          ///< 요청 순서 (클수록 먼저)
+	gint cancelled;            ///< 취소 여부 (atomic)
+	GtkPicture* picture;       ///< 결과를 넣을 곳 (참조)
+	GdkTexture* texture;       ///< 결과
+};
+
+/**
+ * @brief 책과 저장소 참조를 놓습니다. 마지막이면 저장소를 닫고 책도 놓습니다.
+ * @param source ThumbSource 포인터 (NULL이면 아무것도 안 함)
+ */
+static void thumb_source_unref(ThumbSource* source)
+{
+	if (source == NULL || !g_atomic_ref_count_dec(&source->ref))
+		return;
+	thumb_store_close(source->store);
+	book_dispose(source->book);
+	g_free(source);
+}
+
+/**
+ * @brief 로더 참조를 놓습니다. 마지막이면 해제합니다.
+ * @param loader ThumbLoader 포인터
+ */
+static void thumb_loader_unref(ThumbLoader* loader)
+{
+	if (!g_atomic_ref_count_dec(&loader->ref))
+		return;
+	g_hash_table_destroy(loader->cache);
+	g_queue_free(loader->cache_order);
+	g_mutex_clear(&loader->lock);
+	g_free(loader);
+}
+
+/**
+ * @brief 요청 참조를 놓습니다. 마지막이면 해제합니다. 위젯을 놓으므로 메인 스레드에서만 부를 것
+ * @param request ThumbRequest 포인터
+ */
+static void thumb_request_unref(ThumbRequest* request)
+{
+	if (!g_atomic_ref_count_dec(&request->ref))
+		return;
+	if (request->texture)
+		g_object_unref(request->texture);
+	g_object_unref(request->picture);
+	thumb_loader_unref(request->loader);
+	g_free(request);
+}
+
+/**
+ * @brief 캐시에 썸네일을 넣습니다. 넘치면 오래된 것부터 버립니다.
+ * @param loader ThumbLoader 포인터
+ * @param page 쪽 번호
+ * @param texture 썸네일 텍스쳐
+ */
+static void cache_put(ThumbLoader* loader, int page, GdkTexture* texture)
+{
+	if (g_hash_table_contains(loader->cache, GINT_TO_POINTER(page)))
+		return;
+	while (g_queue_get_length(loader->cache_order) >= THUMB_CACHE_MAX)
+		g_hash_table_remove(loader->cache, g_queue_pop_head(loader->cache_order));
+	g_hash_table_insert(loader->cache, GINT_TO_POINTER(page), g_object_ref(texture));
+	g_queue_push_tail(loader->cache_order, GINT_TO_POINTER(page));
+}
+
+/**
+ * @brief 캐시를 비웁니다.
+ * @param loader ThumbLoader 포인터
+ */
+static void cache_clear(ThumbLoader* loader)
+{
+	g_hash_table_remove_all(loader->cache);
+	g_queue_clear(loader->cache_order);
+}
+
+/**
+ * @brief 요청이 더 필요 없는지 확인합니다. 취소했거나 책이 바뀌었으면 필요 없음
+ * @param request ThumbRequest 포인터
+ * @return 필요 없으면 true
+ */
+static bool thumb_request_is_stale(ThumbRequest* request)
+{
+	return g_atomic_int_get(&request->cancelled) ||
+		request->generation != (guint)g_atomic_int_get(&request->loader->generation);
+}
+
+/**
+ * @brief 메인 스레드에서 결과를 넣고 요청을 해제합니다.
+ * @param data ThumbRequest 포인터
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean idle_thumb_deliver(gpointer data)
+{
+	ThumbRequest* request = data;
+	ThumbLoader* loader = request->loader;
+	if (request->texture != NULL && request->generation == loader->generation)
+	{
+		cache_put(loader, request->page, request->texture);
+		if (!g_atomic_int_get(&request->cancelled))
+			gtk_picture_set_paintable(request->picture, GDK_PAINTABLE(request->texture));
+	}
+	thumb_request_unref(request);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 스레드 풀 작업 함수. 쪽을 읽어서 줄여 만듭니다.
+ * @param data ThumbRequest 포인터
+ * @param user_data ThumbLoader 포인터
+ */
+static void thread_thumb_work(gpointer data, gpointer user_data)
+{
+	ThumbRequest* request = data;
+	ThumbLoader* loader = user_data;
+
+	ThumbSource* source = NULL;
+	if (!thumb_request_is_stale(request))
+	{
+		g_mutex_lock(&loader->lock);
+		if (loader->source != NULL && request->generation == loader->generation)
+		{
+			source = loader->source;
+			g_atomic_ref_count_inc(&source->ref);
+		}
+		g_mutex_unlock(&loader->lock);
+	}
+
+	if (source != NULL)
+	{
+		Book* book = source->book;
+		ThumbStore* store = source->store;
+		if (request->page >= 0 && request->page < (int)book->entries->len)
+		{
+			GBytes* stored = store ? thumb_store_lookup(store, request->page) : NULL;
+			if (stored != NULL)
+			{
+				request->texture = gdk_texture_new_from_bytes(stored, NULL);
+				g_bytes_unref(stored);
+			}
+
+			if (request->texture == NULL)
+			{
+				GBytes* bytes = book_read_data(book, request->page);
+				// 읽는 사이에 책이 바뀌었으면 줄이지 않음
+				if (bytes != NULL && !thumb_request_is_stale(request))
+				{
+					GBytes* encoded = NULL;
+					request->texture = doumi_load_thumbnail_texture(bytes, loader->size, store ? &encoded : NULL);
+					if (encoded != NULL)
+					{
+						thumb_store_put(store, request->page, encoded);
+						g_bytes_unref(encoded);
+					}
+				}
+				if (bytes != NULL)
+					g_bytes_unref(bytes);
+			}
+		}
+		// 책을 바꾼 뒤라면 여기서 옛 책이 해제될 수 있음
+		thumb_source_unref(source);
+	}
+
+	// 위젯 참조를 놓아야 하므로 해제는 메인 스레드에서
+	g_idle_add(idle_thumb_deliver, request);
+}
+
+/**
+ * @brief 요청 순서 비교 함수, 나중에 한 요청(지금 보이는 쪽)이 먼저
+ */
+static gint compare_thumb_request(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const ThumbRequest* ra = a;
+	const ThumbRequest* rb = b;
+	return ra->sequence < rb->sequence ? 1 : ra->sequence > rb->sequence ? -1 : 0;
+}
+
+// 썸네일 로더 만들기
+ThumbLoader* thumb_loader_new(int size)
+{
+	ThumbLoader* loader = g_new0(ThumbLoader, 1);
+	g_atomic_ref_count_init(&loader->ref);
+	loader->size = size;
+
+	g_mutex_init(&loader->lock);
+	loader->generation = 1;
+
+	loader->cache = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_object_unref);
+	loader->cache_order = g_queue_new();
+
+	const int threads = CLAMP((int)g_get_num_processors() - 1, 1, 4);
+	loader->pool = g_thread_pool_new(thread_thumb_work, loader, threads, false, NULL);
+	g_thread_pool_set_sort_function(loader->pool, compare_thumb_request, NULL);
+
+	return loader;
+}
+
+// 썸네일 로더 끝내기
+void thumb_loader_dispose(ThumbLoader* loader)
+{
+	g_return_if_fail(loader != NULL);
+
+	// 책을 떼면 남은 작업은 읽지 않고 바로 지나간다
+	thumb_loader_set_book(loader, NULL);
+	g_thread_pool_free(loader->pool, false, true);
+	loader->pool = NULL;
+	loader->lookup = NULL;
+
+	thumb_loader_unref(loader);
+}
+
+// 책 바꾸기
+void thumb_loader_set_book(ThumbLoader* loader, Book* book)
+{
+	g_return_if_fail(loader != NULL);
+
+	ThumbSource* source = NULL;
+	if (book != NULL)
+	{
+		source = g_new0(ThumbSource, 1);
+		g_atomic_ref_count_init(&source->ref);
+		source->book = book_ref(book);
+		source->store = thumb_store_open(book->full_name, loader->size);
+	}
+
+	// 하던 작업은 기다리지 않음. 세대가 바뀐 걸 보고 그만두며, 옛 책은 마지막 작업이 놓는다
+	g_mutex_lock(&loader->lock);
+	g_atomic_int_inc(&loader->generation);
+	ThumbSource* old = loader->source;
+	loader->source = source;
+	g_mutex_unlock(&loader->lock);
+
+	thumb_source_unref(old);
+	cache_clear(loader);
+}
+
+// 읽어둔 텍스쳐 찾기 콜백
+void thumb_loader_set_lookup(ThumbLoader* loader, ThumbLookupFunc func, gpointer user_data)
+{
+	g_return_if_fail(loader != NULL);
+	loader->lookup = func;
+	loader->lookup_data = user_data;
+}
+
+// 썸네일 요청
+ThumbRequest* thumb_loader_request(ThumbLoader* loader, int page, GtkPicture* picture)
+{
+	g_return_val_if_fail(loader != NULL && picture != NULL, NULL);
+
+	GdkTexture* texture = g_hash_table_lookup(loader->cache, GINT_TO_POINTER(page));
+	if (texture == NULL && loader->lookup != NULL)
+		texture = loader->lookup(loader->lookup_data, page); // 큰 텍스쳐라 캐시에는 안 넣음
+	gtk_picture_set_paintable(picture, GDK_PAINTABLE(texture));
+	if (texture != NULL || loader->source == NULL)
+		return NULL;
+
+	ThumbRequest* request = g_new0(ThumbRequest, 1);
+	g_atomic_ref_count_init(&request->ref);
+	g_atomic_ref_count_inc(&request->ref); // 하나는 작업이 가짐
+	g_atomic_ref_count_inc(&loader->ref);
+	request->loader = loader;
+	request->page = page;
+	request->generation = loader->generation;
+	request->sequence = ++loader->sequence;
+	request->picture = g_object_ref(picture);
+
+	g_thread_pool_push(loader->pool, request, NULL);
+	return request;
+}
+
+// 썸네일 요청 취소
+void thumb_request_cancel(ThumbRequest* request)
+{
+	if (request == NULL)
+		return;
+	g_atomic_int_set(&request->cancelled, true);
+	thumb_request_unref(request);
+}
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include "book.h"
+
+/**
+ * @file thumb.h
+ * @brief 쪽 썸네일을 백그라운드 스레드에서 만드는 로더를 정의하는 헤더 파일입니다.
+ *        가장 최근에 요청한(= 지금 보이는) 쪽을 먼저 만들고, 스크롤해서 지나간 요청은 취소합니다.
+ */
+
+typedef struct ThumbLoader ThumbLoader;
+typedef struct ThumbRequest ThumbRequest;
+typedef struct ThumbStore ThumbStore;
+
+/**
+ * @brief 이미 읽어둔 쪽 텍스쳐를 찾는 콜백 (읽기 창의 캐시 등)
+ * @param user_data 사용자 데이터
+ * @param page 쪽 번호
+ * @return 텍스쳐 (참조를 넘기지 않음), 없으면 NULL
+ */
+typedef GdkTexture* (*ThumbLookupFunc)(gpointer user_data, int page);
+
+/**
+ * @brief 썸네일 로더를 만듭니다.
+ * @param size 썸네일 긴 쪽 크기
+ * @return ThumbLoader 포인터
+ */
+extern ThumbLoader* thumb_loader_new(int size);
+
+/**
+ * @brief 썸네일 로더를 끝냅니다. 대기 중인 요청은 버리고, 진행 중인 작업이 끝나길 기다립니다.
+ * @param loader ThumbLoader 포인터
+ */
+extern void thumb_loader_dispose(ThumbLoader* loader);
+
+/**
+ * @brief 썸네일을 만들 책을 바꿉니다. 이전 책의 요청은 모두 취소되고 캐시도 비웁니다.
+ *        진행 중인 작업이 끝나길 기다리므로, 책을 해제하기 전에 NULL로 불러야 합니다.
+ * @param loader ThumbLoader 포인터
+ * @param book Book 포인터 (NULL이면 비움)
+ */
+extern void thumb_loader_set_book(ThumbLoader* loader, Book* book);
+
+/**
+ * @brief 이미 읽어둔 쪽 텍스쳐를 찾는 콜백을 설정합니다.
+ * @param loader ThumbLoader 포인터
+ * @param func 콜백
+ * @param user_data 콜백 사용자 데이터
+ */
+extern void thumb_loader_set_lookup(ThumbLoader* loader, ThumbLookupFunc func, gpointer user_data);
+
+/**
+ * @brief 쪽 썸네일을 요청합니다. 만들어지면 picture에 넣습니다.
+ *        캐시에 있으면 바로 넣고 NULL을 반환합니다.
+ * @param loader ThumbLoader 포인터
+ * @param page 쪽 번호
+ * @param picture 썸네일을 넣을 GtkPicture
+ * @return 요청 핸들 (thumb_request_cancel로 해제), 바로 끝났으면 NULL
+ */
+extern ThumbRequest* thumb_loader_request(ThumbLoader* loader, int page, GtkPicture* picture);
+
+/**
+ * @brief 썸네일 요청을 취소하고 핸들을 해제합니다.
+ * @param request ThumbRequest 포인터
+ */
+extern void thumb_request_cancel(ThumbRequest* request);
+
+/**
+ * @brief 책의 썸네일 저장소를 엽니다. 전에 저장한 파일이 있으면 메모리 매핑합니다.
+ *        책 파일의 크기나 수정 시각이 바뀌었으면 저장한 파일을 버립니다.
+ * @param filename 책 파일 경로
+ * @param thumb_size 썸네일 긴 쪽 크기
+ * @return ThumbStore 포인터, 책 파일이 없으면 NULL
+ */
+extern ThumbStore* thumb_store_open(const char* filename, int thumb_size);
+
+/**
+ * @brief 썸네일 저장소를 닫습니다. 새로 넣은 썸네일이 있으면 작업 스레드에서 파일에 씁니다.
+ *        찾기나 넣기를 하는 스레드가 없을 때 불러야 합니다.
+ * @param store ThumbStore 포인터
+ */
+extern void thumb_store_close(ThumbStore* store);
+
+/**
+ * @brief 작업 스레드에서 하고 있는 저장이 모두 끝나길 기다립니다. 프로그램을 끝낼 때 부릅니다.
+ */
+extern void thumb_store_sync(void);
+
+/**
+ * @brief 저장한 썸네일을 찾습니다. 스레드에서 불러도 됩니다.
+ * @param store ThumbStore 포인터
+ * @param page 쪽 번호
+ * @return 인코딩한 썸네일 (g_bytes_unref로 해제), 없으면 NULL
+ */
+extern GBytes* thumb_store_lookup(ThumbStore* store, int page);
+
+/**
+ * @brief 썸네일을 저장소에 넣습니다. 스레드에서 불러도 됩니다.
+ * @param store ThumbStore 포인터
+ * @param page 쪽 번호
+ * @param encoded 인코딩한 썸네일
+ */
+extern void thumb_store_put(ThumbStore* store, int page, GBytes* encoded);
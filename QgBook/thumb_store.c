@@ -0,0 +1,353 @@
+﻿#include "pch.h"
+#include "configs.h"
+#include "thumb.h"
+
+/**
+ * @file thumb_store.c
+ * @brief 책마다 썸네일을 한 파일에 묶어 디스크에 두는 저장소 구현 파일입니다.
+ *        파일은 메모리 매핑으로 읽으므로, 전에 본 책은 원래 쪽을 다시 읽고 줄이지 않아도 됩니다.
+ *
+ *        파일 구조: [헤더][책 경로 (4바이트 정렬)][색인 x count][인코딩한 썸네일 ...]
+ *        책 파일의 크기나 수정 시각, 썸네일 크기가 다르면 버리고 새로 만듭니다.
+ *        파일을 통째로 다시 쓰는 저장은 작업 스레드에서 하고, 끝낼 때 thumb_store_sync로 기다립니다.
+ */
+
+#define THUMB_STORE_MAGIC "QGTH"
+#define THUMB_STORE_VERSION 1
+#define THUMB_STORE_MAX_COUNT 100000
+
+/**
+ * @brief 썸네일 저장 파일 헤더
+ */
+typedef struct ThumbStoreHeader
+{
+	char magic[4];             ///< "QGTH"
+	guint32 version;           ///< 파일 버전
+	gint64 file_size;          ///< 책 파일 크기
+	gint64 file_mtime;         ///< 책 파일 수정 시각
+	guint32 thumb_size;        ///< 썸네일 긴 쪽 크기
+	guint32 name_len;          ///< 책 경로 길이
+	guint32 count;             ///< 색인 개수
+	guint32 reserved;          ///< 예약
+} ThumbStoreHeader;
+
+/**
+ * @brief 썸네일 색인 항목, length가 0이면 없는 쪽
+ */
+typedef struct ThumbStoreIndex
+{
+	guint32 offset;            ///< 파일 처음부터의 위치
+	guint32 length;            ///< 인코딩한 데이터 길이
+} ThumbStoreIndex;
+
+/**
+ * @brief 썸네일 저장소 구조체
+ */
+struct ThumbStore
+{
+	char* path;                ///< 저장 파일 경로
+	char* name;                ///< 책 경로
+	gint64 file_size;          ///< 책 파일 크기
+	gint64 file_mtime;         ///< 책 파일 수정 시각
+	guint32 thumb_size;        ///< 썸네일 긴 쪽 크기
+
+	GMappedFile* mapped;       ///< 매핑한 저장 파일
+	GBytes* bytes;             ///< 매핑 전체 (조각을 나눠 줌)
+	gsize index_pos;           ///< 색인 시작 위치
+	guint32 count;             ///< 색인 개수
+
+	GMutex lock;               ///< added 보호
+	GHashTable* added;         ///< 쪽 번호 -> GBytes, 이번에 새로 만든 썸네일
+};
+
+// 작업 스레드에서 저장하고 있는 저장소 수
+static struct
+{
+	GMutex lock;
+	GCond cond;
+	int pending;
+} s_flush;
+
+/**
+ * @brief 책 경로 뒤에 붙는 채움 길이를 포함한 색인 시작 위치를 구합니다.
+ * @param name_len 책 경로 길이
+ * @return 색인 시작 위치
+ */
+static gsize store_index_pos(gsize name_len)
+{
+	return sizeof(ThumbStoreHeader) + ((name_len + 3) & ~(gsize)3);
+}
+
+/**
+ * @brief 색인 항목 하나를 읽습니다. 매핑이 정렬되어 있다고 기대하지 않고 복사합니다.
+ * @param store ThumbStore 포인터
+ * @param data 매핑 데이터
+ * @param page 쪽 번호
+ * @param entry 읽은 항목
+ */
+static void store_read_index(const ThumbStore* store, const guint8* data, guint32 page, ThumbStoreIndex* entry)
+{
+	memcpy(entry, data + store->index_pos + (gsize)page * sizeof(ThumbStoreIndex), sizeof(ThumbStoreIndex));
+}
+
+/**
+ * @brief 매핑을 풉니다.
+ * @param store ThumbStore 포인터
+ */
+static void store_unmap(ThumbStore* store)
+{
+	g_clear_pointer(&store->bytes, g_bytes_unref);
+	g_clear_pointer(&store->mapped, g_mapped_file_unref);
+	store->count = 0;
+}
+
+/**
+ * @brief 저장 파일을 매핑하고 책과 맞는지 확인합니다. 맞지 않는 파일은 지웁니다.
+ * @param store ThumbStore 포인터
+ */
+static void store_map(ThumbStore* store)
+{
+	GMappedFile* mapped = g_mapped_file_new(store->path, FALSE, NULL);
+	if (mapped == NULL)
+		return;
+
+	const gsize size = g_mapped_file_get_length(mapped);
+	const guint8* data = (const guint8*)g_mapped_file_get_contents(mapped);
+	ThumbStoreHeader header;
+	bool ok = size >= sizeof(header);
+	if (ok)
+	{
+		memcpy(&header, data, sizeof(header));
+		ok = memcmp(header.magic, THUMB_STORE_MAGIC, sizeof(header.magic)) == 0 &&
+			header.version == THUMB_STORE_VERSION &&
+			header.file_size == store->file_size &&
+			header.file_mtime == store->file_mtime &&
+			header.thumb_size == store->thumb_size &&
+			header.count <= THUMB_STORE_MAX_COUNT &&
+			header.name_len == strlen(store->name) &&
+			store_index_pos(header.name_len) + (gsize)header.count * sizeof(ThumbStoreIndex) <= size &&
+			memcmp(data + sizeof(header), store->name, header.name_len) == 0;
+	}
+
+	if (ok)
+	{
+		store->mapped = mapped;
+		store->bytes = g_mapped_file_get_bytes(mapped);
+		store->index_pos = store_index_pos(header.name_len);
+		store->count = header.count;
+
+		// 색인이 파일 밖을 가리키면 통째로 버림
+		for (guint32 i = 0; i < store->count; i++)
+		{
+			ThumbStoreIndex entry;
+			store_read_index(store, data, i, &entry);
+			if (entry.length > 0 && (gsize)entry.offset + entry.length > size)
+			{
+				ok = false;
+				break;
+			}
+		}
+		if (ok)
+			return;
+		store_unmap(store);
+	}
+	else
+		g_mapped_file_unref(mapped);
+
+	g_log("THUMB", G_LOG_LEVEL_DEBUG, "Stale thumbnail store: %s", store->path);
+	g_remove(store->path);
+}
+
+/**
+ * @brief 새로 만든 썸네일을 합쳐서 저장 파일을 다시 씁니다.
+ * @param store ThumbStore 포인터
+ */
+static void store_flush(ThumbStore* store)
+{
+	if (g_hash_table_size(store->added) == 0)
+		return;
+
+	guint32 count = store->count;
+	GHashTableIter iter;
+	gpointer key;
+	g_hash_table_iter_init(&iter, store->added);
+	while (g_hash_table_iter_next(&iter, &key, NULL))
+		count = MAX(count, (guint32)GPOINTER_TO_INT(key) + 1);
+
+	const size_t name_len = strlen(store->name);
+	ThumbStoreHeader header = {
+		.version = THUMB_STORE_VERSION,
+		.file_size = store->file_size,
+		.file_mtime = store->file_mtime,
+		.thumb_size = store->thumb_size,
+		.name_len = (guint32)name_len,
+		.count = count,
+	};
+	memcpy(header.magic, THUMB_STORE_MAGIC, sizeof(header.magic));
+
+	const gsize index_pos = store_index_pos(name_len);
+	GByteArray* ba = g_byte_array_sized_new((guint)(index_pos + count * sizeof(ThumbStoreIndex)));
+	g_byte_array_append(ba, (const guint8*)&header, sizeof(header));
+	g_byte_array_append(ba, (const guint8*)store->name, (guint)name_len);
+	g_byte_array_set_size(ba, (guint)(index_pos + count * sizeof(ThumbStoreIndex)));
+	memset(ba->data + sizeof(header) + name_len, 0, ba->len - sizeof(header) - name_len);
+
+	const guint8* mapped = store->bytes ? g_bytes_get_data(store->bytes, NULL) : NULL;
+	for (guint32 i = 0; i < count; i++)
+	{
+		const guint8* data = NULL;
+		gsize len = 0;
+		GBytes* added = g_hash_table_lookup(store->added, GINT_TO_POINTER(i));
+		if (added != NULL)
+			data = g_bytes_get_data(added, &len);
+		else if (i < store->count)
+		{
+			ThumbStoreIndex old;
+			store_read_index(store, mapped, i, &old);
+			data = mapped + old.offset;
+			len = old.length;
+		}
+		if (len == 0 || ba->len + len > G_MAXUINT32)
+			continue;
+
+		const ThumbStoreIndex entry = { .offset = ba->len, .length = (guint32)len };
+		memcpy(ba->data + index_pos + (gsize)i * sizeof(entry), &entry, sizeof(entry));
+		g_byte_array_append(ba, data, (guint)len);
+	}
+
+	// 매핑을 먼저 풀어야 윈도우에서 파일을 바꿔 쓸 수 있음
+	store_unmap(store);
+	g_hash_table_remove_all(store->added);
+
+	char* dir = g_path_get_dirname(store->path);
+	g_mkdir_with_parents(dir, 0755);
+	g_free(dir);
+
+	GError* error = NULL;
+	if (!g_file_set_contents(store->path, (const char*)ba->data, ba->len, &error))
+	{
+		g_log("THUMB", G_LOG_LEVEL_WARNING, _("Failed to save thumbnail store: %s"), error->message);
+		g_clear_error(&error);
+	}
+	g_byte_array_free(ba, true);
+}
+
+// 썸네일 저장소 열기
+ThumbStore* thumb_store_open(const char* filename, int thumb_size)
+{
+	g_return_val_if_fail(filename != NULL, NULL);
+
+	GStatBuf st;
+	if (g_stat(filename, &st) != 0)
+		return NULL;
+
+	ThumbStore* store = g_new0(ThumbStore, 1);
+	store->name = g_strdup(filename);
+	store->file_size = (gint64)st.st_size;
+	store->file_mtime = (gint64)st.st_mtime;
+	store->thumb_size = (guint32)thumb_size;
+	g_mutex_init(&store->lock);
+	store->added = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)g_bytes_unref);
+
+	char* hash = g_compute_checksum_for_string(G_CHECKSUM_SHA1, filename, -1);
+	char* base = g_strconcat(hash, ".qgt", NULL);
+	store->path = g_build_filename(config_get_app_path(), "thumbs", base, NULL);
+	g_free(base);
+	g_free(hash);
+
+	store_map(store);
+	return store;
+}
+
+/**
+ * @brief 저장소를 해제합니다.
+ * @param store ThumbStore 포인터
+ */
+static void store_free(ThumbStore* store)
+{
+	store_unmap(store);
+	g_hash_table_destroy(store->added);
+	g_mutex_clear(&store->lock);
+	g_free(store->name);
+	g_free(store->path);
+	g_free(store);
+}
+
+/**
+ * @brief 작업 스레드에서 저장소를 저장하고 해제합니다.
+ */
+static void thread_store_flush(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	ThumbStore* store = task_data;
+	store_flush(store);
+	store_free(store);
+
+	g_mutex_lock(&s_flush.lock);
+	s_flush.pending--;
+	g_cond_broadcast(&s_flush.cond);
+	g_mutex_unlock(&s_flush.lock);
+}
+
+// 썸네일 저장소 닫기
+void thumb_store_close(ThumbStore* store)
+{
+	if (store == NULL)
+		return;
+	if (g_hash_table_size(store->added) == 0)
+	{
+		store_free(store);
+		return;
+	}
+
+	// 책을 바꿀 때마다 불리므로 파일을 다시 쓰는 일은 작업 스레드에서
+	g_mutex_lock(&s_flush.lock);
+	s_flush.pending++;
+	g_mutex_unlock(&s_flush.lock);
+
+	GTask* task = g_task_new(NULL, NULL, NULL, NULL);
+	g_task_set_task_data(task, store, NULL);
+	g_task_run_in_thread(task, thread_store_flush);
+	g_object_unref(task);
+}
+
+// 저장 끝나길 기다리기
+void thumb_store_sync(void)
+{
+	g_mutex_lock(&s_flush.lock);
+	while (s_flush.pending > 0)
+		g_cond_wait(&s_flush.cond, &s_flush.lock);
+	g_mutex_unlock(&s_flush.lock);
+}
+
+// 저장한 썸네일 찾기
+GBytes* thumb_store_lookup(ThumbStore* store, int page)
+{
+	g_return_val_if_fail(store != NULL, NULL);
+
+	g_mutex_lock(&store->lock);
+	GBytes* added = g_hash_table_lookup(store->added, GINT_TO_POINTER(page));
+	if (added != NULL)
+		g_bytes_ref(added);
+	g_mutex_unlock(&store->lock);
+	if (added != NULL)
+		return added;
+
+	if (store->bytes == NULL || page < 0 || (guint32)page >= store->count)
+		return NULL;
+	ThumbStoreIndex entry;
+	store_read_index(store, g_bytes_get_data(store->bytes, NULL), (guint32)page, &entry);
+	if (entry.length == 0)
+		return NULL;
+	return g_bytes_new_from_bytes(store->bytes, entry.offset, entry.length);
+}
+
+// 썸네일 저장
+void thumb_store_put(ThumbStore* store, int page, GBytes* encoded)
+{
+	g_return_if_fail(store != NULL && encoded != NULL && page >= 0);
+
+	g_mutex_lock(&store->lock);
+	if (!g_hash_table_contains(store->added, GINT_TO_POINTER(page)))
+		g_hash_table_insert(store->added, GINT_TO_POINTER(page), g_bytes_ref(encoded));
+	g_mutex_unlock(&store->lock);
+}
@@ -0,0 +1,426 @@
+﻿#include "pch.h"
+#include "bufpool.h"
+#include "decoder.h"
+#include "tiled.h"
+
+/**
+ * @file tiled.c
+ * @brief 아주 긴 그림을 타일로 나눠 보이는 타일만 푸는 타일 그림 구현 파일입니다.
+ *        타일은 TILE_SIZE 높이의 띠로 묶어서 줄 디코더로 한번에 풀고, 띠 버퍼를 가로 타일들이 나눠 씁니다.
+ *        푸는 일은 작업 하나가 보이는 띠부터 차례로 하고, 결과는 메인 스레드에서 넣습니다.
+ */
+
+#define TILE_SIZE 1024 // 타일 한 변 (띠 높이)
+#define TILE_GIANT_SIZE 8192 // 긴 변이 이보다 크면 타일로
+#define TILE_KEEP_BANDS 1 // 보이는 띠 위아래로 남기고 미리 풀 띠 수
+#define TILE_SHRINK_MAX 8 // 줄여 보일 때 줄여 푸는 가장 큰 배수
+
+/**
+ * @brief 띠 상태
+ */
+typedef enum TileState
+{
+	TILE_EMPTY,                ///< 안 풀림
+	TILE_PENDING,              ///< 푸는 중이거나 넣기를 기다림
+	TILE_READY,                ///< 올라와 있음
+	TILE_FAILED,               ///< 풀지 못함 (다시 하지 않음)
+} TileState;
+
+/**
+ * @brief 타일 그림 구조체
+ */
+struct TiledImage
+{
+	gatomicrefcount ref;       ///< 참조 수 (작업과 넣기가 하나씩 가짐)
+	GBytes* data;              ///< 그림 파일 데이터
+	ImageInfo info;            ///< 그림 정보
+	int bands;                 ///< 띠 수
+	int columns;               ///< 가로 타일 수
+
+	GdkTexture** tiles;        ///< bands * columns 타일 (메인 스레드 전용)
+	gint* states;              ///< 띠마다 TileState (atomic)
+	size_t* sizes;             ///< 띠마다 올라온 크기 (메인 스레드 전용)
+	size_t resident;           ///< 올라와 있는 타일 크기 (메인 스레드 전용)
+
+	GMutex lock;               ///< view_*, shrink, running 보호
+	int view_first;            ///< 보이는 첫 띠
+	int view_last;             ///< 보이는 끝 띠 (포함, 없으면 view_first보다 작음)
+	int shrink;                ///< 줄여 푸는 배수, 보기 배율에서 고름
+	bool running;              ///< 작업 중
+	GCancellable* cancellable; ///< 해제하면 취소
+
+	DecodeRows* rows;          ///< 줄 디코더 (작업 스레드 전용)
+	int rows_shrink;           ///< 줄 디코더를 연 배수 (작업 스레드 전용)
+
+	TiledUpdateFunc update;    ///< 타일이 올라오면 부를 콜백
+	gpointer update_data;      ///< 콜백 사용자 데이터
+};
+
+/**
+ * @brief 작업이 메인 스레드로 넘기는 띠 하나
+ */
+typedef struct TileDelivery
+{
+	TiledImage* image;         ///< 타일 그림 (참조)
+	int band;                  ///< 띠 번호
+	int shrink;                ///< 줄여 푼 배수
+	size_t size;               ///< 띠 크기
+	GdkTexture* tiles[];       ///< 가로 타일들
+} TileDelivery;
+
+/**
+ * @brief 참조를 놓습니다. 마지막이면 해제합니다. 타일 텍스쳐를 놓으므로 메인 스레드에서 부를 것
+ * @param image 타일 그림
+ */
+static void tiled_image_unref(TiledImage* image)
+{
+	if (!g_atomic_ref_count_dec(&image->ref))
+		return;
+	for (int i = 0; i < image->bands * image->columns; i++)
+	{
+		if (image->tiles[i])
+			g_object_unref(image->tiles[i]);
+	}
+	g_free(image->tiles);
+	g_free(image->states);
+	g_free(image->sizes);
+	decoder_rows_close(image->rows);
+	g_object_unref(image->cancellable);
+	g_mutex_clear(&image->lock);
+	g_bytes_unref(image->data);
+	g_free(image);
+}
+
+/**
+ * @brief 띠가 남길 범위(보이는 띠 ± TILE_KEEP_BANDS) 안에 있는지 알아봅니다. 잠그고 부를 것
+ */
+static bool band_in_keep(const TiledImage* image, int band)
+{
+	return image->view_last >= image->view_first &&
+		band >= image->view_first - TILE_KEEP_BANDS && band <= image->view_last + TILE_KEEP_BANDS;
+}
+
+/**
+ * @brief 띠 하나의 타일을 버립니다. (메인 스레드)
+ */
+static void drop_band(TiledImage* image, int band)
+{
+	GdkTexture** tiles = image->tiles + (gsize)band * image->columns;
+	for (int c = 0; c < image->columns; c++)
+		g_clear_object(&tiles[c]);
+	image->resident -= image->sizes[band];
+	image->sizes[band] = 0;
+	g_atomic_int_set(&image->states[band], TILE_EMPTY);
+}
+
+static void start_work(TiledImage* image);
+
+/**
+ * @brief 메인 스레드에서 풀린 띠를 넣습니다. 그 사이에 멀어졌거나 배율이 바뀐 띠는 버립니다.
+ * @param data TileDelivery 포인터
+ * @return G_SOURCE_REMOVE
+ */
+static gboolean idle_tile_deliver(gpointer data)
+{
+	TileDelivery* delivery = data;
+	TiledImage* image = delivery->image;
+
+	g_mutex_lock(&image->lock);
+	const bool alive = !g_cancellable_is_cancelled(image->cancellable);
+	const bool wanted = alive && band_in_keep(image, delivery->band);
+	const bool keep = wanted && delivery->shrink == image->shrink;
+	g_mutex_unlock(&image->lock);
+
+	if (keep)
+	{
+		memcpy(image->tiles + (gsize)delivery->band * image->columns, delivery->tiles, sizeof(GdkTexture*) * image->columns);
+		image->sizes[delivery->band] = delivery->size;
+		image->resident += delivery->size;
+		g_atomic_int_set(&image->states[delivery->band], TILE_READY);
+		if (image->update)
+			image->update(image, image->update_data);
+	}
+	else
+	{
+		for (int c = 0; c < image->columns; c++)
+			g_object_unref(delivery->tiles[c]);
+		g_atomic_int_set(&image->states[delivery->band], TILE_EMPTY);
+		if (wanted)
+			start_work(image); // 옛 배율로 푼 띠는 새 배율로 다시
+	}
+
+	tiled_image_unref(image);
+	g_free(delivery);
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief 띠 하나를 풀어서 가로 타일로 나눕니다. (작업 스레드)
+ * @return 넘길 띠, 실패하면 NULL
+ */
+static TileDelivery* decode_band(TiledImage* image, int band, int shrink, GCancellable* cancellable)
+{
+	// 배율이 바뀌었으면 줄 디코더를 새 배율로 다시 연다
+	if (image->rows != NULL && image->rows_shrink != shrink)
+	{
+		decoder_rows_close(image->rows);
+		image->rows = NULL;
+	}
+	if (image->rows == NULL)
+	{
+		image->rows = decoder_rows_open(image->data, &image->info, shrink);
+		image->rows_shrink = shrink;
+	}
+	if (image->rows == NULL)
+		return NULL;
+
+	// 띠와 타일은 원래 좌표로 나누고, 줄여 풀면 타일 텍스쳐만 작아진다
+	int bpp, rows_width, rows_height;
+	const GdkMemoryFormat format = decoder_rows_get_format(image->rows, &bpp);
+	decoder_rows_get_size(image->rows, &rows_width, &rows_height);
+	const int tile = TILE_SIZE / shrink;
+	const int top = band * tile;
+	const int count = MIN(tile, rows_height - top);
+	const gsize stride = (gsize)rows_width * (gsize)bpp;
+	gpointer pixels;
+	GBytes* bytes = bufpool_bytes_new(stride * (gsize)count, &pixels);
+	if (!decoder_rows_read(image->rows, top, count, pixels, stride, cancellable))
+	{
+		g_bytes_unref(bytes);
+		return NULL;
+	}
+
+	// 가로 타일은 띠 버퍼를 나눠 쓴다
+	TileDelivery* delivery = g_malloc(sizeof(TileDelivery) + sizeof(GdkTexture*) * image->columns);
+	delivery->band = band;
+	delivery->shrink = shrink;
+	delivery->size = stride * (gsize)count;
+	for (int c = 0; c < image->columns; c++)
+	{
+		const int x = c * tile;
+		const int width = MIN(tile, rows_width - x);
+		GBytes* part = image->columns == 1 ? g_bytes_ref(bytes) :
+			g_bytes_new_from_bytes(bytes, (gsize)x * bpp, stride * (gsize)(count - 1) + (gsize)width * bpp);
+		delivery->tiles[c] = gdk_memory_texture_new(width, count, format, part, stride);
+		g_bytes_unref(part);
+	}
+	g_bytes_unref(bytes);
+	return delivery;
+}
+
+/**
+ * @brief 다음에 풀 띠를 고릅니다. 보이는 띠를 위에서부터, 그 다음 아래, 위 순서. 잠그고 부를 것
+ * @return 띠 번호, 없으면 -1
+ */
+static int pick_band(TiledImage* image)
+{
+	if (image->view_last < image->view_first)
+		return -1;
+	const int first = MAX(image->view_first - TILE_KEEP_BANDS, 0);
+	const int last = MIN(image->view_last + TILE_KEEP_BANDS, image->bands - 1);
+	for (int pass = 0; pass < 3; pass++)
+	{
+		const int from = pass == 0 ? image->view_first : pass == 1 ? image->view_last + 1 : first;
+		const int to = pass == 0 ? image->view_last : pass == 1 ? last : image->view_first - 1;
+		for (int b = from; b <= to; b++)
+		{
+			if (g_atomic_int_compare_and_exchange(&image->states[b], TILE_EMPTY, TILE_PENDING))
+				return b;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief 작업 함수. 모자란 띠가 없을 때까지 풉니다.
+ */
+static void thread_tiled_work(GTask* task, gpointer source_object, gpointer task_data, GCancellable* cancellable)
+{
+	TiledImage* image = task_data;
+	for (;;)
+	{
+		g_mutex_lock(&image->lock);
+		const int band = g_cancellable_is_cancelled(cancellable) ? -1 : pick_band(image);
+		const int shrink = image->shrink;
+		if (band < 0)
+		{
+			// 다 풀어 둔 디코더는 메모리를 많이 잡으니 바로 닫는다, 다음 작업이 쓰기 전에
+			if (image->rows != NULL && decoder_rows_is_buffered(image->rows))
+			{
+				decoder_rows_close(image->rows);
+				image->rows = NULL;
+			}
+			image->running = false;
+		}
+		g_mutex_unlock(&image->lock);
+		if (band < 0)
+			break;
+
+		TileDelivery* delivery = decode_band(image, band, shrink, cancellable);
+		if (delivery == NULL)
+		{
+			// 취소면 다시 풀 수 있게, 아니면 다시 하지 않게
+			g_atomic_int_set(&image->states[band], g_cancellable_is_cancelled(cancellable) ? TILE_EMPTY : TILE_FAILED);
+			continue;
+		}
+		g_atomic_ref_count_inc(&image->ref);
+		delivery->image = image;
+		g_idle_add(idle_tile_deliver, delivery);
+	}
+	g_task_return_boolean(task, true);
+}
+
+/**
+ * @brief 작업이 끝나면 메인 스레드에서 작업이 가졌던 참조를 놓습니다.
+ */
+static void cb_tiled_work_finish(GObject* source_object, GAsyncResult* res, gpointer user_data)
+{
+	tiled_image_unref(user_data);
+}
+
+/**
+ * @brief 작업 중이 아니고 보이는 띠가 있으면 작업을 시작합니다. (메인 스레드)
+ */
+static void start_work(TiledImage* image)
+{
+	g_mutex_lock(&image->lock);
+	const bool start = !image->running && image->view_last >= image->view_first &&
+		!g_cancellable_is_cancelled(image->cancellable);
+	if (start)
+		image->running = true;
+	g_mutex_unlock(&image->lock);
+	if (!start)
+		return;
+
+	// 작업 데이터는 작업 스레드에서 놓일 수 있으므로, 참조는 끝 콜백에서 놓는다
+	g_atomic_ref_count_inc(&image->ref);
+	GTask* task = g_task_new(NULL, image->cancellable, cb_tiled_work_finish, image);
+	g_task_set_task_data(task, image, NULL);
+	g_task_run_in_thread(task, thread_tiled_work);
+	g_object_unref(task);
+}
+
+// 타일로 풀 그림인가
+bool tiled_image_wanted(const ImageInfo* info)
+{
+	return !info->has_anim && (info->width > TILE_GIANT_SIZE || info->height > TILE_GIANT_SIZE);
+}
+
+// 타일 그림 만들기
+TiledImage* tiled_image_new(GBytes* data, const ImageInfo* info, TiledUpdateFunc func, gpointer user_data)
+{
+	g_return_val_if_fail(data != NULL && info != NULL && info->width > 0 && info->height > 0, NULL);
+
+	TiledImage* image = g_new0(TiledImage, 1);
+	g_atomic_ref_count_init(&image->ref);
+	image->data = g_bytes_ref(data);
+	image->info = *info;
+	image->bands = (info->height + TILE_SIZE - 1) / TILE_SIZE;
+	image->columns = (info->width + TILE_SIZE - 1) / TILE_SIZE;
+	image->tiles = g_new0(GdkTexture*, (gsize)image->bands * image->columns);
+	image->states = g_new0(gint, image->bands);
+	image->sizes = g_new0(size_t, image->bands);
+	g_mutex_init(&image->lock);
+	image->view_first = 0;
+	image->view_last = -1;
+	image->shrink = 1;
+	image->cancellable = g_cancellable_new();
+	image->update = func;
+	image->update_data = user_data;
+	return image;
+}
+
+// 타일 그림 해제
+void tiled_image_free(TiledImage* image)
+{
+	if (image == NULL)
+		return;
+	image->update = NULL;
+	g_cancellable_cancel(image->cancellable);
+	tiled_image_unref(image);
+}
+
+// 보이는 줄 범위
+void tiled_image_set_view(TiledImage* image, int top, int bottom, double scale)
+{
+	g_return_if_fail(image != NULL);
+
+	const int first = CLAMP(top, 0, image->info.height) / TILE_SIZE;
+	const int last = (CLAMP(bottom, 0, image->info.height) - 1) / TILE_SIZE;
+
+	// 줄여 보이면 화면 픽셀보다 작아지지 않는 만큼 줄여 푼다
+	int shrink = 1;
+	while (shrink < TILE_SHRINK_MAX && scale * shrink * 2 <= 1.0)
+		shrink *= 2;
+
+	g_mutex_lock(&image->lock);
+	const bool rescale = shrink != image->shrink;
+	const bool changed = rescale || first != image->view_first || last != image->view_last;
+	image->view_first = first;
+	image->view_last = last;
+	image->shrink = shrink;
+	g_mutex_unlock(&image->lock);
+
+	if (!changed)
+		return;
+
+	// 멀어진 띠는 버린다, 배율이 바뀌었으면 모두 버리고 새 배율로 다시 푼다
+	for (int b = 0; b < image->bands; b++)
+	{
+		if ((rescale || !band_in_keep(image, b)) && g_atomic_int_get(&image->states[b]) == TILE_READY)
+			drop_band(image, b);
+	}
+
+	start_work(image);
+}
+
+// 올라와 있는 타일 모두 버리기
+void tiled_image_trim(TiledImage* image)
+{
+	g_return_if_fail(image != NULL);
+
+	g_mutex_lock(&image->lock);
+	image->view_first = 0;
+	image->view_last = -1;
+	g_mutex_unlock(&image->lock);
+
+	for (int b = 0; b < image->bands; b++)
+	{
+		if (g_atomic_int_get(&image->states[b]) == TILE_READY)
+			drop_band(image, b);
+	}
+}
+
+// 올라와 있는 타일 크기
+size_t tiled_image_get_resident_size(const TiledImage* image)
+{
+	return image ? image->resident : 0;
+}
+
+// 보이는 타일 그리기
+void tiled_image_snapshot(TiledImage* image, GtkSnapshot* snapshot, float x, float y, float scale, int top, int bottom)
+{
+	g_return_if_fail(image != NULL);
+
+	static const GdkRGBA empty_color = { 0.1f, 0.1f, 0.1f, 1.0f };
+	const int first = CLAMP(top, 0, image->info.height) / TILE_SIZE;
+	const int last = (CLAMP(bottom, 0, image->info.height) - 1) / TILE_SIZE;
+	for (int b = first; b <= last; b++)
+	{
+		const int band_top = b * TILE_SIZE;
+		const int band_height = MIN(TILE_SIZE, image->info.height - band_top);
+		GdkTexture** tiles = image->tiles + (gsize)b * image->columns;
+		for (int c = 0; c < image->columns; c++)
+		{
+			const int tile_left = c * TILE_SIZE;
+			const int tile_width = MIN(TILE_SIZE, image->info.width - tile_left);
+			const graphene_rect_t rect = GRAPHENE_RECT_INIT(
+				x + (float)tile_left * scale, y + (float)band_top * scale,
+				(float)tile_width * scale, (float)band_height * scale);
+			if (tiles[c])
+				gtk_snapshot_append_texture(snapshot, tiles[c], &rect);
+			else
+				gtk_snapshot_append_color(snapshot, &empty_color, &rect);
+		}
+	}
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "defs.h"
+
+/**
+ * @file tiled.h
+ * @brief 아주 긴 그림(웹툰 한 줄 그림 등)을 고정 크기 타일로 나눠서 보이는 타일만 푸는 타일 그림을 정의하는 헤더 파일입니다.
+ *        통째로 텍스쳐를 만들면 GL 최대 텍스쳐 크기를 넘고 수백 MB를 잡으므로,
+ *        위에서부터 줄 디코더로 띠를 풀어 타일 텍스쳐를 만들고, 화면에서 멀어진 타일은 버립니다.
+ *        작업 스레드 말고는 모두 메인 스레드에서 부를 것
+ */
+
+typedef struct TiledImage TiledImage;
+
+/**
+ * @brief 타일이 올라오면 메인 스레드에서 부르는 콜백
+ * @param image 타일 그림
+ * @param user_data 사용자 데이터
+ */
+typedef void (*TiledUpdateFunc)(TiledImage* image, gpointer user_data);
+
+/**
+ * @brief 타일로 나눠 풀어야 할 그림인지 알아봅니다.
+ * @param info 그림 정보
+ * @return 긴 변이 GL 최대 텍스쳐 크기를 넘을 수 있으면 true
+ */
+extern bool tiled_image_wanted(const ImageInfo* info);
+
+/**
+ * @brief 타일 그림을 만듭니다. 타일은 tiled_image_set_view로 보이는 곳을 알려줄 때 풉니다.
+ * @param data 그림 파일 데이터 (참조를 가짐)
+ * @param info 그림 정보
+ * @param func 타일이 올라오면 부를 콜백
+ * @param user_data 콜백 사용자 데이터
+ * @return 타일 그림
+ */
+extern TiledImage* tiled_image_new(GBytes* data, const ImageInfo* info, TiledUpdateFunc func, gpointer user_data);
+
+/**
+ * @brief 타일 그림을 해제합니다. 진행 중인 작업은 취소하고, 콜백은 더 부르지 않습니다.
+ * @param image 타일 그림 (NULL 가능)
+ */
+extern void tiled_image_free(TiledImage* image);
+
+/**
+ * @brief 보이는 줄 범위를 알려줍니다. 범위에서 멀어진 타일은 버리고, 모자란 타일은 위에서부터 풀기 시작합니다.
+ *        줄여 보이면 배율에 맞게 줄여 풀고, 배율이 바뀌면 올라와 있는 타일을 버리고 다시 풉니다.
+ * @param image 타일 그림
+ * @param top 보이는 첫 줄 (그림 좌표)
+ * @param bottom 보이는 끝 줄 (그림 좌표, 포함하지 않음)
+ * @param scale 그림 배율 (화면 픽셀 / 그림 픽셀)
+ */
+extern void tiled_image_set_view(TiledImage* image, int top, int bottom, double scale);
+
+/**
+ * @brief 올라와 있는 타일을 모두 버립니다. 다음 tiled_image_set_view에서 다시 풉니다.
+ * @param image 타일 그림
+ */
+extern void tiled_image_trim(TiledImage* image);
+
+/**
+ * @brief 올라와 있는 타일의 크기를 얻습니다. 쪽 캐시는 이 크기로 셉니다.
+ * @param image 타일 그림
+ * @return 크기(바이트)
+ */
+extern size_t tiled_image_get_resident_size(const TiledImage* image);
+
+/**
+ * @brief 보이는 타일을 그립니다. 아직 안 풀린 타일 자리는 어둡게 칠합니다.
+ * @param image 타일 그림
+ * @param snapshot 스냅샷
+ * @param x 그림 왼쪽 (화면 좌표)
+ * @param y 그림 위쪽 (화면 좌표)
+ * @param scale 그림 배율
+ * @param top 그릴 첫 줄 (그림 좌표)
+ * @param bottom 그릴 끝 줄 (그림 좌표, 포함하지 않음)
+ */
+extern void tiled_image_snapshot(TiledImage* image, GtkSnapshot* snapshot, float x, float y, float scale, int top, int bottom);